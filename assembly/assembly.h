@@ -1,10 +1,263 @@
 #pragma once
 
-#include "assembly/particle.h"
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "assembly/field.h"
+#include "assembly/force_accumulator.h"
+#include "assembly/pose_hierarchy.h"
+#include "glog/logging.h"
 
 namespace ndyn::assembly {
 
-template <typename Algebra>
-struct Assembly final {};
+/**
+ * The particles of a simulation, stored as a flat tree in structure-of-arrays form.
+ *
+ * Each particle has a parent (or none, for a root), a local pose relative to its parent, a
+ * velocity, the generator V for which motor_exp(V * dt) * pose advances the local pose by dt, a
+ * coupling to fields, an acceleration accumulated over the current step, and a handle to its
+ * worldline in whatever store the caller keeps them. Every attribute lives in its own contiguous
+ * array indexed by ParticleId, so each per-step pass -- world-pose propagation, force
+ * accumulation, integration -- is a linear scan that touches only the arrays it needs.
+ *
+ * Particles must be added parents first. sort_breadth_first() then reorders them so that each
+ * level of the tree, and each particle's children, are contiguous; parents always precede their
+ * children, so world poses propagate in a single top-down scan either way.
+ *
+ * A typical step:
+ *
+ *   assembly.update_world_poses();
+ *   assembly.clear_accelerations();
+ *   assembly.accumulate(field);  // and/or connections, through a ForceAccumulator
+ *   assembly.integrate(dt);
+ */
+template <typename Geometry>
+class Assembly final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using ParticleId = typename PoseHierarchy<Geometry>::NodeId;
+  using WorldlineHandle = size_t;
+
+  static constexpr ParticleId NO_PARENT{PoseHierarchy<Geometry>::NO_PARENT};
+  static constexpr WorldlineHandle NO_WORLDLINE{std::numeric_limits<WorldlineHandle>::max()};
+
+ private:
+  // Parents, local poses and world poses, with dirty tracking.
+  PoseHierarchy<Geometry> poses_{};
+  std::vector<Multivector> velocities_{};
+  std::vector<Multivector> couplings_{};
+  std::vector<Multivector> accelerations_{};
+  std::vector<WorldlineHandle> worldlines_{};
+  // Scratch for batched field evaluations.
+  std::vector<Multivector> field_values_{};
+
+  void check_particle(ParticleId particle) const {
+    LOG_IF(FATAL, particle >= size()) << "Unknown particle " << particle << ".";
+  }
+
+  template <typename T>
+  static void permute(std::vector<T>& values, const std::vector<ParticleId>& order) {
+    std::vector<T> permuted;
+    permuted.reserve(values.size());
+    for (const ParticleId old_id : order) {
+      permuted.push_back(std::move(values[old_id]));
+    }
+    values = std::move(permuted);
+  }
+
+ public:
+  void reserve(size_t count) {
+    poses_.reserve(count);
+    velocities_.reserve(count);
+    couplings_.reserve(count);
+    accelerations_.reserve(count);
+    worldlines_.reserve(count);
+  }
+
+  /**
+   * Adds a particle below parent, or a root if parent is NO_PARENT, at rest in the given local
+   * pose, and returns its id. The parent must already exist.
+   */
+  ParticleId add(ParticleId parent,
+                 const Multivector& local_pose = Multivector{static_cast<ScalarType>(1)},
+                 const Multivector& coupling = {}, WorldlineHandle worldline = NO_WORLDLINE) {
+    const ParticleId particle{poses_.add(parent, local_pose)};
+    velocities_.emplace_back();
+    couplings_.push_back(coupling);
+    accelerations_.emplace_back();
+    worldlines_.push_back(worldline);
+    return particle;
+  }
+
+  /**
+   * Reorders the particles breadth-first: roots first, in their current order, then each level of
+   * the tree with every particle's children contiguous and in their current relative order.
+   * Returns the new id of each old id. World poses must be updated again afterwards.
+   */
+  std::vector<ParticleId> sort_breadth_first() {
+    const size_t count{size()};
+    const std::span<const ParticleId> parents{poses_.parents()};
+
+    // Children of each particle in compressed form: children of p are
+    // children[first_child[p]] .. children[first_child[p + 1] - 1].
+    std::vector<size_t> first_child(count + 1, 0);
+    for (const ParticleId parent : parents) {
+      if (parent != NO_PARENT) ++first_child[parent + 1];
+    }
+    for (size_t i = 0; i < count; ++i) {
+      first_child[i + 1] += first_child[i];
+    }
+    std::vector<ParticleId> children(first_child.back());
+    std::vector<size_t> next_child(first_child.begin(), first_child.end() - 1);
+    for (ParticleId particle = 0; particle < count; ++particle) {
+      if (parents[particle] != NO_PARENT) children[next_child[parents[particle]]++] = particle;
+    }
+
+    // order[new_id] is the old id; the order vector doubles as the breadth-first queue.
+    std::vector<ParticleId> order;
+    order.reserve(count);
+    for (ParticleId particle = 0; particle < count; ++particle) {
+      if (parents[particle] == NO_PARENT) order.push_back(particle);
+    }
+    for (size_t head = 0; head < order.size(); ++head) {
+      const ParticleId particle{order[head]};
+      order.insert(order.end(), children.begin() + first_child[particle],
+                   children.begin() + first_child[particle + 1]);
+    }
+
+    std::vector<ParticleId> new_id(count);
+    for (size_t i = 0; i < count; ++i) {
+      new_id[order[i]] = i;
+    }
+
+    PoseHierarchy<Geometry> poses;
+    poses.reserve(count);
+    for (const ParticleId old_id : order) {
+      const ParticleId parent{parents[old_id]};
+      poses.add(parent == NO_PARENT ? NO_PARENT : new_id[parent], poses_.local_pose(old_id));
+    }
+    poses_ = std::move(poses);
+    permute(velocities_, order);
+    permute(couplings_, order);
+    permute(accelerations_, order);
+    permute(worldlines_, order);
+
+    return new_id;
+  }
+
+  /**
+   * Whether the particles are in breadth-first order, as sort_breadth_first() leaves them: roots
+   * first, then the parent ids never decrease.
+   */
+  bool is_breadth_first() const noexcept {
+    const std::span<const ParticleId> parents{poses_.parents()};
+    size_t i{0};
+    while (i < parents.size() && parents[i] == NO_PARENT) ++i;
+    for (++i; i < parents.size(); ++i) {
+      if (parents[i] == NO_PARENT || parents[i] < parents[i - 1]) return false;
+    }
+    return true;
+  }
+
+  /**
+   * Propagates changed local poses to the world poses in one top-down scan. Returns the number of
+   * world poses recomputed.
+   */
+  size_t update_world_poses() { return poses_.update(); }
+
+  void clear_accelerations() noexcept {
+    for (Multivector& acceleration : accelerations_) {
+      acceleration = Multivector{};
+    }
+  }
+
+  void add_acceleration(ParticleId particle, const Multivector& acceleration) {
+    check_particle(particle);
+    accelerations_[particle] += acceleration;
+  }
+
+  /**
+   * Adds the field's acceleration of every particle, evaluated at its world pose with its coupling
+   * in one batch. Requires up-to-date world poses.
+   */
+  template <BatchField<Geometry> FieldType>
+  void accumulate(const FieldType& field) {
+    field_values_.resize(size());
+    field.evaluate_batch(poses_.world_poses(), couplings_, std::span<Multivector>{field_values_});
+    for (size_t i = 0; i < size(); ++i) {
+      accelerations_[i] += field_values_[i];
+    }
+  }
+
+  /**
+   * Adds the influences of a set of connections, evaluated in parallel by accumulator, whose
+   * leaves must be particle ids of this assembly.
+   */
+  template <typename Influence>
+  void accumulate(ForceAccumulator<Geometry>& accumulator, const Influence& influence) {
+    accumulator.accumulate(influence, std::span<Multivector>{accelerations_});
+  }
+
+  /**
+   * Advances every particle by dt with semi-implicit Euler: the velocity takes the accumulated
+   * acceleration first, and the local pose then moves along the new velocity. Marks every local
+   * pose dirty for the next update_world_poses().
+   */
+  void integrate(ScalarType dt) {
+    for (size_t i = 0; i < size(); ++i) {
+      velocities_[i] += accelerations_[i] * dt;
+      poses_.set_local_pose(i, Geometry::motor_exp(velocities_[i] * dt) * poses_.local_pose(i));
+    }
+  }
+
+  size_t size() const noexcept { return poses_.size(); }
+
+  ParticleId parent(ParticleId particle) const noexcept { return poses_.parent(particle); }
+
+  const Multivector& local_pose(ParticleId particle) const noexcept {
+    return poses_.local_pose(particle);
+  }
+  void set_local_pose(ParticleId particle, const Multivector& local_pose) {
+    poses_.set_local_pose(particle, local_pose);
+  }
+
+  const Multivector& world_pose(ParticleId particle) const noexcept {
+    return poses_.world_pose(particle);
+  }
+
+  const Multivector& velocity(ParticleId particle) const noexcept { return velocities_[particle]; }
+  void set_velocity(ParticleId particle, const Multivector& velocity) {
+    check_particle(particle);
+    velocities_[particle] = velocity;
+  }
+
+  const Multivector& coupling(ParticleId particle) const noexcept { return couplings_[particle]; }
+  void set_coupling(ParticleId particle, const Multivector& coupling) {
+    check_particle(particle);
+    couplings_[particle] = coupling;
+  }
+
+  const Multivector& acceleration(ParticleId particle) const noexcept {
+    return accelerations_[particle];
+  }
+
+  WorldlineHandle worldline(ParticleId particle) const noexcept { return worldlines_[particle]; }
+  void set_worldline(ParticleId particle, WorldlineHandle worldline) {
+    check_particle(particle);
+    worldlines_[particle] = worldline;
+  }
+
+  // The arrays themselves, for passes that scan them directly.
+  const PoseHierarchy<Geometry>& poses() const noexcept { return poses_; }
+  std::span<const Multivector> velocities() const noexcept { return velocities_; }
+  std::span<const Multivector> couplings() const noexcept { return couplings_; }
+  std::span<const Multivector> accelerations() const noexcept { return accelerations_; }
+  std::span<Multivector> accelerations() noexcept { return accelerations_; }
+  std::span<const WorldlineHandle> worldlines() const noexcept { return worldlines_; }
+};
 
 }  // namespace ndyn::assembly
@@ -0,0 +1,128 @@
+#include "assembly/assembly.h"
+
+#include <vector>
+
+#include "assembly/geometry_test_utils.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+/**
+ * A field that accelerates every particle by its coupling times a fixed bivector.
+ */
+template <typename Geometry>
+class UniformField final : public Field<Geometry> {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+  explicit UniformField(const Multivector& acceleration) : acceleration_{acceleration} {}
+
+  Multivector evaluate_at(const Multivector& /*event*/,
+                          const Multivector& coupling) const noexcept override {
+    return coupling.scalar() * acceleration_;
+  }
+
+ private:
+  Multivector acceleration_;
+};
+
+template <typename Geometry>
+class AssemblyTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+
+  static MV rotation(Scalar angle) { return Geometry::motor_exp(Geometry::bivector_xy(angle)); }
+  static MV translation(Scalar x) { return Geometry::translator(x, 2 * x, 0); }
+
+  static void expect_near(const MV& actual, const MV& expected) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      EXPECT_NEAR(actual.coefficient(i), expected.coefficient(i), 1e-12) << "blade: " << i;
+    }
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(AssemblyTest, GeometryTypes);
+
+/**
+ * A tree added depth first must come out level by level, with every attribute following its
+ * particle and the world poses unchanged.
+ */
+TYPED_TEST(AssemblyTest, SortsBreadthFirst) {
+  using Geometry = TypeParam;
+  using Scalar = typename Geometry::ScalarType;
+  using AssemblyType = Assembly<Geometry>;
+
+  AssemblyType assembly;
+  // root(0) -> a(1) -> aa(2) -> aaa(3); a -> ab(4); root -> b(5) -> ba(6); second root(7).
+  const std::vector<size_t> parents{
+      AssemblyType::NO_PARENT, 0, 1, 2, 1, 0, 5, AssemblyType::NO_PARENT};
+  for (size_t i = 0; i < parents.size(); ++i) {
+    assembly.add(parents[i], i % 2 == 0 ? this->rotation(0.1 * i) : this->translation(0.1 * i),
+                 typename Geometry::Multivector{static_cast<Scalar>(i)}, 100 + i);
+  }
+  EXPECT_FALSE(assembly.is_breadth_first());
+  assembly.update_world_poses();
+  std::vector<typename Geometry::Multivector> world_poses;
+  for (size_t i = 0; i < parents.size(); ++i) {
+    world_poses.push_back(assembly.world_pose(i));
+  }
+
+  const auto new_id{assembly.sort_breadth_first()};
+  EXPECT_TRUE(assembly.is_breadth_first());
+  // Breadth-first, the old ids run 0, 7, 1, 5, 2, 4, 6, 3.
+  EXPECT_EQ(new_id, (std::vector<size_t>{0, 2, 4, 7, 5, 3, 6, 1}));
+
+  EXPECT_EQ(assembly.update_world_poses(), parents.size());
+  for (size_t old_id = 0; old_id < parents.size(); ++old_id) {
+    const size_t id{new_id[old_id]};
+    EXPECT_EQ(assembly.parent(id),
+              parents[old_id] == AssemblyType::NO_PARENT ? AssemblyType::NO_PARENT
+                                                         : new_id[parents[old_id]]);
+    EXPECT_EQ(assembly.coupling(id).scalar(), static_cast<Scalar>(old_id));
+    EXPECT_EQ(assembly.worldline(id), 100 + old_id);
+    this->expect_near(assembly.world_pose(id), world_poses[old_id]);
+  }
+}
+
+/**
+ * One step accumulates the field into each particle's acceleration, moves the velocity, then the
+ * local pose, and the world poses follow the tree.
+ */
+TYPED_TEST(AssemblyTest, StepsAsLinearScans) {
+  using Geometry = TypeParam;
+  using MV = typename Geometry::Multivector;
+  const double dt{0.01};
+
+  Assembly<Geometry> assembly;
+  const auto root{assembly.add(Assembly<Geometry>::NO_PARENT, this->translation(1), MV{1.0})};
+  const auto child{assembly.add(root, this->rotation(0.2), MV{2.0})};
+  const auto idle{assembly.add(root, this->translation(-1))};
+  assembly.set_velocity(root, Geometry::bivector_xy(0.5));
+  assembly.update_world_poses();
+
+  const UniformField<Geometry> field{Geometry::bivector_xy(3.0)};
+  assembly.clear_accelerations();
+  assembly.accumulate(field);
+  assembly.add_acceleration(child, Geometry::bivector_xy(1.0));
+  this->expect_near(assembly.acceleration(root), Geometry::bivector_xy(3.0));
+  this->expect_near(assembly.acceleration(child), Geometry::bivector_xy(7.0));
+  this->expect_near(assembly.acceleration(idle), MV{});
+
+  assembly.integrate(dt);
+  this->expect_near(assembly.velocity(root), Geometry::bivector_xy(0.5 + 3.0 * dt));
+  this->expect_near(assembly.velocity(child), Geometry::bivector_xy(7.0 * dt));
+
+  const MV root_pose{Geometry::motor_exp(assembly.velocity(root) * dt) * this->translation(1)};
+  const MV child_pose{Geometry::motor_exp(assembly.velocity(child) * dt) * this->rotation(0.2)};
+  EXPECT_EQ(assembly.update_world_poses(), 3u);
+  this->expect_near(assembly.world_pose(root), root_pose);
+  this->expect_near(assembly.world_pose(child), root_pose * child_pose);
+  this->expect_near(assembly.world_pose(idle), root_pose * this->translation(-1));
+}
+
+}  // namespace ndyn::test
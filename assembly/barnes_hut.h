@@ -0,0 +1,409 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "assembly/field.h"
+#include "assembly/spatial.h"
+#include "glog/logging.h"
+
+namespace ndyn::assembly {
+
+/**
+ * A Barnes-Hut octree over the positions of a set of point sources, for evaluating their combined
+ * field at every particle in O(N log N) evaluations instead of the O(N^2) of the pairwise sum.
+ *
+ * build() sorts the sources into an octree, splitting cells until they hold at most leaf_size
+ * sources, and aggregates each cell: the sum of its sources' couplings, and their centre, weighted
+ * by the magnitude of each coupling's scalar part. The tree is cheap to build and meant to be
+ * rebuilt every step from the current world poses.
+ *
+ * accumulate() walks the tree for each target. A cell whose size s and distance d from the target
+ * satisfy s < theta * d is far enough away to be treated as one source: its summed coupling at its
+ * centre, one field evaluation for the whole cell. Closer cells are opened; at the leaves,
+ * sources interact one by one. theta = 0 opens every cell and reproduces the pairwise sum; larger
+ * theta trades accuracy for speed. Sources and targets interact as described at
+ * source_interaction().
+ *
+ * With the QUADRUPOLE expansion, a far cell is instead represented by six pseudo-sources, each with
+ * a sixth of its coupling, placed symmetrically along the principal axes of the cell's weighted
+ * second moment so that they reproduce it exactly. The error then falls from second to third order
+ * in s / d, for six evaluations per cell instead of one. The second moment uses the same weights as
+ * the centre, so it is exact for couplings whose scalar parts share a sign, such as masses, and an
+ * approximation otherwise.
+ */
+template <typename Geometry>
+class BarnesHutTree final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using Point = SpatialPoint<ScalarType>;
+
+  enum class Expansion {
+    MONOPOLE,
+    QUADRUPOLE,
+  };
+
+  struct Counters final {
+    // Field evaluations for whole cells, counting each quadrupole pseudo-source.
+    uint64_t cluster_evaluations{0};
+    // Field evaluations for single sources.
+    uint64_t direct_evaluations{0};
+  };
+
+  static constexpr size_t DEFAULT_LEAF_SIZE{8};
+  // Coincident sources cannot be separated; cells stop splitting at this depth regardless.
+  static constexpr size_t MAX_DEPTH{32};
+
+ private:
+  static constexpr size_t NO_CHILDREN{std::numeric_limits<size_t>::max()};
+  static constexpr size_t NUM_PSEUDO_SOURCES{6};
+
+  // A symmetric 3x3 matrix as xx, yy, zz, xy, xz, yz.
+  using Moment = std::array<ScalarType, 6>;
+
+  struct Node final {
+    Point center{};
+    ScalarType half_size{0};
+    // The eight children are nodes_[first_child] .. nodes_[first_child + 7].
+    size_t first_child{NO_CHILDREN};
+    // The node's sources are order_[begin] .. order_[end - 1].
+    size_t begin{0};
+    size_t end{0};
+
+    Multivector coupling{};
+    ScalarType weight{0};
+    Point expansion_center{};
+    Moment moment{};
+    // Quadrupole pseudo-sources, at expansion_center plus and minus each offset.
+    std::array<Point, 3> offsets{};
+  };
+
+  Expansion expansion_;
+  size_t leaf_size_;
+  std::vector<Node> nodes_{};
+  std::vector<size_t> order_{};
+  std::vector<size_t> scratch_{};
+  std::vector<Point> positions_{};
+  std::vector<Multivector> couplings_{};
+
+  static size_t octant(const Point& point, const Point& center) noexcept {
+    return (point[0] >= center[0] ? 1 : 0) | (point[1] >= center[1] ? 2 : 0) |
+           (point[2] >= center[2] ? 4 : 0);
+  }
+
+  static bool contains(const Node& node, const Point& point) noexcept {
+    using std::abs;
+    for (size_t i = 0; i < 3; ++i) {
+      if (abs(point[i] - node.center[i]) > node.half_size) return false;
+    }
+    return true;
+  }
+
+  void split(size_t index, size_t depth) {
+    const size_t begin{nodes_[index].begin};
+    const size_t end{nodes_[index].end};
+    if (end - begin <= leaf_size_ || depth == MAX_DEPTH) return;
+
+    const Point center{nodes_[index].center};
+    const ScalarType half_size{nodes_[index].half_size / 2};
+
+    // Counting sort of the node's sources by octant.
+    std::array<size_t, 9> first{};
+    for (size_t i = begin; i < end; ++i) {
+      ++first[octant(positions_[order_[i]], center) + 1];
+    }
+    for (size_t child = 0; child < 8; ++child) {
+      first[child + 1] += first[child];
+    }
+    std::array<size_t, 8> next{};
+    std::copy(first.begin(), first.end() - 1, next.begin());
+    for (size_t i = begin; i < end; ++i) {
+      const size_t source{order_[i]};
+      scratch_[begin + next[octant(positions_[source], center)]++] = source;
+    }
+    std::copy(scratch_.begin() + begin, scratch_.begin() + end, order_.begin() + begin);
+
+    const size_t first_child{nodes_.size()};
+    nodes_[index].first_child = first_child;
+    for (size_t child = 0; child < 8; ++child) {
+      Point child_center{center};
+      for (size_t i = 0; i < 3; ++i) {
+        child_center[i] += (child >> i & 1) != 0 ? half_size : -half_size;
+      }
+      nodes_.push_back(Node{child_center, half_size, NO_CHILDREN, begin + first[child],
+                            begin + first[child + 1]});
+    }
+    for (size_t child = 0; child < 8; ++child) {
+      split(first_child + child, depth + 1);
+    }
+  }
+
+  /**
+   * Aggregates every node from its children, or from its sources at a leaf. Children always follow
+   * their parent in nodes_, so a reverse scan sees every child before its parent.
+   */
+  void aggregate() {
+    for (size_t index = nodes_.size(); index-- > 0;) {
+      Node& node{nodes_[index]};
+      node.coupling = Multivector{};
+      node.weight = 0;
+      node.expansion_center = Point{};
+      node.moment = Moment{};
+
+      // The aggregates of the parts that make up the node: its children, or its sources, each
+      // with a moment about its own centre.
+      const auto for_each_part = [&](const auto& visit) {
+        if (node.first_child == NO_CHILDREN) {
+          for (size_t i = node.begin; i < node.end; ++i) {
+            const size_t source{order_[i]};
+            using std::abs;
+            visit(couplings_[source], abs(couplings_[source].scalar()), positions_[source],
+                  Moment{});
+          }
+        } else {
+          for (size_t child = node.first_child; child < node.first_child + 8; ++child) {
+            const Node& part{nodes_[child]};
+            visit(part.coupling, part.weight, part.expansion_center, part.moment);
+          }
+        }
+      };
+
+      for_each_part([&](const Multivector& coupling, ScalarType weight, const Point& center,
+                        const Moment& /*moment*/) {
+        node.coupling += coupling;
+        node.weight += weight;
+        for (size_t i = 0; i < 3; ++i) {
+          node.expansion_center[i] += weight * center[i];
+        }
+      });
+      for (size_t i = 0; i < 3; ++i) {
+        node.expansion_center[i] =
+            node.weight > 0 ? node.expansion_center[i] / node.weight : node.center[i];
+      }
+
+      if (expansion_ == Expansion::QUADRUPOLE) {
+        // Parallel axis theorem: each part's moment about its own centre, plus its weight at its
+        // centre's offset from the node's.
+        for_each_part([&](const Multivector& /*coupling*/, ScalarType weight, const Point& center,
+                          const Moment& moment) {
+          const Point d{center[0] - node.expansion_center[0], center[1] - node.expansion_center[1],
+                        center[2] - node.expansion_center[2]};
+          const Moment offset{d[0] * d[0], d[1] * d[1], d[2] * d[2],
+                              d[0] * d[1], d[0] * d[2], d[1] * d[2]};
+          for (size_t i = 0; i < 6; ++i) {
+            node.moment[i] += moment[i] + weight * offset[i];
+          }
+        });
+        set_pseudo_sources(node);
+      }
+    }
+  }
+
+  /**
+   * Places the pseudo-sources of a node. Six sources of weight W / 6 at +-a_k u_k along the
+   * eigenvectors u_k of the second moment, with eigenvalues l_k, have moment sum_k (W / 3) a_k^2
+   * u_k u_k^T, which matches for a_k = sqrt(3 l_k / W).
+   */
+  static void set_pseudo_sources(Node& node) {
+    node.offsets = std::array<Point, 3>{};
+    if (node.weight <= 0) return;
+
+    std::array<std::array<ScalarType, 3>, 3> matrix{{
+        {node.moment[0], node.moment[3], node.moment[4]},
+        {node.moment[3], node.moment[1], node.moment[5]},
+        {node.moment[4], node.moment[5], node.moment[2]},
+    }};
+    std::array<std::array<ScalarType, 3>, 3> vectors{{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}};
+    diagonalize(matrix, vectors);
+
+    using std::max;
+    using std::sqrt;
+    for (size_t k = 0; k < 3; ++k) {
+      const ScalarType scale{sqrt(max(ScalarType{0}, 3 * matrix[k][k] / node.weight))};
+      for (size_t i = 0; i < 3; ++i) {
+        node.offsets[k][i] = scale * vectors[i][k];
+      }
+    }
+  }
+
+  /**
+   * Cyclic Jacobi eigenvalue iteration for a symmetric 3x3 matrix. Leaves the eigenvalues on the
+   * diagonal of matrix and the eigenvectors in the columns of vectors.
+   */
+  static void diagonalize(std::array<std::array<ScalarType, 3>, 3>& matrix,
+                          std::array<std::array<ScalarType, 3>, 3>& vectors) {
+    using std::abs;
+    using std::sqrt;
+    static constexpr size_t MAX_SWEEPS{16};
+    for (size_t sweep = 0; sweep < MAX_SWEEPS; ++sweep) {
+      const ScalarType off_diagonal{abs(matrix[0][1]) + abs(matrix[0][2]) + abs(matrix[1][2])};
+      const ScalarType diagonal{abs(matrix[0][0]) + abs(matrix[1][1]) + abs(matrix[2][2])};
+      if (off_diagonal <= std::numeric_limits<ScalarType>::epsilon() * diagonal) return;
+
+      for (size_t p = 0; p < 2; ++p) {
+        for (size_t q = p + 1; q < 3; ++q) {
+          if (matrix[p][q] == 0) continue;
+          // The rotation in the (p, q) plane that zeroes matrix[p][q].
+          const ScalarType tau{(matrix[q][q] - matrix[p][p]) / (2 * matrix[p][q])};
+          const ScalarType t{(tau >= 0 ? 1 : -1) / (abs(tau) + sqrt(1 + tau * tau))};
+          const ScalarType c{1 / sqrt(1 + t * t)};
+          const ScalarType s{t * c};
+          for (size_t k = 0; k < 3; ++k) {
+            const ScalarType kp{matrix[k][p]};
+            const ScalarType kq{matrix[k][q]};
+            matrix[k][p] = c * kp - s * kq;
+            matrix[k][q] = s * kp + c * kq;
+          }
+          for (size_t k = 0; k < 3; ++k) {
+            const ScalarType pk{matrix[p][k]};
+            const ScalarType qk{matrix[q][k]};
+            matrix[p][k] = c * pk - s * qk;
+            matrix[q][k] = s * pk + c * qk;
+          }
+          for (size_t k = 0; k < 3; ++k) {
+            const ScalarType kp{vectors[k][p]};
+            const ScalarType kq{vectors[k][q]};
+            vectors[k][p] = c * kp - s * kq;
+            vectors[k][q] = s * kp + c * kq;
+          }
+        }
+      }
+    }
+  }
+
+ public:
+  explicit BarnesHutTree(Expansion expansion = Expansion::MONOPOLE,
+                         size_t leaf_size = DEFAULT_LEAF_SIZE)
+      : expansion_{expansion}, leaf_size_{leaf_size} {
+    LOG_IF(FATAL, leaf_size_ == 0) << "Barnes-Hut trees require a positive leaf size.";
+  }
+
+  /**
+   * Rebuilds the tree over sources at the positions of the given world poses with the given
+   * couplings. Source i is the particle at index i.
+   */
+  void build(std::span<const Multivector> world_poses, std::span<const Multivector> couplings) {
+    LOG_IF(FATAL, couplings.size() != world_poses.size())
+        << "Barnes-Hut trees require one coupling per source.";
+    positions_.resize(world_poses.size());
+    spatial_positions<Geometry>(world_poses, std::span<Point>{positions_});
+    couplings_.assign(couplings.begin(), couplings.end());
+
+    order_.resize(positions_.size());
+    std::iota(order_.begin(), order_.end(), size_t{0});
+    scratch_.resize(positions_.size());
+
+    // The root is the bounding cube of the sources.
+    Point low{};
+    Point high{};
+    if (!positions_.empty()) low = high = positions_.front();
+    for (const Point& position : positions_) {
+      for (size_t i = 0; i < 3; ++i) {
+        low[i] = std::min(low[i], position[i]);
+        high[i] = std::max(high[i], position[i]);
+      }
+    }
+    Point center{};
+    ScalarType half_size{0};
+    for (size_t i = 0; i < 3; ++i) {
+      center[i] = (low[i] + high[i]) / 2;
+      half_size = std::max(half_size, (high[i] - low[i]) / 2);
+    }
+    if (half_size == 0) half_size = 1;
+
+    nodes_.clear();
+    nodes_.push_back(Node{center, half_size, NO_CHILDREN, 0, positions_.size()});
+    split(0, 0);
+    aggregate();
+  }
+
+  /**
+   * The acceleration of a target with the given world pose and coupling due to every source but
+   * `self`, which should be the target's own index if it is one of the sources. The interactions
+   * are gathered into batch and evaluated in one call.
+   */
+  template <BatchField<Geometry> FieldType>
+  Multivector evaluate(const FieldType& field, ScalarType theta, const Multivector& pose,
+                       const Multivector& coupling, size_t self, InteractionBatch<Geometry>& batch,
+                       Counters& counters) const {
+    if (nodes_.empty()) return {};
+
+    const Point target{spatial_coordinates<Geometry>(origin_image<Geometry>(pose))};
+    const ScalarType theta_squared{theta * theta};
+
+    std::vector<size_t> stack{0};
+    while (!stack.empty()) {
+      const Node& node{nodes_[stack.back()]};
+      stack.pop_back();
+      if (node.begin == node.end) continue;
+
+      const ScalarType size{2 * node.half_size};
+      if (size * size < theta_squared * squared_distance(target, node.expansion_center) &&
+          !contains(node, target)) {
+        if (expansion_ == Expansion::MONOPOLE) {
+          batch.add(node.expansion_center, node.coupling, pose, coupling);
+          ++counters.cluster_evaluations;
+        } else {
+          const Multivector share{node.coupling * (ScalarType{1} / NUM_PSEUDO_SOURCES)};
+          for (const Point& offset : node.offsets) {
+            for (const ScalarType sign : {ScalarType{1}, ScalarType{-1}}) {
+              const Point source{node.expansion_center[0] + sign * offset[0],
+                                 node.expansion_center[1] + sign * offset[1],
+                                 node.expansion_center[2] + sign * offset[2]};
+              batch.add(source, share, pose, coupling);
+            }
+          }
+          counters.cluster_evaluations += NUM_PSEUDO_SOURCES;
+        }
+      } else if (node.first_child == NO_CHILDREN) {
+        for (size_t i = node.begin; i < node.end; ++i) {
+          const size_t source{order_[i]};
+          if (source == self) continue;
+          batch.add(positions_[source], couplings_[source], pose, coupling);
+          ++counters.direct_evaluations;
+        }
+      } else {
+        for (size_t child = node.first_child; child < node.first_child + 8; ++child) {
+          stack.push_back(child);
+        }
+      }
+    }
+    return batch.sum(field);
+  }
+
+  /**
+   * Adds to each acceleration the field of every source at the corresponding world pose, with the
+   * corresponding coupling. The targets are the sources the tree was built from.
+   */
+  template <BatchField<Geometry> FieldType>
+  Counters accumulate(const FieldType& field, ScalarType theta,
+                      std::span<const Multivector> world_poses,
+                      std::span<const Multivector> couplings,
+                      std::span<Multivector> accelerations) const {
+    LOG_IF(FATAL, world_poses.size() != positions_.size() ||
+                      couplings.size() != positions_.size() ||
+                      accelerations.size() != positions_.size())
+        << "Barnes-Hut accumulation requires one pose, coupling and acceleration per source.";
+    Counters counters{};
+    InteractionBatch<Geometry> batch{};
+    for (size_t target = 0; target < world_poses.size(); ++target) {
+      accelerations[target] +=
+          evaluate(field, theta, world_poses[target], couplings[target], target, batch, counters);
+    }
+    return counters;
+  }
+
+  size_t num_sources() const noexcept { return positions_.size(); }
+  size_t num_nodes() const noexcept { return nodes_.size(); }
+  std::span<const Point> positions() const noexcept { return positions_; }
+};
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,139 @@
+#include "assembly/barnes_hut.h"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "assembly/assembly.h"
+#include "assembly/field_test_utils.h"
+#include "assembly/geometry_test_utils.h"
+#include "assembly/spatial.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class BarnesHutTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using Tree = BarnesHutTree<Geometry>;
+
+  /**
+   * Particles in a few clusters of different sizes, with masses between 0.5 and 1.5, at their
+   * world poses.
+   */
+  static Assembly<Geometry> clustered(size_t count) {
+    std::mt19937_64 random{count};
+    const auto uniform{[&random] { return uniform_sample<Scalar>(random); }};
+    Assembly<Geometry> assembly;
+    assembly.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      const Scalar cluster{static_cast<Scalar>(i % 4)};
+      const Scalar radius{0.2 + 0.3 * cluster};
+      assembly.add(Assembly<Geometry>::NO_PARENT,
+                   Geometry::translator(3 * cluster + radius * (2 * uniform() - 1),
+                                        2 * (cluster - 1.5) + radius * (2 * uniform() - 1),
+                                        radius * (2 * uniform() - 1)),
+                   MV{0.5 + uniform()});
+    }
+    assembly.update_world_poses();
+    return assembly;
+  }
+
+  static std::vector<MV> approximate(const Field<Geometry>& field,
+                                     const Assembly<Geometry>& assembly,
+                                     typename Tree::Expansion expansion, Scalar theta) {
+    Tree tree{expansion};
+    tree.build(assembly.poses().world_poses(), assembly.couplings());
+    std::vector<MV> accelerations(assembly.size());
+    tree.accumulate(field, theta, assembly.poses().world_poses(), assembly.couplings(),
+                    std::span<MV>{accelerations});
+    return accelerations;
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(BarnesHutTest, GeometryTypes);
+
+TYPED_TEST(BarnesHutTest, ZeroThetaIsExact) {
+  using Tree = typename TestFixture::Tree;
+  const InverseSquareField<TypeParam> field{};
+  const auto assembly{this->clustered(300)};
+  const auto expected{pairwise_accelerations(field, assembly)};
+  for (const auto expansion : {Tree::Expansion::MONOPOLE, Tree::Expansion::QUADRUPOLE}) {
+    EXPECT_LT(relative_error(this->approximate(field, assembly, expansion, 0), expected), 1e-12);
+  }
+}
+
+/**
+ * Benchmark: accuracy against theta for both expansions. The error must fall with theta, and the
+ * quadrupole must beat the monopole.
+ */
+TYPED_TEST(BarnesHutTest, AccuracyAgainstTheta) {
+  using Tree = typename TestFixture::Tree;
+  const InverseSquareField<TypeParam> field{};
+  const auto assembly{this->clustered(400)};
+  const auto expected{pairwise_accelerations(field, assembly)};
+
+  double previous_monopole{1};
+  double previous_quadrupole{1};
+  for (const double theta : {1.0, 0.7, 0.5, 0.3}) {
+    const double monopole{relative_error(
+        this->approximate(field, assembly, Tree::Expansion::MONOPOLE, theta), expected)};
+    const double quadrupole{relative_error(
+        this->approximate(field, assembly, Tree::Expansion::QUADRUPOLE, theta), expected)};
+    LOG(INFO) << "theta " << theta << ": monopole error " << monopole << ", quadrupole error "
+              << quadrupole;
+    EXPECT_LT(monopole, previous_monopole) << "theta: " << theta;
+    EXPECT_LT(quadrupole, previous_quadrupole) << "theta: " << theta;
+    EXPECT_LT(quadrupole, monopole) << "theta: " << theta;
+    previous_monopole = monopole;
+    previous_quadrupole = quadrupole;
+  }
+  EXPECT_LT(previous_monopole, 1e-2);
+}
+
+/**
+ * Benchmark: wall time and field evaluations of the tree, including its construction, against the
+ * pairwise sum as the number of particles grows.
+ */
+TYPED_TEST(BarnesHutTest, ScalingWithParticles) {
+  using Tree = typename TestFixture::Tree;
+  using MV = typename TypeParam::Multivector;
+  const InverseSquareField<TypeParam> field{};
+  const double theta{0.5};
+
+  for (const size_t count : {125, 250, 500, 1000}) {
+    const auto assembly{this->clustered(count)};
+
+    auto start{std::chrono::steady_clock::now()};
+    const auto expected{pairwise_accelerations(field, assembly)};
+    const double exact_seconds{
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    start = std::chrono::steady_clock::now();
+    Tree tree{};
+    tree.build(assembly.poses().world_poses(), assembly.couplings());
+    std::vector<MV> actual(count);
+    const auto counters{tree.accumulate(field, theta, assembly.poses().world_poses(),
+                                        assembly.couplings(), std::span<MV>{actual})};
+    const double tree_seconds{
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    const uint64_t evaluations{counters.cluster_evaluations + counters.direct_evaluations};
+    LOG(INFO) << count << " particles: pairwise " << exact_seconds * 1e3 << " ms, tree "
+              << tree_seconds * 1e3 << " ms, " << evaluations << " evaluations against "
+              << count * (count - 1) << ", error " << relative_error(actual, expected);
+    if (count >= 500) {
+      EXPECT_LT(evaluations, count * (count - 1) / 2);
+    }
+  }
+}
+
+}  // namespace ndyn::test
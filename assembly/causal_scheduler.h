@@ -0,0 +1,400 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "assembly/light_speed.h"
+#include "assembly/manifold.h"
+#include "assembly/root_finders.h"
+#include "assembly/spatial.h"
+#include "assembly/work_stealing_pool.h"
+#include "glog/logging.h"
+
+namespace ndyn::assembly {
+
+/**
+ * Advances particles concurrently and out of lockstep, as far as causality allows.
+ *
+ * A particle's step from t to t + dt reads the worldlines of its sources only at retarded times,
+ * those from which light covers the source's distance d by t + dt. Its source need only have
+ * recorded that far: a source L light-steps away, where light takes at least L steps to cover d
+ * (L = floor(d / (c dt)) for a constant c), may lag it by up to L - 1 steps, and it may equally
+ * lag the source. Particles under a light-step apart read each other's current step, so
+ * they are grouped into clusters that always advance together; clusters are the units of work.
+ *
+ * run() advances every particle num_steps steps, in the manner of a conservative parallel
+ * discrete-event simulation. It computes the light-step distance between every pair of clusters
+ * close enough to constrain each other within the window, then lets the pool's workers take any
+ * cluster whose neighbours are far enough along, lowest step first, with no barrier between steps.
+ * A cluster that finishes a step releases its neighbours.
+ *
+ * The distances come from the world poses at the start of the window, reduced by how much closer
+ * two particles moving at max_speed could get within it. The reach of a lag of L steps is the
+ * longest optical path, Manifold::calculate_optical_path(), over any L consecutive steps of the
+ * window, so a speed of light that peaks between step boundaries is accounted for. Longer windows
+ * constrain more pairs; a window is one barrier, so choose it long enough to amortize it.
+ *
+ * advance(particles, step, worker) must advance the cluster's particles from step to step + 1 of
+ * the window, computing all their influences before recording any of their states. It runs
+ * concurrently with the advance of other clusters, which may be appending to worldlines it reads,
+ * so the worldlines must support that, as ConcurrentWorldline does. It reads only recorded history,
+ * so its results do not depend on the schedule.
+ */
+template <typename Geometry, typename RootFinder = BrentRootFinder,
+          typename LightSpeed = CallableLightSpeed<typename Geometry::ScalarType>>
+class CausalScheduler final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using Point = SpatialPoint<ScalarType>;
+  using ManifoldType = Manifold<Geometry, RootFinder, LightSpeed>;
+
+  struct Counters final {
+    uint64_t windows{0};
+    // Cluster steps advanced.
+    uint64_t tasks{0};
+    // The most steps any cluster has run ahead of the slowest.
+    uint64_t max_lead{0};
+  };
+
+ private:
+  // Cells per side of the grid used to find close pairs are capped, so that sparse scenes with a
+  // large extent do not allocate a huge grid.
+  static constexpr size_t MAX_CELLS_PER_SIDE{64};
+
+  struct Neighbour final {
+    size_t cluster;
+    // The neighbour's light-step distance, in whole steps; at least one.
+    size_t lag;
+  };
+
+  enum class State : uint8_t {
+    IDLE,
+    QUEUED,
+    RUNNING,
+  };
+
+  using Ready = std::pair<size_t, size_t>;
+
+  const ManifoldType* manifold_;
+  WorkStealingPool* pool_;
+  ScalarType max_speed_;
+
+  std::vector<Point> positions_{};
+  // reach_[L - 1] is how far light can travel in any L consecutive steps of the window.
+  std::vector<ScalarType> reach_{};
+  std::vector<size_t> cluster_of_{};
+  // The particles of cluster c are particles_[cluster_begin_[c]] .. [cluster_begin_[c + 1] - 1].
+  std::vector<size_t> cluster_begin_{};
+  std::vector<size_t> particles_{};
+  std::vector<size_t> neighbour_begin_{};
+  std::vector<Neighbour> neighbours_{};
+
+  // Scheduling state for run(), guarded by mutex_.
+  std::mutex mutex_{};
+  std::condition_variable wake_{};
+  std::priority_queue<Ready, std::vector<Ready>, std::greater<Ready>> ready_{};
+  std::vector<size_t> steps_{};
+  std::vector<State> states_{};
+  // How many clusters have finished each step of the window, and the lowest step not yet finished
+  // by all of them.
+  std::vector<size_t> finished_{};
+  size_t slowest_{0};
+  size_t unfinished_{0};
+  size_t num_steps_{0};
+
+  Counters counters_{};
+
+  static size_t find_root(std::vector<size_t>& parent, size_t i) noexcept {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  }
+
+  /**
+   * Calls visit(i, j, distance) for every pair i < j of particles closer than radius, using a
+   * uniform grid of cells at least radius wide.
+   */
+  template <typename Visitor>
+  void for_each_close_pair(ScalarType radius, const Visitor& visit) const {
+    using std::floor;
+    using std::sqrt;
+    const size_t count{positions_.size()};
+    if (count < 2) return;
+
+    Point lower{positions_[0]};
+    Point upper{positions_[0]};
+    for (const Point& p : positions_) {
+      for (size_t axis = 0; axis < 3; ++axis) {
+        lower[axis] = std::min(lower[axis], p[axis]);
+        upper[axis] = std::max(upper[axis], p[axis]);
+      }
+    }
+    ScalarType width{radius};
+    for (size_t axis = 0; axis < 3; ++axis) {
+      width = std::max(width, (upper[axis] - lower[axis]) / MAX_CELLS_PER_SIDE);
+    }
+    std::array<size_t, 3> dims{};
+    for (size_t axis = 0; axis < 3; ++axis) {
+      dims[axis] = static_cast<size_t>(floor((upper[axis] - lower[axis]) / width)) + 1;
+    }
+    const auto cell_of{[&](const Point& p, size_t axis) {
+      return std::min(static_cast<size_t>(floor((p[axis] - lower[axis]) / width)), dims[axis] - 1);
+    }};
+    const auto cell_index{
+        [&](size_t x, size_t y, size_t z) { return x + dims[0] * (y + dims[1] * z); }};
+
+    // Counting sort of the particles by cell.
+    std::vector<size_t> cell_begin(dims[0] * dims[1] * dims[2] + 1);
+    std::vector<size_t> cell(count);
+    for (size_t i = 0; i < count; ++i) {
+      const Point& p{positions_[i]};
+      cell[i] = cell_index(cell_of(p, 0), cell_of(p, 1), cell_of(p, 2));
+      ++cell_begin[cell[i] + 1];
+    }
+    std::partial_sum(cell_begin.begin(), cell_begin.end(), cell_begin.begin());
+    std::vector<size_t> next(cell_begin.begin(), cell_begin.end() - 1);
+    std::vector<size_t> sorted(count);
+    for (size_t i = 0; i < count; ++i) {
+      sorted[next[cell[i]]++] = i;
+    }
+
+    const ScalarType radius_squared{radius * radius};
+    for (size_t i = 0; i < count; ++i) {
+      const Point& p{positions_[i]};
+      const std::array<size_t, 3> home{cell_of(p, 0), cell_of(p, 1), cell_of(p, 2)};
+      std::array<size_t, 3> first{};
+      std::array<size_t, 3> last{};
+      for (size_t axis = 0; axis < 3; ++axis) {
+        first[axis] = home[axis] == 0 ? 0 : home[axis] - 1;
+        last[axis] = std::min(home[axis] + 1, dims[axis] - 1);
+      }
+      for (size_t z = first[2]; z <= last[2]; ++z) {
+        for (size_t y = first[1]; y <= last[1]; ++y) {
+          for (size_t x = first[0]; x <= last[0]; ++x) {
+            const size_t c{cell_index(x, y, z)};
+            for (size_t k = cell_begin[c]; k < cell_begin[c + 1]; ++k) {
+              const size_t j{sorted[k]};
+              if (j <= i) continue;
+              const ScalarType d_squared{squared_distance(p, positions_[j])};
+              if (d_squared < radius_squared) visit(i, j, sqrt(d_squared));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Finds how far light can travel in any run of consecutive steps of the window, from the optical
+   * paths from t0 to each step boundary.
+   */
+  void measure_reach(ScalarType t0, ScalarType dt, size_t num_steps) {
+    std::vector<ScalarType> path_to(num_steps + 1);
+    for (size_t k = 0; k <= num_steps; ++k) {
+      path_to[k] = manifold_->calculate_optical_path(t0, t0 + dt * static_cast<ScalarType>(k));
+    }
+    reach_.assign(num_steps, 0);
+    for (size_t lag = 1; lag <= num_steps; ++lag) {
+      ScalarType& reach{reach_[lag - 1]};
+      // A reach never shrinks with the lag, even where rounding would make it.
+      reach = lag > 1 ? reach_[lag - 2] : ScalarType{0};
+      for (size_t first = 0; first + lag <= num_steps; ++first) {
+        reach = std::max(reach, path_to[first + lag] - path_to[first]);
+      }
+    }
+  }
+
+  /**
+   * Groups the particles into clusters and finds the lag between neighbouring clusters, for a
+   * window of num_steps steps of dt whose reach has been measured.
+   */
+  void plan(ScalarType dt, size_t num_steps) {
+    const size_t count{positions_.size()};
+    // How much closer two particles can get within the window.
+    const ScalarType approach{2 * max_speed_ * dt * static_cast<ScalarType>(num_steps)};
+    // Pairs at least this far apart cannot constrain each other within the window.
+    const ScalarType radius{reach_.back() + approach};
+    // The most steps a source at this distance may lag: the longest lag whose reach does not
+    // cover the distance.
+    const auto lag_of{[&](ScalarType distance) {
+      return static_cast<size_t>(
+          std::upper_bound(reach_.begin(), reach_.end(), distance - approach) - reach_.begin());
+    }};
+
+    std::vector<std::tuple<size_t, size_t, size_t>> pairs{};
+    std::vector<size_t> parent(count);
+    std::iota(parent.begin(), parent.end(), size_t{0});
+    for_each_close_pair(radius, [&](size_t i, size_t j, ScalarType distance) {
+      const size_t lag{lag_of(distance)};
+      if (lag == 0) {
+        parent[find_root(parent, i)] = find_root(parent, j);
+      } else {
+        pairs.emplace_back(i, j, lag);
+      }
+    });
+
+    // Number the clusters in order of their first particle.
+    cluster_of_.assign(count, count);
+    std::vector<size_t> cluster_of_root(count, count);
+    size_t num_clusters{0};
+    for (size_t i = 0; i < count; ++i) {
+      size_t& cluster{cluster_of_root[find_root(parent, i)]};
+      if (cluster == count) cluster = num_clusters++;
+      cluster_of_[i] = cluster;
+    }
+    cluster_begin_.assign(num_clusters + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+      ++cluster_begin_[cluster_of_[i] + 1];
+    }
+    std::partial_sum(cluster_begin_.begin(), cluster_begin_.end(), cluster_begin_.begin());
+    std::vector<size_t> next(cluster_begin_.begin(), cluster_begin_.end() - 1);
+    particles_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      particles_[next[cluster_of_[i]]++] = i;
+    }
+
+    // The lag between two clusters is the least between any of their particles.
+    std::vector<std::tuple<size_t, size_t, size_t>> edges{};
+    edges.reserve(2 * pairs.size());
+    for (const auto& [i, j, lag] : pairs) {
+      const size_t a{cluster_of_[i]};
+      const size_t b{cluster_of_[j]};
+      if (a == b) continue;
+      edges.emplace_back(a, b, lag);
+      edges.emplace_back(b, a, lag);
+    }
+    std::sort(edges.begin(), edges.end());
+    neighbour_begin_.assign(num_clusters + 1, 0);
+    neighbours_.clear();
+    for (size_t k = 0; k < edges.size(); ++k) {
+      const auto& [a, b, lag] = edges[k];
+      if (k > 0 && std::get<0>(edges[k - 1]) == a && std::get<1>(edges[k - 1]) == b) continue;
+      neighbours_.push_back(Neighbour{b, lag});
+      ++neighbour_begin_[a + 1];
+    }
+    std::partial_sum(neighbour_begin_.begin(), neighbour_begin_.end(), neighbour_begin_.begin());
+  }
+
+  // Whether the cluster can take its next step now. Requires mutex_.
+  bool is_ready(size_t cluster) const noexcept {
+    if (states_[cluster] != State::IDLE || steps_[cluster] == num_steps_) return false;
+    for (size_t k = neighbour_begin_[cluster]; k < neighbour_begin_[cluster + 1]; ++k) {
+      const Neighbour& neighbour{neighbours_[k]};
+      if (steps_[neighbour.cluster] + neighbour.lag < steps_[cluster] + 1) return false;
+    }
+    return true;
+  }
+
+  // Requires mutex_.
+  void enqueue_if_ready(size_t cluster) {
+    if (!is_ready(cluster)) return;
+    states_[cluster] = State::QUEUED;
+    ready_.emplace(steps_[cluster], cluster);
+  }
+
+  template <typename Advance>
+  void work(size_t worker, const Advance& advance) {
+    std::unique_lock lock{mutex_};
+    while (true) {
+      wake_.wait(lock, [this] { return !ready_.empty() || unfinished_ == 0; });
+      if (ready_.empty()) return;
+      const size_t cluster{ready_.top().second};
+      ready_.pop();
+      states_[cluster] = State::RUNNING;
+      const size_t step{steps_[cluster]};
+      lock.unlock();
+
+      advance(std::span<const size_t>{particles_.data() + cluster_begin_[cluster],
+                                      cluster_begin_[cluster + 1] - cluster_begin_[cluster]},
+              step, worker);
+
+      lock.lock();
+      states_[cluster] = State::IDLE;
+      ++steps_[cluster];
+      ++counters_.tasks;
+      ++finished_[step];
+      while (slowest_ < num_steps_ && finished_[slowest_] == steps_.size()) {
+        ++slowest_;
+      }
+      counters_.max_lead = std::max<uint64_t>(counters_.max_lead, steps_[cluster] - slowest_);
+      if (steps_[cluster] == num_steps_) --unfinished_;
+
+      enqueue_if_ready(cluster);
+      for (size_t k = neighbour_begin_[cluster]; k < neighbour_begin_[cluster + 1]; ++k) {
+        enqueue_if_ready(neighbours_[k].cluster);
+      }
+      wake_.notify_all();
+    }
+  }
+
+ public:
+  /**
+   * max_speed bounds the speed of every particle in the frame of the world poses. The speed of
+   * light is always a safe bound.
+   */
+  CausalScheduler(const ManifoldType& manifold, WorkStealingPool& pool, ScalarType max_speed)
+      : manifold_{&manifold}, pool_{&pool}, max_speed_{max_speed} {
+    LOG_IF(FATAL, !(max_speed >= 0)) << "Causal scheduling requires a non-negative speed bound.";
+  }
+
+  /**
+   * Advances the particles at world_poses, at time t0, by num_steps steps of dt, calling
+   * advance(particles, step, worker) for each cluster and step of the window.
+   */
+  template <typename Advance>
+  void run(std::span<const Multivector> world_poses, ScalarType t0, ScalarType dt,
+           size_t num_steps, const Advance& advance) {
+    LOG_IF(FATAL, !(dt > 0)) << "Causal scheduling requires a positive step.";
+    ++counters_.windows;
+    if (num_steps == 0 || world_poses.empty()) return;
+
+    positions_.resize(world_poses.size());
+    spatial_positions<Geometry>(world_poses, std::span<Point>{positions_});
+    measure_reach(t0, dt, num_steps);
+    plan(dt, num_steps);
+
+    const size_t num_clusters{cluster_begin_.size() - 1};
+    steps_.assign(num_clusters, 0);
+    states_.assign(num_clusters, State::IDLE);
+    finished_.assign(num_steps, 0);
+    slowest_ = 0;
+    unfinished_ = num_clusters;
+    num_steps_ = num_steps;
+    for (size_t cluster = 0; cluster < num_clusters; ++cluster) {
+      enqueue_if_ready(cluster);
+    }
+
+    pool_->run(pool_->size(), [this, &advance](size_t /*task*/, size_t worker) {
+      work(worker, advance);
+    });
+    LOG_IF(FATAL, unfinished_ != 0) << "Causal scheduling stalled.";
+  }
+
+  size_t num_clusters() const noexcept {
+    return cluster_begin_.empty() ? 0 : cluster_begin_.size() - 1;
+  }
+
+  /**
+   * The cluster of each particle in the latest window.
+   */
+  size_t cluster_of(size_t particle) const noexcept { return cluster_of_[particle]; }
+
+  const Counters& counters() const noexcept { return counters_; }
+};
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,219 @@
+#include "assembly/causal_scheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "assembly/geometry_test_utils.h"
+#include "assembly/light_speed.h"
+#include "assembly/manifold.h"
+#include "assembly/root_finders.h"
+#include "assembly/work_stealing_pool.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class CausalSchedulerTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+
+  static constexpr Scalar C{1};
+  static constexpr Scalar DT{0.1};
+
+  auto constant_c(Scalar value) {
+    return [value](Scalar /*time*/) { return value; };
+  }
+
+  /**
+   * Particles on a line, spacing apart, with every tenth one close enough to the next to share its
+   * cluster.
+   */
+  static std::vector<MV> line(size_t count, Scalar spacing) {
+    std::vector<MV> poses{};
+    Scalar x{0};
+    for (size_t i = 0; i < count; ++i) {
+      poses.push_back(Geometry::translator(x, 0, 0));
+      x += i % 10 == 0 ? spacing / 10 : spacing;
+    }
+    return poses;
+  }
+
+  // How many whole light-steps apart two particles of line() are, for particles at rest.
+  static size_t lag(const std::vector<MV>& poses, size_t i, size_t j) {
+    const auto a{spatial_coordinates<Geometry>(origin_image<Geometry>(poses[i]))};
+    const auto b{spatial_coordinates<Geometry>(origin_image<Geometry>(poses[j]))};
+    return static_cast<size_t>(std::floor(std::abs(a[0] - b[0]) / (C * DT)));
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(CausalSchedulerTest, GeometryTypes);
+
+/**
+ * Every particle takes every step once and in order, and never starts a step before each other
+ * particle has finished the steps its signals could reach it from.
+ */
+TYPED_TEST(CausalSchedulerTest, RespectsLightConeOrdering) {
+  using Geometry = TypeParam;
+  const auto poses{this->line(60, 0.25)};
+  const size_t num_steps{20};
+  Manifold<Geometry> manifold(this->constant_c(this->C));
+  WorkStealingPool pool{4};
+  CausalScheduler<Geometry> scheduler{manifold, pool, 0};
+
+  std::vector<std::atomic<size_t>> done(poses.size());
+  std::atomic<bool> out_of_order{false};
+  std::atomic<bool> acausal{false};
+  scheduler.run(poses, 0, this->DT, num_steps,
+                [&](std::span<const size_t> particles, size_t step, size_t /*worker*/) {
+                  for (const size_t i : particles) {
+                    if (done[i].load() != step) out_of_order = true;
+                    for (size_t j = 0; j < poses.size(); ++j) {
+                      if (scheduler.cluster_of(j) == scheduler.cluster_of(i)) continue;
+                      if (done[j].load() + this->lag(poses, i, j) < step + 1) acausal = true;
+                    }
+                  }
+                  for (const size_t i : particles) {
+                    done[i].fetch_add(1);
+                  }
+                });
+
+  for (size_t i = 0; i < poses.size(); ++i) {
+    EXPECT_EQ(done[i].load(), num_steps) << "particle: " << i;
+  }
+  EXPECT_FALSE(out_of_order);
+  EXPECT_FALSE(acausal);
+  EXPECT_EQ(scheduler.counters().windows, 1u);
+  EXPECT_EQ(scheduler.counters().tasks, scheduler.num_clusters() * num_steps);
+}
+
+/**
+ * Particles within a light-step of each other advance together; distant ones do not.
+ */
+TYPED_TEST(CausalSchedulerTest, ClustersCloseParticles) {
+  using Geometry = TypeParam;
+  const auto poses{this->line(30, 0.25)};
+  Manifold<Geometry> manifold(this->constant_c(this->C));
+  WorkStealingPool pool{2};
+  CausalScheduler<Geometry> scheduler{manifold, pool, 0};
+  scheduler.run(poses, 0, this->DT, 5, [](std::span<const size_t>, size_t, size_t) {});
+
+  EXPECT_EQ(scheduler.num_clusters(), 27u);
+  EXPECT_EQ(scheduler.cluster_of(0), scheduler.cluster_of(1));
+  EXPECT_EQ(scheduler.cluster_of(10), scheduler.cluster_of(11));
+  EXPECT_NE(scheduler.cluster_of(1), scheduler.cluster_of(2));
+
+  // Moving particles may close in on each other within the window, so more of them must share a
+  // cluster.
+  CausalScheduler<Geometry> moving{manifold, pool, 0.3};
+  moving.run(poses, 0, this->DT, 5, [](std::span<const size_t>, size_t, size_t) {});
+  EXPECT_LT(moving.num_clusters(), scheduler.num_clusters());
+}
+
+/**
+ * A speed of light that peaks between step boundaries: c is 1 at every boundary but 9 halfway
+ * through every step, so light covers 0.5 in a step, not the 0.1 the boundaries suggest.
+ */
+TYPED_TEST(CausalSchedulerTest, ReachFollowsTheOpticalPath) {
+  using Geometry = TypeParam;
+  using Scalar = typename TestFixture::Scalar;
+  using LightSpeed = TabulatedLightSpeed<Scalar>;
+  const size_t num_steps{5};
+  std::vector<Scalar> speeds{};
+  for (size_t knot = 0; knot <= 2 * num_steps; ++knot) {
+    speeds.push_back(knot % 2 == 0 ? 1 : 9);
+  }
+  const Manifold<Geometry, BrentRootFinder, LightSpeed> manifold{
+      LightSpeed{0, this->DT / 2, std::move(speeds)}};
+  ASSERT_EQ(manifold.calculate_speed_of_light(this->DT), 1);
+  ASSERT_NEAR(manifold.calculate_optical_path(0, this->DT), 0.5, 1e-12);
+
+  // Light covers 0.5 in any step, so particles lag each other by floor(distance / 0.5) steps.
+  const std::vector<Scalar> xs{0, 0.3, 2.4, 4.6};
+  std::vector<typename TestFixture::MV> poses{};
+  for (const Scalar x : xs) {
+    poses.push_back(Geometry::translator(x, 0, 0));
+  }
+  WorkStealingPool pool{2};
+  CausalScheduler<Geometry, BrentRootFinder, LightSpeed> scheduler{manifold, pool, 0};
+  std::vector<size_t> done(poses.size());
+  std::mutex mutex{};
+  bool acausal{false};
+  scheduler.run(poses, 0, this->DT, num_steps,
+                [&](std::span<const size_t> particles, size_t step, size_t /*worker*/) {
+                  std::lock_guard lock{mutex};
+                  for (const size_t i : particles) {
+                    for (size_t j = 0; j < poses.size(); ++j) {
+                      if (scheduler.cluster_of(j) == scheduler.cluster_of(i)) continue;
+                      const auto lag{static_cast<size_t>(std::abs(xs[i] - xs[j]) / 0.5)};
+                      if (done[j] + lag < step + 1) acausal = true;
+                    }
+                  }
+                  for (const size_t i : particles) {
+                    ++done[i];
+                  }
+                });
+
+  // Within a light-step of each other, though 3 light-steps apart at the boundaries' speed.
+  EXPECT_EQ(scheduler.cluster_of(0), scheduler.cluster_of(1));
+  EXPECT_NE(scheduler.cluster_of(1), scheduler.cluster_of(2));
+  EXPECT_NE(scheduler.cluster_of(2), scheduler.cluster_of(3));
+  EXPECT_FALSE(acausal);
+}
+
+/**
+ * Benchmark: uneven work per particle, advanced in lockstep with a barrier per step against the
+ * causal schedule.
+ */
+TYPED_TEST(CausalSchedulerTest, AgainstLockstep) {
+  using Geometry = TypeParam;
+  const auto poses{this->line(64, 0.5)};
+  const size_t num_steps{40};
+  const auto work{[](size_t particle, size_t step) {
+    // One particle in eight, varying with the step, is slow.
+    const auto duration{(particle + step) % 8 == 0 ? std::chrono::microseconds(400)
+                                                   : std::chrono::microseconds(50)};
+    std::this_thread::sleep_for(duration);
+  }};
+  Manifold<Geometry> manifold(this->constant_c(this->C));
+  WorkStealingPool pool{4};
+
+  auto start{std::chrono::steady_clock::now()};
+  for (size_t step = 0; step < num_steps; ++step) {
+    pool.run(poses.size(), [&](size_t particle, size_t /*worker*/) { work(particle, step); });
+  }
+  const double lockstep_ms{std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - start)
+                               .count()};
+
+  CausalScheduler<Geometry> scheduler{manifold, pool, 0};
+  start = std::chrono::steady_clock::now();
+  scheduler.run(poses, 0, this->DT, num_steps,
+                [&](std::span<const size_t> particles, size_t step, size_t /*worker*/) {
+                  for (const size_t particle : particles) {
+                    work(particle, step);
+                  }
+                });
+  const double causal_ms{std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - start)
+                             .count()};
+
+  LOG(INFO) << poses.size() << " particles, " << num_steps << " steps: lockstep " << lockstep_ms
+            << " ms, causal " << causal_ms << " ms, " << scheduler.num_clusters()
+            << " clusters, max lead " << scheduler.counters().max_lead << " steps";
+  EXPECT_EQ(scheduler.counters().tasks, scheduler.num_clusters() * num_steps);
+  EXPECT_GT(scheduler.counters().max_lead, 0u);
+}
+
+}  // namespace ndyn::test
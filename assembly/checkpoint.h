@@ -0,0 +1,352 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "assembly/assembly.h"
+#include "assembly/light_speed.h"
+#include "assembly/manifold.h"
+#include "glog/logging.h"
+#include "io/checkpoint.h"
+#include "math/state.h"
+
+namespace ndyn::assembly {
+
+/**
+ * The full state of a simulation in an io checkpoint: the step and time, the particles of an
+ * Assembly, the samples of every Worldline and the Manifold's speed of light.
+ *
+ * The particles are stored as one section per Assembly array, so that each restores with a single
+ * copy. Multivectors are stored as NUM_BASIS_BLADES coefficients each and states as their pose
+ * followed by their velocity; the metadata records the algebra's signature, blade count and
+ * scalar size, and a checkpoint only loads with a geometry of the same algebra, so that algebras
+ * with as many blades, such as Pga and a 4D Vga, cannot read each other's files. Worldline samples
+ * are stored decoded, whatever the history policy, and all worldlines share one section of states
+ * indexed by a second.
+ *
+ * The speed of light is saved for ConstantLightSpeed and TabulatedLightSpeed profiles. Callable
+ * profiles cannot be saved; the caller must rebuild the Manifold itself when restarting.
+ */
+template <typename Geometry>
+class Checkpoint final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+  using ParticleId = typename Assembly<Geometry>::ParticleId;
+
+  static constexpr uint32_t METADATA{io::checkpoint_tag("META")};
+  static constexpr uint32_t PARENTS{io::checkpoint_tag("PRNT")};
+  static constexpr uint32_t LOCAL_POSES{io::checkpoint_tag("POSE")};
+  static constexpr uint32_t VELOCITIES{io::checkpoint_tag("VELO")};
+  static constexpr uint32_t COUPLINGS{io::checkpoint_tag("CPLG")};
+  static constexpr uint32_t WORLDLINE_HANDLES{io::checkpoint_tag("WLHD")};
+  static constexpr uint32_t WORLDLINES{io::checkpoint_tag("WLIX")};
+  static constexpr uint32_t WORLDLINE_STATES{io::checkpoint_tag("WLST")};
+  static constexpr uint32_t LIGHT_SPEED{io::checkpoint_tag("LITE")};
+
+  enum class LightSpeedKind : uint32_t {
+    NONE,
+    CONSTANT,
+    TABULATED,
+  };
+
+  struct Metadata final {
+    uint32_t num_basis_blades;
+    uint32_t scalar_size;
+    uint32_t num_positive_bases;
+    uint32_t num_negative_bases;
+    uint32_t num_zero_bases;
+    LightSpeedKind light_speed_kind;
+    uint64_t step;
+    double time;
+    uint64_t num_particles;
+    uint64_t num_worldlines;
+  };
+
+  struct WorldlineRecord final {
+    uint64_t first_sample;
+    uint64_t num_samples;
+    uint64_t capacity;
+  };
+
+ private:
+  using Algebra = typename Geometry::Algebra;
+  static constexpr size_t NUM_BLADES{Algebra::NUM_BASIS_BLADES};
+
+  // Whether multivectors are laid out exactly as their stored coefficients, so that arrays of them
+  // restore with a single copy.
+  static constexpr bool IS_PACKED{std::is_trivially_copyable_v<Multivector> &&
+                                  sizeof(Multivector) == NUM_BLADES * sizeof(ScalarType)};
+
+  io::MappedCheckpoint file_;
+  Metadata metadata_{};
+
+  static void pack(const Multivector& value, std::vector<ScalarType>& out) {
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      out.push_back(value.coefficient(i));
+    }
+  }
+
+  static std::vector<ScalarType> pack(std::span<const Multivector> values) {
+    std::vector<ScalarType> out{};
+    out.reserve(values.size() * NUM_BLADES);
+    for (const Multivector& value : values) {
+      pack(value, out);
+    }
+    return out;
+  }
+
+  static void unpack(const std::byte* bytes, size_t count, Multivector* out) noexcept {
+    if constexpr (IS_PACKED) {
+      std::memcpy(static_cast<void*>(out), bytes, count * sizeof(Multivector));
+    } else {
+      for (size_t k = 0; k < count; ++k) {
+        for (size_t i = 0; i < NUM_BLADES; ++i) {
+          ScalarType value;
+          std::memcpy(&value, bytes + (k * NUM_BLADES + i) * sizeof(ScalarType), sizeof(value));
+          out[k].set_coefficient(i, value);
+        }
+      }
+    }
+  }
+
+  // The section as an array of count records of record_size bytes, or a throw if it is not.
+  std::span<const std::byte> section(uint32_t tag, size_t count, size_t record_size) const {
+    const std::span<const std::byte> bytes{file_.section(tag)};
+    if (bytes.size() != count * record_size) {
+      LOG(WARNING) << "Checkpoint section has the wrong size. File: '" << file_.path()
+                   << "', tag: " << tag << ", bytes: " << bytes.size();
+      throw std::runtime_error("Checkpoint section has the wrong size.");
+    }
+    return bytes;
+  }
+
+  std::vector<Multivector> multivectors(uint32_t tag) const {
+    const size_t count{metadata_.num_particles};
+    const std::span<const std::byte> bytes{section(tag, count, NUM_BLADES * sizeof(ScalarType))};
+    std::vector<Multivector> values(count);
+    unpack(bytes.data(), count, values.data());
+    return values;
+  }
+
+  std::vector<uint64_t> integers(uint32_t tag) const {
+    const size_t count{metadata_.num_particles};
+    const std::span<const std::byte> bytes{section(tag, count, sizeof(uint64_t))};
+    std::vector<uint64_t> values(count);
+    std::memcpy(values.data(), bytes.data(), bytes.size());
+    return values;
+  }
+
+  WorldlineRecord worldline_record(size_t index) const {
+    LOG_IF(FATAL, index >= metadata_.num_worldlines) << "Unknown worldline " << index << ".";
+    const std::span<const std::byte> records{
+        section(WORLDLINES, metadata_.num_worldlines, sizeof(WorldlineRecord))};
+    WorldlineRecord record{};
+    std::memcpy(&record, records.data() + index * sizeof(record), sizeof(record));
+    return record;
+  }
+
+ public:
+  /**
+   * Saves the simulation at the given step and time to path, atomically replacing any file there.
+   * The worldlines are saved in order; each particle's worldline handle refers to one of them by
+   * index, or is NO_WORLDLINE.
+   */
+  template <typename WorldlineType, typename RootFinder, typename LightSpeed>
+  static void save(const std::filesystem::path& path, uint64_t step, ScalarType time,
+                   const Assembly<Geometry>& assembly, std::span<const WorldlineType> worldlines,
+                   const Manifold<Geometry, RootFinder, LightSpeed>& manifold) {
+    Metadata metadata{};
+    metadata.num_basis_blades = NUM_BLADES;
+    metadata.scalar_size = sizeof(ScalarType);
+    metadata.num_positive_bases = Algebra::NUM_POSITIVE_BASES;
+    metadata.num_negative_bases = Algebra::NUM_NEGATIVE_BASES;
+    metadata.num_zero_bases = Algebra::NUM_ZERO_BASES;
+    metadata.step = step;
+    metadata.time = static_cast<double>(time);
+    metadata.num_particles = assembly.size();
+    metadata.num_worldlines = worldlines.size();
+
+    std::vector<ScalarType> light_speed{};
+    if constexpr (std::is_same_v<LightSpeed, ConstantLightSpeed<ScalarType>>) {
+      metadata.light_speed_kind = LightSpeedKind::CONSTANT;
+      light_speed.push_back(manifold.light_speed().speed(0));
+    } else if constexpr (std::is_same_v<LightSpeed, TabulatedLightSpeed<ScalarType>>) {
+      metadata.light_speed_kind = LightSpeedKind::TABULATED;
+      light_speed.push_back(manifold.light_speed().start());
+      light_speed.push_back(manifold.light_speed().spacing());
+      const auto& speeds{manifold.light_speed().speeds()};
+      light_speed.insert(light_speed.end(), speeds.begin(), speeds.end());
+    } else {
+      metadata.light_speed_kind = LightSpeedKind::NONE;
+    }
+
+    const std::span<const ParticleId> parents{assembly.poses().parents()};
+    const std::vector<uint64_t> parent_ids(parents.begin(), parents.end());
+    const std::vector<ScalarType> local_poses{pack(assembly.poses().local_poses())};
+    const std::vector<ScalarType> velocities{pack(assembly.velocities())};
+    const std::vector<ScalarType> couplings{pack(assembly.couplings())};
+    const std::span<const size_t> handles{assembly.worldlines()};
+    const std::vector<uint64_t> handle_ids(handles.begin(), handles.end());
+
+    std::vector<WorldlineRecord> records{};
+    records.reserve(worldlines.size());
+    std::vector<ScalarType> states{};
+    uint64_t num_samples{0};
+    for (const WorldlineType& worldline : worldlines) {
+      const auto& history{worldline.history()};
+      records.push_back(WorldlineRecord{num_samples, history.size(), history.capacity()});
+      num_samples += history.size();
+    }
+    states.reserve(num_samples * 2 * NUM_BLADES);
+    for (const WorldlineType& worldline : worldlines) {
+      const auto& history{worldline.history()};
+      for (size_t i = 0; i < history.size(); ++i) {
+        const StateType state{history.state(i)};
+        pack(state.template element<0>(), states);
+        pack(state.template element<1>(), states);
+      }
+    }
+
+    io::CheckpointWriter writer{};
+    writer.add_section(METADATA, std::span<const Metadata>{&metadata, 1});
+    writer.add_section(PARENTS, std::span<const uint64_t>{parent_ids});
+    writer.add_section(LOCAL_POSES, std::span<const ScalarType>{local_poses});
+    writer.add_section(VELOCITIES, std::span<const ScalarType>{velocities});
+    writer.add_section(COUPLINGS, std::span<const ScalarType>{couplings});
+    writer.add_section(WORLDLINE_HANDLES, std::span<const uint64_t>{handle_ids});
+    writer.add_section(WORLDLINES, std::span<const WorldlineRecord>{records});
+    writer.add_section(WORLDLINE_STATES, std::span<const ScalarType>{states});
+    if (!light_speed.empty()) {
+      writer.add_section(LIGHT_SPEED, std::span<const ScalarType>{light_speed});
+    }
+    writer.commit(path);
+  }
+
+  /**
+   * Maps the checkpoint at path. Throws if it cannot be read, or was saved from another geometry.
+   */
+  explicit Checkpoint(std::filesystem::path path) : file_{std::move(path)} {
+    const std::span<const std::byte> bytes{section(METADATA, 1, sizeof(Metadata))};
+    std::memcpy(&metadata_, bytes.data(), sizeof(metadata_));
+    if (metadata_.num_basis_blades != NUM_BLADES || metadata_.scalar_size != sizeof(ScalarType) ||
+        metadata_.num_positive_bases != Algebra::NUM_POSITIVE_BASES ||
+        metadata_.num_negative_bases != Algebra::NUM_NEGATIVE_BASES ||
+        metadata_.num_zero_bases != Algebra::NUM_ZERO_BASES) {
+      LOG(WARNING) << "Checkpoint is from another geometry. File: '" << file_.path()
+                   << "', signature: (" << metadata_.num_positive_bases << ", "
+                   << metadata_.num_negative_bases << ", " << metadata_.num_zero_bases
+                   << "), blades: " << metadata_.num_basis_blades
+                   << ", scalar size: " << metadata_.scalar_size;
+      throw std::runtime_error("Checkpoint is from another geometry.");
+    }
+  }
+
+  uint64_t step() const noexcept { return metadata_.step; }
+  ScalarType time() const noexcept { return static_cast<ScalarType>(metadata_.time); }
+  size_t num_particles() const noexcept { return metadata_.num_particles; }
+  size_t num_worldlines() const noexcept { return metadata_.num_worldlines; }
+  LightSpeedKind light_speed_kind() const noexcept { return metadata_.light_speed_kind; }
+  const io::MappedCheckpoint& file() const noexcept { return file_; }
+
+  /**
+   * The saved particles, with their world poses updated.
+   */
+  Assembly<Geometry> restore_assembly() const {
+    const std::vector<uint64_t> parents{integers(PARENTS)};
+    const std::vector<Multivector> local_poses{multivectors(LOCAL_POSES)};
+    const std::vector<Multivector> velocities{multivectors(VELOCITIES)};
+    const std::vector<Multivector> couplings{multivectors(COUPLINGS)};
+    const std::vector<uint64_t> handles{integers(WORLDLINE_HANDLES)};
+
+    Assembly<Geometry> assembly{};
+    assembly.reserve(num_particles());
+    for (size_t i = 0; i < num_particles(); ++i) {
+      if (parents[i] != Assembly<Geometry>::NO_PARENT && parents[i] >= i) {
+        LOG(WARNING) << "Checkpoint particle precedes its parent. File: '" << file_.path()
+                     << "', particle: " << i;
+        throw std::runtime_error("Checkpoint particle precedes its parent.");
+      }
+      const ParticleId particle{
+          assembly.add(parents[i], local_poses[i], couplings[i], handles[i])};
+      assembly.set_velocity(particle, velocities[i]);
+    }
+    assembly.update_world_poses();
+    return assembly;
+  }
+
+  /**
+   * The history capacity the worldline was saved with, with which to construct its replacement.
+   */
+  size_t worldline_capacity(size_t index) const { return worldline_record(index).capacity; }
+
+  size_t worldline_size(size_t index) const { return worldline_record(index).num_samples; }
+
+  /**
+   * Records the saved samples of a worldline into an empty one, which must have room for them.
+   */
+  template <typename WorldlineType>
+  void restore_worldline(size_t index, WorldlineType& worldline) const {
+    const WorldlineRecord record{worldline_record(index)};
+    LOG_IF(FATAL, !worldline.empty()) << "Worldlines must be restored into empty worldlines.";
+    LOG_IF(FATAL, worldline.history().capacity() < record.num_samples)
+        << "Worldline capacity " << worldline.history().capacity() << " cannot hold "
+        << record.num_samples << " restored samples.";
+
+    const size_t state_size{2 * NUM_BLADES * sizeof(ScalarType)};
+    const std::span<const std::byte> states{file_.section(WORLDLINE_STATES)};
+    if (states.size() < (record.first_sample + record.num_samples) * state_size) {
+      LOG(WARNING) << "Checkpoint worldline exceeds its states. File: '" << file_.path()
+                   << "', worldline: " << index;
+      throw std::runtime_error("Checkpoint worldline exceeds its states.");
+    }
+    for (size_t i = 0; i < record.num_samples; ++i) {
+      const std::byte* bytes{states.data() + (record.first_sample + i) * state_size};
+      std::array<Multivector, 2> elements{};
+      unpack(bytes, elements.size(), elements.data());
+      StateType state{};
+      state.template set_element<0>(elements[0]);
+      state.template set_element<1>(elements[1]);
+      worldline.record_state(state);
+    }
+  }
+
+  /**
+   * The saved speed of light, for Manifolds with the profile it was saved from.
+   */
+  template <typename LightSpeed>
+  LightSpeed light_speed() const {
+    constexpr bool IS_CONSTANT{std::is_same_v<LightSpeed, ConstantLightSpeed<ScalarType>>};
+    constexpr bool IS_TABULATED{std::is_same_v<LightSpeed, TabulatedLightSpeed<ScalarType>>};
+    static_assert(IS_CONSTANT || IS_TABULATED, "Only constant and tabulated speeds are saved.");
+
+    const LightSpeedKind expected{IS_CONSTANT ? LightSpeedKind::CONSTANT
+                                              : LightSpeedKind::TABULATED};
+    const std::span<const std::byte> bytes{file_.section(LIGHT_SPEED)};
+    const size_t count{bytes.size() / sizeof(ScalarType)};
+    if (metadata_.light_speed_kind != expected || count < (IS_CONSTANT ? 1 : 4)) {
+      LOG(WARNING) << "Checkpoint has another speed of light profile. File: '" << file_.path()
+                   << "'";
+      throw std::runtime_error("Checkpoint has another speed of light profile.");
+    }
+    std::vector<ScalarType> values(count);
+    std::memcpy(values.data(), bytes.data(), count * sizeof(ScalarType));
+    if constexpr (IS_CONSTANT) {
+      return LightSpeed{values[0]};
+    } else {
+      return LightSpeed{values[0], values[1],
+                        std::vector<ScalarType>(values.begin() + 2, values.end())};
+    }
+  }
+};
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,262 @@
+#include "assembly/checkpoint.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "assembly/assembly.h"
+#include "assembly/geometry_test_utils.h"
+#include "assembly/light_speed.h"
+#include "assembly/manifold.h"
+#include "assembly/root_finders.h"
+#include "assembly/worldline.h"
+#include "assembly/worldline_history.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "io/checkpoint.h"
+#include "testing/test_temp_directory.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class CheckpointTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using StateType = math::State<Geometry, 2>;
+  using ConstantManifold = Manifold<Geometry, BrentRootFinder, ConstantLightSpeed<Scalar>>;
+  using TabulatedManifold = Manifold<Geometry, BrentRootFinder, TabulatedLightSpeed<Scalar>>;
+
+  std::filesystem::path directory_{
+      ndyn::testing::TestTempDirectory::getInstance()->createTestSubdirectory()};
+
+  static StateType make_state(Scalar t, Scalar phase) {
+    StateType s;
+    s.template set_element<0>(Geometry::translator(2 * t, std::sin(t + phase), phase) *
+                              Geometry::identity_at_time(t));
+    s.template set_element<1>(Geometry::bivector_xy(std::cos(t + phase)));
+    return s;
+  }
+
+  /**
+   * A tree of count particles, every third a root, with distinct poses, velocities and couplings,
+   * each with a worldline of its own.
+   */
+  static Assembly<Geometry> particles(size_t count) {
+    Assembly<Geometry> assembly;
+    assembly.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      const auto parent{i % 3 == 0 ? Assembly<Geometry>::NO_PARENT : i - 1};
+      const auto particle{assembly.add(parent, Geometry::translator(i, 0.5 * i, -0.25 * i),
+                                       MV{1.0 + i}, i)};
+      assembly.set_velocity(particle, Geometry::bivector_xy(0.1 * i));
+    }
+    assembly.update_world_poses();
+    return assembly;
+  }
+
+  static void expect_equal(const MV& actual, const MV& expected) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      EXPECT_EQ(actual.coefficient(i), expected.coefficient(i)) << "blade: " << i;
+    }
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(CheckpointTest, GeometryTypes);
+
+/**
+ * Particles, worldline samples, the step, the time and the speed of light all restore bit for bit.
+ */
+TYPED_TEST(CheckpointTest, RoundTripsFullState) {
+  using Geometry = TypeParam;
+  using Scalar = typename TestFixture::Scalar;
+  using Manifold = typename TestFixture::ConstantManifold;
+  using WorldlineType = Worldline<Geometry>;
+  const size_t count{10};
+
+  const Manifold manifold{ConstantLightSpeed<Scalar>{2.5}};
+  const auto assembly{this->particles(count)};
+  std::vector<WorldlineType> worldlines{};
+  for (size_t i = 0; i < count; ++i) {
+    worldlines.emplace_back(manifold, 64 + i);
+    for (size_t j = 0; j < 5 * i; ++j) {
+      worldlines.back().record_state(this->make_state(0.1 * j, i));
+    }
+  }
+  const auto path{this->directory_ / "checkpoint"};
+  Checkpoint<Geometry>::save(path, 1234, 5.5, assembly, std::span<const WorldlineType>{worldlines},
+                             manifold);
+  EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+
+  const Checkpoint<Geometry> checkpoint{path};
+  EXPECT_EQ(checkpoint.step(), 1234u);
+  EXPECT_EQ(checkpoint.time(), 5.5);
+  ASSERT_EQ(checkpoint.num_particles(), count);
+  ASSERT_EQ(checkpoint.num_worldlines(), count);
+
+  const auto restored{checkpoint.restore_assembly()};
+  ASSERT_EQ(restored.size(), count);
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(restored.parent(i), assembly.parent(i));
+    EXPECT_EQ(restored.worldline(i), assembly.worldline(i));
+    this->expect_equal(restored.local_pose(i), assembly.local_pose(i));
+    this->expect_equal(restored.world_pose(i), assembly.world_pose(i));
+    this->expect_equal(restored.velocity(i), assembly.velocity(i));
+    this->expect_equal(restored.coupling(i), assembly.coupling(i));
+  }
+
+  const Manifold restored_manifold{checkpoint.template light_speed<ConstantLightSpeed<Scalar>>()};
+  EXPECT_EQ(restored_manifold.calculate_speed_of_light(0), 2.5);
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(checkpoint.worldline_capacity(i), 64 + i);
+    WorldlineType worldline{restored_manifold, checkpoint.worldline_capacity(i)};
+    checkpoint.restore_worldline(i, worldline);
+    ASSERT_EQ(worldline.history().size(), worldlines[i].history().size());
+    for (size_t j = 0; j < worldline.history().size(); ++j) {
+      EXPECT_EQ(worldline.history().time(j), worldlines[i].history().time(j));
+      this->expect_equal(worldline.history().state(j).template element<0>(),
+                         worldlines[i].history().state(j).template element<0>());
+      this->expect_equal(worldline.history().state(j).template element<1>(),
+                         worldlines[i].history().state(j).template element<1>());
+    }
+  }
+}
+
+/**
+ * Encoded histories are saved decoded, and restore into any history policy; tabulated speeds of
+ * light keep their knots.
+ */
+TYPED_TEST(CheckpointTest, RestoresAcrossHistoryPolicies) {
+  using Geometry = TypeParam;
+  using Scalar = typename TestFixture::Scalar;
+  using Manifold = typename TestFixture::TabulatedManifold;
+  using Quantized = Worldline<Geometry, QuantizedHistory<Geometry>>;
+  using Dense = Worldline<Geometry>;
+
+  const Manifold manifold{TabulatedLightSpeed<Scalar>{0, 0.5, {1, 2, 3, 2}}};
+  std::vector<Quantized> worldlines{};
+  worldlines.emplace_back(manifold, 256, 1e-6);
+  for (size_t j = 0; j < 100; ++j) {
+    worldlines.back().record_state(this->make_state(0.05 * j, 0));
+  }
+  const auto path{this->directory_ / "quantized"};
+  Checkpoint<Geometry>::save(path, 7, 5.0, this->particles(1),
+                             std::span<const Quantized>{worldlines}, manifold);
+
+  const Checkpoint<Geometry> checkpoint{path};
+  const auto light_speed{checkpoint.template light_speed<TabulatedLightSpeed<Scalar>>()};
+  EXPECT_EQ(light_speed.speeds(), (std::vector<Scalar>{1, 2, 3, 2}));
+  EXPECT_EQ(light_speed.speed(0.75), manifold.calculate_speed_of_light(0.75));
+  EXPECT_THROW(checkpoint.template light_speed<ConstantLightSpeed<Scalar>>(), std::runtime_error);
+
+  const Manifold restored_manifold{light_speed};
+  Dense dense{restored_manifold, checkpoint.worldline_capacity(0)};
+  checkpoint.restore_worldline(0, dense);
+  ASSERT_EQ(dense.history().size(), 100u);
+  for (size_t j = 0; j < 100; ++j) {
+    this->expect_equal(dense.history().state(j).template element<0>(),
+                       worldlines[0].history().state(j).template element<0>());
+  }
+}
+
+/**
+ * A new checkpoint replaces the old one whole; truncated and foreign files are rejected.
+ */
+TYPED_TEST(CheckpointTest, ReplacesAtomicallyAndRejectsDamage) {
+  using Geometry = TypeParam;
+  using Scalar = typename TestFixture::Scalar;
+  using Manifold = typename TestFixture::ConstantManifold;
+  using WorldlineType = Worldline<Geometry>;
+  const Manifold manifold{ConstantLightSpeed<Scalar>{1}};
+  const std::vector<WorldlineType> none{};
+  const auto path{this->directory_ / "replaced"};
+
+  Checkpoint<Geometry>::save(path, 1, 0.1, this->particles(3),
+                             std::span<const WorldlineType>{none}, manifold);
+  {
+    // A reader keeps the checkpoint it mapped while a new one replaces it.
+    const Checkpoint<Geometry> old{path};
+    Checkpoint<Geometry>::save(path, 2, 0.2, this->particles(6),
+                               std::span<const WorldlineType>{none}, manifold);
+    EXPECT_EQ(old.step(), 1u);
+    EXPECT_EQ(old.restore_assembly().size(), 3u);
+  }
+  EXPECT_EQ(Checkpoint<Geometry>{path}.step(), 2u);
+  EXPECT_EQ(Checkpoint<Geometry>{path}.restore_assembly().size(), 6u);
+
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+  EXPECT_THROW(Checkpoint<Geometry>{path}, std::runtime_error);
+
+  const auto foreign{this->directory_ / "foreign"};
+  std::ofstream{foreign} << "not a checkpoint, but long enough to hold a header";
+  EXPECT_THROW(Checkpoint<Geometry>{foreign}, std::runtime_error);
+  EXPECT_THROW(Checkpoint<Geometry>{this->directory_ / "missing"}, std::runtime_error);
+}
+
+/**
+ * A checkpoint refuses a geometry with as many blades as its own but another signature.
+ */
+TEST(CheckpointSignatureTest, RejectsAlgebrasWithTheSameBladeCount) {
+  using Geometry = PgaSpacetimeGeometry;
+  using ConstantManifold = Manifold<Geometry, BrentRootFinder, ConstantLightSpeed<double>>;
+  using WorldlineType = Worldline<Geometry>;
+  static_assert(Vga4dGeometry::Algebra::NUM_BASIS_BLADES == Geometry::Algebra::NUM_BASIS_BLADES);
+
+  const ConstantManifold manifold{ConstantLightSpeed<double>{1}};
+  const std::vector<WorldlineType> none{};
+  Assembly<Geometry> assembly{};
+  assembly.add(Assembly<Geometry>::NO_PARENT, Geometry::translator(1, 2, 3),
+               Geometry::Multivector{1}, Assembly<Geometry>::NO_WORLDLINE);
+  const auto path{ndyn::testing::TestTempDirectory::getInstance()->createTestSubdirectory() /
+                  "pga"};
+  Checkpoint<Geometry>::save(path, 0, 0, assembly, std::span<const WorldlineType>{none},
+                             manifold);
+
+  EXPECT_EQ(Checkpoint<Geometry>{path}.num_particles(), 1u);
+  EXPECT_THROW(Checkpoint<Vga4dGeometry>{path}, std::runtime_error);
+}
+
+/**
+ * Benchmark: time to save, and to map and restore the particles, as the state grows.
+ */
+TYPED_TEST(CheckpointTest, RestartTime) {
+  using Geometry = TypeParam;
+  using Scalar = typename TestFixture::Scalar;
+  using Manifold = typename TestFixture::ConstantManifold;
+  using WorldlineType = Worldline<Geometry>;
+  const Manifold manifold{ConstantLightSpeed<Scalar>{1}};
+  const std::vector<WorldlineType> none{};
+
+  for (const size_t count : {1000, 10000, 100000}) {
+    const auto assembly{this->particles(count)};
+    const auto path{this->directory_ / ("restart_" + std::to_string(count))};
+
+    const auto start{std::chrono::steady_clock::now()};
+    Checkpoint<Geometry>::save(path, 0, 0, assembly, std::span<const WorldlineType>{none},
+                               manifold);
+    const auto saved{std::chrono::steady_clock::now()};
+    const Checkpoint<Geometry> checkpoint{path};
+    const auto mapped{std::chrono::steady_clock::now()};
+    const auto restored{checkpoint.restore_assembly()};
+    const auto end{std::chrono::steady_clock::now()};
+
+    const auto milliseconds{[](auto duration) {
+      return std::chrono::duration<double, std::milli>(duration).count();
+    }};
+    LOG(INFO) << count << " particles, " << checkpoint.file().size() << " bytes: save "
+              << milliseconds(saved - start) << " ms, map " << milliseconds(mapped - saved)
+              << " ms, restore " << milliseconds(end - mapped) << " ms";
+    EXPECT_EQ(restored.size(), count);
+  }
+}
+
+}  // namespace ndyn::test
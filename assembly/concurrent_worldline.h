@@ -0,0 +1,304 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "assembly/worldline.h"
+#include "glog/logging.h"
+#include "math/state.h"
+
+namespace ndyn::assembly {
+
+/**
+ * A Worldline that one thread appends to while any number of other threads sample it.
+ *
+ * The history is a fixed ring of slots addressed by a monotonically increasing logical index; the
+ * live samples are the logical range [head_, tail_). Publication uses two levels of seqlock:
+ *
+ *  - Each slot carries a sequence number derived from the logical index it holds: 2k + 1 while
+ *    sample k is being written and 2k + 2 once it is complete. A reader that expects sample k and
+ *    sees any other value, before or after copying the payload, knows the slot was recycled under
+ *    it and retries.
+ *  - A global epoch is made odd for the duration of a decimation, which renumbers every live
+ *    sample at once. Readers snapshot the epoch before a lookup and retry if it changed.
+ *
+ * Appends and pruning never touch the epoch, so the common path costs the writer two release
+ * stores per sample. The writer never waits on readers. Readers never take a lock; they only retry
+ * when the writer recycled or renumbered the very samples they were using.
+ *
+ * Every payload word is a relaxed std::atomic, so a reader racing with the writer copies stale or
+ * mixed values, never undefined ones; the sequence checks then discard the copy. This keeps the
+ * protocol free of data races in the C++ memory model and clean under ThreadSanitizer.
+ *
+ * The causal pruning and decimation policy is the same as Worldline's.
+ */
+template <typename Geometry>
+class ConcurrentWorldline final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+
+ private:
+  static constexpr size_t NUM_BLADES{Geometry::Algebra::NUM_BASIS_BLADES};
+
+  struct Slot final {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<ScalarType> time{};
+    std::array<std::atomic<ScalarType>, 2 * NUM_BLADES> coefficients{};
+  };
+
+  static constexpr uint64_t writing(uint64_t index) { return 2 * index + 1; }
+  static constexpr uint64_t complete(uint64_t index) { return 2 * index + 2; }
+
+  // The speed of light of the Manifold, which must outlive this worldline.
+  std::function<ScalarType(ScalarType)> speed_of_light_;
+  const size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+
+  // Logical index of the oldest live sample and one past the newest.
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+
+  // Odd while a decimation is renumbering the live samples.
+  std::atomic<uint64_t> epoch_{0};
+
+  Slot& slot(uint64_t index) const noexcept { return slots_[index % capacity_]; }
+
+  /**
+   * Writer-side only. The writer is the sole mutator, so it may read its own slots without any
+   * validation.
+   */
+  ScalarType owned_time(uint64_t index) const noexcept {
+    return slot(index).time.load(std::memory_order_relaxed);
+  }
+
+  void write_slot(uint64_t index, ScalarType t, const StateType& state) noexcept {
+    Slot& s{slot(index)};
+    s.sequence.store(writing(index), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s.time.store(t, std::memory_order_relaxed);
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      s.coefficients[i].store(state.template element<0>().coefficient(i),
+                              std::memory_order_relaxed);
+      s.coefficients[NUM_BLADES + i].store(state.template element<1>().coefficient(i),
+                                           std::memory_order_relaxed);
+    }
+
+    s.sequence.store(complete(index), std::memory_order_release);
+  }
+
+  void copy_slot(uint64_t from, uint64_t to) noexcept {
+    Slot& source{slot(from)};
+    Slot& destination{slot(to)};
+    destination.sequence.store(writing(to), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    destination.time.store(source.time.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    for (size_t i = 0; i < 2 * NUM_BLADES; ++i) {
+      destination.coefficients[i].store(source.coefficients[i].load(std::memory_order_relaxed),
+                                        std::memory_order_relaxed);
+    }
+
+    destination.sequence.store(complete(to), std::memory_order_release);
+  }
+
+  /**
+   * Reader-side copy of sample `index`. Returns false if the slot does not hold that sample, or was
+   * overwritten while being copied.
+   */
+  bool read_slot(uint64_t index, ScalarType& t, StateType* state) const noexcept {
+    const Slot& s{slot(index)};
+    const uint64_t before{s.sequence.load(std::memory_order_acquire)};
+    if (before != complete(index)) {
+      return false;
+    }
+
+    t = s.time.load(std::memory_order_relaxed);
+    if (state != nullptr) {
+      Multivector pose{};
+      Multivector velocity{};
+      for (size_t i = 0; i < NUM_BLADES; ++i) {
+        pose.set_coefficient(i, s.coefficients[i].load(std::memory_order_relaxed));
+        velocity.set_coefficient(i, s.coefficients[NUM_BLADES + i].load(std::memory_order_relaxed));
+      }
+      state->template set_element<0>(pose);
+      state->template set_element<1>(velocity);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return s.sequence.load(std::memory_order_relaxed) == before;
+  }
+
+  /**
+   * Writer-side. Removes every other live sample, keeping the oldest, and renumbers the survivors
+   * contiguously from head_.
+   */
+  void decimate() noexcept {
+    const uint64_t head{head_.load(std::memory_order_relaxed)};
+    const uint64_t tail{tail_.load(std::memory_order_relaxed)};
+
+    epoch_.fetch_add(1, std::memory_order_acq_rel);
+    uint64_t next{head};
+    for (uint64_t index = head; index < tail; index += 2) {
+      if (index != next) {
+        copy_slot(index, next);
+      }
+      ++next;
+    }
+    tail_.store(next, std::memory_order_release);
+    epoch_.fetch_add(1, std::memory_order_release);
+  }
+
+  /**
+   * Writer-side. Retires every sample older than t by advancing head_. The retired slots are
+   * recycled by later appends; readers still using them notice via the slot sequence.
+   */
+  void drop_before(ScalarType t) noexcept {
+    const uint64_t tail{tail_.load(std::memory_order_relaxed)};
+    uint64_t head{head_.load(std::memory_order_relaxed)};
+    while (head < tail && owned_time(head) < t) {
+      ++head;
+    }
+    head_.store(head, std::memory_order_release);
+  }
+
+ public:
+  template <typename RootFinder, typename LightSpeed>
+  explicit ConcurrentWorldline(const Manifold<Geometry, RootFinder, LightSpeed>& manifold,
+                               size_t max_size = 1024)
+      : speed_of_light_{[&manifold](ScalarType t) { return manifold.calculate_speed_of_light(t); }},
+        capacity_{max_size},
+        slots_{std::make_unique<Slot[]>(max_size)} {
+    LOG_IF(FATAL, max_size < 2) << "ConcurrentWorldline requires room for at least two samples.";
+  }
+
+  /**
+   * Appends a state. Must only be called from the single writer thread.
+   */
+  void record_state(const StateType& state) noexcept {
+    const ScalarType t_now{Geometry::extract_time(state.template element<0>())};
+
+    if (size() == capacity_) {
+      const ScalarType speed_of_light{speed_of_light_(t_now)};
+      const ScalarType t_oldest{owned_time(head_.load(std::memory_order_relaxed))};
+      const ScalarType causal_limit{t_now - (Geometry::max_system_radius() / speed_of_light)};
+
+      if (t_oldest > causal_limit) {
+        LOG(WARNING) << "Causal horizon reaching buffer limit. Decimating Worldline.";
+        decimate();
+      } else {
+        drop_before(causal_limit);
+      }
+    }
+
+    LOG_IF(FATAL, size() == capacity_)
+        << "Invalid history size. Worldline would exceed memory bounds.";
+
+    const uint64_t tail{tail_.load(std::memory_order_relaxed)};
+    write_slot(tail, t_now, state);
+    tail_.store(tail + 1, std::memory_order_release);
+  }
+
+  /**
+   * Samples the worldline at time t. Safe to call from any thread concurrently with
+   * record_state(). The result is always built from samples that were simultaneously live.
+   */
+  StateType get_state_at(ScalarType t) const noexcept {
+    while (true) {
+      const uint64_t epoch{epoch_.load(std::memory_order_acquire)};
+      if (epoch % 2 == 1) {
+        continue;
+      }
+
+      const uint64_t head{head_.load(std::memory_order_acquire)};
+      const uint64_t tail{tail_.load(std::memory_order_acquire)};
+      if (head == tail) {
+        return {};
+      }
+
+      // Binary search for the first sample with time >= t, validating every probe.
+      uint64_t lower{head};
+      uint64_t upper{tail};
+      bool valid{true};
+      while (valid && lower < upper) {
+        const uint64_t middle{lower + (upper - lower) / 2};
+        ScalarType middle_time{};
+        valid = read_slot(middle, middle_time, nullptr);
+        if (middle_time < t) {
+          lower = middle + 1;
+        } else {
+          upper = middle;
+        }
+      }
+
+      StateType result{};
+      if (valid) {
+        if (lower == head || lower == tail) {
+          // Clamp to the oldest or newest sample.
+          ScalarType sample_time{};
+          valid = read_slot(lower == head ? head : tail - 1, sample_time, &result);
+        } else {
+          StateType s0{};
+          StateType s1{};
+          ScalarType t0{};
+          ScalarType t1{};
+          valid = read_slot(lower - 1, t0, &s0) && read_slot(lower, t1, &s1);
+          if (valid) {
+            result = interpolate_states<Geometry>(s0, t0, s1, t1, t);
+          }
+        }
+      }
+
+      if (valid && epoch_.load(std::memory_order_acquire) == epoch) {
+        return result;
+      }
+    }
+  }
+
+  ScalarType oldest_time() const noexcept { return end_time(/* oldest= */ true); }
+
+  ScalarType latest_time() const noexcept { return end_time(/* oldest= */ false); }
+
+  /**
+   * Number of live samples. From a reader thread this is a snapshot that may be stale by the time
+   * it is used.
+   */
+  size_t size() const noexcept {
+    // Load head_ first: it never overtakes tail_, so this order cannot produce a negative size.
+    const uint64_t head{head_.load(std::memory_order_acquire)};
+    const uint64_t tail{tail_.load(std::memory_order_acquire)};
+    return static_cast<size_t>(tail - head);
+  }
+
+  bool empty() const noexcept { return size() == 0; }
+
+  size_t capacity() const noexcept { return capacity_; }
+
+ private:
+  ScalarType end_time(bool oldest) const noexcept {
+    while (true) {
+      const uint64_t epoch{epoch_.load(std::memory_order_acquire)};
+      if (epoch % 2 == 1) {
+        continue;
+      }
+      const uint64_t head{head_.load(std::memory_order_acquire)};
+      const uint64_t tail{tail_.load(std::memory_order_acquire)};
+      if (head == tail) {
+        return 0;
+      }
+      ScalarType t{};
+      if (read_slot(oldest ? head : tail - 1, t, nullptr) &&
+          epoch_.load(std::memory_order_acquire) == epoch) {
+        return t;
+      }
+    }
+  }
+};
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,151 @@
+#include "assembly/concurrent_worldline.h"
+
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "assembly/geometry_test_utils.h"
+#include "assembly/manifold.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+/**
+ * Stress tests for the single-writer / multi-reader protocol. These are most useful under
+ * ThreadSanitizer:
+ *
+ *   CC=clang bazel test --config tsan //assembly:concurrent_worldline_test
+ */
+template <typename Geometry>
+class ConcurrentWorldlineTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using StateType = math::State<Geometry, 2>;
+
+  static constexpr size_t NUM_READERS{4};
+  static constexpr int NUM_SAMPLES{20000};
+  static constexpr Scalar DT{0.01};
+  static constexpr Scalar TOLERANCE{1e-6};
+
+  auto constant_c(Scalar value) {
+    return [value](Scalar /*time*/) { return value; };
+  }
+
+  static MV position(const MV& pose) { return pose * Geometry::origin() * ~pose; }
+
+  // The particle moves along the line (2t, 3t, 0). Interpolation of pure translations is exact, so
+  // every sample of the worldline lies on this line. A torn read would mix the x and y components
+  // of different samples and fall off it.
+  static StateType make_state(Scalar t) {
+    StateType s;
+    s.template set_element<0>(Geometry::translator(2 * t, 3 * t, 0) *
+                              Geometry::identity_at_time(t));
+    return s;
+  }
+
+  /**
+   * Runs one writer and NUM_READERS readers against the same worldline and returns the number of
+   * samples that were not on the trajectory.
+   */
+  int hammer(const Manifold<Geometry>& manifold, size_t capacity) {
+    ConcurrentWorldline<Geometry> worldline(manifold, capacity);
+    worldline.record_state(make_state(0));
+
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+
+    const MV reference{position(Geometry::translator(0, 100, 0))};
+    const Scalar speed{std::sqrt(Scalar{13})};
+
+    std::vector<std::thread> readers{};
+    for (size_t r = 0; r < NUM_READERS; ++r) {
+      readers.emplace_back([&, r]() {
+        std::mt19937 generator{static_cast<unsigned>(r)};
+        std::uniform_real_distribution<Scalar> unit{0, 1};
+        while (!done.load(std::memory_order_acquire)) {
+          const Scalar oldest{worldline.oldest_time()};
+          const Scalar latest{worldline.latest_time()};
+          const Scalar t{oldest + unit(generator) * (latest - oldest)};
+
+          const MV p{position(worldline.get_state_at(t).template element<0>())};
+          const Scalar t_sample{Geometry::distance(p, Geometry::origin()) / speed};
+          const Scalar expected{
+              std::sqrt(4 * t_sample * t_sample + (3 * t_sample - 100) * (3 * t_sample - 100))};
+
+          // t_sample may exceed t only if the samples around t were pruned and the lookup clamped
+          // to a newer oldest sample.
+          if (std::abs(Geometry::distance(p, reference) - expected) > TOLERANCE ||
+              t_sample < t - TOLERANCE) {
+            failures.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      });
+    }
+
+    for (int i = 1; i < NUM_SAMPLES; ++i) {
+      worldline.record_state(make_state(DT * i));
+    }
+    done.store(true, std::memory_order_release);
+
+    for (auto& reader : readers) {
+      reader.join();
+    }
+
+    EXPECT_NEAR(worldline.latest_time(), DT * (NUM_SAMPLES - 1), TOLERANCE);
+    return failures.load();
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(ConcurrentWorldlineTest, GeometryTypes);
+
+/**
+ * Fast light keeps the causal horizon short, so the writer continually retires the oldest samples
+ * and recycles their slots underneath the readers.
+ */
+TYPED_TEST(ConcurrentWorldlineTest, ReadersNeverSeeTornStatesWhilePruning) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(4000));
+  EXPECT_EQ(this->hammer(manifold, 64), 0);
+}
+
+/**
+ * Slow light keeps every sample causally reachable, so the writer repeatedly decimates the whole
+ * ring while readers are searching it.
+ */
+TYPED_TEST(ConcurrentWorldlineTest, ReadersNeverSeeTornStatesWhileDecimating) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(1e-3));
+  EXPECT_EQ(this->hammer(manifold, 64), 0);
+}
+
+/**
+ * With no concurrent writer the concurrent variant must agree with the plain Worldline.
+ */
+TYPED_TEST(ConcurrentWorldlineTest, MatchesWorldlineSingleThreaded) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(1.0));
+  Worldline<Geometry> reference(manifold, 32);
+  ConcurrentWorldline<Geometry> concurrent(manifold, 32);
+
+  for (int i = 0; i < 100; ++i) {
+    reference.record_state(this->make_state(0.1 * i));
+    concurrent.record_state(this->make_state(0.1 * i));
+  }
+
+  EXPECT_EQ(reference.oldest_time(), concurrent.oldest_time());
+  EXPECT_EQ(reference.latest_time(), concurrent.latest_time());
+  for (double t = 0; t < 10; t += 0.37) {
+    const auto expected{this->position(reference.get_state_at(t).template element<0>())};
+    const auto actual{this->position(concurrent.get_state_at(t).template element<0>())};
+    EXPECT_NEAR(Geometry::distance(expected, actual), 0, this->TOLERANCE) << "t: " << t;
+  }
+}
+
+}  // namespace ndyn::test
@@ -1,12 +1,18 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
 #include <vector>
 
 #include "assembly/field.h"
+#include "assembly/field_set.h"
 #include "assembly/manifold.h"
 #include "assembly/particle.h"
-#include "math/geometry_model.h"
+#include "assembly/pose_hierarchy.h"
+#include "assembly/propagator.h"
+#include "assembly/retardation_cache.h"
 #include "math/state.h"
 
 namespace ndyn::assembly {
@@ -31,18 +37,23 @@ namespace ndyn::assembly {
  * operators, the sandwich product provides a consistent way to reframe any multivector
  * (positions, velocities, or fields) across the hierarchy.
  */
-template <math::ConformalGeometryModel Geometry>
+template <typename Geometry, typename RootFinder = BrentRootFinder,
+          typename LightSpeed = CallableLightSpeed<typename Geometry::ScalarType>>
 class Connection final {
  public:
   using Multivector = typename Geometry::Multivector;
   using ScalarType = typename Geometry::ScalarType;
   using StateType = math::State<Geometry, 2>;
+  using PropagatorType = Propagator<Geometry, RootFinder, LightSpeed>;
 
  private:
-  const Manifold<Geometry>* manifold_;
+  const Manifold<Geometry, RootFinder, LightSpeed>* manifold_;
   const Particle<Geometry>* leaf_;
   // parents_[0] is the leaf's immediate parent; parents_.back() is the root.
   std::vector<const Particle<Geometry>*> parents_;
+  // When set, the parent's world pose is read from this cache instead of composing parents_.
+  const PoseHierarchy<Geometry>* poses_{nullptr};
+  typename PoseHierarchy<Geometry>::NodeId parent_node_{PoseHierarchy<Geometry>::NO_PARENT};
 
  public:
   /**
@@ -54,8 +65,8 @@ class Connection final {
    * left-multiplication when computing the world pose.
    */
   template <typename... Args>
-  Connection(const Manifold<Geometry>& manifold, const Particle<Geometry>& leaf,
-             const Args&... hierarchy_pack)
+  Connection(const Manifold<Geometry, RootFinder, LightSpeed>& manifold,
+             const Particle<Geometry>& leaf, const Args&... hierarchy_pack)
       : manifold_{&manifold}, leaf_{&leaf} {
     parents_.reserve(sizeof...(Args));
     const Particle<Geometry>* temporary_pack[] = {(&hierarchy_pack)...};
@@ -64,6 +75,25 @@ class Connection final {
     }
   }
 
+  /**
+   * As above, but reads the parent's world pose from a PoseHierarchy, where parent_node is the
+   * parent's node, in O(1) instead of composing the chain on every call. The hierarchy must be
+   * updated before each step's first read. The chain is still required for the parent's worldline.
+   */
+  template <typename... Args>
+  Connection(const Manifold<Geometry, RootFinder, LightSpeed>& manifold,
+             const PoseHierarchy<Geometry>& poses,
+             typename PoseHierarchy<Geometry>::NodeId parent_node, const Particle<Geometry>& leaf,
+             const Args&... hierarchy_pack)
+      : Connection(manifold, leaf, hierarchy_pack...) {
+    poses_ = &poses;
+    parent_node_ = parent_node;
+  }
+
+  /**
+   * Extends the chain of initial with a more distal parent. The extended chain no longer matches
+   * any cached node, so the result composes its world pose from the chain.
+   */
   Connection(const Particle<Geometry>& distal_parent, const Connection& initial)
       : manifold_{initial.manifold_}, leaf_{initial.leaf_}, parents_{initial.parents_} {
     parents_.push_back(&distal_parent);
@@ -78,8 +108,14 @@ class Connection final {
    * motor, we recursively "wrap" the geometry in its parents' reference frames.
    * This builds the unique transition map that lifts a multivector from the parent's
    * local fiber into the base manifold's global frame.
+   *
+   * With a PoseHierarchy, the product has already been formed once for the step and is read
+   * directly.
    */
   Multivector compute_parent_world_pose() const noexcept {
+    if (poses_ != nullptr) {
+      return poses_->world_pose(parent_node_);
+    }
     Multivector world_pose{static_cast<ScalarType>(1)};
     for (const auto* parent : parents_) {
       world_pose = parent->current_state().template element<0>() * world_pose;
@@ -105,16 +141,29 @@ class Connection final {
    * Returns the transition motor M = (~leaf_world) * M_transport * parent_world
    */
   Multivector compute_total_motor() const noexcept {
-    const Multivector leaf_world_pose{leaf_->current_state().template element<0>()};
-    const Multivector parent_world_pose{compute_parent_world_pose()};
+    return compose_total_motor([this](const Multivector& leaf_world_pose) {
+      return manifold_->transport(parents_.front()->worldline(), leaf_world_pose);
+    });
+  }
 
-    // transport() handles the light-cone intersection (retardation) and the
-    // manifold's geometric curvature between the two world-events.
-    const Multivector M_transport{
-        manifold_->transport(parents_.front()->worldline(), leaf_world_pose)};
+  /**
+   * As compute_total_motor(), but resolves retardation through a per-step cache shared with other
+   * connections and with the other stages of the same step.
+   */
+  Multivector compute_total_motor(RetardationCache<Geometry>& cache) const noexcept {
+    return compose_total_motor([this, &cache](const Multivector& leaf_world_pose) {
+      return manifold_->transport(parents_.front()->worldline(), leaf_world_pose, cache);
+    });
+  }
 
-    // The composition maps: Parent_Local -> World -> (Transport) -> World -> Leaf_Local
-    return (~leaf_world_pose) * M_transport * parent_world_pose;
+  /**
+   * As compute_total_motor(), but takes the retarded source event from a Propagator shared with
+   * other connections for the current step.
+   */
+  Multivector compute_total_motor(PropagatorType& propagator) const noexcept {
+    return compose_total_motor([this, &propagator](const Multivector& leaf_world_pose) {
+      return propagator.transport(parents_.front()->worldline(), leaf_world_pose);
+    });
   }
 
   /**
@@ -132,24 +181,167 @@ class Connection final {
    * the Leaf's local frame for integration.
    * Reference: https://en.wikipedia.org/wiki/Bivector
    */
-  Multivector calculate_influence(const Field<Geometry>& field) const noexcept {
-    const Multivector coupling_in_leaf{leaf_->coupling(field)};
+  template <BatchField<Geometry> FieldType>
+  Multivector calculate_influence(const FieldType& field) const noexcept {
+    return calculate_influence(FieldSet<Geometry, FieldType>{field});
+  }
+
+  /**
+   * Resolves retardation through the cache, either a RetardationCache or a Propagator; see
+   * compute_total_motor().
+   */
+  template <BatchField<Geometry> FieldType, typename Retardation>
+  Multivector calculate_influence(const FieldType& field, Retardation& cache) const noexcept {
+    return calculate_influence(FieldSet<Geometry, FieldType>{field}, cache);
+  }
+
+  /**
+   * As above, for superposed fields: the motor and the Leaf's frame changes are resolved once, and
+   * the fields' accelerations are summed in the Parent's frame and transported back together. Only
+   * the Leaf's coupling to each field is mapped per field.
+   */
+  template <BatchField<Geometry>... Fields>
+  Multivector calculate_influence(const FieldSet<Geometry, Fields...>& fields) const noexcept {
+    return calculate_influence_with(fields, [this]() { return compute_total_motor(); });
+  }
+
+  template <BatchField<Geometry>... Fields, typename Retardation>
+  Multivector calculate_influence(const FieldSet<Geometry, Fields...>& fields,
+                                  Retardation& cache) const noexcept {
+    return calculate_influence_with(fields,
+                                    [this, &cache]() { return compute_total_motor(cache); });
+  }
 
-    if (Geometry::magnitude_squared(coupling_in_leaf) < Geometry::Algebra::EPSILON) {
+  /**
+   * Evaluates the influences of many connections with a single batched field evaluation:
+   * influences[i] receives connections[i].calculate_influence(field, cache). The motors and frame
+   * changes are resolved per connection; the field sees them all at once.
+   */
+  template <BatchField<Geometry> FieldType, typename Retardation>
+  static void calculate_influences(const FieldType& field, std::span<const Connection> connections,
+                                   Retardation& cache,
+                                   std::span<Multivector> influences) {
+    calculate_influences(FieldSet<Geometry, FieldType>{field}, connections, cache, influences);
+  }
+
+  /**
+   * As above, for superposed fields: one motor and frame change per connection, and one batched
+   * evaluation per field over the connections whose Leaf couples to it.
+   */
+  template <BatchField<Geometry>... Fields, typename Retardation>
+  static void calculate_influences(const FieldSet<Geometry, Fields...>& fields,
+                                   std::span<const Connection> connections, Retardation& cache,
+                                   std::span<Multivector> influences) {
+    static constexpr size_t NUM_FIELDS{sizeof...(Fields)};
+    const size_t count{connections.size()};
+    std::vector<Multivector> motors;
+    std::vector<Multivector> events;
+    std::vector<size_t> active;
+    // For each field, the positions in `active` of the connections coupled to it, and their
+    // couplings in the Parent's frame.
+    std::array<std::vector<size_t>, NUM_FIELDS> coupled;
+    std::array<std::vector<Multivector>, NUM_FIELDS> couplings;
+    motors.reserve(count);
+    events.reserve(count);
+    active.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+      const Connection& connection{connections[i]};
+      influences[i] = Multivector{};
+      const auto couplings_in_leaf{connection.leaf_couplings(fields)};
+      if (!any_coupling(couplings_in_leaf)) continue;
+
+      const Multivector M{connection.compute_total_motor(cache)};
+      const Multivector M_rev{~M};
+      const Multivector leaf_local_pose{connection.leaf_->current_state().template element<0>()};
+      for (size_t k = 0; k < NUM_FIELDS; ++k) {
+        if (negligible(couplings_in_leaf[k])) continue;
+        coupled[k].push_back(active.size());
+        couplings[k].push_back(M_rev * couplings_in_leaf[k] * M);
+      }
+      active.push_back(i);
+      motors.push_back(M);
+      events.push_back(M_rev * leaf_local_pose * M);
+    }
+
+    std::vector<Multivector> parent_accels(active.size());
+    std::vector<Multivector> field_events;
+    std::vector<Multivector> field_accels;
+    fields.for_each([&](size_t k, const auto& field) {
+      field_events.clear();
+      for (const size_t j : coupled[k]) {
+        field_events.push_back(events[j]);
+      }
+      field_accels.resize(field_events.size());
+      field.evaluate_batch(field_events, couplings[k], std::span<Multivector>{field_accels});
+      for (size_t m = 0; m < coupled[k].size(); ++m) {
+        parent_accels[coupled[k][m]] += field_accels[m];
+      }
+    });
+
+    for (size_t j = 0; j < active.size(); ++j) {
+      influences[active[j]] = motors[j] * parent_accels[j] * ~motors[j];
+    }
+  }
+
+ private:
+  template <typename TransportFunc>
+  Multivector compose_total_motor(const TransportFunc& transport) const noexcept {
+    const Multivector leaf_world_pose{leaf_->current_state().template element<0>()};
+    const Multivector parent_world_pose{compute_parent_world_pose()};
+
+    // transport() handles the light-cone intersection (retardation) and the
+    // manifold's geometric curvature between the two world-events.
+    const Multivector M_transport{transport(leaf_world_pose)};
+
+    // The composition maps: Parent_Local -> World -> (Transport) -> World -> Leaf_Local
+    return (~leaf_world_pose) * M_transport * parent_world_pose;
+  }
+
+  static bool negligible(const Multivector& coupling) noexcept {
+    return Geometry::magnitude_squared(coupling) < Geometry::Algebra::EPSILON;
+  }
+
+  template <size_t NUM_FIELDS>
+  static bool any_coupling(const std::array<Multivector, NUM_FIELDS>& couplings) noexcept {
+    return std::any_of(couplings.begin(), couplings.end(),
+                       [](const Multivector& coupling) { return !negligible(coupling); });
+  }
+
+  // The Leaf's coupling to each field of the set, in the Leaf's frame.
+  template <BatchField<Geometry>... Fields>
+  typename FieldSet<Geometry, Fields...>::Couplings leaf_couplings(
+      const FieldSet<Geometry, Fields...>& fields) const noexcept {
+    typename FieldSet<Geometry, Fields...>::Couplings result{};
+    fields.for_each(
+        [this, &result](size_t k, const auto& field) { result[k] = leaf_->coupling(field); });
+    return result;
+  }
+
+  template <BatchField<Geometry>... Fields, typename MotorFunc>
+  Multivector calculate_influence_with(const FieldSet<Geometry, Fields...>& fields,
+                                       const MotorFunc& total_motor) const noexcept {
+    const auto couplings_in_leaf{leaf_couplings(fields)};
+
+    if (!any_coupling(couplings_in_leaf)) {
       return {};
     }
 
-    const Multivector M{compute_total_motor()};
+    const Multivector M{total_motor()};
     const Multivector M_rev{~M};
 
     const Multivector leaf_local_pose{leaf_->current_state().template element<0>()};
 
-    // Map the Leaf's pose and coupling into the Parent's frame for evaluation.
+    // Map the Leaf's pose into the Parent's frame once for all the fields.
     const Multivector leaf_in_parent_frame{M_rev * leaf_local_pose * M};
-    const Multivector coupling_in_parent_frame{M_rev * coupling_in_leaf * M};
 
-    const Multivector parent_accel{
-        field.evaluate_at(leaf_in_parent_frame, coupling_in_parent_frame)};
+    // Sum the accelerations in the Parent's frame, mapping only each field's coupling.
+    Multivector parent_accel{};
+    fields.for_each([&](size_t k, const auto& field) {
+      if (negligible(couplings_in_leaf[k])) return;
+      const Multivector coupling_in_parent_frame{M_rev * couplings_in_leaf[k] * M};
+      parent_accel += field.evaluate_at(leaf_in_parent_frame, coupling_in_parent_frame);
+    });
 
     // Bring the force/acceleration back to the Leaf's frame.
     return M * parent_accel * M_rev;
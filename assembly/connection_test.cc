@@ -0,0 +1,320 @@
+#include "assembly/connection.h"
+
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "assembly/field.h"
+#include "assembly/field_set.h"
+#include "assembly/field_test_utils.h"
+#include "assembly/geometry_test_utils.h"
+#include "assembly/manifold.h"
+#include "assembly/particle.h"
+#include "assembly/pose_hierarchy.h"
+#include "assembly/propagator.h"
+#include "assembly/retardation_cache.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+/**
+ * Counts the batched evaluations of the field it wraps.
+ */
+template <typename Geometry>
+class CountingField final : public Field<Geometry> {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+  explicit CountingField(const Field<Geometry>& field) : field_{&field} {}
+
+  Multivector evaluate_at(const Multivector& event,
+                          const Multivector& coupling) const noexcept override {
+    return field_->evaluate_at(event, coupling);
+  }
+
+  void evaluate_batch(std::span<const Multivector> events, std::span<const Multivector> couplings,
+                      std::span<Multivector> out) const noexcept override {
+    ++batches_;
+    field_->evaluate_batch(events, couplings, out);
+  }
+
+  size_t batches() const noexcept { return batches_; }
+
+ private:
+  const Field<Geometry>* field_;
+  mutable size_t batches_{0};
+};
+
+/**
+ * A uniform push along x, scaled by the coupling, dispatched statically.
+ */
+template <typename Geometry>
+class UniformField final : public StaticField<UniformField<Geometry>, Geometry> {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+  Multivector evaluate_at(const Multivector& /*event*/,
+                          const Multivector& coupling) const noexcept {
+    return Geometry::motor_log(Geometry::translator(0.1 * coupling.scalar(), 0, 0));
+  }
+};
+
+template <typename Geometry>
+class ConnectionTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using StateType = math::State<Geometry, 2>;
+
+  static constexpr Scalar QUANTUM{1e-4};
+  static constexpr Scalar T_NOW{10};
+
+  Manifold<Geometry> manifold_{[](Scalar /*time*/) { return Scalar{1}; }};
+
+  static StateType state_at(Scalar t, Scalar x, Scalar y = 0) {
+    StateType s;
+    s.template set_element<0>(Geometry::translator(x, y, 0) * Geometry::identity_at_time(t));
+    return s;
+  }
+
+  // A pose rotated about z, as a particle's local pose relative to its parent.
+  static StateType rotated(Scalar angle) {
+    StateType s;
+    s.template set_element<0>(Geometry::motor_exp(Geometry::bivector_xy(angle)) *
+                              Geometry::identity_at_time(0));
+    return s;
+  }
+
+  // A source drifting along x with a wobble in y, recorded every 0.1 up to T_NOW.
+  Particle<Geometry> source() const {
+    Particle<Geometry> particle{manifold_, state_at(0, 0)};
+    for (int i = 1; i <= 100; ++i) {
+      const Scalar t{Scalar{0.1} * i};
+      particle.set_state(state_at(t, 0.3 * t, std::sin(t)));
+    }
+    return particle;
+  }
+
+  Particle<Geometry> leaf(Scalar x, Scalar y = 0) const {
+    return Particle<Geometry>{manifold_, state_at(T_NOW, x, y)};
+  }
+
+  // The sum of the squared coefficients, which unlike the algebra's square is zero only for zero.
+  static Scalar coefficient_norm(const MV& m) {
+    Scalar result{0};
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      result += m.coefficient(i) * m.coefficient(i);
+    }
+    return result;
+  }
+
+  static void expect_near(const MV& actual, const MV& expected) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      EXPECT_NEAR(actual.coefficient(i), expected.coefficient(i), 1e-12) << "blade: " << i;
+    }
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(ConnectionTest, GeometryTypes);
+
+/**
+ * The stages of a step that share a time, and connections whose leaves share an event and a
+ * parent, resolve the retardation once through a shared cache, with the result an uncached
+ * connection computes. Leaves that do not couple to the field never reach the cache.
+ */
+TYPED_TEST(ConnectionTest, CachedInfluencesShareSolves) {
+  using Geometry = TypeParam;
+  const InverseSquareField<Geometry> field;
+  const auto parent{this->source()};
+  auto first{this->leaf(5)};
+  auto second{this->leaf(5)};
+  const auto uncoupled{this->leaf(5)};
+  first.set_coupling(field, typename Geometry::Multivector{1});
+  second.set_coupling(field, typename Geometry::Multivector{1});
+
+  const Connection<Geometry> first_connection{this->manifold_, first, parent};
+  const Connection<Geometry> second_connection{this->manifold_, second, parent};
+  const Connection<Geometry> uncoupled_connection{this->manifold_, uncoupled, parent};
+  const auto expected{first_connection.calculate_influence(field)};
+  ASSERT_GT(this->coefficient_norm(expected), 0);
+
+  RetardationCache<Geometry> cache{this->QUANTUM, this->QUANTUM};
+  this->expect_near(first_connection.compute_total_motor(cache),
+                    first_connection.compute_total_motor());
+  for (int stage = 0; stage < 2; ++stage) {
+    this->expect_near(first_connection.calculate_influence(field, cache), expected);
+  }
+  this->expect_near(second_connection.calculate_influence(field, cache), expected);
+  this->expect_near(uncoupled_connection.calculate_influence(field, cache),
+                    typename Geometry::Multivector{});
+
+  EXPECT_EQ(cache.counters().misses, 1u);
+  EXPECT_EQ(cache.counters().hits, 3u);
+  EXPECT_EQ(cache.solver_counters().solves, 1u);
+}
+
+/**
+ * A connection reading its parent's world pose from a PoseHierarchy sees the pose that composing
+ * the chain gives, before and after an ancestor moves.
+ */
+TYPED_TEST(ConnectionTest, HierarchyPosesMatchTheChain) {
+  using Geometry = TypeParam;
+  Particle<Geometry> root{this->manifold_, this->rotated(0.3)};
+  const auto parent{this->source()};
+  const auto leaf{this->leaf(5)};
+
+  PoseHierarchy<Geometry> poses;
+  const auto root_node{poses.add(PoseHierarchy<Geometry>::NO_PARENT,
+                                 root.current_state().template element<0>())};
+  const auto parent_node{poses.add(root_node, parent.current_state().template element<0>())};
+  poses.update();
+
+  const Connection<Geometry> chained{this->manifold_, leaf, root, parent};
+  const Connection<Geometry> cached{this->manifold_, poses, parent_node, leaf, root, parent};
+  this->expect_near(cached.compute_parent_world_pose(), chained.compute_parent_world_pose());
+  this->expect_near(cached.compute_total_motor(), chained.compute_total_motor());
+
+  root.set_state(this->rotated(-0.8));
+  poses.set_local_pose(root_node, root.current_state().template element<0>());
+  poses.update();
+  this->expect_near(cached.compute_parent_world_pose(), chained.compute_parent_world_pose());
+  this->expect_near(cached.compute_total_motor(), chained.compute_total_motor());
+}
+
+/**
+ * The influences of a span of connections come from one batched field evaluation, and are those
+ * each connection computes alone. Connections whose leaf does not couple to the field get none.
+ */
+TYPED_TEST(ConnectionTest, BatchedInfluencesMatchSingleOnes) {
+  using Geometry = TypeParam;
+  using MV = typename Geometry::Multivector;
+  const InverseSquareField<Geometry> inverse_square;
+  const CountingField<Geometry> field{inverse_square};
+  const auto parent{this->source()};
+  std::vector<Particle<Geometry>> leaves;
+  for (int i = 0; i < 5; ++i) {
+    leaves.push_back(this->leaf(3 + i, 0.5 * i));
+  }
+  for (int i = 0; i < 5; ++i) {
+    if (i != 2) leaves[i].set_coupling(field, MV{1 + 0.25 * i});
+  }
+
+  std::vector<Connection<Geometry>> connections;
+  for (const auto& leaf : leaves) {
+    connections.emplace_back(this->manifold_, leaf, parent);
+  }
+  std::vector<MV> influences(connections.size());
+  RetardationCache<Geometry> cache{this->QUANTUM, this->QUANTUM};
+  Connection<Geometry>::calculate_influences(
+      field, std::span<const Connection<Geometry>>{connections}, cache, std::span<MV>{influences});
+
+  EXPECT_EQ(field.batches(), 1u);
+  EXPECT_EQ(cache.counters().misses, 4u);
+  for (size_t i = 0; i < connections.size(); ++i) {
+    SCOPED_TRACE(i);
+    this->expect_near(influences[i], connections[i].calculate_influence(field));
+  }
+  EXPECT_EQ(this->coefficient_norm(influences[2]), 0);
+}
+
+/**
+ * Superposed fields resolve each connection's motor once, and give the sum of the influences of
+ * the fields taken one at a time, for single connections and for batches, whichever of the fields
+ * a leaf couples to.
+ */
+TYPED_TEST(ConnectionTest, SuperposedFieldsResolveOnce) {
+  using Geometry = TypeParam;
+  using MV = typename Geometry::Multivector;
+  const InverseSquareField<Geometry> inverse_square;
+  const CountingField<Geometry> attraction{inverse_square};
+  const UniformField<Geometry> push;
+  const FieldSet<Geometry, CountingField<Geometry>, UniformField<Geometry>> fields{attraction,
+                                                                                   push};
+  const auto parent{this->source()};
+  std::vector<Particle<Geometry>> leaves;
+  for (int i = 0; i < 3; ++i) {
+    leaves.push_back(this->leaf(4 + i, -0.5 * i));
+  }
+  leaves[0].set_coupling(attraction, MV{1});
+  leaves[0].set_coupling(push, MV{2});
+  leaves[1].set_coupling(push, MV{-1});
+  leaves[2].set_coupling(attraction, MV{0.5});
+
+  std::vector<Connection<Geometry>> connections;
+  for (const auto& leaf : leaves) {
+    connections.emplace_back(this->manifold_, leaf, parent);
+  }
+
+  std::vector<MV> expected;
+  for (const auto& connection : connections) {
+    expected.push_back(connection.calculate_influence(attraction) +
+                       connection.calculate_influence(push));
+  }
+  for (size_t i = 0; i < connections.size(); ++i) {
+    SCOPED_TRACE(i);
+    RetardationCache<Geometry> cache{this->QUANTUM, this->QUANTUM};
+    this->expect_near(connections[i].calculate_influence(fields), expected[i]);
+    this->expect_near(connections[i].calculate_influence(fields, cache), expected[i]);
+    EXPECT_EQ(cache.counters().hits + cache.counters().misses, 1u);
+  }
+
+  std::vector<MV> influences(connections.size());
+  RetardationCache<Geometry> cache{this->QUANTUM, this->QUANTUM};
+  Connection<Geometry>::calculate_influences(
+      fields, std::span<const Connection<Geometry>>{connections}, cache, std::span<MV>{influences});
+  EXPECT_EQ(attraction.batches(), 1u);
+  EXPECT_EQ(cache.counters().hits + cache.counters().misses, connections.size());
+  for (size_t i = 0; i < connections.size(); ++i) {
+    SCOPED_TRACE(i);
+    this->expect_near(influences[i], expected[i]);
+  }
+}
+
+/**
+ * Connections take their retarded events from a Propagator shared for the step, singly and in
+ * batches, with the influences they compute without it. Leaves at the same event share a solve.
+ */
+TYPED_TEST(ConnectionTest, PropagatorSharesRetardedEvents) {
+  using Geometry = TypeParam;
+  using MV = typename Geometry::Multivector;
+  const InverseSquareField<Geometry> field;
+  const auto parent{this->source()};
+  std::vector<Particle<Geometry>> leaves;
+  for (const double x : {5.0, 5.0, 7.0}) {
+    leaves.push_back(this->leaf(x));
+    leaves.back().set_coupling(field, MV{1});
+  }
+  std::vector<Connection<Geometry>> connections;
+  for (const auto& leaf : leaves) {
+    connections.emplace_back(this->manifold_, leaf, parent);
+  }
+
+  Propagator<Geometry> propagator{this->manifold_, this->QUANTUM, this->QUANTUM};
+  propagator.begin_step(1);
+  this->expect_near(connections[0].compute_total_motor(propagator),
+                    connections[0].compute_total_motor());
+  for (size_t i = 0; i < connections.size(); ++i) {
+    SCOPED_TRACE(i);
+    this->expect_near(connections[i].calculate_influence(field, propagator),
+                      connections[i].calculate_influence(field));
+  }
+  EXPECT_EQ(propagator.counters().lookups, 4u);
+  EXPECT_EQ(propagator.counters().solves, 2u);
+
+  std::vector<MV> influences(connections.size());
+  Connection<Geometry>::calculate_influences(field,
+                                            std::span<const Connection<Geometry>>{connections},
+                                            propagator, std::span<MV>{influences});
+  EXPECT_EQ(propagator.counters().solves, 2u);
+  for (size_t i = 0; i < connections.size(); ++i) {
+    SCOPED_TRACE(i);
+    this->expect_near(influences[i], connections[i].calculate_influence(field));
+  }
+}
+
+}  // namespace ndyn::test
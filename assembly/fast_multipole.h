@@ -0,0 +1,483 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "assembly/field.h"
+#include "assembly/spatial.h"
+#include "glog/logging.h"
+
+namespace ndyn::assembly {
+
+/**
+ * A fast multipole method for the combined field of many point sources, in O(N) work per step for
+ * a fixed depth and density.
+ *
+ * The method is kernel-independent: it needs nothing from the Field but evaluations, so any Field
+ * can be used, and sources and targets interact as described at source_interaction(). Space is a
+ * fixed cube, split uniformly `depth` times into an octree whose leaves hold the particles. Each
+ * cell carries p^3 interpolation nodes on an equispaced grid, p being the order:
+ *
+ *  - P2M, M2M: the couplings of a cell's sources are interpolated onto its nodes, and children's
+ *    node weights onto their parent's. These are the multipole expansions.
+ *  - M2L: each cell receives, at its nodes, the field of the multipole expansions of the cells in
+ *    its interaction list: the children of its parent's neighbours that are not its own neighbours.
+ *    These are the local expansions.
+ *  - L2L, L2P: parents' local expansions are interpolated down to their children's nodes, and at
+ *    the leaves onto the targets.
+ *  - P2P: sources in a target's own and neighbouring leaves interact directly.
+ *
+ * Because a source at y acts on a target at x through the field at x - y, and the nodes of every
+ * cell on a level lie on one lattice, every M2L translation on a level reads the field at lattice
+ * points. The constructor evaluates the field once at each of those (8 (p - 1) + 1)^3 points per
+ * level, and every step after that is arithmetic on the tables. Only the blades the field actually
+ * produces are stored and translated.
+ *
+ * The far field takes two approximations that the near field does not. Expansions carry the scalar
+ * parts of the couplings, so the far field is exact only for fields that act through the scalar
+ * parts of both couplings, such as masses and charges. And it is computed at the target's position
+ * and transported into the target's frame by the rest of its pose, which is exact for fields that
+ * are invariant under rigid motions.
+ *
+ * For retarded fields, the far field is quasi-static: it uses the current positions, which is
+ * accurate while the light-crossing time of the domain is small against the step. Nearby sources
+ * can still be retarded, through the near-field callable that accumulate() accepts.
+ *
+ * The error falls with the order as the interpolation error of the field over a cell, while the M2L
+ * work grows as p^6 per cell pair.
+ */
+template <typename Geometry>
+class FastMultipole final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using Point = SpatialPoint<ScalarType>;
+
+  struct Counters final {
+    // Direct source-target evaluations.
+    uint64_t near_evaluations{0};
+    // Cell pairs translated from a multipole to a local expansion.
+    uint64_t translations{0};
+  };
+
+ private:
+  static constexpr size_t NUM_BLADES{Multivector::NUM_BASIS_BLADES};
+
+  Point low_;
+  ScalarType half_size_;
+  size_t depth_;
+  size_t order_;
+  // Nodes per cell.
+  size_t num_nodes_;
+  // Lattice points per axis of the field tables, and the offset of the origin along each axis.
+  size_t lattice_size_;
+  size_t lattice_radius_;
+
+  // The blades the field produces.
+  std::vector<size_t> blades_{};
+  // kernels_[level][blade * lattice_size_^3 + lattice point], for levels from 2.
+  std::vector<std::vector<ScalarType>> kernels_{};
+  // Offset of each node's lattice point from the cell's first node's.
+  std::vector<ptrdiff_t> node_offsets_{};
+  // child_interpolation_[half][k * order + k']: the k-th 1D basis polynomial of a parent at its
+  // child's k'-th node, for the lower (half = 0) and upper (half = 1) child.
+  std::array<std::vector<ScalarType>, 2> child_interpolation_{};
+
+  // Particles of leaf c are leaf_particles_[leaf_first_[c]] .. leaf_particles_[leaf_first_[c + 1]].
+  std::vector<size_t> leaf_first_{};
+  std::vector<size_t> leaf_particles_{};
+  std::vector<size_t> leaf_of_{};
+  std::vector<Point> positions_{};
+  // multipoles_[level][cell * num_nodes_ + node].
+  std::vector<std::vector<ScalarType>> multipoles_{};
+  // locals_[level][(cell * blades_.size() + blade) * num_nodes_ + node].
+  std::vector<std::vector<ScalarType>> locals_{};
+
+  size_t cells_per_axis(size_t level) const noexcept { return size_t{1} << level; }
+  size_t num_cells(size_t level) const noexcept {
+    const size_t n{cells_per_axis(level)};
+    return n * n * n;
+  }
+  ScalarType cell_half_size(size_t level) const noexcept {
+    return half_size_ / static_cast<ScalarType>(cells_per_axis(level));
+  }
+
+  ScalarType node(size_t k) const noexcept {
+    return -1 + 2 * static_cast<ScalarType>(k) / static_cast<ScalarType>(order_ - 1);
+  }
+
+  // The k-th Lagrange basis polynomial on the nodes, at x in [-1, 1].
+  ScalarType basis(size_t k, ScalarType x) const noexcept {
+    ScalarType result{1};
+    for (size_t j = 0; j < order_; ++j) {
+      if (j != k) result *= (x - node(j)) / (node(k) - node(j));
+    }
+    return result;
+  }
+
+  // The basis polynomials of every node at a point, per axis: weights[axis * order_ + k].
+  void basis_at(const Point& point, size_t level, size_t cell,
+                std::vector<ScalarType>& weights) const {
+    const size_t n{cells_per_axis(level)};
+    const size_t index[3]{cell / (n * n), cell / n % n, cell % n};
+    const ScalarType h{cell_half_size(level)};
+    for (size_t axis = 0; axis < 3; ++axis) {
+      const ScalarType center{low_[axis] + h * static_cast<ScalarType>(2 * index[axis] + 1)};
+      const ScalarType x{(point[axis] - center) / h};
+      for (size_t k = 0; k < order_; ++k) {
+        weights[axis * order_ + k] = basis(k, x);
+      }
+    }
+  }
+
+  size_t leaf_containing(const Point& point) const {
+    const size_t n{cells_per_axis(depth_)};
+    const ScalarType width{2 * cell_half_size(depth_)};
+    size_t index[3];
+    for (size_t axis = 0; axis < 3; ++axis) {
+      const ScalarType offset{(point[axis] - low_[axis]) / width};
+      LOG_IF(FATAL, !(offset >= 0 && offset <= static_cast<ScalarType>(n)))
+          << "Particle outside the fast multipole domain.";
+      index[axis] = std::min(static_cast<size_t>(offset), n - 1);
+    }
+    return (index[0] * n + index[1]) * n + index[2];
+  }
+
+  template <BatchField<Geometry> FieldType>
+  void build_kernels(const FieldType& field) {
+    const size_t points{lattice_size_ * lattice_size_ * lattice_size_};
+    std::vector<Multivector> events(points);
+    const std::vector<Multivector> couplings(points, Multivector{static_cast<ScalarType>(1)});
+    std::vector<std::vector<Multivector>> values(depth_ + 1);
+    std::vector<bool> produced(NUM_BLADES, false);
+    for (size_t level = 2; level <= depth_; ++level) {
+      // Nodes are spaced by the cell width over order - 1.
+      const ScalarType spacing{2 * cell_half_size(level) / static_cast<ScalarType>(order_ - 1)};
+      const ScalarType radius{static_cast<ScalarType>(lattice_radius_)};
+      const auto coordinate{
+          [&](size_t index) { return spacing * (static_cast<ScalarType>(index) - radius); }};
+      for (size_t point = 0; point < points; ++point) {
+        events[point] = Geometry::translator(coordinate(point / (lattice_size_ * lattice_size_)),
+                                             coordinate(point / lattice_size_ % lattice_size_),
+                                             coordinate(point % lattice_size_));
+      }
+      values[level].resize(points);
+      field.evaluate_batch(events, couplings, std::span<Multivector>{values[level]});
+      // The origin, where source and target coincide, is never read.
+      values[level][points / 2] = Multivector{};
+      for (size_t point = 0; point < points; ++point) {
+        for (size_t blade = 0; blade < NUM_BLADES; ++blade) {
+          if (values[level][point].coefficient(blade) != 0) produced[blade] = true;
+        }
+      }
+    }
+    for (size_t blade = 0; blade < NUM_BLADES; ++blade) {
+      if (produced[blade]) blades_.push_back(blade);
+    }
+
+    kernels_.resize(depth_ + 1);
+    for (size_t level = 2; level <= depth_; ++level) {
+      kernels_[level].resize(blades_.size() * points);
+      for (size_t b = 0; b < blades_.size(); ++b) {
+        for (size_t point = 0; point < points; ++point) {
+          kernels_[level][b * points + point] = values[level][point].coefficient(blades_[b]);
+        }
+      }
+    }
+  }
+
+  void upward_pass(std::span<const Multivector> couplings) {
+    std::vector<ScalarType> weights(3 * order_);
+    std::vector<ScalarType>& leaves{multipoles_[depth_]};
+    std::fill(leaves.begin(), leaves.end(), ScalarType{0});
+    for (size_t particle = 0; particle < positions_.size(); ++particle) {
+      const size_t cell{leaf_of_[particle]};
+      basis_at(positions_[particle], depth_, cell, weights);
+      const ScalarType charge{couplings[particle].scalar()};
+      ScalarType* multipole{&leaves[cell * num_nodes_]};
+      for (size_t node = 0; node < num_nodes_; ++node) {
+        multipole[node] += charge * weights[node / (order_ * order_)] *
+                           weights[order_ + node / order_ % order_] *
+                           weights[2 * order_ + node % order_];
+      }
+    }
+
+    for (size_t level = depth_; level > 2; --level) {
+      std::vector<ScalarType>& parents{multipoles_[level - 1]};
+      std::fill(parents.begin(), parents.end(), ScalarType{0});
+      const size_t n{cells_per_axis(level)};
+      for (size_t cell = 0; cell < num_cells(level); ++cell) {
+        transfer(level, cell, n, /* upward = */ true);
+      }
+    }
+  }
+
+  /**
+   * Interpolates between a cell at `level` and its parent: the cell's multipole expansion into its
+   * parent's (upward), or its parent's local expansion into the cell's (downward).
+   */
+  void transfer(size_t level, size_t cell, size_t n, bool upward) {
+    const size_t index[3]{cell / (n * n), cell / n % n, cell % n};
+    const size_t parent_n{n / 2};
+    const size_t parent{((index[0] / 2) * parent_n + index[1] / 2) * parent_n + index[2] / 2};
+    const ScalarType* along[3]{child_interpolation_[index[0] % 2].data(),
+                               child_interpolation_[index[1] % 2].data(),
+                               child_interpolation_[index[2] % 2].data()};
+    const size_t num_components{upward ? size_t{1} : blades_.size()};
+    std::vector<ScalarType>& parent_values{upward ? multipoles_[level - 1] : locals_[level - 1]};
+    std::vector<ScalarType>& child_values{upward ? multipoles_[level] : locals_[level]};
+
+    for (size_t component = 0; component < num_components; ++component) {
+      ScalarType* parent_nodes{&parent_values[(parent * num_components + component) * num_nodes_]};
+      ScalarType* child_nodes{&child_values[(cell * num_components + component) * num_nodes_]};
+      for (size_t p = 0; p < num_nodes_; ++p) {
+        const size_t p0{p / (order_ * order_)};
+        const size_t p1{p / order_ % order_};
+        const size_t p2{p % order_};
+        for (size_t c = 0; c < num_nodes_; ++c) {
+          const ScalarType weight{along[0][p0 * order_ + c / (order_ * order_)] *
+                                  along[1][p1 * order_ + c / order_ % order_] *
+                                  along[2][p2 * order_ + c % order_]};
+          if (upward) {
+            parent_nodes[p] += weight * child_nodes[c];
+          } else {
+            child_nodes[c] += weight * parent_nodes[p];
+          }
+        }
+      }
+    }
+  }
+
+  void translate(size_t level, Counters& counters) {
+    const size_t n{cells_per_axis(level)};
+    const size_t points{lattice_size_ * lattice_size_ * lattice_size_};
+    const size_t num_blades{blades_.size()};
+    const ptrdiff_t stride[3]{static_cast<ptrdiff_t>(lattice_size_ * lattice_size_),
+                              static_cast<ptrdiff_t>(lattice_size_), 1};
+    const ptrdiff_t origin{static_cast<ptrdiff_t>(lattice_radius_) * (stride[0] + stride[1] + 1)};
+    const ptrdiff_t nodes_per_cell{static_cast<ptrdiff_t>(order_ - 1)};
+    std::vector<ScalarType>& locals{locals_[level]};
+    std::fill(locals.begin(), locals.end(), ScalarType{0});
+
+    for (size_t target = 0; target < num_cells(level); ++target) {
+      const ptrdiff_t t[3]{static_cast<ptrdiff_t>(target / (n * n)),
+                           static_cast<ptrdiff_t>(target / n % n),
+                           static_cast<ptrdiff_t>(target % n)};
+      ptrdiff_t first[3];
+      ptrdiff_t last[3];
+      for (size_t axis = 0; axis < 3; ++axis) {
+        first[axis] = std::max<ptrdiff_t>(0, 2 * (t[axis] / 2 - 1));
+        last[axis] = std::min<ptrdiff_t>(static_cast<ptrdiff_t>(n) - 1, 2 * (t[axis] / 2 + 1) + 1);
+      }
+      for (ptrdiff_t s0 = first[0]; s0 <= last[0]; ++s0) {
+        for (ptrdiff_t s1 = first[1]; s1 <= last[1]; ++s1) {
+          for (ptrdiff_t s2 = first[2]; s2 <= last[2]; ++s2) {
+            using std::abs;
+            if (abs(t[0] - s0) <= 1 && abs(t[1] - s1) <= 1 && abs(t[2] - s2) <= 1) continue;
+            const size_t source{(static_cast<size_t>(s0) * n + static_cast<size_t>(s1)) * n +
+                                static_cast<size_t>(s2)};
+            const ScalarType* multipole{&multipoles_[level][source * num_nodes_]};
+            const ptrdiff_t base{origin +
+                                 nodes_per_cell * ((t[0] - s0) * stride[0] +
+                                                   (t[1] - s1) * stride[1] + (t[2] - s2))};
+            for (size_t b = 0; b < num_blades; ++b) {
+              const ScalarType* kernel{&kernels_[level][b * points]};
+              ScalarType* local{&locals[(target * num_blades + b) * num_nodes_]};
+              for (size_t l = 0; l < num_nodes_; ++l) {
+                const ScalarType* row{kernel + base + node_offsets_[l]};
+                ScalarType sum{0};
+                for (size_t m = 0; m < num_nodes_; ++m) {
+                  sum += row[-node_offsets_[m]] * multipole[m];
+                }
+                local[l] += sum;
+              }
+            }
+            ++counters.translations;
+          }
+        }
+      }
+    }
+  }
+
+ public:
+  /**
+   * An engine for sources within the cube of the given centre and half size, split depth times,
+   * with interpolation of the given order, at least 2. Evaluates the field at the M2L lattice of
+   * every level.
+   */
+  template <BatchField<Geometry> FieldType>
+  FastMultipole(const FieldType& field, const Point& center, ScalarType half_size,
+                size_t depth, size_t order)
+      : half_size_{half_size},
+        depth_{depth},
+        order_{order},
+        num_nodes_{order * order * order},
+        lattice_size_{8 * (order - 1) + 1},
+        lattice_radius_{4 * (order - 1)} {
+    LOG_IF(FATAL, order_ < 2) << "Fast multipole interpolation requires an order of at least 2.";
+    LOG_IF(FATAL, !(half_size_ > 0)) << "The fast multipole domain must have a positive size.";
+    for (size_t axis = 0; axis < 3; ++axis) {
+      low_[axis] = center[axis] - half_size_;
+    }
+
+    build_kernels(field);
+
+    const ptrdiff_t size{static_cast<ptrdiff_t>(lattice_size_)};
+    for (size_t node = 0; node < num_nodes_; ++node) {
+      node_offsets_.push_back(
+          (static_cast<ptrdiff_t>(node / (order_ * order_)) * size +
+           static_cast<ptrdiff_t>(node / order_ % order_)) * size +
+          static_cast<ptrdiff_t>(node % order_));
+    }
+    for (size_t half = 0; half < 2; ++half) {
+      child_interpolation_[half].resize(order_ * order_);
+      for (size_t k = 0; k < order_; ++k) {
+        for (size_t child_k = 0; child_k < order_; ++child_k) {
+          const ScalarType x{(node(child_k) + (half == 0 ? -1 : 1)) / 2};
+          child_interpolation_[half][k * order_ + child_k] = basis(k, x);
+        }
+      }
+    }
+
+    multipoles_.resize(depth_ + 1);
+    locals_.resize(depth_ + 1);
+    for (size_t level = 2; level <= depth_; ++level) {
+      multipoles_[level].resize(num_cells(level) * num_nodes_);
+      locals_[level].resize(num_cells(level) * blades_.size() * num_nodes_);
+    }
+    leaf_first_.resize(num_cells(depth_) + 1);
+  }
+
+  /**
+   * Adds to each acceleration the field of every other source at the corresponding world pose.
+   * Sources within a neighbouring leaf of the target interact through near_field(source, target),
+   * which can, for instance, retard the source; all others through the expansions.
+   */
+  template <typename NearField>
+  Counters accumulate(std::span<const Multivector> world_poses,
+                      std::span<const Multivector> couplings, std::span<Multivector> accelerations,
+                      const NearField& near_field) {
+    LOG_IF(FATAL, couplings.size() != world_poses.size() ||
+                      accelerations.size() != world_poses.size())
+        << "Fast multipole accumulation requires one coupling and acceleration per pose.";
+    Counters counters{};
+
+    positions_.resize(world_poses.size());
+    spatial_positions<Geometry>(world_poses, std::span<Point>{positions_});
+
+    // Counting sort of the particles by leaf.
+    leaf_of_.resize(positions_.size());
+    std::fill(leaf_first_.begin(), leaf_first_.end(), 0);
+    for (size_t particle = 0; particle < positions_.size(); ++particle) {
+      leaf_of_[particle] = leaf_containing(positions_[particle]);
+      ++leaf_first_[leaf_of_[particle] + 1];
+    }
+    for (size_t cell = 0; cell + 1 < leaf_first_.size(); ++cell) {
+      leaf_first_[cell + 1] += leaf_first_[cell];
+    }
+    leaf_particles_.resize(positions_.size());
+    {
+      std::vector<size_t> next(leaf_first_.begin(), leaf_first_.end() - 1);
+      for (size_t particle = 0; particle < positions_.size(); ++particle) {
+        leaf_particles_[next[leaf_of_[particle]]++] = particle;
+      }
+    }
+
+    if (depth_ >= 2) {
+      upward_pass(couplings);
+      for (size_t level = 2; level <= depth_; ++level) {
+        translate(level, counters);
+        if (level > 2) {
+          for (size_t cell = 0; cell < num_cells(level); ++cell) {
+            transfer(level, cell, cells_per_axis(level), /* upward = */ false);
+          }
+        }
+      }
+
+      // L2P: the far field at each target's position, in the world frame, then in its own.
+      std::vector<ScalarType> weights(3 * order_);
+      const std::vector<ScalarType>& leaves{locals_[depth_]};
+      for (size_t particle = 0; particle < positions_.size(); ++particle) {
+        const size_t cell{leaf_of_[particle]};
+        const Point& x{positions_[particle]};
+        basis_at(x, depth_, cell, weights);
+        Multivector far{};
+        for (size_t b = 0; b < blades_.size(); ++b) {
+          const ScalarType* local{&leaves[(cell * blades_.size() + b) * num_nodes_]};
+          ScalarType value{0};
+          for (size_t node = 0; node < num_nodes_; ++node) {
+            value += local[node] * weights[node / (order_ * order_)] *
+                     weights[order_ + node / order_ % order_] *
+                     weights[2 * order_ + node % order_];
+          }
+          far.set_coefficient(blades_[b], value);
+        }
+        const Multivector frame{Geometry::translator(-x[0], -x[1], -x[2]) * world_poses[particle]};
+        accelerations[particle] += couplings[particle].scalar() * (~frame * far * frame);
+      }
+    }
+
+    // P2P over each leaf and its neighbours.
+    const ptrdiff_t n{static_cast<ptrdiff_t>(cells_per_axis(depth_))};
+    for (size_t target = 0; target < positions_.size(); ++target) {
+      const size_t cell{leaf_of_[target]};
+      const ptrdiff_t t[3]{static_cast<ptrdiff_t>(cell) / (n * n),
+                           static_cast<ptrdiff_t>(cell) / n % n, static_cast<ptrdiff_t>(cell) % n};
+      ptrdiff_t first[3];
+      ptrdiff_t last[3];
+      for (size_t axis = 0; axis < 3; ++axis) {
+        first[axis] = std::max<ptrdiff_t>(0, t[axis] - 1);
+        last[axis] = std::min<ptrdiff_t>(n - 1, t[axis] + 1);
+      }
+      for (ptrdiff_t s0 = first[0]; s0 <= last[0]; ++s0) {
+        for (ptrdiff_t s1 = first[1]; s1 <= last[1]; ++s1) {
+          for (ptrdiff_t s2 = first[2]; s2 <= last[2]; ++s2) {
+            const size_t neighbour{static_cast<size_t>((s0 * n + s1) * n + s2)};
+            for (size_t i = leaf_first_[neighbour]; i < leaf_first_[neighbour + 1]; ++i) {
+              const size_t source{leaf_particles_[i]};
+              if (source == target) continue;
+              accelerations[target] += near_field(source, target);
+              ++counters.near_evaluations;
+            }
+          }
+        }
+      }
+    }
+    return counters;
+  }
+
+  /**
+   * As above, with instantaneous near-field interactions at the current positions.
+   */
+  template <BatchField<Geometry> FieldType>
+  Counters accumulate(const FieldType& field, std::span<const Multivector> world_poses,
+                      std::span<const Multivector> couplings,
+                      std::span<Multivector> accelerations) {
+    return accumulate(world_poses, couplings, accelerations,
+                      [this, &field, world_poses, couplings](size_t source, size_t target) {
+                        return source_interaction<Geometry>(field, positions_[source],
+                                                            couplings[source], world_poses[target],
+                                                            couplings[target]);
+                      });
+  }
+
+  /**
+   * The time light at the given speed takes to cross the domain. The quasi-static far field is
+   * accurate while this is small against the step.
+   */
+  ScalarType light_crossing_time(ScalarType speed_of_light) const noexcept {
+    using std::sqrt;
+    return 2 * sqrt(ScalarType{3}) * half_size_ / speed_of_light;
+  }
+
+  size_t depth() const noexcept { return depth_; }
+  size_t order() const noexcept { return order_; }
+  size_t num_blades() const noexcept { return blades_.size(); }
+};
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,178 @@
+#include "assembly/fast_multipole.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "assembly/assembly.h"
+#include "assembly/field_test_utils.h"
+#include "assembly/geometry_test_utils.h"
+#include "assembly/spatial.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class FastMultipoleTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using Point = SpatialPoint<Scalar>;
+  using Engine = FastMultipole<Geometry>;
+
+  // The domain is the cube of half size 1 about the origin.
+  static constexpr Point CENTER{0, 0, 0};
+  static constexpr Scalar HALF_SIZE{1};
+
+  /**
+   * Particles spread through the domain, denser towards its centre, with masses between 0.5 and
+   * 1.5, at their world poses.
+   */
+  static Assembly<Geometry> particles(size_t count) {
+    std::mt19937_64 random{count};
+    const auto uniform{[&random] { return uniform_sample<Scalar>(random); }};
+    const auto coordinate{[&uniform] {
+      const Scalar u{2 * uniform() - 1};
+      return u * std::abs(u);
+    }};
+    Assembly<Geometry> assembly;
+    assembly.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      assembly.add(Assembly<Geometry>::NO_PARENT,
+                   Geometry::translator(coordinate(), coordinate(), coordinate()),
+                   MV{0.5 + uniform()});
+    }
+    assembly.update_world_poses();
+    return assembly;
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(FastMultipoleTest, GeometryTypes);
+
+/**
+ * Benchmark: accuracy against the interpolation order. The error must fall with every order.
+ */
+TYPED_TEST(FastMultipoleTest, ErrorAgainstOrder) {
+  using MV = typename TypeParam::Multivector;
+  using Engine = typename TestFixture::Engine;
+  const InverseSquareField<TypeParam> field{};
+  const auto assembly{this->particles(1000)};
+  const auto expected{pairwise_accelerations(field, assembly)};
+
+  double previous{1};
+  for (const size_t order : {2, 3, 4, 5}) {
+    const auto start{std::chrono::steady_clock::now()};
+    Engine engine{field, this->CENTER, this->HALF_SIZE, 3, order};
+    const auto setup{std::chrono::steady_clock::now()};
+    std::vector<MV> actual(assembly.size());
+    const auto counters{engine.accumulate(field, assembly.poses().world_poses(),
+                                          assembly.couplings(), std::span<MV>{actual})};
+    const auto end{std::chrono::steady_clock::now()};
+
+    const double error{relative_error(actual, expected)};
+    LOG(INFO) << "order " << order << ": error " << error << ", setup "
+              << std::chrono::duration<double>(setup - start).count() * 1e3 << " ms, step "
+              << std::chrono::duration<double>(end - setup).count() * 1e3 << " ms, "
+              << counters.translations << " translations, " << counters.near_evaluations
+              << " near evaluations";
+    EXPECT_LT(error, previous) << "order: " << order;
+    previous = error;
+  }
+  EXPECT_LT(previous, 1e-3);
+}
+
+/**
+ * The near-field callable sees exactly the pairs in neighbouring leaves, and the far field
+ * accounts for everything else.
+ */
+TYPED_TEST(FastMultipoleTest, NearFieldCoversNeighbouringLeaves) {
+  using MV = typename TypeParam::Multivector;
+  using Engine = typename TestFixture::Engine;
+  using Point = typename TestFixture::Point;
+  const InverseSquareField<TypeParam> field{};
+  const auto assembly{this->particles(300)};
+  const size_t depth{3};
+  const double leaf_width{2 * this->HALF_SIZE / (1 << depth)};
+
+  std::vector<Point> positions(assembly.size());
+  spatial_positions<TypeParam>(assembly.poses().world_poses(), std::span<Point>{positions});
+
+  Engine engine{field, this->CENTER, this->HALF_SIZE, depth, 3};
+  std::vector<MV> far(assembly.size());
+  std::vector<std::vector<bool>> near(assembly.size(), std::vector<bool>(assembly.size()));
+  const auto counters{engine.accumulate(assembly.poses().world_poses(), assembly.couplings(),
+                                        std::span<MV>{far}, [&](size_t source, size_t target) {
+                                          near[target][source] = true;
+                                          return MV{};
+                                        })};
+
+  uint64_t num_near{0};
+  for (size_t target = 0; target < assembly.size(); ++target) {
+    EXPECT_FALSE(near[target][target]);
+    for (size_t source = 0; source < assembly.size(); ++source) {
+      const double distance{std::sqrt(squared_distance(positions[source], positions[target]))};
+      if (near[target][source]) {
+        ++num_near;
+        EXPECT_LT(distance, 2 * std::sqrt(3.0) * leaf_width);
+      } else if (source != target) {
+        EXPECT_GT(distance, leaf_width);
+      }
+    }
+  }
+  EXPECT_EQ(num_near, counters.near_evaluations);
+
+  // Adding the near field back recovers the full sum.
+  std::vector<MV> total(far);
+  for (size_t target = 0; target < assembly.size(); ++target) {
+    for (size_t source = 0; source < assembly.size(); ++source) {
+      if (near[target][source]) {
+        total[target] +=
+            source_interaction<TypeParam>(field, positions[source], assembly.coupling(source),
+                                          assembly.world_pose(target), assembly.coupling(target));
+      }
+    }
+  }
+  EXPECT_LT(relative_error(total, pairwise_accelerations(field, assembly)), 1e-2);
+}
+
+/**
+ * Benchmark: wall time of a step against the pairwise sum as the number of particles grows, with
+ * the depth growing to keep about eight particles per leaf.
+ */
+TYPED_TEST(FastMultipoleTest, ScalingWithParticles) {
+  using MV = typename TypeParam::Multivector;
+  using Engine = typename TestFixture::Engine;
+  const InverseSquareField<TypeParam> field{};
+
+  for (const size_t count : {500, 1000, 2000}) {
+    const auto assembly{this->particles(count)};
+    const size_t depth{static_cast<size_t>(std::lround(std::log2(count / 8.0) / 3))};
+
+    auto start{std::chrono::steady_clock::now()};
+    const auto expected{pairwise_accelerations(field, assembly)};
+    const double exact_seconds{
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    Engine engine{field, this->CENTER, this->HALF_SIZE, depth, 3};
+    std::vector<MV> actual(count);
+    start = std::chrono::steady_clock::now();
+    engine.accumulate(field, assembly.poses().world_poses(), assembly.couplings(),
+                      std::span<MV>{actual});
+    const double step_seconds{
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    const double error{relative_error(actual, expected)};
+    LOG(INFO) << count << " particles, depth " << depth << ": pairwise " << exact_seconds * 1e3
+              << " ms, multipole " << step_seconds * 1e3 << " ms, error " << error;
+    EXPECT_LT(error, 1e-2);
+  }
+}
+
+}  // namespace ndyn::test
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <utility>
+
 namespace ndyn::assembly {
 
 template <typename Geometry>
@@ -16,6 +21,84 @@ class Field {
    */
   virtual Multivector evaluate_at(const Multivector& event,
                                   const Multivector& coupling) const noexcept = 0;
+
+  /**
+   * Evaluates the field at each event with the corresponding coupling: out[i] = evaluate_at(
+   * events[i], couplings[i]). The spans must have equal sizes.
+   *
+   * This default makes every Field usable wherever a BatchField is expected, at one virtual call
+   * per element. Fields can override it with a loop that inlines their evaluation; StaticField does
+   * so for fields that need not be virtual at all.
+   */
+  virtual void evaluate_batch(std::span<const Multivector> events,
+                              std::span<const Multivector> couplings,
+                              std::span<Multivector> out) const noexcept {
+    for (size_t i = 0; i < events.size(); ++i) {
+      out[i] = evaluate_at(events[i], couplings[i]);
+    }
+  }
+};
+
+/**
+ * A field evaluated through static dispatch: single events with evaluate_at(), and spans of them
+ * with evaluate_batch(). Every Field is one, as is every StaticField.
+ */
+template <typename F, typename Geometry>
+concept BatchField = requires(const F& field, const typename Geometry::Multivector& event,
+                              std::span<const typename Geometry::Multivector> events,
+                              std::span<typename Geometry::Multivector> out) {
+  { field.evaluate_at(event, event) } -> std::convertible_to<typename Geometry::Multivector>;
+  field.evaluate_batch(events, events, out);
+};
+
+/**
+ * A base for fields that need no virtual dispatch. Derived implements
+ *
+ *   Multivector evaluate_at(const Multivector& event, const Multivector& coupling) const noexcept;
+ *
+ * as an ordinary member, and inherits an evaluate_batch() whose loop calls it directly, so it can
+ * be inlined. Derived can also provide its own evaluate_batch(), which hides this one. Wrap a
+ * StaticField in DynamicField to use it where a Field is required.
+ */
+template <typename Derived, typename Geometry>
+class StaticField {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+  void evaluate_batch(std::span<const Multivector> events, std::span<const Multivector> couplings,
+                      std::span<Multivector> out) const noexcept {
+    const Derived& field{static_cast<const Derived&>(*this)};
+    for (size_t i = 0; i < events.size(); ++i) {
+      out[i] = field.evaluate_at(events[i], couplings[i]);
+    }
+  }
+};
+
+/**
+ * Adapts a BatchField that is not a Field, such as a StaticField, to the virtual interface. Batches
+ * cost one virtual call, forwarded to the wrapped field's own evaluate_batch().
+ */
+template <typename FieldType, typename Geometry>
+class DynamicField final : public Field<Geometry> {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+  explicit DynamicField(FieldType field) : field_{std::move(field)} {}
+
+  Multivector evaluate_at(const Multivector& event,
+                          const Multivector& coupling) const noexcept override {
+    return field_.evaluate_at(event, coupling);
+  }
+
+  void evaluate_batch(std::span<const Multivector> events, std::span<const Multivector> couplings,
+                      std::span<Multivector> out) const noexcept override {
+    field_.evaluate_batch(events, couplings, out);
+  }
+
+  const FieldType& field() const noexcept { return field_; }
+
+ private:
+  FieldType field_;
 };
 
 }  // namespace ndyn::assembly
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+#include "assembly/field.h"
+
+namespace ndyn::assembly {
+
+/**
+ * Fields superposed on the same particles, such as gravity, electromagnetism and damping at once.
+ *
+ * A particle couples to each field separately, with one coupling per field, but all the fields are
+ * evaluated at the same event. Connection::calculate_influence() takes a FieldSet to resolve the
+ * connection's motor, the retardation and the frame changes once for the whole set, and sums the
+ * fields' accelerations in the parent frame before transporting them back.
+ *
+ * The set refers to its fields, which must outlive it. Fields of any BatchField type can be mixed,
+ * and each is called through its own type, so static fields stay statically dispatched.
+ */
+template <typename Geometry, BatchField<Geometry>... Fields>
+class FieldSet final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+  static constexpr size_t NUM_FIELDS{sizeof...(Fields)};
+
+  // One coupling per field, in the order of the fields.
+  using Couplings = std::array<Multivector, NUM_FIELDS>;
+
+ private:
+  std::tuple<const Fields*...> fields_;
+
+  template <typename Visitor, size_t... INDICES>
+  void for_each(const Visitor& visit, std::index_sequence<INDICES...>) const {
+    (visit(INDICES, *std::get<INDICES>(fields_)), ...);
+  }
+
+ public:
+  explicit FieldSet(const Fields&... fields) noexcept : fields_{&fields...} {}
+
+  template <size_t INDEX>
+  const auto& field() const noexcept {
+    return *std::get<INDEX>(fields_);
+  }
+
+  /**
+   * Calls visit(index, field) for each field in order.
+   */
+  template <typename Visitor>
+  void for_each(const Visitor& visit) const {
+    for_each(visit, std::index_sequence_for<Fields...>{});
+  }
+
+  /**
+   * The summed acceleration of a target at the event, where couplings[k] is its coupling to the
+   * k-th field.
+   */
+  Multivector evaluate_at(const Multivector& event, const Couplings& couplings) const noexcept {
+    Multivector result{};
+    for_each([&](size_t index, const auto& field) {
+      result += field.evaluate_at(event, couplings[index]);
+    });
+    return result;
+  }
+};
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,101 @@
+#include "assembly/field_set.h"
+
+#include <cmath>
+#include <vector>
+
+#include "assembly/field.h"
+#include "assembly/geometry_test_utils.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+/**
+ * A field that accelerates every particle by its coupling times a fixed bivector.
+ */
+template <typename Geometry>
+class UniformField final : public Field<Geometry> {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+  explicit UniformField(const Multivector& acceleration) : acceleration_{acceleration} {}
+
+  Multivector evaluate_at(const Multivector& /*event*/,
+                          const Multivector& coupling) const noexcept override {
+    return coupling.scalar() * acceleration_;
+  }
+
+ private:
+  Multivector acceleration_;
+};
+
+/**
+ * A statically dispatched field whose acceleration depends on the event as well as the coupling.
+ */
+template <typename Geometry>
+class ShearField final : public StaticField<ShearField<Geometry>, Geometry> {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+  Multivector evaluate_at(const Multivector& event, const Multivector& coupling) const noexcept {
+    return Geometry::bivector_xy(coupling.scalar() * event.scalar());
+  }
+};
+
+template <typename Geometry>
+class FieldSetTest : public ::testing::Test {
+ protected:
+  using MV = typename Geometry::Multivector;
+
+  static void expect_near(const MV& actual, const MV& expected) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      EXPECT_NEAR(actual.coefficient(i), expected.coefficient(i), 1e-12) << "blade: " << i;
+    }
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(FieldSetTest, GeometryTypes);
+
+TYPED_TEST(FieldSetTest, VisitsFieldsInOrder) {
+  using Geometry = TypeParam;
+  const UniformField<Geometry> gravity{Geometry::bivector_xy(1.0)};
+  const ShearField<Geometry> shear{};
+  const UniformField<Geometry> damping{Geometry::bivector_xy(-0.5)};
+  const FieldSet<Geometry, UniformField<Geometry>, ShearField<Geometry>, UniformField<Geometry>>
+      fields{gravity, shear, damping};
+  static_assert(decltype(fields)::NUM_FIELDS == 3);
+
+  std::vector<const void*> visited{};
+  fields.for_each([&](size_t index, const auto& field) {
+    EXPECT_EQ(index, visited.size());
+    visited.push_back(&field);
+  });
+  EXPECT_EQ(visited, (std::vector<const void*>{&gravity, &shear, &damping}));
+  EXPECT_EQ(&fields.template field<1>(), &shear);
+}
+
+/**
+ * The set's acceleration is the sum of its fields' accelerations, each with its own coupling, for
+ * virtual and static fields alike.
+ */
+TYPED_TEST(FieldSetTest, SumsFieldsWithTheirCouplings) {
+  using Geometry = TypeParam;
+  using MV = typename Geometry::Multivector;
+  const UniformField<Geometry> gravity{Geometry::bivector_xy(1.0)};
+  const ShearField<Geometry> shear{};
+  const Field<Geometry>& damping{gravity};
+  const FieldSet<Geometry, UniformField<Geometry>, ShearField<Geometry>, Field<Geometry>> fields{
+      gravity, shear, damping};
+
+  const MV event{Geometry::translator(0.5, -1, 2) * MV{2.0}};
+  const typename decltype(fields)::Couplings couplings{MV{3.0}, MV{-1.0}, MV{0.0}};
+  const MV expected{gravity.evaluate_at(event, couplings[0]) +
+                    shear.evaluate_at(event, couplings[1]) +
+                    damping.evaluate_at(event, couplings[2])};
+  this->expect_near(fields.evaluate_at(event, couplings), expected);
+}
+
+}  // namespace ndyn::test
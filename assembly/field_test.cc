@@ -0,0 +1,163 @@
+#include "assembly/field.h"
+
+#include <chrono>
+#include <cmath>
+#include <span>
+#include <vector>
+
+#include "assembly/geometry_test_utils.h"
+#include "assembly/spatial.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+/**
+ * A softened inverse-square attraction, dispatched statically.
+ */
+template <typename Geometry>
+class StaticInverseSquareField final
+    : public StaticField<StaticInverseSquareField<Geometry>, Geometry> {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+
+  Multivector evaluate_at(const Multivector& event, const Multivector& coupling) const noexcept {
+    const auto r{spatial_coordinates<Geometry>(origin_image<Geometry>(event))};
+    const ScalarType r_squared{r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + SOFTENING * SOFTENING};
+    const ScalarType scale{-coupling.scalar() / (r_squared * std::sqrt(r_squared))};
+    return Geometry::motor_log(Geometry::translator(scale * r[0], scale * r[1], scale * r[2]));
+  }
+
+ private:
+  static constexpr ScalarType SOFTENING{0.01};
+};
+
+/**
+ * The same field through the virtual interface, relying on the default evaluate_batch().
+ */
+template <typename Geometry>
+class VirtualInverseSquareField final : public Field<Geometry> {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+  Multivector evaluate_at(const Multivector& event,
+                          const Multivector& coupling) const noexcept override {
+    return field_.evaluate_at(event, coupling);
+  }
+
+ private:
+  StaticInverseSquareField<Geometry> field_{};
+};
+
+template <typename Geometry>
+class FieldTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+
+  static_assert(BatchField<Field<Geometry>, Geometry>);
+  static_assert(BatchField<StaticInverseSquareField<Geometry>, Geometry>);
+  static_assert(BatchField<DynamicField<StaticInverseSquareField<Geometry>, Geometry>, Geometry>);
+
+  // Events along a spiral about the origin, with couplings between 0.5 and 1.5.
+  static void events(size_t count, std::vector<MV>& events, std::vector<MV>& couplings) {
+    events.clear();
+    couplings.clear();
+    for (size_t i = 0; i < count; ++i) {
+      const Scalar phase{static_cast<Scalar>(i) * Scalar{0.37}};
+      events.push_back(Geometry::translator(std::cos(phase), std::sin(phase), 0.01 * phase));
+      couplings.push_back(MV{1 + 0.5 * std::sin(3 * phase)});
+    }
+  }
+
+  template <typename FieldType>
+  static std::vector<MV> batch(const FieldType& field, const std::vector<MV>& events,
+                               const std::vector<MV>& couplings) {
+    std::vector<MV> result(events.size());
+    field.evaluate_batch(events, couplings, std::span<MV>{result});
+    return result;
+  }
+
+  static bool identical(const MV& lhs, const MV& rhs) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      if (lhs.coefficient(i) != rhs.coefficient(i)) return false;
+    }
+    return true;
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(FieldTest, GeometryTypes);
+
+/**
+ * Every way of evaluating a batch gives exactly the single evaluations.
+ */
+TYPED_TEST(FieldTest, BatchesMatchSingleEvaluations) {
+  using MV = typename TypeParam::Multivector;
+  const StaticInverseSquareField<TypeParam> static_field{};
+  const VirtualInverseSquareField<TypeParam> virtual_field{};
+  const DynamicField<StaticInverseSquareField<TypeParam>, TypeParam> dynamic_field{static_field};
+  const Field<TypeParam>& dynamic_base{dynamic_field};
+
+  std::vector<MV> events{};
+  std::vector<MV> couplings{};
+  this->events(100, events, couplings);
+
+  const auto from_static{this->batch(static_field, events, couplings)};
+  const auto from_virtual{this->batch(virtual_field, events, couplings)};
+  const auto from_dynamic{this->batch(dynamic_base, events, couplings)};
+  for (size_t i = 0; i < events.size(); ++i) {
+    const MV expected{static_field.evaluate_at(events[i], couplings[i])};
+    EXPECT_TRUE(this->identical(from_static[i], expected)) << "event: " << i;
+    EXPECT_TRUE(this->identical(from_virtual[i], expected)) << "event: " << i;
+    EXPECT_TRUE(this->identical(from_dynamic[i], expected)) << "event: " << i;
+    EXPECT_TRUE(this->identical(dynamic_base.evaluate_at(events[i], couplings[i]), expected))
+        << "event: " << i;
+  }
+}
+
+/**
+ * Benchmark: wall time of one virtual call per event against one batch through each interface.
+ */
+TYPED_TEST(FieldTest, DispatchCost) {
+  using MV = typename TypeParam::Multivector;
+  const StaticInverseSquareField<TypeParam> static_field{};
+  const VirtualInverseSquareField<TypeParam> virtual_field{};
+  const DynamicField<StaticInverseSquareField<TypeParam>, TypeParam> dynamic_field{static_field};
+  const Field<TypeParam>& virtual_base{virtual_field};
+  const Field<TypeParam>& dynamic_base{dynamic_field};
+
+  std::vector<MV> events{};
+  std::vector<MV> couplings{};
+  this->events(100000, events, couplings);
+  std::vector<MV> out(events.size());
+
+  const auto time{[](const auto& evaluate) {
+    const auto start{std::chrono::steady_clock::now()};
+    evaluate();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }};
+  const double single_seconds{time([&] {
+    for (size_t i = 0; i < events.size(); ++i) {
+      out[i] = virtual_base.evaluate_at(events[i], couplings[i]);
+    }
+  })};
+  const double virtual_seconds{
+      time([&] { virtual_base.evaluate_batch(events, couplings, std::span<MV>{out}); })};
+  const double dynamic_seconds{
+      time([&] { dynamic_base.evaluate_batch(events, couplings, std::span<MV>{out}); })};
+  const double static_seconds{
+      time([&] { static_field.evaluate_batch(events, couplings, std::span<MV>{out}); })};
+
+  LOG(INFO) << events.size() << " events: single virtual calls " << single_seconds * 1e3
+            << " ms, virtual batch " << virtual_seconds * 1e3 << " ms, dynamic batch "
+            << dynamic_seconds * 1e3 << " ms, static batch " << static_seconds * 1e3 << " ms";
+  EXPECT_TRUE(
+      this->identical(out.back(), static_field.evaluate_at(events.back(), couplings.back())));
+}
+
+}  // namespace ndyn::test
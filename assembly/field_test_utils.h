@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "assembly/assembly.h"
+#include "assembly/spatial.h"
+
+namespace ndyn::assembly {
+
+/**
+ * A softened inverse-square attraction towards the source: the acceleration generator of a
+ * translation by -coupling * r / (|r|^2 + softening^2)^(3/2). The field the approximate solvers
+ * are tested with.
+ */
+template <typename Geometry>
+class InverseSquareField final : public Field<Geometry> {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+
+  explicit InverseSquareField(ScalarType softening = 0.01) : softening_{softening} {}
+
+  Multivector evaluate_at(const Multivector& event,
+                          const Multivector& coupling) const noexcept override {
+    const auto r{spatial_coordinates<Geometry>(origin_image<Geometry>(event))};
+    const ScalarType r_squared{r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + softening_ * softening_};
+    const ScalarType scale{-coupling.scalar() / (r_squared * std::sqrt(r_squared))};
+    return Geometry::motor_log(Geometry::translator(scale * r[0], scale * r[1], scale * r[2]));
+  }
+
+ private:
+  ScalarType softening_;
+};
+
+/**
+ * A uniform sample in [0, 1) from the top 53 bits of the generator's next value.
+ */
+template <typename Scalar>
+Scalar uniform_sample(std::mt19937_64& random) {
+  return static_cast<Scalar>(random() >> 11) * Scalar{0x1p-53};
+}
+
+/**
+ * The acceleration of every particle of the assembly from all the others, summed pair by pair with
+ * accumulate_pairwise(): the reference the approximate solvers are measured against.
+ */
+template <typename Geometry, BatchField<Geometry> FieldType>
+std::vector<typename Geometry::Multivector> pairwise_accelerations(
+    const FieldType& field, const Assembly<Geometry>& assembly) {
+  using Multivector = typename Geometry::Multivector;
+  using Point = SpatialPoint<typename Geometry::ScalarType>;
+  std::vector<Point> positions(assembly.size());
+  spatial_positions<Geometry>(assembly.poses().world_poses(), std::span<Point>{positions});
+  std::vector<Multivector> accelerations(assembly.size());
+  accumulate_pairwise<Geometry>(field, positions, assembly.poses().world_poses(),
+                                assembly.couplings(), std::span<Multivector>{accelerations});
+  return accelerations;
+}
+
+/**
+ * The root-mean-square error of actual against expected over every coefficient, relative to the
+ * root-mean-square of expected.
+ */
+template <typename Multivector>
+double relative_error(const std::vector<Multivector>& actual,
+                      const std::vector<Multivector>& expected) {
+  double error{0};
+  double magnitude{0};
+  for (size_t i = 0; i < expected.size(); ++i) {
+    for (size_t j = 0; j < Multivector::NUM_BASIS_BLADES; ++j) {
+      const double difference{actual[i].coefficient(j) - expected[i].coefficient(j)};
+      error += difference * difference;
+      magnitude += expected[i].coefficient(j) * expected[i].coefficient(j);
+    }
+  }
+  return std::sqrt(error / magnitude);
+}
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "assembly/work_stealing_pool.h"
+#include "glog/logging.h"
+
+namespace ndyn::assembly {
+
+/**
+ * Accumulates the influences of many connections into per-leaf accelerations on a
+ * WorkStealingPool, with results that are bit-identical for any number of threads.
+ *
+ * Every influence in a step is an independent read of the previous state, so they can be evaluated
+ * in any order; only their summation into each leaf's acceleration needs care, since floating-point
+ * addition is not associative. The accumulator fixes the order of every addition in advance:
+ *
+ *  1. set_leaves() sorts the connections by leaf, stably, and cuts the sorted sequence into chunks
+ *     of chunk_size connections. The chunks depend only on the connections, never on the threads.
+ *  2. accumulate() runs one pool task per chunk. A task sums its chunk's consecutive influences on
+ *     the same leaf, in connection order, into the chunk's own buffer; the task owns that buffer
+ *     while it runs, so no two threads ever write the same memory.
+ *  3. The partial sums are then added to each leaf's acceleration in chunk order.
+ *
+ * The connections themselves are opaque: accumulate() takes a callable influence(connection,
+ * worker) that evaluates connection number `connection`, typically through
+ * Connection::calculate_influence() with the worker's own RetardationCache.
+ */
+template <typename Geometry>
+class ForceAccumulator final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+  static constexpr size_t DEFAULT_CHUNK_SIZE{64};
+
+ private:
+  // The partial sum of one run of consecutive connections on the same leaf within a chunk.
+  struct Run final {
+    size_t leaf;
+    Multivector sum;
+  };
+
+  WorkStealingPool* pool_;
+  size_t chunk_size_;
+  size_t num_leaves_{0};
+  // Connections in the order they are summed: by leaf, then by index.
+  std::vector<size_t> order_{};
+  std::vector<size_t> leaf_of_{};
+  // Chunk c writes its run_counts_[c] runs from runs_[c * chunk_size_].
+  std::vector<Run> runs_{};
+  std::vector<size_t> run_counts_{};
+  // The influence of each connection, in summation order.
+  std::vector<Multivector> values_{};
+
+  size_t num_chunks() const noexcept { return (order_.size() + chunk_size_ - 1) / chunk_size_; }
+
+ public:
+  explicit ForceAccumulator(WorkStealingPool& pool, size_t chunk_size = DEFAULT_CHUNK_SIZE)
+      : pool_{&pool}, chunk_size_{chunk_size} {
+    LOG_IF(FATAL, chunk_size_ == 0) << "Force accumulation requires a positive chunk size.";
+  }
+
+  /**
+   * Sets the leaf of every connection: leaves[i] receives the influence of connection i. Call
+   * whenever the connections change; the ordering is reused across steps.
+   */
+  void set_leaves(std::span<const size_t> leaves, size_t num_leaves) {
+    num_leaves_ = num_leaves;
+    leaf_of_.assign(leaves.begin(), leaves.end());
+
+    // Counting sort, which is stable, so each leaf's connections stay in index order.
+    std::vector<size_t> next(num_leaves + 1, 0);
+    for (const size_t leaf : leaves) {
+      LOG_IF(FATAL, leaf >= num_leaves) << "Connection leaf " << leaf << " out of range.";
+      ++next[leaf + 1];
+    }
+    for (size_t leaf = 0; leaf < num_leaves; ++leaf) {
+      next[leaf + 1] += next[leaf];
+    }
+    order_.resize(leaves.size());
+    for (size_t connection = 0; connection < leaves.size(); ++connection) {
+      order_[next[leaves[connection]]++] = connection;
+    }
+
+    runs_.resize(order_.size());
+    values_.resize(order_.size());
+    run_counts_.resize(num_chunks());
+  }
+
+  /**
+   * Adds the influence of every connection to its leaf's entry in accelerations.
+   */
+  template <typename Influence>
+  void accumulate(const Influence& influence, std::span<Multivector> accelerations) {
+    accumulate_batched(
+        [&influence](std::span<const size_t> connections, size_t worker,
+                     std::span<Multivector> influences) {
+          for (size_t i = 0; i < connections.size(); ++i) {
+            influences[i] = influence(connections[i], worker);
+          }
+        },
+        accelerations);
+  }
+
+  /**
+   * As accumulate(), but with the influences of a whole chunk evaluated in one call:
+   * influences(connections, worker, out) writes the influence of connections[i] to out[i], for
+   * instance through Connection::calculate_influences(), so that the field sees a batch.
+   */
+  template <typename BatchInfluence>
+  void accumulate_batched(const BatchInfluence& influences, std::span<Multivector> accelerations) {
+    LOG_IF(FATAL, accelerations.size() != num_leaves_)
+        << "Force accumulation requires one acceleration per leaf.";
+
+    pool_->run(num_chunks(), [this, &influences](size_t chunk, size_t worker) {
+      const size_t begin{chunk * chunk_size_};
+      const size_t end{std::min(begin + chunk_size_, order_.size())};
+      const std::span<Multivector> values{&values_[begin], end - begin};
+      influences(std::span<const size_t>{&order_[begin], end - begin}, worker, values);
+
+      Run* runs{&runs_[begin]};
+      size_t count{0};
+      for (size_t i = begin; i < end; ++i) {
+        const size_t leaf{leaf_of_[order_[i]]};
+        if (count == 0 || runs[count - 1].leaf != leaf) {
+          runs[count++] = Run{leaf, values[i - begin]};
+        } else {
+          runs[count - 1].sum += values[i - begin];
+        }
+      }
+      run_counts_[chunk] = count;
+    });
+
+    for (size_t chunk = 0; chunk < num_chunks(); ++chunk) {
+      const Run* runs{&runs_[chunk * chunk_size_]};
+      for (size_t i = 0; i < run_counts_[chunk]; ++i) {
+        accelerations[runs[i].leaf] += runs[i].sum;
+      }
+    }
+  }
+
+  size_t num_connections() const noexcept { return order_.size(); }
+};
+
+}  // namespace ndyn::assembly
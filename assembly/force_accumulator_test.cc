@@ -0,0 +1,156 @@
+#include "assembly/force_accumulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "assembly/geometry_test_utils.h"
+#include "assembly/work_stealing_pool.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class ForceAccumulatorTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+
+  static constexpr size_t NUM_LEAVES{97};
+
+  // Connections on leaves in a scrambled order, some leaves with many, some with none.
+  static std::vector<size_t> leaves(size_t num_connections) {
+    std::vector<size_t> result(num_connections);
+    for (size_t i = 0; i < num_connections; ++i) {
+      result[i] = (i * i * 31 + 7 * i) % (NUM_LEAVES - 3);
+    }
+    return result;
+  }
+
+  /**
+   * A stand-in for Connection::calculate_influence(): transports a bivector through a motor that
+   * depends on the connection, `work` times over, so that the result's low bits depend on the
+   * connection and the cost can be tuned.
+   */
+  static MV influence(size_t connection, size_t work) {
+    const Scalar phase{static_cast<Scalar>(connection) * Scalar{0.37}};
+    const MV motor{Geometry::translator(std::sin(phase), std::cos(phase), 0) *
+                   Geometry::motor_exp(Geometry::bivector_xy(0.1 * std::sin(3 * phase)))};
+    MV result{Geometry::bivector_xy(1 / (1 + phase))};
+    for (size_t i = 0; i < work; ++i) {
+      result = motor * result * ~motor;
+    }
+    return result;
+  }
+
+  static std::vector<MV> accumulate(size_t num_threads, const std::vector<size_t>& leaves,
+                                    size_t work) {
+    WorkStealingPool pool{num_threads};
+    ForceAccumulator<Geometry> accumulator{pool};
+    accumulator.set_leaves(leaves, NUM_LEAVES);
+    std::vector<MV> accelerations(NUM_LEAVES);
+    accumulator.accumulate(
+        [work](size_t connection, size_t /*worker*/) { return influence(connection, work); },
+        std::span<MV>{accelerations});
+    return accelerations;
+  }
+
+  static bool identical(const MV& lhs, const MV& rhs) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      if (lhs.coefficient(i) != rhs.coefficient(i)) return false;
+    }
+    return true;
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(ForceAccumulatorTest, GeometryTypes);
+
+TYPED_TEST(ForceAccumulatorTest, MatchesSerialSum) {
+  using MV = typename TypeParam::Multivector;
+  const auto leaves{this->leaves(5000)};
+
+  std::vector<MV> expected(this->NUM_LEAVES);
+  for (size_t connection = 0; connection < leaves.size(); ++connection) {
+    expected[leaves[connection]] += this->influence(connection, 2);
+  }
+
+  const auto actual{this->accumulate(4, leaves, 2)};
+  for (size_t leaf = 0; leaf < this->NUM_LEAVES; ++leaf) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      EXPECT_NEAR(actual[leaf].coefficient(i), expected[leaf].coefficient(i), 1e-9)
+          << "leaf: " << leaf << " blade: " << i;
+    }
+  }
+}
+
+TYPED_TEST(ForceAccumulatorTest, BitIdenticalForAnyThreadCount) {
+  const auto leaves{this->leaves(5000)};
+  const auto reference{this->accumulate(1, leaves, 2)};
+  for (const size_t num_threads : {2, 3, 5, 8}) {
+    const auto actual{this->accumulate(num_threads, leaves, 2)};
+    for (size_t leaf = 0; leaf < this->NUM_LEAVES; ++leaf) {
+      EXPECT_TRUE(this->identical(actual[leaf], reference[leaf]))
+          << "threads: " << num_threads << " leaf: " << leaf;
+    }
+  }
+}
+
+TYPED_TEST(ForceAccumulatorTest, BatchedMatchesSingle) {
+  using MV = typename TypeParam::Multivector;
+  const auto leaves{this->leaves(5000)};
+  const auto reference{this->accumulate(1, leaves, 2)};
+
+  WorkStealingPool pool{3};
+  ForceAccumulator<TypeParam> accumulator{pool};
+  accumulator.set_leaves(leaves, this->NUM_LEAVES);
+  std::vector<MV> actual(this->NUM_LEAVES);
+  accumulator.accumulate_batched(
+      [this](std::span<const size_t> connections, size_t /*worker*/, std::span<MV> influences) {
+        for (size_t i = 0; i < connections.size(); ++i) {
+          influences[i] = this->influence(connections[i], 2);
+        }
+      },
+      std::span<MV>{actual});
+  for (size_t leaf = 0; leaf < this->NUM_LEAVES; ++leaf) {
+    EXPECT_TRUE(this->identical(actual[leaf], reference[leaf])) << "leaf: " << leaf;
+  }
+}
+
+/**
+ * Benchmark: wall time of one accumulation from one thread up to the hardware concurrency. The
+ * results must stay bit-identical throughout.
+ */
+TYPED_TEST(ForceAccumulatorTest, Scaling) {
+  using MV = typename TypeParam::Multivector;
+  const auto leaves{this->leaves(20000)};
+  const size_t max_threads{std::max<size_t>(1, std::thread::hardware_concurrency())};
+
+  std::vector<MV> reference{};
+  double serial_seconds{0};
+  for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    const auto start{std::chrono::steady_clock::now()};
+    const auto actual{this->accumulate(num_threads, leaves, 16)};
+    const double seconds{
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    if (num_threads == 1) {
+      reference = actual;
+      serial_seconds = seconds;
+    }
+    LOG(INFO) << num_threads << " threads: " << seconds * 1e3 << " ms, speedup "
+              << serial_seconds / seconds;
+    for (size_t leaf = 0; leaf < this->NUM_LEAVES; ++leaf) {
+      EXPECT_TRUE(this->identical(actual[leaf], reference[leaf]))
+          << "threads: " << num_threads << " leaf: " << leaf;
+    }
+  }
+}
+
+}  // namespace ndyn::test
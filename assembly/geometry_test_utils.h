@@ -0,0 +1,285 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <span>
+
+#include "math/algebra.h"
+#include "math/cga_geometry.h"
+#include "math/geometry_model.h"
+#include "math/multivector.h"
+#include "math/pga_geometry.h"
+
+namespace ndyn::assembly {
+
+/**
+ * Spacetime geometries for the assembly tests, built on the algebras and geometries of the math
+ * library. They are test fixtures, not geometries the library ships: no math geometry knows the
+ * time of a pose, which the assembly layer needs, so these adapters add it.
+ *
+ * The assembly layer needs a little more of a geometry than a GeometryModel provides: poses that
+ * carry a time, the spatial position and distance of the events they place, and motor logarithms
+ * and exponentials to integrate and interpolate them. These adapters supply that vocabulary:
+ *
+ *   translator(x, y, z)    A motor displacing the origin by (x, y, z).
+ *   identity_at_time(t)    A pose at the origin at time t.
+ *   extract_time(pose)     The time of a pose.
+ *   bivector_xy(omega)     A velocity rotating in the xy plane.
+ *
+ * so that a particle at (x, y, z) at time t has the pose translator(x, y, z) * identity_at_time(t).
+ *
+ * Motors are exponentials of bivectors whose Euclidean part is a simple rotation: exp(B) is
+ * cos|R| + sin|R| / |R| B, where R is the rotational part of B. This is exact for rotations about
+ * an axis through the origin and for translations, which is all the tests build, and motor_log()
+ * is its exact inverse.
+ */
+template <typename Multivector, size_t NUM_ROTATION_BLADES>
+Multivector simple_motor_exp(const Multivector& bivector,
+                             const std::array<size_t, NUM_ROTATION_BLADES>& rotation_blades) {
+  using Scalar = typename Multivector::ScalarType;
+  Scalar angle_sq{0};
+  for (const size_t blade : rotation_blades) {
+    angle_sq += bivector.coefficient(blade) * bivector.coefficient(blade);
+  }
+  const Scalar angle{std::sqrt(angle_sq)};
+  const Scalar scale{angle > 0 ? std::sin(angle) / angle : Scalar{1}};
+  Multivector result{bivector.grade_projection(2) * scale};
+  result.set_scalar(std::cos(angle));
+  return result;
+}
+
+template <typename Multivector, size_t NUM_ROTATION_BLADES>
+Multivector simple_motor_log(const Multivector& motor,
+                             const std::array<size_t, NUM_ROTATION_BLADES>& rotation_blades) {
+  using Scalar = typename Multivector::ScalarType;
+  Scalar sin_sq{0};
+  for (const size_t blade : rotation_blades) {
+    sin_sq += motor.coefficient(blade) * motor.coefficient(blade);
+  }
+  const Scalar sine{std::sqrt(sin_sq)};
+  const Scalar angle{std::atan2(sine, motor.scalar())};
+  const Scalar scale{sine > 0 ? angle / sine : Scalar{1} / motor.scalar()};
+  return motor.grade_projection(2) * scale;
+}
+
+/**
+ * The GeometryModel vocabulary shared by the spacetime geometries below: the spatial basis vectors,
+ * here e<1>, e<2> and e<3> in both, and the outer product join and regressive product meet.
+ */
+template <typename Multivector>
+struct SpatialGeometryModel {
+  static constexpr size_t NUM_PHYSICAL_DIMENSIONS{3};
+
+  static constexpr Multivector e1() { return Multivector::template e<1>(); }
+  static constexpr Multivector e2() { return Multivector::template e<2>(); }
+  static constexpr Multivector e3() { return Multivector::template e<3>(); }
+  static constexpr auto get_e1(const Multivector& mv) { return mv.coefficient(0b0010); }
+  static constexpr auto get_e2(const Multivector& mv) { return mv.coefficient(0b0100); }
+  static constexpr auto get_e3(const Multivector& mv) { return mv.coefficient(0b1000); }
+
+  static constexpr Multivector join() { return Multivector{1}; }
+  static constexpr Multivector meet() { return Multivector::pseudoscalar(); }
+
+  template <typename... Rest>
+  static constexpr Multivector join(const Multivector& first, const Rest&... rest) {
+    return (first ^ ... ^ rest);
+  }
+
+  template <typename... Rest>
+  static constexpr Multivector meet(const Multivector& first, const Rest&... rest) {
+    return (first & ... & rest);
+  }
+};
+
+/**
+ * Spacetime on the 3D projective algebra, math::Pga, with points as trivectors: the origin is
+ * e123 and a translator is 1 + (x e01 + y e02 + z e03) / 2.
+ *
+ * PGA has no spare direction for time, so a pose carries its time on the pseudoscalar I = e0123,
+ * as M * (1 + t I) for a motor M. I commutes with every motor and squares to zero, so composing
+ * poses adds their times, and the time is recovered from any pose as half the I coefficient of
+ * pose * ~pose, whatever motors have been applied to it. Reversal does not negate the time, so a
+ * relative motor m1 * ~m0 carries no meaningful time and motor_log() ignores it.
+ *
+ * Without its time, a pose is a motor of math::PgaGrade3PointGeometry, which supplies the image of
+ * the origin.
+ */
+struct PgaSpacetimeGeometry final : SpatialGeometryModel<math::Pga<double>::VectorType> {
+  using SpatialGeometry = math::PgaGrade3PointGeometry<double>;
+  using Algebra = math::Pga<double>;
+  using Multivector = Algebra::VectorType;
+  using Scalar = Algebra::ScalarType;
+  using ScalarType = Scalar;
+
+  static constexpr size_t E01{0b0011};
+  static constexpr size_t E02{0b0101};
+  static constexpr size_t E03{0b1001};
+  static constexpr size_t E12{0b0110};
+  static constexpr size_t E13{0b1010};
+  static constexpr size_t E23{0b1100};
+  static constexpr size_t E012{0b0111};
+  static constexpr size_t E013{0b1011};
+  static constexpr size_t E023{0b1101};
+  static constexpr size_t E123{0b1110};
+  static constexpr size_t E0123{0b1111};
+  static constexpr std::array<size_t, 3> ROTATION_BLADES{E12, E13, E23};
+
+  static Multivector blade(size_t index, Scalar value) {
+    Multivector result{};
+    result.set_coefficient(index, value);
+    return result;
+  }
+
+  static Multivector translator(Scalar x, Scalar y, Scalar z) {
+    return Multivector{1} + blade(E01, x / 2) + blade(E02, y / 2) + blade(E03, z / 2);
+  }
+
+  static Multivector identity_at_time(Scalar t) { return Multivector{1} + blade(E0123, t); }
+
+  static Multivector bivector_xy(Scalar omega) { return blade(E12, omega); }
+
+  static Scalar extract_time(const Multivector& pose) {
+    const Multivector norm{pose * ~pose};
+    return norm.coefficient(E0123) / (2 * norm.scalar());
+  }
+
+  /**
+   * The motor of a pose, without its time.
+   */
+  static Multivector spatial_motor(const Multivector& pose) {
+    return pose * (Multivector{1} - blade(E0123, extract_time(pose)));
+  }
+
+  static Multivector origin() { return blade(E123, 1); }
+
+  static Multivector extract_origin_image(const Multivector& pose) {
+    return SpatialGeometry::extract_origin_image(spatial_motor(pose));
+  }
+
+  static void extract_origin_images(std::span<const Multivector> poses,
+                                    std::span<Multivector> images) {
+    for (size_t i = 0; i < poses.size(); ++i) {
+      images[i] = extract_origin_image(poses[i]);
+    }
+  }
+
+  /**
+   * The coordinates of a point w e123 + x e023 - y e013 + z e012.
+   */
+  static void extract_point(const Multivector& point, Scalar& x, Scalar& y, Scalar& z) {
+    const Scalar w{point.coefficient(E123)};
+    x = point.coefficient(E023) / w;
+    y = -point.coefficient(E013) / w;
+    z = point.coefficient(E012) / w;
+  }
+
+  static Scalar distance(const Multivector& a, const Multivector& b) {
+    Scalar ax, ay, az, bx, by, bz;
+    extract_point(a, ax, ay, az);
+    extract_point(b, bx, by, bz);
+    return std::hypot(ax - bx, ay - by, az - bz);
+  }
+
+  static Multivector motor_log(const Multivector& motor) {
+    return simple_motor_log(spatial_motor(motor), ROTATION_BLADES);
+  }
+
+  static Multivector motor_exp(const Multivector& bivector) {
+    return simple_motor_exp(bivector, ROTATION_BLADES);
+  }
+
+  static Scalar magnitude_squared(const Multivector& m) { return m.square_magnitude(); }
+
+  static constexpr Scalar max_system_radius() { return 1000; }
+};
+
+/**
+ * Spacetime on 4D CGA, math::Cga4dGeometry, whose first axis is time. A pose is a conformal motor
+ * and its time is the time coordinate of the image of the origin, so times translate, compose and
+ * invert like the spatial coordinates.
+ */
+struct CgaSpacetimeGeometry final
+    : SpatialGeometryModel<math::Cga4dGeometry<double>::Multivector> {
+  using SpacetimeGeometry = math::Cga4dGeometry<double>;
+  using Algebra = SpacetimeGeometry::Algebra;
+  using Multivector = SpacetimeGeometry::Multivector;
+  using Scalar = SpacetimeGeometry::Scalar;
+  using ScalarType = Scalar;
+
+  // Blades of the spatial planes; bit 0 is time, bits 1 to 3 are x, y and z.
+  static constexpr std::array<size_t, 3> ROTATION_BLADES{0b0110, 0b1010, 0b1100};
+
+  static Multivector translator(Scalar x, Scalar y, Scalar z) {
+    return SpacetimeGeometry::make_translator(Scalar{0}, x, y, z);
+  }
+
+  static Multivector identity_at_time(Scalar t) { return SpacetimeGeometry::make_translator(t); }
+
+  static Multivector bivector_xy(Scalar omega) {
+    Multivector result{};
+    result.set_coefficient(ROTATION_BLADES[0], omega);
+    return result;
+  }
+
+  static Multivector origin() { return SpacetimeGeometry::origin(); }
+
+  static Multivector extract_origin_image(const Multivector& pose) {
+    return SpacetimeGeometry::extract_origin_image(pose);
+  }
+
+  static void extract_origin_images(std::span<const Multivector> poses,
+                                    std::span<Multivector> images) {
+    SpacetimeGeometry::extract_origin_images(poses, images);
+  }
+
+  static Scalar extract_time(const Multivector& pose) {
+    Scalar t, x, y, z;
+    SpacetimeGeometry::extract_point(extract_origin_image(pose), t, x, y, z);
+    return t;
+  }
+
+  static void extract_point(const Multivector& point, Scalar& x, Scalar& y, Scalar& z) {
+    Scalar t;
+    SpacetimeGeometry::extract_point(point, t, x, y, z);
+  }
+
+  static Scalar distance(const Multivector& a, const Multivector& b) {
+    Scalar ax, ay, az, bx, by, bz;
+    extract_point(a, ax, ay, az);
+    extract_point(b, bx, by, bz);
+    return std::hypot(ax - bx, ay - by, az - bz);
+  }
+
+  static Multivector motor_log(const Multivector& motor) {
+    return simple_motor_log(motor, ROTATION_BLADES);
+  }
+
+  static Multivector motor_exp(const Multivector& bivector) {
+    return simple_motor_exp(bivector, ROTATION_BLADES);
+  }
+
+  static Scalar magnitude_squared(const Multivector& m) { return m.square_magnitude(); }
+
+  static constexpr Scalar max_system_radius() { return 1000; }
+};
+
+/**
+ * A geometry on the 4D Euclidean algebra, which has as many blades as Pga but another signature.
+ * VGA has no null directions, and so no translators to carry poses; it is only ever the foreign
+ * geometry that files written from PgaSpacetimeGeometry must refuse.
+ */
+struct Vga4dGeometry final : SpatialGeometryModel<math::Algebra<double, 4, 0, 0>::VectorType> {
+  using Algebra = math::Algebra<double, 4, 0, 0>;
+  using Multivector = Algebra::VectorType;
+  using Scalar = Algebra::ScalarType;
+  using ScalarType = Scalar;
+};
+
+static_assert(math::GeometryModel<PgaSpacetimeGeometry>);
+static_assert(math::GeometryModel<CgaSpacetimeGeometry>);
+static_assert(math::HasOriginImage<PgaSpacetimeGeometry>);
+static_assert(math::HasOriginImage<CgaSpacetimeGeometry>);
+static_assert(math::GeometryModel<Vga4dGeometry>);
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace ndyn::assembly {
+
+/**
+ * Light-speed profiles: the speed of light as a function of time, selected per Manifold as a
+ * template policy:
+ *
+ *   Manifold<Geometry, BrentRootFinder, ConstantLightSpeed<double>> manifold{{1.0}};
+ *
+ * Besides the speed itself, a profile provides the optical path between two times: the distance
+ * light covers between them, the integral of c(t). A signal emitted at t_ret reaches a target at
+ * distance d at t_now exactly when d == optical_path(t_ret, t_now), which is the condition the
+ * retardation solver enforces.
+ */
+template <typename Profile, typename ScalarType>
+concept LightSpeedProfile = requires(const Profile& profile, ScalarType t) {
+  { profile.speed(t) } -> std::convertible_to<ScalarType>;
+  { profile.optical_path(t, t) } -> std::convertible_to<ScalarType>;
+};
+
+/**
+ * A fixed speed of light.
+ */
+template <typename ScalarType>
+class ConstantLightSpeed final {
+ private:
+  ScalarType speed_;
+
+ public:
+  constexpr ConstantLightSpeed(ScalarType speed) : speed_{speed} {}
+
+  constexpr ScalarType speed(ScalarType /*t*/) const noexcept { return speed_; }
+
+  constexpr ScalarType optical_path(ScalarType from, ScalarType to) const noexcept {
+    return speed_ * (to - from);
+  }
+};
+
+/**
+ * A speed of light tabulated at uniformly spaced knots and interpolated linearly between them. The
+ * first and last knots' speeds hold before and after the table.
+ *
+ * The table also carries the optical path from the first knot to every other, so the optical path
+ * between any two times costs two index computations and two quadratic evaluations, with no
+ * search and no numeric integration.
+ */
+template <typename ScalarType>
+class TabulatedLightSpeed final {
+ private:
+  ScalarType start_;
+  ScalarType spacing_;
+  std::vector<ScalarType> speeds_;
+  // cumulative_[i] is the optical path from the first knot to knot i.
+  std::vector<ScalarType> cumulative_;
+
+  // Optical path from the first knot to t.
+  ScalarType path_to(ScalarType t) const noexcept {
+    using std::floor;
+
+    const ScalarType offset{t - start_};
+    if (offset <= 0) {
+      return speeds_.front() * offset;
+    }
+    const size_t last{speeds_.size() - 1};
+    const ScalarType position{offset / spacing_};
+    if (position >= last) {
+      return cumulative_.back() + speeds_.back() * (offset - last * spacing_);
+    }
+
+    const size_t i{static_cast<size_t>(floor(position))};
+    const ScalarType s{offset - i * spacing_};
+    return cumulative_[i] + s * (speeds_[i] + (speeds_[i + 1] - speeds_[i]) * s / (2 * spacing_));
+  }
+
+ public:
+  /**
+   * speeds[i] is the speed of light at start + i * spacing.
+   */
+  TabulatedLightSpeed(ScalarType start, ScalarType spacing, std::vector<ScalarType> speeds)
+      : start_{start}, spacing_{spacing}, speeds_{std::move(speeds)} {
+    LOG_IF(FATAL, speeds_.size() < 2) << "Tabulated light speed requires at least two knots.";
+    LOG_IF(FATAL, !(spacing_ > 0)) << "Tabulated light speed requires a positive knot spacing.";
+    LOG_IF(FATAL, std::any_of(speeds_.begin(), speeds_.end(),
+                              [](ScalarType speed) { return !(speed > 0); }))
+        << "Tabulated light speed requires positive speeds.";
+
+    cumulative_.reserve(speeds_.size());
+    cumulative_.push_back(0);
+    for (size_t i = 1; i < speeds_.size(); ++i) {
+      cumulative_.push_back(cumulative_.back() + spacing_ * (speeds_[i - 1] + speeds_[i]) / 2);
+    }
+  }
+
+  /**
+   * Tabulates any callable speed of light at num_knots knots spanning [start, end].
+   */
+  template <typename Function>
+  static TabulatedLightSpeed tabulate(const Function& c_func, ScalarType start, ScalarType end,
+                                      size_t num_knots) {
+    LOG_IF(FATAL, num_knots < 2) << "Tabulated light speed requires at least two knots.";
+    const ScalarType spacing{(end - start) / (num_knots - 1)};
+    std::vector<ScalarType> speeds;
+    speeds.reserve(num_knots);
+    for (size_t i = 0; i < num_knots; ++i) {
+      speeds.push_back(c_func(start + i * spacing));
+    }
+    return TabulatedLightSpeed{start, spacing, std::move(speeds)};
+  }
+
+  ScalarType speed(ScalarType t) const noexcept {
+    using std::floor;
+
+    const ScalarType position{(t - start_) / spacing_};
+    if (position <= 0) return speeds_.front();
+    if (position >= speeds_.size() - 1) return speeds_.back();
+
+    const size_t i{static_cast<size_t>(floor(position))};
+    const ScalarType fraction{position - i};
+    return speeds_[i] + fraction * (speeds_[i + 1] - speeds_[i]);
+  }
+
+  ScalarType optical_path(ScalarType from, ScalarType to) const noexcept {
+    return path_to(to) - path_to(from);
+  }
+
+  ScalarType start() const noexcept { return start_; }
+  ScalarType spacing() const noexcept { return spacing_; }
+  const std::vector<ScalarType>& speeds() const noexcept { return speeds_; }
+};
+
+/**
+ * An arbitrary callable speed of light. The optical path is integrated numerically with adaptive
+ * Gauss-Kronrod quadrature: an interval is accepted once its seven-point Kronrod estimate and the
+ * three-point Gauss estimate embedded in it agree to within the tolerance, and is otherwise split
+ * in two, each half being refined in turn against half the tolerance. The work therefore follows
+ * the interval's length and the speed's variation: a smooth speed over a short interval costs seven
+ * calls, and long horizons are refined until they meet the same relative tolerance. The nodes are
+ * not evenly spaced, so periodic speeds do not alias them as easily as they would even samples,
+ * but like any quadrature it can miss features much narrower than its first samples; tabulate
+ * speeds like that instead.
+ *
+ * The default Function type keeps Manifold constructible from any callable, as before profiles
+ * were introduced.
+ */
+template <typename ScalarType, typename Function = std::function<ScalarType(ScalarType)>>
+class CallableLightSpeed final {
+ private:
+  // Relative to the optical path, and never below what the scalar type can resolve.
+  static constexpr ScalarType RELATIVE_TOLERANCE{
+      std::max(static_cast<ScalarType>(1e-10), 64 * std::numeric_limits<ScalarType>::epsilon())};
+  // Bounds the refinement of speeds that are discontinuous.
+  static constexpr size_t MAX_DEPTH{50};
+
+  // Kronrod nodes on [0, 1], mirrored onto [-1, 0), and their weights. The three-point Gauss rule
+  // uses the center and the second node.
+  static constexpr std::array<ScalarType, 4> KRONROD_NODES{
+      0, static_cast<ScalarType>(0.434243749346802558),
+      static_cast<ScalarType>(0.774596669241483377),
+      static_cast<ScalarType>(0.960491268708020283)};
+  static constexpr std::array<ScalarType, 4> KRONROD_WEIGHTS{
+      static_cast<ScalarType>(0.450916538658474142),
+      static_cast<ScalarType>(0.401397414775962222),
+      static_cast<ScalarType>(0.268488089868333440),
+      static_cast<ScalarType>(0.104656226026467265)};
+  static constexpr ScalarType GAUSS_CENTER_WEIGHT{static_cast<ScalarType>(8) / 9};
+  static constexpr ScalarType GAUSS_OUTER_WEIGHT{static_cast<ScalarType>(5) / 9};
+
+  Function c_func_;
+
+  // The Kronrod estimate of the path over an interval, and its difference from the Gauss one.
+  struct Estimate final {
+    ScalarType path;
+    ScalarType error;
+  };
+
+  Estimate estimate(ScalarType from, ScalarType to) const {
+    using std::abs;
+
+    const ScalarType half_width{(to - from) / 2};
+    const ScalarType center{from + half_width};
+    const ScalarType c_center{c_func_(center)};
+    ScalarType kronrod{KRONROD_WEIGHTS[0] * c_center};
+    ScalarType gauss{GAUSS_CENTER_WEIGHT * c_center};
+    for (size_t i = 1; i < KRONROD_NODES.size(); ++i) {
+      const ScalarType offset{KRONROD_NODES[i] * half_width};
+      const ScalarType sum{c_func_(center - offset) + c_func_(center + offset)};
+      kronrod += KRONROD_WEIGHTS[i] * sum;
+      if (i == 2) gauss += GAUSS_OUTER_WEIGHT * sum;
+    }
+    return Estimate{kronrod * half_width, abs(kronrod - gauss) * abs(half_width)};
+  }
+
+  ScalarType refine(ScalarType from, ScalarType to, const Estimate& whole, ScalarType tolerance,
+                    size_t depth) const {
+    // Estimates that are not numbers are not refined: no refinement would make them numbers.
+    if (depth == 0 || !(whole.error > tolerance)) {
+      return whole.path;
+    }
+    const ScalarType middle{(from + to) / 2};
+    return refine(from, middle, estimate(from, middle), tolerance / 2, depth - 1) +
+           refine(middle, to, estimate(middle, to), tolerance / 2, depth - 1);
+  }
+
+ public:
+  template <typename F>
+    requires std::constructible_from<Function, F&&> &&
+             (!std::same_as<std::remove_cvref_t<F>, CallableLightSpeed>)
+  CallableLightSpeed(F&& c_func) : c_func_(std::forward<F>(c_func)) {}
+
+  ScalarType speed(ScalarType t) const { return c_func_(t); }
+
+  ScalarType optical_path(ScalarType from, ScalarType to) const {
+    using std::abs;
+
+    if (from == to) return 0;
+    const Estimate whole{estimate(from, to)};
+    return refine(from, to, whole, RELATIVE_TOLERANCE * abs(whole.path), MAX_DEPTH);
+  }
+};
+
+}  // namespace ndyn::assembly
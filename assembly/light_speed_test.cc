@@ -0,0 +1,174 @@
+#include "assembly/light_speed.h"
+
+#include <cmath>
+#include <cstddef>
+
+#include "assembly/concurrent_worldline.h"
+#include "assembly/geometry_test_utils.h"
+#include "assembly/manifold.h"
+#include "assembly/root_finders.h"
+#include "assembly/worldline.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+TEST(LightSpeedTest, ConstantOpticalPathIsDistanceTravelled) {
+  const ConstantLightSpeed<double> light_speed{2.5};
+  EXPECT_EQ(light_speed.speed(-3.0), 2.5);
+  EXPECT_DOUBLE_EQ(light_speed.optical_path(1.0, 5.0), 10.0);
+  EXPECT_DOUBLE_EQ(light_speed.optical_path(5.0, 1.0), -10.0);
+}
+
+/**
+ * A linear speed is reproduced exactly by linear interpolation, so the tabulated optical path must
+ * match the closed-form integral, including across knots and outside the table.
+ */
+TEST(LightSpeedTest, TabulatedIsExactForLinearSpeed) {
+  const auto c_func = [](double t) { return 1 + 0.1 * t; };
+  const auto integral = [](double t) { return t + 0.05 * t * t; };
+  const auto light_speed{TabulatedLightSpeed<double>::tabulate(c_func, 0.0, 20.0, 11)};
+
+  for (double t = 0; t <= 20; t += 0.37) {
+    EXPECT_NEAR(light_speed.speed(t), c_func(t), 1e-12) << "t: " << t;
+    EXPECT_NEAR(light_speed.optical_path(0.3, t), integral(t) - integral(0.3), 1e-12)
+        << "t: " << t;
+  }
+
+  // Before and after the table the end speeds hold.
+  EXPECT_DOUBLE_EQ(light_speed.speed(-5.0), 1.0);
+  EXPECT_DOUBLE_EQ(light_speed.speed(30.0), 3.0);
+  EXPECT_NEAR(light_speed.optical_path(-2.0, 0.0), 2.0, 1e-12);
+  EXPECT_NEAR(light_speed.optical_path(20.0, 25.0), 15.0, 1e-12);
+  EXPECT_NEAR(light_speed.optical_path(-2.0, 25.0), 2.0 + integral(20.0) + 15.0, 1e-12);
+}
+
+TEST(LightSpeedTest, TabulatedConvergesForSmoothSpeed) {
+  const auto c_func = [](double t) { return 5 + std::sin(t); };
+  const auto integral = [](double t) { return 5 * t - std::cos(t); };
+  const auto light_speed{TabulatedLightSpeed<double>::tabulate(c_func, 0.0, 20.0, 2001)};
+
+  for (double t = 0; t <= 20; t += 0.37) {
+    EXPECT_NEAR(light_speed.optical_path(1.0, t), integral(t) - integral(1.0), 1e-4)
+        << "t: " << t;
+  }
+}
+
+TEST(LightSpeedTest, CallableIntegratesSmoothSpeed) {
+  const CallableLightSpeed<double> light_speed{[](double t) { return 5 + std::sin(t); }};
+  const auto integral = [](double t) { return 5 * t - std::cos(t); };
+
+  EXPECT_DOUBLE_EQ(light_speed.speed(0.5), 5 + std::sin(0.5));
+  for (double t = 0; t <= 4; t += 0.37) {
+    EXPECT_NEAR(light_speed.optical_path(1.0, t), integral(t) - integral(1.0), 1e-6)
+        << "t: " << t;
+  }
+
+  // Exact for polynomials of degree five.
+  const CallableLightSpeed<double> quintic{[](double t) { return 1 + t * t * t * t * t; }};
+  EXPECT_NEAR(quintic.optical_path(0.0, 2.0), 2 + 64.0 / 6, 1e-12);
+}
+
+/**
+ * The quadrature refines with the length of the interval, so long horizons are as accurate,
+ * relative to the path, as short ones.
+ */
+TEST(LightSpeedTest, CallableIsAccurateOverLongHorizons) {
+  const CallableLightSpeed<double> light_speed{[](double t) { return 5 + std::sin(t); }};
+  const auto integral = [](double t) { return 5 * t - std::cos(t); };
+
+  for (const double end : {20.0, 100.0, 1000.0, 10000.0}) {
+    const double expected{integral(end) - integral(0.0)};
+    EXPECT_NEAR(light_speed.optical_path(0.0, end), expected, 1e-9 * expected) << "end: " << end;
+    EXPECT_NEAR(light_speed.optical_path(end, 0.0), -expected, 1e-9 * expected) << "end: " << end;
+  }
+  EXPECT_EQ(light_speed.optical_path(3.0, 3.0), 0);
+}
+
+/**
+ * Short intervals of a smooth speed, as the retardation solver asks for, cost a handful of calls.
+ */
+TEST(LightSpeedTest, CallableCostFollowsTheInterval) {
+  size_t calls{0};
+  const CallableLightSpeed<double> light_speed{[&calls](double t) {
+    ++calls;
+    return 1 + 0.1 * t;
+  }};
+  EXPECT_NEAR(light_speed.optical_path(2.0, 4.0), 2.6, 1e-12);
+  EXPECT_EQ(calls, 7u);
+
+  const CallableLightSpeed<double> oscillating{[&calls](double t) {
+    ++calls;
+    return 5 + std::sin(t);
+  }};
+  calls = 0;
+  oscillating.optical_path(10.0, 10.1);
+  const size_t short_calls{calls};
+  calls = 0;
+  oscillating.optical_path(0.0, 1000.0);
+  EXPECT_EQ(short_calls, 7u);
+  EXPECT_GT(calls, 100 * short_calls);
+}
+
+template <typename Geometry>
+class LightSpeedManifoldTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+
+  static math::State<Geometry, 2> make_state(Scalar t, Scalar x) {
+    math::State<Geometry, 2> s;
+    s.template set_element<0>(Geometry::translator(x, 0, 0) * Geometry::identity_at_time(t));
+    return s;
+  }
+
+  /**
+   * A source at rest 10 units from the target, which is at t = 20, under c(t) = 1 + t / 10. The
+   * signal must cover the distance integrated over the speed along its way, not at t_now:
+   * (20 - t_ret) + (400 - t_ret^2) / 20 = 10.
+   */
+  template <typename SourceWorldline, typename ManifoldType>
+  static Scalar solve(const ManifoldType& manifold) {
+    SourceWorldline wl(manifold, 1024);
+    for (int i = 0; i <= 200; ++i) {
+      wl.record_state(make_state(0.1 * i, 10));
+    }
+    return manifold.solve_retardation(wl, Geometry::identity_at_time(20.0));
+  }
+
+  static constexpr Scalar EXPECTED_T_RET{16.457513110645905};
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(LightSpeedManifoldTest, GeometryTypes);
+
+TYPED_TEST(LightSpeedManifoldTest, RetardationFollowsOpticalPath) {
+  using Geometry = TypeParam;
+  const auto c_func = [](double t) { return 1 + 0.1 * t; };
+
+  const Manifold<Geometry> callable(c_func);
+  const Manifold<Geometry, BrentRootFinder, TabulatedLightSpeed<double>> tabulated(
+      TabulatedLightSpeed<double>::tabulate(c_func, 0.0, 20.0, 21));
+
+  EXPECT_NEAR((this->template solve<Worldline<Geometry>>(callable)), this->EXPECTED_T_RET, 1e-6);
+  EXPECT_NEAR((this->template solve<ConcurrentWorldline<Geometry>>(callable)),
+              this->EXPECTED_T_RET, 1e-6);
+  EXPECT_NEAR((this->template solve<Worldline<Geometry>>(tabulated)), this->EXPECTED_T_RET, 1e-6);
+  EXPECT_NEAR((this->template solve<ConcurrentWorldline<Geometry>>(tabulated)),
+              this->EXPECTED_T_RET, 1e-6);
+}
+
+TYPED_TEST(LightSpeedManifoldTest, ConstantProfileMatchesCallable) {
+  using Geometry = TypeParam;
+  const Manifold<Geometry> callable([](double) { return 2.0; });
+  const Manifold<Geometry, BrentRootFinder, ConstantLightSpeed<double>> constant(2.0);
+
+  EXPECT_NEAR((this->template solve<Worldline<Geometry>>(constant)),
+              (this->template solve<Worldline<Geometry>>(callable)), 1e-9);
+  EXPECT_NEAR((this->template solve<Worldline<Geometry>>(constant)), 15.0, 1e-6);
+  EXPECT_EQ(constant.calculate_speed_of_light(7.0), 2.0);
+  EXPECT_DOUBLE_EQ(constant.calculate_optical_path(1.0, 4.0), 6.0);
+}
+
+}  // namespace ndyn::test
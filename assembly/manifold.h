@@ -1,165 +1,736 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
+#include <limits>
+#include <optional>
+#include <span>
+#include <utility>
 #include <vector>
 
+#include "assembly/light_speed.h"
+#include "assembly/retardation.h"
+#include "assembly/root_finders.h"
+#include "assembly/spatial.h"
 #include "assembly/worldline.h"
+#include "glog/logging.h"
 #include "math/abs.h"
+#include "math/geometry_model.h"
 #include "math/state.h"
 
 namespace ndyn::assembly {
 
 template <typename Geometry>
+class RetardationCache;
+
+/**
+ * The spacetime in which particles interact: the speed of light as a function of time, and the
+ * retardation solver that finds where a source's past light cone meets a target event. RootFinder
+ * selects how the light-cone equation is solved once its root is bracketed; see root_finders.h.
+ * LightSpeed selects how the speed of light and its optical path are computed; see light_speed.h.
+ */
+template <typename Geometry, typename RootFinder = BrentRootFinder,
+          typename LightSpeed = CallableLightSpeed<typename Geometry::ScalarType>>
 class Manifold final {
  public:
   using Multivector = typename Geometry::Multivector;
   using ScalarType = typename Geometry::ScalarType;
   using WorldlineType = Worldline<Geometry>;
   using LightSpeedFunc = std::function<ScalarType(ScalarType)>;
+  using LightSpeedType = LightSpeed;
+
+  static_assert(LightSpeedProfile<LightSpeed, ScalarType>);
 
   static constexpr ScalarType TOLERANCE{Geometry::Algebra::EPSILON};
 
  private:
-  LightSpeedFunc c_func_;
+  LightSpeed light_speed_;
+
+  // Half-width of the first warm-started bracket, as a fraction of the time since the previous
+  // solve, and its floor. Failed brackets grow by WIDENING_FACTOR up to MAX_WIDENINGS times.
+  static constexpr ScalarType WARM_BRACKET_FRACTION{0.125};
+  static constexpr ScalarType WARM_BRACKET_MINIMUM{64 * TOLERANCE};
+  static constexpr ScalarType WIDENING_FACTOR{4};
+  static constexpr int MAX_WIDENINGS{8};
+
+  // Regula falsi steps allowed within a located segment before deferring to the RootFinder.
+  static constexpr int MAX_SEGMENT_STEPS{3};
+
+  static Multivector position_of(const Multivector& pose) { return origin_image<Geometry>(pose); }
+
+  static void positions_of(std::span<const Multivector> poses, std::span<Multivector> positions) {
+    if constexpr (math::HasOriginImage<Geometry>) {
+      Geometry::extract_origin_images(poses, positions);
+    } else {
+      std::transform(poses.begin(), poses.end(), positions.begin(), position_of);
+    }
+  }
 
   /**
-   * Finds the retarded time (emission time) using Brent's Method.
+   * The light-cone intersection equation for a source worldline and a fixed target event:
+   * f(t) = spatial_distance(source(t), target(t_now)) - optical_path(t, t_now)
+   * where the optical path is the distance light covers between t and t_now.
    *
-   * This solver finds the root of the light-cone intersection equation:
-   * f(t) = spatial_distance(source(t), target(t_now)) - speed_of_light * (t_now - t)
-   */
-  // TODO(james): Fix this solver. The speed of light is currently fixed in these calculations,
-  // rather than using c_func_ to recompute at each iteration. Likely, the entire method is
-  // structurally incorrect and needs to be rethought.
-  ScalarType solve_retardation(const WorldlineType& source_worldline,
-                               const Multivector& target_pose, ScalarType t_now) const {
-    using math::abs;
-    const ScalarType speed_of_light{c_func_(t_now)};
-    const Multivector target_position{target_pose * Geometry::origin() * ~target_pose};
+   * Its derivatives, for the root-finding policies that use them, come from the source's recorded
+   * velocity, State element 1: the generator V for which motor_exp(V * dt) * pose advances the pose
+   * by dt. Moving the source along V by a small step on either side and differencing the distances
+   * costs no further samples of the worldline. The second derivative is that of the distance along
+   * this tangent motion, and so ignores the source's acceleration.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  class LightTravelError final {
+   private:
+    const SourceWorldline* source_worldline_;
+    RetardationCounters* counters_;
+    const LightSpeed* light_speed_;
+    Multivector target_position_;
+    ScalarType t_now_;
+
+    // Relative step of the central differences; cbrt(epsilon) balances truncation and round-off
+    // in the second difference.
+    static ScalarType derivative_step() noexcept {
+      using std::cbrt;
+      static const ScalarType step{cbrt(std::numeric_limits<ScalarType>::epsilon())};
+      return step;
+    }
 
-    // The objective function: we are looking for f(t_retarded) == 0
-    auto light_travel_error = [&](ScalarType t_test) {
-      const auto state{source_worldline.get_state_at(t_test)};
+   public:
+    LightTravelError(const SourceWorldline& source_worldline, const LightSpeed& light_speed,
+                     const Multivector& target_position, ScalarType t_now,
+                     RetardationCounters& counters)
+        : source_worldline_{&source_worldline},
+          counters_{&counters},
+          light_speed_{&light_speed},
+          target_position_{target_position},
+          t_now_{t_now} {}
+
+    ScalarType operator()(ScalarType t_test) const {
+      ++counters_->evaluations;
+      const auto state{source_worldline_->get_state_at(t_test)};
       const Multivector source_pose{state.template element<0>()};
-      const Multivector source_position{source_pose * Geometry::origin() * ~source_pose};
+      const Multivector source_position{position_of(source_pose)};
+
+      const ScalarType spatial_distance{Geometry::distance(source_position, target_position_)};
 
-      const ScalarType spatial_distance{Geometry::distance(source_position, target_position)};
-      const ScalarType time_delay{t_now - t_test};
+      return spatial_distance - light_speed_->optical_path(t_test, t_now_);
+    }
 
-      return spatial_distance - (speed_of_light * time_delay);
-    };
+    LightConeSample<ScalarType> with_derivatives(ScalarType t_test) const {
+      using std::max;
+
+      ++counters_->evaluations;
+      const auto state{source_worldline_->get_state_at(t_test)};
+      const Multivector source_pose{state.template element<0>()};
+      const Multivector velocity{state.template element<1>()};
+
+      const auto distance_after = [&](ScalarType dt) {
+        const Multivector pose{Geometry::motor_exp(velocity * dt) * source_pose};
+        return Geometry::distance(position_of(pose), target_position_);
+      };
+
+      const ScalarType h{derivative_step() * max(ScalarType{1}, t_now_ - t_test)};
+      const ScalarType here{Geometry::distance(position_of(source_pose), target_position_)};
+      const ScalarType ahead{distance_after(h)};
+      const ScalarType behind{distance_after(-h)};
+
+      return {here - light_speed_->optical_path(t_test, t_now_),
+              (ahead - behind) / (2 * h) + light_speed_->speed(t_test),
+              (ahead - 2 * here + behind) / (h * h) +
+                  (light_speed_->speed(t_test + h) - light_speed_->speed(t_test - h)) / (2 * h)};
+    }
+  };
+
+  template <WorldlineLike<Geometry> SourceWorldline>
+  LightTravelError<SourceWorldline> light_travel_error(const SourceWorldline& source_worldline,
+                                                       const Multivector& target_position,
+                                                       ScalarType t_now,
+                                                       RetardationCounters& counters) const {
+    return {source_worldline, light_speed_, target_position, t_now, counters};
+  }
+
+  /**
+   * Finds a root of f inside [lower_bound, upper_bound] using the RootFinder policy. The caller has
+   * already evaluated f at both ends and guarantees that they bracket a sign change.
+   */
+  template <typename Function>
+  static ScalarType find_root(const Function& f, ScalarType lower_bound, ScalarType upper_bound,
+                              ScalarType f_lower, ScalarType f_upper,
+                              RetardationCounters& counters) {
+    return RootFinder::find_root(f, lower_bound, upper_bound, f_lower, f_upper, TOLERANCE,
+                                 counters);
+  }
+
+  /**
+   * Solves over the full history, bracketing between the oldest available sample and t_now.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  ScalarType solve_by_bracketing(const SourceWorldline& source_worldline,
+                                 const Multivector& target_position, ScalarType t_now,
+                                 RetardationCounters& counters) const {
+    const auto f{light_travel_error(source_worldline, target_position, t_now, counters)};
 
     // Bracket the search between the oldest available history and the current time.
-    ScalarType lower_bound{source_worldline.oldest_time()};
-    ScalarType upper_bound{t_now};
+    const ScalarType lower_bound{source_worldline.oldest_time()};
+    const ScalarType upper_bound{t_now};
 
-    ScalarType f_lower{light_travel_error(lower_bound)};
-    ScalarType f_upper{light_travel_error(upper_bound)};
+    const ScalarType f_lower{f(lower_bound)};
+    const ScalarType f_upper{f(upper_bound)};
 
     // If the signs are the same, the signal hasn't reached the target yet.
     if (f_lower * f_upper > 0) {
       return lower_bound;
     }
 
-    // Brent's Method variables
-    ScalarType best_estimate{upper_bound};
-    ScalarType prev_best{lower_bound};
-    ScalarType contrivance_point{lower_bound};  // 'c' in standard Brent notation
+    return find_root(f, lower_bound, upper_bound, f_lower, f_upper, counters);
+  }
+
+  /**
+   * Warm-started counterpart of solve_by_bracketing(). Searches a bracket of the given half-width
+   * around the guess, widening it geometrically until it captures the root, and falls back to the
+   * full history if it never does.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  ScalarType solve_by_bracketing_from(const SourceWorldline& source_worldline,
+                                      const Multivector& target_position, ScalarType t_now,
+                                      ScalarType guess, ScalarType half_width,
+                                      RetardationCounters& counters) const {
+    using std::max;
+    using std::min;
+
+    const auto f{light_travel_error(source_worldline, target_position, t_now, counters)};
+    const ScalarType oldest{source_worldline.oldest_time()};
+    guess = min(max(guess, oldest), t_now);
+
+    ScalarType lower{max(guess - half_width, oldest)};
+    ScalarType upper{min(guess + half_width, t_now)};
+    ScalarType f_lower{f(lower)};
+    ScalarType f_upper{f(upper)};
+
+    int widenings{0};
+    while (f_lower * f_upper > 0 && widenings < MAX_WIDENINGS &&
+           (lower > oldest || upper < t_now)) {
+      ++widenings;
+      ++counters.widenings;
+      half_width *= WIDENING_FACTOR;
+
+      // Only re-evaluate the ends that actually moved.
+      if (lower > oldest) {
+        lower = max(guess - half_width, oldest);
+        f_lower = f(lower);
+      }
+      if (upper < t_now) {
+        upper = min(guess + half_width, t_now);
+        f_upper = f(upper);
+      }
+    }
+
+    if (f_lower * f_upper <= 0) {
+      return find_root(f, lower, upper, f_lower, f_upper, counters);
+    }
+    if (lower == oldest && upper == t_now) {
+      // The widened bracket is the full history, and the signal hasn't reached the target yet.
+      return oldest;
+    }
+    ++counters.fallbacks;
+    return solve_over_history(source_worldline, target_position, t_now, counters);
+  }
+
+  // Source positions at each segment boundary, filled in as they are first needed. Shared by every
+  // target of a batched solve.
+  using BoundaryPositions = std::vector<std::optional<Multivector>>;
 
-    ScalarType f_best{f_upper};
-    ScalarType f_prev{f_lower};
-    ScalarType f_contrivance{f_lower};
+  /**
+   * The boundaries between which a sampled worldline's retarded time is sought: every sample
+   * strictly before t_now, then t_now itself. The light-cone error at a sample is computed from the
+   * recorded state directly; only the final boundary needs an interpolated state.
+   */
+  template <SampledWorldline<Geometry> SourceWorldline>
+  class SegmentBoundaries final {
+   private:
+    const SourceWorldline* source_worldline_;
+    Multivector target_position_;
+    const LightSpeed* light_speed_;
+    ScalarType t_now_;
+    size_t num_samples_;
+    RetardationCounters* counters_;
+    BoundaryPositions* positions_;
+
+    Multivector compute_position(size_t i) const {
+      if (i < num_samples_) {
+        ++counters_->samples;
+        return position_of(source_worldline_->history().state(i).template element<0>());
+      }
+      ++counters_->evaluations;
+      return position_of(source_worldline_->get_state_at(t_now_).template element<0>());
+    }
 
-    ScalarType interpolation_step{0};
-    ScalarType last_step_size{0};
-    bool use_bisection{true};
+   public:
+    /**
+     * If positions is given, it must hold last() + 1 entries; source positions are then looked up
+     * there before being computed, and stored once computed.
+     */
+    SegmentBoundaries(const SourceWorldline& source_worldline, const Multivector& target_position,
+                      const LightSpeed& light_speed, ScalarType t_now,
+                      RetardationCounters& counters, BoundaryPositions* positions = nullptr)
+        : source_worldline_{&source_worldline},
+          target_position_{target_position},
+          light_speed_{&light_speed},
+          t_now_{t_now},
+          num_samples_{source_worldline.history().lower_bound(t_now)},
+          counters_{&counters},
+          positions_{positions} {}
+
+    // Index of the final boundary, t_now.
+    size_t last() const noexcept { return num_samples_; }
+
+    ScalarType time(size_t i) const {
+      return i < num_samples_ ? source_worldline_->history().time(i) : t_now_;
+    }
 
-    for (int iteration{0}; iteration < 64; ++iteration) {
-      // Check convergence
-      if (abs(f_best) < TOLERANCE || abs(best_estimate - prev_best) < TOLERANCE) {
-        return best_estimate;
+    Multivector position(size_t i) const {
+      if (positions_ == nullptr) {
+        return compute_position(i);
       }
+      std::optional<Multivector>& position{(*positions_)[i]};
+      if (!position) {
+        position = compute_position(i);
+      }
+      return *position;
+    }
+
+    // Distance light covers between boundary i and t_now.
+    ScalarType optical_path(size_t i) const {
+      return light_speed_->optical_path(time(i), t_now_);
+    }
 
-      // Inverse Quadratic Interpolation or Secant Method
-      if (f_best != f_prev && f_best != f_contrivance && f_prev != f_contrivance) {
-        // Inverse Quadratic
-        interpolation_step =
-            (prev_best * f_best * f_contrivance) / ((f_prev - f_best) * (f_prev - f_contrivance)) +
-            (best_estimate * f_prev * f_contrivance) /
-                ((f_best - f_prev) * (f_best - f_contrivance)) +
-            (contrivance_point * f_prev * f_best) /
-                ((f_contrivance - f_prev) * (f_contrivance - f_best));
+    ScalarType error(size_t i, const Multivector& position) const {
+      return Geometry::distance(position, target_position_) - optical_path(i);
+    }
+
+    const Multivector& target_position() const noexcept { return target_position_; }
+    ScalarType t_now() const noexcept { return t_now_; }
+  };
+
+  /**
+   * A span of boundaries, with the source position and light-cone error at either end.
+   */
+  struct Segment final {
+    size_t lower;
+    size_t upper;
+    Multivector p_lower;
+    Multivector p_upper;
+    ScalarType f_lower;
+    ScalarType f_upper;
+
+    template <typename Boundaries>
+    static Segment between(const Boundaries& boundaries, size_t lower, size_t upper) {
+      Segment result{lower, upper, boundaries.position(lower), boundaries.position(upper), 0, 0};
+      result.f_lower = boundaries.error(lower, result.p_lower);
+      result.f_upper = boundaries.error(upper, result.p_upper);
+      return result;
+    }
+  };
+
+  /**
+   * Narrows a segment whose ends differ in sign to a pair of adjacent boundaries, by binary search
+   * on the sign of the error at the boundaries in between.
+   */
+  template <typename Boundaries>
+  static void narrow(const Boundaries& boundaries, Segment& segment) {
+    while (segment.upper - segment.lower > 1) {
+      const size_t middle{segment.lower + (segment.upper - segment.lower) / 2};
+      const Multivector p_middle{boundaries.position(middle)};
+      const ScalarType f_middle{boundaries.error(middle, p_middle)};
+      if (f_middle * segment.f_lower > 0) {
+        segment.lower = middle;
+        segment.p_lower = p_middle;
+        segment.f_lower = f_middle;
       } else {
-        // Secant
-        interpolation_step =
-            best_estimate - f_best * (best_estimate - prev_best) / (f_best - f_prev);
+        segment.upper = middle;
+        segment.p_upper = p_middle;
+        segment.f_upper = f_middle;
       }
+    }
+  }
 
-      // Evaluate if the proposed step is acceptable
-      const ScalarType delta_est_prev{abs(best_estimate - prev_best)};
-      const ScalarType delta_prev_contrivance{abs(prev_best - contrivance_point)};
+  /**
+   * Solves within a pair of adjacent boundaries whose errors differ in sign.
+   *
+   * Between two samples the source moves along a single constant-generator motion. Approximating
+   * its position as linear in time there, which is exact for pure translations, turns the
+   * light-cone condition into a quadratic whose coefficients need only the distances between the
+   * segment end points and the target. Its root is then polished by at most MAX_SEGMENT_STEPS
+   * regula falsi steps on the exact error f, and handed to the RootFinder on the segment in the
+   * rare case that is not enough.
+   */
+  template <typename Function, typename Boundaries>
+  static ScalarType solve_in_segment(const Function& f, const Boundaries& boundaries,
+                                     const Segment& segment, RetardationCounters& counters) {
+    using math::abs;
+    using std::sqrt;
+
+    ScalarType t_lower{boundaries.time(segment.lower)};
+    ScalarType t_upper{boundaries.time(segment.upper)};
+    ScalarType f_lower{segment.f_lower};
+    ScalarType f_upper{segment.f_upper};
+    if (f_lower == 0) return t_lower;
+    if (f_upper == 0) return t_upper;
+
+    // With p(tau) = p_lower + tau (p_upper - p_lower) over the segment, the law of cosines gives
+    // |p(tau) - target|^2 = d0^2 + tau (d1^2 - d0^2 - L^2) + tau^2 L^2. Taking the optical path to
+    // t_now as linear in tau too, P(tau) = P0 - tau (P0 - P1), which is exact for a constant speed
+    // of light, the light-cone condition |p(tau) - target| = P(tau) becomes a quadratic in tau.
+    // The optical paths at the ends follow from the errors already computed there.
+    const ScalarType d0{Geometry::distance(segment.p_lower, boundaries.target_position())};
+    const ScalarType d1{Geometry::distance(segment.p_upper, boundaries.target_position())};
+    const ScalarType length{Geometry::distance(segment.p_lower, segment.p_upper)};
+    const ScalarType duration{t_upper - t_lower};
+    const ScalarType path_lower{d0 - f_lower};
+    const ScalarType path_change{path_lower - (d1 - f_upper)};
+
+    const ScalarType a{length * length - path_change * path_change};
+    const ScalarType b{d1 * d1 - d0 * d0 - length * length + 2 * path_lower * path_change};
+    const ScalarType c{d0 * d0 - path_lower * path_lower};
+
+    // Fall back on the secant through the end points if the quadratic has no root in the segment.
+    ScalarType tau{f_lower / (f_lower - f_upper)};
+    const auto in_segment = [](ScalarType candidate) { return candidate >= 0 && candidate <= 1; };
+    if (abs(a) < TOLERANCE) {
+      if (abs(b) > TOLERANCE && in_segment(-c / b)) tau = -c / b;
+    } else {
+      const ScalarType discriminant{b * b - 4 * a * c};
+      if (discriminant >= 0) {
+        const ScalarType root{sqrt(discriminant)};
+        const ScalarType tau_minus{(-b - root) / (2 * a)};
+        const ScalarType tau_plus{(-b + root) / (2 * a)};
+        if (in_segment(tau_minus)) {
+          tau = tau_minus;
+        } else if (in_segment(tau_plus)) {
+          tau = tau_plus;
+        }
+      }
+    }
 
-      const bool out_of_bounds = (interpolation_step < (3 * prev_best + best_estimate) / 4 ||
-                                  interpolation_step > best_estimate);
-      const bool too_slow_iq =
-          (use_bisection && abs(interpolation_step - best_estimate) >= delta_est_prev / 2);
-      const bool too_slow_secant =
-          (!use_bisection && abs(interpolation_step - best_estimate) >= delta_prev_contrivance / 2);
+    ScalarType estimate{t_lower + tau * duration};
+    for (int step{0}; step < MAX_SEGMENT_STEPS; ++step) {
+      ++counters.iterations;
+      const ScalarType f_estimate{f(estimate)};
+      if (abs(f_estimate) < TOLERANCE) {
+        return estimate;
+      }
 
-      if (out_of_bounds || too_slow_iq || too_slow_secant) {
-        interpolation_step = (prev_best + best_estimate) / 2;
-        use_bisection = true;
+      if (f_estimate * f_lower > 0) {
+        t_lower = estimate;
+        f_lower = f_estimate;
       } else {
-        use_bisection = false;
+        t_upper = estimate;
+        f_upper = f_estimate;
       }
+      if (t_upper - t_lower < TOLERANCE) {
+        return estimate;
+      }
+      estimate = t_lower - f_lower * (t_upper - t_lower) / (f_upper - f_lower);
+    }
+
+    return find_root(f, t_lower, t_upper, f_lower, f_upper, counters);
+  }
 
-      const ScalarType f_new{light_travel_error(interpolation_step)};
+  /**
+   * Solves over the full history by first locating the pair of samples that bracket the root, using
+   * O(log n) evaluations at the samples themselves, then solving within that segment only.
+   */
+  template <SampledWorldline<Geometry> SourceWorldline>
+  ScalarType solve_by_segments(const SourceWorldline& source_worldline,
+                               const Multivector& target_position, ScalarType t_now,
+                               RetardationCounters& counters) const {
+    const SegmentBoundaries<SourceWorldline> boundaries{
+        source_worldline, target_position, light_speed_, t_now, counters};
 
-      // Update the bracket
-      contrivance_point = prev_best;
-      f_contrivance = f_prev;
-      last_step_size = abs(best_estimate - prev_best);
+    Segment segment{Segment::between(boundaries, 0, boundaries.last())};
 
-      if (f_prev * f_new < 0) {
-        best_estimate = interpolation_step;
-        f_best = f_new;
+    // If the signs are the same, the signal hasn't reached the target yet.
+    if (segment.f_lower * segment.f_upper > 0) {
+      return boundaries.time(0);
+    }
+
+    narrow(boundaries, segment);
+    return solve_in_segment(light_travel_error(source_worldline, target_position, t_now, counters),
+                            boundaries, segment, counters);
+  }
+
+  /**
+   * Warm-started counterpart of solve_by_segments(). Starts from the segment containing the
+   * predicted retarded time and gallops outwards, doubling the stride each time, until the
+   * segment brackets the root.
+   *
+   * The error is negative before the retarded time and positive after it, since it is never
+   * negative at t_now; that tells the search which way to move.
+   */
+  template <SampledWorldline<Geometry> SourceWorldline>
+  ScalarType solve_by_segments_from(const SourceWorldline& source_worldline,
+                                    const Multivector& target_position, ScalarType t_now,
+                                    ScalarType guess, RetardationCounters& counters,
+                                    BoundaryPositions* positions = nullptr) const {
+    using std::clamp;
+
+    const SegmentBoundaries<SourceWorldline> boundaries{
+        source_worldline, target_position, light_speed_, t_now, counters, positions};
+    const size_t last{boundaries.last()};
+
+    const size_t start{clamp<size_t>(source_worldline.history().lower_bound(guess), 1, last)};
+    Segment segment{Segment::between(boundaries, start - 1, start)};
+
+    size_t stride{1};
+    while (segment.f_lower * segment.f_upper > 0) {
+      if (segment.f_lower > 0) {
+        if (segment.lower == 0) {
+          // The signal hasn't reached the target yet.
+          return boundaries.time(0);
+        }
+        const size_t lower{segment.lower > stride ? segment.lower - stride : 0};
+        const Multivector p_lower{boundaries.position(lower)};
+        segment = Segment{lower, segment.lower, p_lower, segment.p_lower,
+                          boundaries.error(lower, p_lower), segment.f_lower};
       } else {
-        prev_best = interpolation_step;
-        f_prev = f_new;
+        if (segment.upper == last) {
+          // Only possible through round-off; the error at t_now is never negative.
+          ++counters.fallbacks;
+          return solve_by_segments(source_worldline, target_position, t_now, counters);
+        }
+        const size_t upper{std::min(segment.upper + stride, last)};
+        const Multivector p_upper{boundaries.position(upper)};
+        segment = Segment{segment.upper, upper, segment.p_upper, p_upper, segment.f_upper,
+                          boundaries.error(upper, p_upper)};
       }
+      ++counters.widenings;
+      stride *= 2;
+    }
+
+    narrow(boundaries, segment);
+    return solve_in_segment(light_travel_error(source_worldline, target_position, t_now, counters),
+                            boundaries, segment, counters);
+  }
 
-      if (abs(f_prev) < abs(f_best)) {
-        std::swap(prev_best, best_estimate);
-        std::swap(f_prev, f_best);
+  /**
+   * Solves over the full history, using the recorded samples when the worldline exposes them.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  ScalarType solve_over_history(const SourceWorldline& source_worldline,
+                                const Multivector& target_position, ScalarType t_now,
+                                RetardationCounters& counters) const {
+    if (has_samples_before(source_worldline, t_now)) {
+      if constexpr (SampledWorldline<SourceWorldline, Geometry>) {
+        return solve_by_segments(source_worldline, target_position, t_now, counters);
       }
     }
+    return solve_by_bracketing(source_worldline, target_position, t_now, counters);
+  }
 
-    return best_estimate;
+  /**
+   * Whether the segment-wise solvers apply: the worldline must expose its samples, and at least one
+   * of them must precede t_now, or there is no segment to search.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  static bool has_samples_before(const SourceWorldline& source_worldline, ScalarType t_now) {
+    if constexpr (SampledWorldline<SourceWorldline, Geometry>) {
+      return source_worldline.history().lower_bound(t_now) > 0;
+    } else {
+      return false;
+    }
   }
 
  public:
-  explicit Manifold(LightSpeedFunc c_func) : c_func_{std::move(c_func)} {}
+  explicit Manifold(LightSpeed light_speed) : light_speed_{std::move(light_speed)} {}
+
+  /**
+   * Finds the retarded time (emission time): the time at which a signal leaving the source
+   * worldline reaches the target event. Returns the oldest available time if no signal in the
+   * recorded history can have reached the target yet.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  ScalarType solve_retardation(const SourceWorldline& source_worldline,
+                               const Multivector& target_pose) const {
+    RetardationCounters counters{};
+    return solve_retardation(source_worldline, target_pose, counters);
+  }
+
+  template <WorldlineLike<Geometry> SourceWorldline>
+  ScalarType solve_retardation(const SourceWorldline& source_worldline,
+                               const Multivector& target_pose,
+                               RetardationCounters& counters) const {
+    ++counters.solves;
+    return solve_over_history(source_worldline, position_of(target_pose),
+                              Geometry::extract_time(target_pose), counters);
+  }
+
+  /**
+   * Warm-started variant for repeated solves of the same source/target pair.
+   *
+   * Searches a small bracket around the retarded time predicted from the previous solve, widening
+   * it geometrically until it captures the root, and falls back to the full history if it never
+   * does. The first solve for a pair is always a full solve. warm_start is updated with the result.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  ScalarType solve_retardation(const SourceWorldline& source_worldline,
+                               const Multivector& target_pose,
+                               RetardationWarmStart<ScalarType>& warm_start) const {
+    using math::abs;
+    using std::max;
+
+    RetardationCounters& counters{warm_start.counters};
+    ++counters.solves;
+
+    const ScalarType t_now{Geometry::extract_time(target_pose)};
+    const Multivector target_position{position_of(target_pose)};
+
+    ScalarType t_ret{};
+    if (!warm_start.primed) {
+      t_ret = solve_over_history(source_worldline, target_position, t_now, counters);
+    } else if (has_samples_before(source_worldline, t_now)) {
+      if constexpr (SampledWorldline<SourceWorldline, Geometry>) {
+        t_ret = solve_by_segments_from(source_worldline, target_position, t_now,
+                                       warm_start.predict(t_now), counters);
+      }
+    } else {
+      t_ret = solve_by_bracketing_from(
+          source_worldline, target_position, t_now, warm_start.predict(t_now),
+          max(WARM_BRACKET_FRACTION * abs(t_now - warm_start.t_now), WARM_BRACKET_MINIMUM),
+          counters);
+    }
+
+    if (warm_start.primed && abs(t_now - warm_start.t_now) > TOLERANCE) {
+      warm_start.rate = (t_ret - warm_start.t_ret) / (t_now - warm_start.t_now);
+    }
+    warm_start.primed = true;
+    warm_start.t_now = t_now;
+    warm_start.t_ret = t_ret;
+
+    return t_ret;
+  }
+
+  /**
+   * Solves retardation for many targets against one source worldline at a common time t_now,
+   * writing the retarded time of target_poses[i] to t_rets[i]. Only the positions of the target
+   * poses are used.
+   *
+   * Each target's retarded time is first estimated by treating the source as fixed at its position
+   * at t_now, and the targets are solved in order of that estimate. Against a worldline with
+   * addressable samples each solve starts from its estimate, and every source position computed at
+   * a sample is kept for the later targets, so the batch makes a single pass over the part of the
+   * history it needs instead of searching it from scratch per target. Against other worldlines
+   * each solve searches a small bracket around its estimate.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  void solve_retardation_batch(const SourceWorldline& source_worldline,
+                               std::span<const Multivector> target_poses, ScalarType t_now,
+                               std::span<ScalarType> t_rets) const {
+    RetardationCounters counters{};
+    solve_retardation_batch(source_worldline, target_poses, t_now, t_rets, counters);
+  }
+
+  template <WorldlineLike<Geometry> SourceWorldline>
+  void solve_retardation_batch(const SourceWorldline& source_worldline,
+                               std::span<const Multivector> target_poses, ScalarType t_now,
+                               std::span<ScalarType> t_rets, RetardationCounters& counters) const {
+    LOG_IF(FATAL, t_rets.size() != target_poses.size())
+        << "Batched retardation requires one output per target.";
+
+    const size_t count{target_poses.size()};
+    if (count == 0) return;
+    counters.solves += count;
+
+    ++counters.evaluations;
+    const Multivector source_now{
+        position_of(source_worldline.get_state_at(t_now).template element<0>())};
+    const ScalarType speed_of_light{light_speed_.speed(t_now)};
+
+    std::vector<Multivector> target_positions(count);
+    positions_of(target_poses, target_positions);
+
+    std::vector<ScalarType> estimates(count);
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+      estimates[i] = t_now - Geometry::distance(source_now, target_positions[i]) / speed_of_light;
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+              [&estimates](size_t lhs, size_t rhs) { return estimates[lhs] < estimates[rhs]; });
+
+    if (has_samples_before(source_worldline, t_now)) {
+      if constexpr (SampledWorldline<SourceWorldline, Geometry>) {
+        BoundaryPositions positions(source_worldline.history().lower_bound(t_now) + 1);
+        positions.back() = source_now;
+        for (const size_t i : order) {
+          t_rets[i] = solve_by_segments_from(source_worldline, target_positions[i], t_now,
+                                             estimates[i], counters, &positions);
+        }
+        return;
+      }
+    }
+
+    for (const size_t i : order) {
+      // The estimate is off by at most the source's own light-time displacement, so a fraction of
+      // the delay is a reasonable first bracket.
+      const ScalarType half_width{
+          std::max(WARM_BRACKET_FRACTION * (t_now - estimates[i]), WARM_BRACKET_MINIMUM)};
+      t_rets[i] = solve_by_bracketing_from(source_worldline, target_positions[i], t_now,
+                                           estimates[i], half_width, counters);
+    }
+  }
 
   /**
    * Resolves retardation and provides the transition motor M.
    * M captures the relative pose shift and the parallel transport
    * across the geometry defined by the current speed of light.
    */
-  Multivector transport(const WorldlineType& source_wl, const Multivector& target_pose) const {
-    const ScalarType t_now{Geometry::extract_time(target_pose)};
-    const ScalarType t_ret{solve_retardation(source_wl, target_pose, t_now)};
+  template <WorldlineLike<Geometry> SourceWorldline>
+  Multivector transport(const SourceWorldline& source_wl, const Multivector& target_pose) const {
+    return transport_from(source_wl, target_pose, solve_retardation(source_wl, target_pose));
+  }
 
-    const auto retarded_state{source_wl.get_state_at(t_ret)};
-    const Multivector source_pose{retarded_state.template element<0>()};
+  template <WorldlineLike<Geometry> SourceWorldline>
+  Multivector transport(const SourceWorldline& source_wl, const Multivector& target_pose,
+                        RetardationWarmStart<ScalarType>& warm_start) const {
+    return transport_from(source_wl, target_pose,
+                          solve_retardation(source_wl, target_pose, warm_start));
+  }
 
-    // The motor M moves the source frame to the target frame.
-    return target_pose * (~source_pose);
+  /**
+   * Cached variant. Reuses the retarded source state resolved for any nearby target event since
+   * the source was last invalidated; see retardation_cache.h.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  Multivector transport(const SourceWorldline& source_wl, const Multivector& target_pose,
+                        RetardationCache<Geometry>& cache) const {
+    const auto& resolved{cache.resolve(*this, source_wl, target_pose)};
+    return target_pose * (~resolved.source_state.template element<0>());
   }
 
   /**
    * Exposed the speed of light for testing as well as logging and visualization.
    */
-  ScalarType calculate_speed_of_light(ScalarType t) const { return c_func_(t); }
+  ScalarType calculate_speed_of_light(ScalarType t) const { return light_speed_.speed(t); }
+
+  /**
+   * The distance light covers between from and to.
+   */
+  ScalarType calculate_optical_path(ScalarType from, ScalarType to) const {
+    return light_speed_.optical_path(from, to);
+  }
+
+  const LightSpeed& light_speed() const noexcept { return light_speed_; }
+
+ private:
+  template <WorldlineLike<Geometry> SourceWorldline>
+  Multivector transport_from(const SourceWorldline& source_wl, const Multivector& target_pose,
+                             ScalarType t_ret) const {
+    const auto retarded_state{source_wl.get_state_at(t_ret)};
+    const Multivector source_pose{retarded_state.template element<0>()};
+
+    // The motor M moves the source frame to the target frame.
+    return target_pose * (~source_pose);
+  }
 };
 
 }  // namespace ndyn::assembly
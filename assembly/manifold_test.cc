@@ -1,11 +1,15 @@
 #include "assembly/manifold.h"
 
 #include <cmath>
+#include <span>
+#include <vector>
 
+#include "assembly/concurrent_worldline.h"
+
+#include "assembly/geometry_test_utils.h"
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 #include "math/cga_geometry.h"
-#include "math/sta_geometry.h"
 
 namespace ndyn::test {
 
@@ -35,7 +39,7 @@ class ManifoldTest : public ::testing::Test {
 };
 
 // Define the geometry types to run the test suite against
-using GeometryTypes = ::testing::Types<TcgaGeometry, CstaGeometry>;
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
 TYPED_TEST_SUITE(ManifoldTest, GeometryTypes);
 
 /**
@@ -45,7 +49,7 @@ TYPED_TEST_SUITE(ManifoldTest, GeometryTypes);
 TYPED_TEST(ManifoldTest, IdentityTransportAtSameEvent) {
   using Geometry = TypeParam;
   Manifold<Geometry> manifold(this->constant_c(this->C_STD));
-  Worldline<Geometry> wl(10, manifold);
+  Worldline<Geometry> wl(manifold, 10);
 
   auto state = this->make_state(0.0);
   wl.record_state(state);
@@ -53,7 +57,7 @@ TYPED_TEST(ManifoldTest, IdentityTransportAtSameEvent) {
   auto M = manifold.transport(wl, state.template element<0>());
 
   EXPECT_NEAR(M.scalar(), 1.0, 1e-9);
-  EXPECT_LT((M - Geometry::Multivector::identity()).square_magnitude(), 1e-9);
+  EXPECT_LT((M - typename Geometry::Multivector{1}).square_magnitude(), 1e-9);
 }
 
 /**
@@ -63,7 +67,7 @@ TYPED_TEST(ManifoldTest, IdentityTransportAtSameEvent) {
 TYPED_TEST(ManifoldTest, GalileanLimitRetardation) {
   using Geometry = TypeParam;
   Manifold<Geometry> manifold(this->constant_c(this->C_INF));
-  Worldline<Geometry> wl(10, manifold);
+  Worldline<Geometry> wl(manifold, 10);
 
   // Source is 50 units away at t=0
   wl.record_state(this->make_state(0.0, 50.0, 0.0, 0.0));
@@ -83,7 +87,7 @@ TYPED_TEST(ManifoldTest, GalileanLimitRetardation) {
 TYPED_TEST(ManifoldTest, TransportPreservesMotorUnitarity) {
   using Geometry = TypeParam;
   Manifold<Geometry> manifold(this->constant_c(this->C_STD));
-  Worldline<Geometry> wl(10, manifold);
+  Worldline<Geometry> wl(manifold, 10);
 
   wl.record_state(this->make_state(0.0));
   auto target_pose = Geometry::translator(10.0, 5.0, -2.0) * Geometry::identity_at_time(15.0);
@@ -106,8 +110,8 @@ TYPED_TEST(ManifoldTest, CausalMonotonicityWithVariableLight) {
   Manifold<Geometry> fast_m(this->constant_c(10.0));
   Manifold<Geometry> slow_m(this->constant_c(1.0));
 
-  Worldline<Geometry> wl_f(10, fast_m);
-  Worldline<Geometry> wl_s(10, slow_m);
+  Worldline<Geometry> wl_f(fast_m, 10);
+  Worldline<Geometry> wl_s(slow_m, 10);
   wl_f.record_state(source_state);
   wl_s.record_state(source_state);
 
@@ -124,7 +128,7 @@ TYPED_TEST(ManifoldTest, CausalMonotonicityWithVariableLight) {
 TYPED_TEST(ManifoldTest, BivectorMagnitudePreservation) {
   using Geometry = TypeParam;
   Manifold<Geometry> manifold(this->constant_c(this->C_STD));
-  Worldline<Geometry> wl(10, manifold);
+  Worldline<Geometry> wl(manifold, 10);
 
   wl.record_state(this->make_state(0.0));
   auto target_pose = Geometry::translator(3.0, 4.0, 0.0) * Geometry::identity_at_time(10.0);
@@ -149,7 +153,7 @@ TYPED_TEST(ManifoldTest, EuclideanDistanceTimeConsistency) {
   using Geometry = TypeParam;
   double c = 2.0;
   Manifold<Geometry> manifold(this->constant_c(c));
-  Worldline<Geometry> wl(10, manifold);
+  Worldline<Geometry> wl(manifold, 10);
 
   wl.record_state(this->make_state(0.0, 0.0, 0.0, 0.0));
 
@@ -168,7 +172,7 @@ TYPED_TEST(ManifoldTest, EuclideanDistanceTimeConsistency) {
 TYPED_TEST(ManifoldTest, RotationalIsotropy) {
   using Geometry = TypeParam;
   Manifold<Geometry> manifold(this->constant_c(this->C_STD));
-  Worldline<Geometry> wl(10, manifold);
+  Worldline<Geometry> wl(manifold, 10);
 
   // Setup A: Source at (1,0,0)
   wl.record_state(this->make_state(0.0, 1.0, 0.0, 0.0));
@@ -176,7 +180,7 @@ TYPED_TEST(ManifoldTest, RotationalIsotropy) {
   auto Ma = manifold.transport(wl, target);
 
   // Setup B: Source at (0,1,0) - a 90 deg Z-rotation
-  Worldline<Geometry> wl_b(10, manifold);
+  Worldline<Geometry> wl_b(manifold, 10);
   wl_b.record_state(this->make_state(0.0, 0.0, 1.0, 0.0));
   auto Mb = manifold.transport(wl_b, target);
 
@@ -192,7 +196,7 @@ TYPED_TEST(ManifoldTest, RotationalIsotropy) {
 TYPED_TEST(ManifoldTest, HorizonClamping) {
   using Geometry = TypeParam;
   Manifold<Geometry> manifold(this->constant_c(0.01));  // Extremely slow light
-  Worldline<Geometry> wl(10, manifold);
+  Worldline<Geometry> wl(manifold, 10);
 
   wl.record_state(this->make_state(0.0, 100.0, 0.0, 0.0));  // Far source
   wl.record_state(this->make_state(1.0, 100.0, 0.0, 0.0));
@@ -212,7 +216,7 @@ TYPED_TEST(ManifoldTest, ComplexLightSpeedConvergence) {
   using Geometry = TypeParam;
   auto complex_c = [](double t) { return 5.0 + std::sin(t); };
   Manifold<Geometry> manifold(complex_c);
-  Worldline<MockGeometry> wl(10, manifold);
+  Worldline<Geometry> wl(manifold, 10);
 
   wl.record_state(this->make_state(0.0, 1.0, 1.0, 1.0));
   auto target = Geometry::identity_at_time(10.0);
@@ -229,8 +233,8 @@ TYPED_TEST(ManifoldTest, ComplexLightSpeedConvergence) {
 TYPED_TEST(ManifoldTest, TransportReversibility) {
   using Geometry = TypeParam;
   Manifold<Geometry> manifold(this->constant_c(this->C_STD));
-  Worldline<Geometry> wl_a(10, manifold);
-  Worldline<Geometry> wl_b(10, manifold);
+  Worldline<Geometry> wl_a(manifold, 10);
+  Worldline<Geometry> wl_b(manifold, 10);
 
   auto pos_a = this->make_state(0.0, 0.0, 0.0, 0.0);
   auto pos_b = this->make_state(0.0, 5.0, 0.0, 0.0);
@@ -245,4 +249,203 @@ TYPED_TEST(ManifoldTest, TransportReversibility) {
   EXPECT_NEAR(combined.scalar(), 1.0, 1e-7);
 }
 
+/**
+ * WARM-STARTED RETARDATION
+ * Tracking a moving source from a fixed target, the warm-started solver must agree with the full
+ * solve while sampling the worldline several times less often.
+ */
+TYPED_TEST(ManifoldTest, WarmStartMatchesColdSolveWithFewerEvaluations) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(this->C_STD));
+  // A worldline without addressable samples, so that both solves bracket in time.
+  ConcurrentWorldline<Geometry> wl(manifold, 1024);
+
+  for (int i = 0; i <= 200; ++i) {
+    const double t{0.1 * i};
+    wl.record_state(this->make_state(t, 0.3 * t, 0.0, 0.0));
+  }
+
+  RetardationCounters cold{};
+  RetardationWarmStart<typename Geometry::ScalarType> warm{};
+  for (double t_now = 10.0; t_now < 20.0; t_now += 0.05) {
+    const auto target = Geometry::translator(0.0, 5.0, 0.0) * Geometry::identity_at_time(t_now);
+    const double t_cold = manifold.solve_retardation(wl, target, cold);
+    const double t_warm = manifold.solve_retardation(wl, target, warm);
+    EXPECT_NEAR(t_cold, t_warm, 1e-5) << "t_now: " << t_now;
+  }
+
+  EXPECT_EQ(cold.solves, warm.counters.solves);
+  EXPECT_EQ(warm.counters.fallbacks, 0u);
+  EXPECT_LT(3 * warm.counters.evaluations, cold.evaluations);
+}
+
+/**
+ * WARM-START RECOVERY
+ * A target that jumps far from the previous solve must still be solved correctly, by widening or
+ * falling back to the full history.
+ */
+TYPED_TEST(ManifoldTest, WarmStartRecoversFromDiscontinuity) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(this->C_STD));
+  Worldline<Geometry> wl(manifold, 1024);
+
+  for (int i = 0; i <= 200; ++i) {
+    const double t{0.1 * i};
+    wl.record_state(this->make_state(t, 0.3 * t, 0.0, 0.0));
+  }
+
+  RetardationWarmStart<typename Geometry::ScalarType> warm{};
+  manifold.solve_retardation(
+      wl, Geometry::translator(0.0, 5.0, 0.0) * Geometry::identity_at_time(19.0), warm);
+
+  const auto target = Geometry::translator(-8.0, 0.0, 0.0) * Geometry::identity_at_time(12.0);
+  const double t_warm = manifold.solve_retardation(wl, target, warm);
+  const double t_cold = manifold.solve_retardation(wl, target);
+
+  EXPECT_NEAR(t_cold, t_warm, 1e-5);
+  EXPECT_GT(warm.counters.widenings + warm.counters.fallbacks, 0u);
+}
+
+/**
+ * WARM-START HORIZON CLAMPING
+ * As with the full solve, an unreachable target clamps to the oldest history point.
+ */
+TYPED_TEST(ManifoldTest, WarmStartHorizonClamping) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(0.01));
+  Worldline<Geometry> wl(manifold, 10);
+
+  wl.record_state(this->make_state(0.0, 100.0, 0.0, 0.0));
+  wl.record_state(this->make_state(1.0, 100.0, 0.0, 0.0));
+
+  RetardationWarmStart<typename Geometry::ScalarType> warm{};
+  for (double t_now = 1.1; t_now < 2.0; t_now += 0.1) {
+    EXPECT_DOUBLE_EQ(manifold.solve_retardation(wl, Geometry::identity_at_time(t_now), warm), 0.0);
+  }
+}
+
+/**
+ * SEGMENT-WISE RETARDATION
+ * Locating the segment from the recorded samples must find the same root as bracketing the whole
+ * history, which is what a worldline without addressable samples gets, while interpolating the
+ * worldline only a handful of times per solve.
+ */
+TYPED_TEST(ManifoldTest, SegmentSolveMatchesBracketing) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(this->C_STD));
+  Worldline<Geometry> sampled(manifold, 1024);
+  ConcurrentWorldline<Geometry> unsampled(manifold, 1024);
+
+  // An accelerating, curving source, so that the segments differ from one another.
+  for (int i = 0; i <= 400; ++i) {
+    const double t{0.05 * i};
+    const auto state = this->make_state(t, 0.01 * t * t, std::sin(0.5 * t), 0.0);
+    sampled.record_state(state);
+    unsampled.record_state(state);
+  }
+
+  RetardationCounters segments{};
+  RetardationCounters bracketing{};
+  for (double t_now = 5.0; t_now < 25.0; t_now += 0.3) {
+    const auto target = Geometry::translator(-3.0, 4.0, 1.0) * Geometry::identity_at_time(t_now);
+    const double t_segments = manifold.solve_retardation(sampled, target, segments);
+    const double t_bracketing = manifold.solve_retardation(unsampled, target, bracketing);
+    EXPECT_NEAR(t_segments, t_bracketing, 1e-5) << "t_now: " << t_now;
+  }
+
+  EXPECT_GT(segments.samples, 0u);
+  EXPECT_EQ(bracketing.samples, 0u);
+  EXPECT_LE(segments.evaluations, 3 * segments.solves);
+  EXPECT_LT(segments.evaluations, bracketing.evaluations);
+
+  // Warm-started, the search starts beside the root instead of bisecting the whole history.
+  RetardationWarmStart<typename Geometry::ScalarType> warm{};
+  for (double t_now = 5.0; t_now < 25.0; t_now += 0.3) {
+    const auto target = Geometry::translator(-3.0, 4.0, 1.0) * Geometry::identity_at_time(t_now);
+    const double t_cold = manifold.solve_retardation(sampled, target);
+    EXPECT_NEAR(manifold.solve_retardation(sampled, target, warm), t_cold, 1e-5);
+  }
+  EXPECT_LT(warm.counters.samples, segments.samples);
+}
+
+/**
+ * SEGMENT-WISE RETARDATION, LINEAR MOTION
+ * For uniform motion the quadratic on the located segment is exact, so a single interpolated
+ * evaluation confirms the root.
+ */
+TYPED_TEST(ManifoldTest, SegmentSolveIsExactForUniformMotion) {
+  using Geometry = TypeParam;
+  const double c = 2.0;
+  Manifold<Geometry> manifold(this->constant_c(c));
+  Worldline<Geometry> wl(manifold, 1024);
+
+  for (int i = 0; i <= 100; ++i) {
+    const double t{0.2 * i};
+    wl.record_state(this->make_state(t, t, 0.0, 0.0));
+  }
+
+  // Source at (t, 0, 0), target at (20.5, 0, 0) at t_now = 18: 20.5 - t = c (18 - t) gives
+  // t = 15.5, midway between two samples.
+  RetardationCounters counters{};
+  const auto target = Geometry::translator(20.5, 0.0, 0.0) * Geometry::identity_at_time(18.0);
+  EXPECT_NEAR(manifold.solve_retardation(wl, target, counters), 15.5, 1e-7);
+  EXPECT_EQ(counters.iterations, 1u);
+}
+
+/**
+ * BATCHED RETARDATION
+ * Solving many targets against one source together must reproduce the individual solves, while
+ * reading each sample of the source at most once.
+ */
+TYPED_TEST(ManifoldTest, BatchMatchesIndividualSolves) {
+  using Geometry = TypeParam;
+  using MV = typename Geometry::Multivector;
+  Manifold<Geometry> manifold(this->constant_c(this->C_STD));
+  Worldline<Geometry> sampled(manifold, 1024);
+  ConcurrentWorldline<Geometry> unsampled(manifold, 1024);
+
+  for (int i = 0; i <= 400; ++i) {
+    const double t{0.05 * i};
+    const auto state = this->make_state(t, 0.01 * t * t, std::sin(0.5 * t), 0.0);
+    sampled.record_state(state);
+    unsampled.record_state(state);
+  }
+
+  const double t_now{18.0};
+  std::vector<MV> targets{};
+  for (int i = 0; i < 64; ++i) {
+    // Targets on a spiral around the source, at a range of distances and so of retarded times.
+    const double angle{0.7 * i};
+    const double radius{0.5 + 0.2 * i};
+    targets.push_back(Geometry::translator(radius * std::cos(angle), radius * std::sin(angle),
+                                           0.1 * (i % 5)) *
+                      Geometry::identity_at_time(t_now));
+  }
+
+  RetardationCounters individual{};
+  std::vector<double> expected(targets.size());
+  for (size_t i = 0; i < targets.size(); ++i) {
+    expected[i] = manifold.solve_retardation(sampled, targets[i], individual);
+  }
+
+  RetardationCounters batched{};
+  std::vector<double> sampled_t_rets(targets.size());
+  manifold.solve_retardation_batch(sampled, std::span<const MV>{targets}, t_now,
+                                   std::span<double>{sampled_t_rets}, batched);
+
+  std::vector<double> unsampled_t_rets(targets.size());
+  manifold.solve_retardation_batch(unsampled, std::span<const MV>{targets}, t_now,
+                                   std::span<double>{unsampled_t_rets});
+
+  for (size_t i = 0; i < targets.size(); ++i) {
+    EXPECT_NEAR(sampled_t_rets[i], expected[i], 1e-5) << "target: " << i;
+    EXPECT_NEAR(unsampled_t_rets[i], expected[i], 1e-5) << "target: " << i;
+  }
+
+  EXPECT_EQ(batched.solves, individual.solves);
+  EXPECT_LE(batched.samples, sampled.history().size());
+  EXPECT_LT(batched.samples, individual.samples);
+  EXPECT_LT(batched.evaluations, individual.evaluations);
+}
+
 }  // namespace ndyn::test
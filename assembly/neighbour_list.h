@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "assembly/field.h"
+#include "assembly/spatial.h"
+#include "glog/logging.h"
+
+namespace ndyn::assembly {
+
+/**
+ * Verlet neighbour lists over a uniform cell list, for fields that vanish beyond a cutoff radius.
+ *
+ * Each particle's list holds every other particle within cutoff + skin of it when the lists were
+ * built. Until some particle has moved more than half the skin since then, no pair can have closed
+ * from beyond cutoff + skin to within the cutoff, so the lists still contain every interacting
+ * pair and update() keeps them. Otherwise it rebuilds them: particles are binned into a uniform
+ * grid of cells at least cutoff + skin wide, and each particle's candidates are those in its own
+ * and the 26 adjacent cells.
+ *
+ * Building is O(N) for a bounded density, and accumulate() evaluates only the listed pairs that are
+ * within the cutoff at the current positions, so a step costs O(N) evaluations instead of O(N^2).
+ * Each target's neighbours are evaluated in one batch. Sources and targets interact as described at
+ * source_interaction().
+ */
+template <typename Geometry>
+class NeighbourList final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using Point = SpatialPoint<ScalarType>;
+
+  struct Counters final {
+    uint64_t updates{0};
+    uint64_t builds{0};
+    uint64_t evaluations{0};
+  };
+
+ private:
+  ScalarType cutoff_;
+  ScalarType skin_;
+
+  std::vector<Point> positions_{};
+  // Positions at the last build.
+  std::vector<Point> reference_positions_{};
+  // Neighbours of particle i are neighbours_[first_[i]] .. neighbours_[first_[i + 1] - 1].
+  std::vector<size_t> first_{};
+  std::vector<size_t> neighbours_{};
+
+  // The cell list, in the same compressed form, used while building.
+  std::vector<size_t> cell_first_{};
+  std::vector<size_t> cell_particles_{};
+  std::vector<size_t> cell_of_{};
+
+  InteractionBatch<Geometry> batch_{};
+  Counters counters_{};
+
+  bool needs_build() const noexcept {
+    if (reference_positions_.size() != positions_.size() || first_.empty()) return true;
+    const ScalarType limit{skin_ * skin_ / 4};
+    for (size_t i = 0; i < positions_.size(); ++i) {
+      if (squared_distance(positions_[i], reference_positions_[i]) > limit) return true;
+    }
+    return false;
+  }
+
+  void build() {
+    const size_t count{positions_.size()};
+    const ScalarType range{cutoff_ + skin_};
+
+    Point low{};
+    Point high{};
+    if (count > 0) low = high = positions_.front();
+    for (const Point& position : positions_) {
+      for (size_t axis = 0; axis < 3; ++axis) {
+        low[axis] = std::min(low[axis], position[axis]);
+        high[axis] = std::max(high[axis], position[axis]);
+      }
+    }
+
+    // Cells at least `range` wide, grown if a sparse, spread-out set would need more cells than
+    // particles.
+    ScalarType width{range};
+    size_t dims[3];
+    while (true) {
+      size_t cells{1};
+      for (size_t axis = 0; axis < 3; ++axis) {
+        dims[axis] = static_cast<size_t>((high[axis] - low[axis]) / width) + 1;
+        cells *= dims[axis];
+      }
+      if (cells <= 8 * count + 8) break;
+      width *= 2;
+    }
+    const auto cell_index{
+        [&](size_t i, size_t j, size_t k) { return (i * dims[1] + j) * dims[2] + k; }};
+    const auto coordinates{[&](const Point& position, size_t out[3]) {
+      for (size_t axis = 0; axis < 3; ++axis) {
+        out[axis] = std::min(static_cast<size_t>((position[axis] - low[axis]) / width),
+                             dims[axis] - 1);
+      }
+    }};
+
+    // Counting sort of the particles by cell.
+    cell_first_.assign(dims[0] * dims[1] * dims[2] + 1, 0);
+    cell_of_.resize(count);
+    for (size_t particle = 0; particle < count; ++particle) {
+      size_t c[3];
+      coordinates(positions_[particle], c);
+      cell_of_[particle] = cell_index(c[0], c[1], c[2]);
+      ++cell_first_[cell_of_[particle] + 1];
+    }
+    for (size_t cell = 0; cell + 1 < cell_first_.size(); ++cell) {
+      cell_first_[cell + 1] += cell_first_[cell];
+    }
+    cell_particles_.resize(count);
+    {
+      std::vector<size_t> next(cell_first_.begin(), cell_first_.end() - 1);
+      for (size_t particle = 0; particle < count; ++particle) {
+        cell_particles_[next[cell_of_[particle]]++] = particle;
+      }
+    }
+
+    const ScalarType range_squared{range * range};
+    first_.resize(count + 1);
+    neighbours_.clear();
+    for (size_t target = 0; target < count; ++target) {
+      first_[target] = neighbours_.size();
+      size_t c[3];
+      coordinates(positions_[target], c);
+      for (size_t i = c[0] > 0 ? c[0] - 1 : 0; i <= std::min(c[0] + 1, dims[0] - 1); ++i) {
+        for (size_t j = c[1] > 0 ? c[1] - 1 : 0; j <= std::min(c[1] + 1, dims[1] - 1); ++j) {
+          for (size_t k = c[2] > 0 ? c[2] - 1 : 0; k <= std::min(c[2] + 1, dims[2] - 1); ++k) {
+            const size_t cell{cell_index(i, j, k)};
+            for (size_t n = cell_first_[cell]; n < cell_first_[cell + 1]; ++n) {
+              const size_t source{cell_particles_[n]};
+              if (source != target &&
+                  squared_distance(positions_[source], positions_[target]) <= range_squared) {
+                neighbours_.push_back(source);
+              }
+            }
+          }
+        }
+      }
+    }
+    first_[count] = neighbours_.size();
+
+    reference_positions_ = positions_;
+    ++counters_.builds;
+  }
+
+ public:
+  NeighbourList(ScalarType cutoff, ScalarType skin) : cutoff_{cutoff}, skin_{skin} {
+    LOG_IF(FATAL, !(cutoff_ > 0)) << "Neighbour lists require a positive cutoff.";
+    LOG_IF(FATAL, !(skin_ >= 0)) << "Neighbour lists require a non-negative skin.";
+  }
+
+  /**
+   * Takes the particles' current positions from their world poses, and rebuilds the lists if any
+   * has moved more than half the skin since they were built, or the particles changed in number.
+   * Returns whether the lists were rebuilt. Call once per step, before accumulate().
+   */
+  bool update(std::span<const Multivector> world_poses) {
+    positions_.resize(world_poses.size());
+    spatial_positions<Geometry>(world_poses, std::span<Point>{positions_});
+    ++counters_.updates;
+    if (!needs_build()) return false;
+    build();
+    return true;
+  }
+
+  /**
+   * Adds to each acceleration the field of every other particle within the cutoff at the
+   * positions of the last update().
+   */
+  template <BatchField<Geometry> FieldType>
+  void accumulate(const FieldType& field, std::span<const Multivector> world_poses,
+                  std::span<const Multivector> couplings, std::span<Multivector> accelerations) {
+    LOG_IF(FATAL, world_poses.size() != positions_.size() ||
+                      couplings.size() != positions_.size() ||
+                      accelerations.size() != positions_.size())
+        << "Neighbour list accumulation requires one pose, coupling and acceleration per "
+           "particle, as of the last update.";
+    const ScalarType cutoff_squared{cutoff_ * cutoff_};
+    for (size_t target = 0; target < positions_.size(); ++target) {
+      for (size_t n = first_[target]; n < first_[target + 1]; ++n) {
+        const size_t source{neighbours_[n]};
+        if (squared_distance(positions_[source], positions_[target]) > cutoff_squared) continue;
+        batch_.add(positions_[source], couplings[source], world_poses[target], couplings[target]);
+      }
+      counters_.evaluations += batch_.size();
+      accelerations[target] += batch_.sum(field);
+    }
+  }
+
+  /**
+   * The particles listed as neighbours of a particle: those within cutoff + skin of it at the last
+   * build.
+   */
+  std::span<const size_t> neighbours(size_t particle) const noexcept {
+    return std::span<const size_t>{neighbours_}.subspan(first_[particle],
+                                                         first_[particle + 1] - first_[particle]);
+  }
+
+  ScalarType cutoff() const noexcept { return cutoff_; }
+  ScalarType skin() const noexcept { return skin_; }
+  const Counters& counters() const noexcept { return counters_; }
+};
+
+}  // namespace ndyn::assembly
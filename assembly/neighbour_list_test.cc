@@ -0,0 +1,171 @@
+#include "assembly/neighbour_list.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "assembly/assembly.h"
+#include "assembly/field_test_utils.h"
+#include "assembly/geometry_test_utils.h"
+#include "assembly/spatial.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+/**
+ * A short-range repulsion that falls smoothly to zero at the cutoff: the acceleration generator of
+ * a translation by coupling * (1 - |r| / cutoff)^2 along r.
+ */
+template <typename Geometry>
+class ContactField final : public Field<Geometry> {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+
+  explicit ContactField(ScalarType cutoff) : cutoff_{cutoff} {}
+
+  Multivector evaluate_at(const Multivector& event,
+                          const Multivector& coupling) const noexcept override {
+    const auto r{spatial_coordinates<Geometry>(origin_image<Geometry>(event))};
+    const ScalarType distance{std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2])};
+    if (distance >= cutoff_ || distance == 0) return Multivector{};
+    const ScalarType overlap{1 - distance / cutoff_};
+    const ScalarType scale{coupling.scalar() * overlap * overlap / distance};
+    return Geometry::motor_log(Geometry::translator(scale * r[0], scale * r[1], scale * r[2]));
+  }
+
+ private:
+  ScalarType cutoff_;
+};
+
+template <typename Geometry>
+class NeighbourListTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+
+  static constexpr Scalar CUTOFF{0.1};
+  static constexpr Scalar SKIN{0.02};
+
+  /**
+   * Particles spread uniformly at unit density per CUTOFF^3, with couplings between 0.5 and 1.5.
+   */
+  static Assembly<Geometry> particles(size_t count) {
+    std::mt19937_64 random{count};
+    const auto uniform{[&random] { return uniform_sample<Scalar>(random); }};
+    const Scalar side{CUTOFF * std::cbrt(static_cast<Scalar>(count))};
+    Assembly<Geometry> assembly;
+    assembly.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      assembly.add(Assembly<Geometry>::NO_PARENT,
+                   Geometry::translator(side * uniform(), side * uniform(), side * uniform()),
+                   MV{0.5 + uniform()});
+    }
+    assembly.update_world_poses();
+    return assembly;
+  }
+
+  // Moves every particle by a displacement of at most `step` in each coordinate.
+  static void jiggle(Assembly<Geometry>& assembly, Scalar step, uint64_t seed) {
+    std::mt19937_64 random{seed};
+    const auto uniform{[&random] { return uniform_sample<Scalar>(random); }};
+    for (size_t i = 0; i < assembly.size(); ++i) {
+      assembly.set_local_pose(i, Geometry::translator(step * (2 * uniform() - 1),
+                                                      step * (2 * uniform() - 1),
+                                                      step * (2 * uniform() - 1)) *
+                                     assembly.local_pose(i));
+    }
+    assembly.update_world_poses();
+  }
+
+  static std::vector<MV> listed(NeighbourList<Geometry>& list, const Field<Geometry>& field,
+                                const Assembly<Geometry>& assembly) {
+    std::vector<MV> accelerations(assembly.size());
+    list.accumulate(field, assembly.poses().world_poses(), assembly.couplings(),
+                    std::span<MV>{accelerations});
+    return accelerations;
+  }
+
+  static void expect_near(const std::vector<MV>& actual, const std::vector<MV>& expected) {
+    for (size_t i = 0; i < expected.size(); ++i) {
+      for (size_t j = 0; j < MV::NUM_BASIS_BLADES; ++j) {
+        EXPECT_NEAR(actual[i].coefficient(j), expected[i].coefficient(j), 1e-12)
+            << "particle: " << i << " blade: " << j;
+      }
+    }
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(NeighbourListTest, GeometryTypes);
+
+TYPED_TEST(NeighbourListTest, MatchesPairwiseSum) {
+  const ContactField<TypeParam> field{this->CUTOFF};
+  const auto assembly{this->particles(500)};
+  NeighbourList<TypeParam> list{this->CUTOFF, this->SKIN};
+  EXPECT_TRUE(list.update(assembly.poses().world_poses()));
+  this->expect_near(this->listed(list, field, assembly), pairwise_accelerations(field, assembly));
+}
+
+/**
+ * The lists survive motion within half the skin and stay exact throughout; a larger move rebuilds
+ * them.
+ */
+TYPED_TEST(NeighbourListTest, RebuildsOnlyBeyondHalfTheSkin) {
+  using Geometry = TypeParam;
+  const ContactField<Geometry> field{this->CUTOFF};
+  auto assembly{this->particles(500)};
+  NeighbourList<Geometry> list{this->CUTOFF, this->SKIN};
+  list.update(assembly.poses().world_poses());
+
+  // Up to SKIN / 8 per coordinate per step, so under half the skin in total after two steps.
+  for (uint64_t step = 0; step < 2; ++step) {
+    this->jiggle(assembly, this->SKIN / 8, step);
+    EXPECT_FALSE(list.update(assembly.poses().world_poses())) << "step: " << step;
+    this->expect_near(this->listed(list, field, assembly), pairwise_accelerations(field, assembly));
+  }
+  EXPECT_EQ(list.counters().builds, 1u);
+
+  assembly.set_local_pose(0, Geometry::translator(this->SKIN, 0, 0) * assembly.local_pose(0));
+  assembly.update_world_poses();
+  EXPECT_TRUE(list.update(assembly.poses().world_poses()));
+  EXPECT_EQ(list.counters().builds, 2u);
+  this->expect_near(this->listed(list, field, assembly), pairwise_accelerations(field, assembly));
+}
+
+/**
+ * Benchmark: wall time of an update and accumulation against the pairwise sum as the number of
+ * particles grows at constant density.
+ */
+TYPED_TEST(NeighbourListTest, ScalingWithParticles) {
+  const ContactField<TypeParam> field{this->CUTOFF};
+
+  for (const size_t count : {500, 1000, 2000}) {
+    const auto assembly{this->particles(count)};
+
+    auto start{std::chrono::steady_clock::now()};
+    const auto expected{pairwise_accelerations(field, assembly)};
+    const double exact_seconds{
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    start = std::chrono::steady_clock::now();
+    NeighbourList<TypeParam> list{this->CUTOFF, this->SKIN};
+    list.update(assembly.poses().world_poses());
+    const auto actual{this->listed(list, field, assembly)};
+    const double list_seconds{
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    LOG(INFO) << count << " particles: pairwise " << exact_seconds * 1e3 << " ms, neighbour list "
+              << list_seconds * 1e3 << " ms, " << list.counters().evaluations << " evaluations";
+    EXPECT_LT(list.counters().evaluations, count * 10);
+    this->expect_near(actual, expected);
+  }
+}
+
+}  // namespace ndyn::test
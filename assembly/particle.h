@@ -1,26 +1,72 @@
 #pragma once
 
-#include <array>
-#include <cmath>
-#include <vector>
+#include <cstddef>
+#include <unordered_map>
 
-#include "gfx/mesh.h"
-#include "math/algebra.h"
+#include "assembly/manifold.h"
+#include "assembly/worldline.h"
 #include "math/state.h"
 
 namespace ndyn::assembly {
 
-template <typename GeometryT>
-struct Particle final {
-  using Geometry = GeometryT;
-  using Algebra = Geometry::Algebra;
-  using Multivector = Geometry::Multivector;
-  using Scalar = Geometry::Scalar;
-  using StateVector = math::State<Algebra, 2>;
+/**
+ * A body in a Connection: its current state, the worldline of its past states that other particles
+ * see it through, and its coupling to each field.
+ *
+ * A particle couples to each field separately, by the field's address, such as a mass to gravity
+ * and a charge to electromagnetism. It does not couple to a field it has no coupling for, and
+ * Connections skip such fields entirely.
+ */
+template <typename Geometry>
+class Particle final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+  using WorldlineType = Worldline<Geometry>;
 
-  MeshId mesh{};
+ private:
+  StateType state_;
+  WorldlineType worldline_;
+  std::unordered_map<const void*, Multivector> couplings_{};
 
-  void update(const Multivector& field, Scalar d_tau) {
+ public:
+  /**
+   * Starts the particle's worldline, of at most history_size samples, at initial_state.
+   */
+  template <typename RootFinder, typename LightSpeed>
+  Particle(const Manifold<Geometry, RootFinder, LightSpeed>& manifold,
+           const StateType& initial_state, size_t history_size = 1024)
+      : state_{initial_state}, worldline_{manifold, history_size} {
+    worldline_.record_state(initial_state);
+  }
+
+  const StateType& current_state() const noexcept { return state_; }
+  const WorldlineType& worldline() const noexcept { return worldline_; }
+
+  /**
+   * Makes state the current state and records it on the worldline.
+   */
+  void set_state(const StateType& state) {
+    state_ = state;
+    worldline_.record_state(state);
+  }
+
+  /**
+   * The coupling to field, zero if the particle does not couple to it.
+   */
+  template <typename FieldType>
+  Multivector coupling(const FieldType& field) const noexcept {
+    const auto it{couplings_.find(&field)};
+    return it == couplings_.end() ? Multivector{} : it->second;
+  }
+
+  /**
+   * Couples the particle to field, which must outlive it.
+   */
+  template <typename FieldType>
+  void set_coupling(const FieldType& field, const Multivector& coupling) {
+    couplings_[&field] = coupling;
   }
 };
 
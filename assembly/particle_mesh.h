@@ -0,0 +1,347 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "assembly/spatial.h"
+#include "glog/logging.h"
+#include "math/fft.h"
+
+namespace ndyn::assembly {
+
+/**
+ * A particle-mesh solver for the inverse-square field of many sources in a bounded domain: the
+ * field of sources with couplings Q_s on a target with coupling Q is the acceleration -Q grad phi,
+ * where phi(x) = -sum_s Q_s / |x - x_s|, the potential that solves Poisson's equation
+ * laplacian phi = 4 pi rho in free space.
+ *
+ * update() deposits the scalar part of each source's coupling onto a cubic mesh of cells^3 nodes,
+ * with cloud-in-cell or triangular-shaped-cloud weights, and convolves it with the potential of a
+ * unit source. The convolution is a product of Fourier transforms on a mesh padded to twice the
+ * size in each dimension, so that the mesh does not wrap around and the boundary is open. The
+ * acceleration per unit coupling is the central difference of the potential, and evaluations
+ * interpolate it back with the same weights as the deposit, so that a pair of particles exert equal
+ * and opposite forces. The cost of an update is O(N + M log M) for M nodes, independent of how
+ * the sources are distributed, and each evaluation is O(1).
+ *
+ * The mesh does not resolve separations shorter than a few cells; the potential of a unit source is
+ * softened to -1 / sqrt(r^2 + softening^2), which should be about the cell size. Sources and
+ * targets must lie inside the domain; weights that fall outside it are dropped.
+ *
+ * The mesh is the field of all the sources at once, in world coordinates, so it is not a Field,
+ * whose events are in the frame of a single source at the origin. Like BarnesHutTree, it is
+ * evaluated at world poses instead: evaluate() takes a target's world pose. The acceleration is the
+ * generator of a translation, like that of the inverse-square Fields.
+ */
+template <typename Geometry>
+class ParticleMesh final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using Point = SpatialPoint<ScalarType>;
+
+  enum class Assignment {
+    // Each source is shared between the 2^3 nearest nodes, linearly in each dimension.
+    CLOUD_IN_CELL,
+    // Each source is shared between the 3^3 nearest nodes, quadratically in each dimension.
+    TRIANGULAR_SHAPED_CLOUD,
+  };
+
+ private:
+  using Complex = std::complex<ScalarType>;
+
+  // The nodes and weights a point is shared between: the nodes first[axis] + k for k < 3 along each
+  // axis, with weights[axis][k].
+  struct Stencil final {
+    std::array<ptrdiff_t, 3> first;
+    std::array<std::array<ScalarType, 3>, 3> weights;
+  };
+
+  Assignment assignment_;
+  size_t cells_;
+  // Twice cells_: the size of the padded mesh.
+  size_t padded_cells_;
+  ScalarType spacing_;
+  // The position of the node (0, 0, 0): the centre of the first cell.
+  Point first_node_;
+  math::Fft<ScalarType> fft_;
+
+  // The Fourier transform of the softened potential of a unit source, on the padded mesh. It is the
+  // transform of a real, even function, so it is real.
+  std::vector<ScalarType> green_{};
+  std::vector<Complex> padded_{};
+  std::vector<Complex> line_{};
+  std::vector<ScalarType> density_{};
+  std::vector<ScalarType> potential_{};
+  std::vector<Point> acceleration_{};
+  std::vector<Multivector> values_{};
+
+  size_t node(size_t x, size_t y, size_t z) const noexcept { return x + cells_ * (y + cells_ * z); }
+
+  size_t padded_node(size_t x, size_t y, size_t z) const noexcept {
+    return x + padded_cells_ * (y + padded_cells_ * z);
+  }
+
+  Stencil stencil(const Point& point) const noexcept {
+    using std::floor;
+    Stencil result{};
+    for (size_t axis = 0; axis < 3; ++axis) {
+      // The point's coordinate in units of the spacing, with nodes at the integers.
+      const ScalarType u{(point[axis] - first_node_[axis]) / spacing_};
+      if (assignment_ == Assignment::CLOUD_IN_CELL) {
+        const ScalarType lower{floor(u)};
+        const ScalarType f{u - lower};
+        result.first[axis] = static_cast<ptrdiff_t>(lower);
+        result.weights[axis] = {1 - f, f, 0};
+      } else {
+        const ScalarType nearest{floor(u + ScalarType{0.5})};
+        const ScalarType d{u - nearest};
+        result.first[axis] = static_cast<ptrdiff_t>(nearest) - 1;
+        result.weights[axis] = {ScalarType{0.5} * (ScalarType{0.5} - d) * (ScalarType{0.5} - d),
+                                ScalarType{0.75} - d * d,
+                                ScalarType{0.5} * (ScalarType{0.5} + d) * (ScalarType{0.5} + d)};
+      }
+    }
+    return result;
+  }
+
+  // Calls visit(node, weight) for each node of the mesh in the stencil.
+  template <typename Visitor>
+  void for_each_node(const Stencil& stencil, const Visitor& visit) const {
+    const ptrdiff_t width{assignment_ == Assignment::CLOUD_IN_CELL ? 2 : 3};
+    const ptrdiff_t cells{static_cast<ptrdiff_t>(cells_)};
+    for (ptrdiff_t k = 0; k < width; ++k) {
+      const ptrdiff_t z{stencil.first[2] + k};
+      if (z < 0 || z >= cells) continue;
+      for (ptrdiff_t j = 0; j < width; ++j) {
+        const ptrdiff_t y{stencil.first[1] + j};
+        if (y < 0 || y >= cells) continue;
+        const ScalarType weight_yz{stencil.weights[1][j] * stencil.weights[2][k]};
+        for (ptrdiff_t i = 0; i < width; ++i) {
+          const ptrdiff_t x{stencil.first[0] + i};
+          if (x < 0 || x >= cells) continue;
+          visit(node(static_cast<size_t>(x), static_cast<size_t>(y), static_cast<size_t>(z)),
+                stencil.weights[0][i] * weight_yz);
+        }
+      }
+    }
+  }
+
+  /**
+   * Transforms the lines of the padded mesh along one axis. Only the lines whose other two
+   * coordinates, in increasing order of axis, are below extent_a and extent_b are transformed;
+   * the rest are known to be zero, or are not needed.
+   */
+  void transform_lines(size_t axis, size_t extent_a, size_t extent_b, bool inverse) {
+    const size_t n{padded_cells_};
+    const std::array<size_t, 3> strides{1, n, n * n};
+    const size_t stride{strides[axis]};
+    const size_t stride_a{strides[axis == 0 ? 1 : 0]};
+    const size_t stride_b{strides[axis == 2 ? 1 : 2]};
+    for (size_t b = 0; b < extent_b; ++b) {
+      for (size_t a = 0; a < extent_a; ++a) {
+        Complex* first{&padded_[a * stride_a + b * stride_b]};
+        for (size_t i = 0; i < n; ++i) {
+          line_[i] = first[i * stride];
+        }
+        if (inverse) {
+          fft_.inverse(line_);
+        } else {
+          fft_.forward(line_);
+        }
+        for (size_t i = 0; i < n; ++i) {
+          first[i * stride] = line_[i];
+        }
+      }
+    }
+  }
+
+  void solve() {
+    const size_t n{cells_};
+    const size_t padded{padded_cells_};
+
+    std::fill(padded_.begin(), padded_.end(), Complex{});
+    for (size_t z = 0; z < n; ++z) {
+      for (size_t y = 0; y < n; ++y) {
+        for (size_t x = 0; x < n; ++x) {
+          padded_[padded_node(x, y, z)] = density_[node(x, y, z)];
+        }
+      }
+    }
+
+    // The density occupies one octant of the padded mesh, so the first passes skip the lines that
+    // are still zero.
+    transform_lines(0, n, n, false);
+    transform_lines(1, padded, n, false);
+    transform_lines(2, padded, padded, false);
+    for (size_t i = 0; i < padded_.size(); ++i) {
+      padded_[i] *= green_[i];
+    }
+    // Only the octant of the real mesh is needed back, so the last passes skip the other lines.
+    transform_lines(2, padded, padded, true);
+    transform_lines(1, padded, n, true);
+    transform_lines(0, n, n, true);
+
+    for (size_t z = 0; z < n; ++z) {
+      for (size_t y = 0; y < n; ++y) {
+        for (size_t x = 0; x < n; ++x) {
+          potential_[node(x, y, z)] = padded_[padded_node(x, y, z)].real();
+        }
+      }
+    }
+    differentiate();
+  }
+
+  // The acceleration per unit coupling, -grad phi, by central differences, and one-sided
+  // differences on the faces of the mesh.
+  void differentiate() {
+    const size_t n{cells_};
+    const std::array<size_t, 3> strides{1, n, n * n};
+    for (size_t z = 0; z < n; ++z) {
+      for (size_t y = 0; y < n; ++y) {
+        for (size_t x = 0; x < n; ++x) {
+          const size_t index{node(x, y, z)};
+          const std::array<size_t, 3> coordinates{x, y, z};
+          for (size_t axis = 0; axis < 3; ++axis) {
+            const size_t c{coordinates[axis]};
+            const size_t lower{c == 0 ? index : index - strides[axis]};
+            const size_t upper{c + 1 == n ? index : index + strides[axis]};
+            const ScalarType distance{spacing_ * static_cast<ScalarType>((c == 0 ? 0 : 1) +
+                                                                         (c + 1 == n ? 0 : 1))};
+            acceleration_[index][axis] = (potential_[lower] - potential_[upper]) / distance;
+          }
+        }
+      }
+    }
+  }
+
+  Multivector acceleration_at(const Multivector& world_pose,
+                              const Multivector& coupling) const noexcept {
+    const Point position{spatial_coordinates<Geometry>(origin_image<Geometry>(world_pose))};
+    Point acceleration{};
+    for_each_node(stencil(position), [&](size_t index, ScalarType weight) {
+      for (size_t axis = 0; axis < 3; ++axis) {
+        acceleration[axis] += weight * acceleration_[index][axis];
+      }
+    });
+    const ScalarType scale{coupling.scalar()};
+    return Geometry::motor_log(Geometry::translator(
+        scale * acceleration[0], scale * acceleration[1], scale * acceleration[2]));
+  }
+
+ public:
+  /**
+   * A mesh of cells^3 nodes over the cube of the given half size about the center. cells must be
+   * a power of two.
+   */
+  ParticleMesh(const Point& center, ScalarType half_size, size_t cells, ScalarType softening,
+               Assignment assignment = Assignment::CLOUD_IN_CELL)
+      : assignment_{assignment},
+        cells_{cells},
+        padded_cells_{2 * cells},
+        spacing_{2 * half_size / static_cast<ScalarType>(cells)},
+        first_node_{},
+        fft_{2 * cells} {
+    LOG_IF(FATAL, cells < 2 || !std::has_single_bit(cells))
+        << "The particle mesh requires a power of two cells per side, not " << cells << ".";
+    LOG_IF(FATAL, !(half_size > 0)) << "The particle mesh requires a positive half size.";
+    LOG_IF(FATAL, !(softening > 0)) << "The particle mesh requires a positive softening.";
+    for (size_t axis = 0; axis < 3; ++axis) {
+      first_node_[axis] = center[axis] - half_size + spacing_ / 2;
+    }
+
+    const size_t n{cells_};
+    const size_t padded{padded_cells_};
+    density_.resize(n * n * n);
+    potential_.resize(n * n * n);
+    acceleration_.resize(n * n * n);
+    line_.resize(padded);
+    padded_.resize(padded * padded * padded);
+    green_.resize(padded_.size());
+
+    // The potential of a unit source at node (0, 0, 0), wrapped around the padded mesh so that
+    // each node sees the nearest image.
+    const auto offset{[this, padded](size_t c) {
+      return spacing_ * static_cast<ScalarType>(std::min(c, padded - c));
+    }};
+    for (size_t z = 0; z < padded; ++z) {
+      for (size_t y = 0; y < padded; ++y) {
+        for (size_t x = 0; x < padded; ++x) {
+          const ScalarType dx{offset(x)};
+          const ScalarType dy{offset(y)};
+          const ScalarType dz{offset(z)};
+          padded_[padded_node(x, y, z)] =
+              -1 / std::sqrt(dx * dx + dy * dy + dz * dz + softening * softening);
+        }
+      }
+    }
+    transform_lines(0, padded, padded, false);
+    transform_lines(1, padded, padded, false);
+    transform_lines(2, padded, padded, false);
+    for (size_t i = 0; i < padded_.size(); ++i) {
+      green_[i] = padded_[i].real();
+    }
+  }
+
+  /**
+   * Deposits the scalar parts of the sources' couplings at their world poses, and solves for the
+   * field. Evaluations see the field of the latest update.
+   */
+  void update(std::span<const Multivector> world_poses, std::span<const Multivector> couplings) {
+    LOG_IF(FATAL, couplings.size() != world_poses.size())
+        << "The particle mesh requires one coupling per source.";
+    std::fill(density_.begin(), density_.end(), ScalarType{0});
+    for (size_t i = 0; i < world_poses.size(); ++i) {
+      const Point position{spatial_coordinates<Geometry>(origin_image<Geometry>(world_poses[i]))};
+      const ScalarType coupling{couplings[i].scalar()};
+      for_each_node(stencil(position), [this, coupling](size_t index, ScalarType weight) {
+        density_[index] += weight * coupling;
+      });
+    }
+    solve();
+  }
+
+  /**
+   * The acceleration of a target at the given world pose with the given coupling.
+   */
+  Multivector evaluate(const Multivector& world_pose, const Multivector& coupling) const noexcept {
+    return acceleration_at(world_pose, coupling);
+  }
+
+  /**
+   * The accelerations of many targets: out[i] receives evaluate(world_poses[i], couplings[i]).
+   */
+  void evaluate(std::span<const Multivector> world_poses, std::span<const Multivector> couplings,
+                std::span<Multivector> out) const noexcept {
+    for (size_t i = 0; i < world_poses.size(); ++i) {
+      out[i] = acceleration_at(world_poses[i], couplings[i]);
+    }
+  }
+
+  /**
+   * Adds the field of the latest update to each particle's acceleration. A particle that is also a
+   * source feels only a small residual force from its own deposit.
+   */
+  void accumulate(std::span<const Multivector> world_poses, std::span<const Multivector> couplings,
+                  std::span<Multivector> accelerations) {
+    LOG_IF(FATAL, couplings.size() != world_poses.size() ||
+                      accelerations.size() != world_poses.size())
+        << "Particle mesh accumulation requires one coupling and acceleration per particle.";
+    values_.resize(world_poses.size());
+    evaluate(world_poses, couplings, std::span<Multivector>{values_});
+    for (size_t i = 0; i < world_poses.size(); ++i) {
+      accelerations[i] += values_[i];
+    }
+  }
+
+  size_t cells() const noexcept { return cells_; }
+  ScalarType spacing() const noexcept { return spacing_; }
+};
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,158 @@
+#include "assembly/particle_mesh.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "assembly/assembly.h"
+#include "assembly/field_test_utils.h"
+#include "assembly/geometry_test_utils.h"
+#include "assembly/spatial.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class ParticleMeshTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using Point = SpatialPoint<Scalar>;
+  using Mesh = ParticleMesh<Geometry>;
+
+  // The domain is the cube of half size 1 about the origin.
+  static constexpr Point CENTER{0, 0, 0};
+  static constexpr Scalar HALF_SIZE{1};
+  // The mesh cannot resolve separations below a few cells, so both the mesh and the pairwise sum
+  // it is measured against are softened to a little over the cell size of the coarsest mesh.
+  static constexpr Scalar SOFTENING{0.15};
+
+  /**
+   * Particles spread uniformly through the middle half of the domain, with masses between 0.5 and
+   * 1.5, at their world poses.
+   */
+  static Assembly<Geometry> particles(size_t count) {
+    std::mt19937_64 random{count};
+    const auto coordinate{[&random] {
+      return uniform_sample<Scalar>(random) * HALF_SIZE - HALF_SIZE / 2;
+    }};
+    Assembly<Geometry> assembly;
+    assembly.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      assembly.add(Assembly<Geometry>::NO_PARENT,
+                   Geometry::translator(coordinate(), coordinate(), coordinate()),
+                   MV{1 + coordinate()});
+    }
+    assembly.update_world_poses();
+    return assembly;
+  }
+
+  static std::vector<MV> exact(const Assembly<Geometry>& assembly) {
+    return pairwise_accelerations(InverseSquareField<Geometry>{SOFTENING}, assembly);
+  }
+
+  static std::vector<MV> meshed(Mesh& mesh, const Assembly<Geometry>& assembly) {
+    mesh.update(assembly.poses().world_poses(), assembly.couplings());
+    std::vector<MV> accelerations(assembly.size());
+    mesh.accumulate(assembly.poses().world_poses(), assembly.couplings(),
+                    std::span<MV>{accelerations});
+    return accelerations;
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(ParticleMeshTest, GeometryTypes);
+
+/**
+ * Away from the source, the mesh reproduces the inverse-square field of a single source, including
+ * across the padding that keeps the boundary open.
+ */
+TYPED_TEST(ParticleMeshTest, MatchesSingleSourceAwayFromIt) {
+  using Geometry = TypeParam;
+  using MV = typename Geometry::Multivector;
+  using Mesh = typename TestFixture::Mesh;
+  Mesh mesh{this->CENTER, this->HALF_SIZE, 32, this->SOFTENING};
+  const std::vector<MV> source{Geometry::translator(-0.5, -0.5, -0.5)};
+  const std::vector<MV> coupling{MV{2.0}};
+  mesh.update(source, coupling);
+
+  const InverseSquareField<Geometry> field{this->SOFTENING};
+  const MV to_source_frame{Geometry::translator(0.5, 0.5, 0.5)};
+  for (const MV& target : {Geometry::translator(0.5, 0.5, 0.5), Geometry::translator(0.5, -0.5, 0),
+                           Geometry::translator(-0.5, 0.25, -0.5)}) {
+    const MV expected{field.evaluate_at(to_source_frame * target, coupling[0])};
+    const MV actual{mesh.evaluate(target, MV{1.0})};
+    double error{0};
+    double magnitude{0};
+    for (size_t j = 0; j < MV::NUM_BASIS_BLADES; ++j) {
+      error += std::pow(actual.coefficient(j) - expected.coefficient(j), 2);
+      magnitude += std::pow(expected.coefficient(j), 2);
+    }
+    EXPECT_LT(std::sqrt(error / magnitude), 0.01);
+  }
+}
+
+/**
+ * Benchmark: accuracy against the pairwise sum as the mesh is refined, for both assignments.
+ */
+TYPED_TEST(ParticleMeshTest, ErrorAgainstResolution) {
+  using Mesh = typename TestFixture::Mesh;
+  const auto assembly{this->particles(1000)};
+  const auto expected{this->exact(assembly)};
+
+  for (const auto assignment :
+       {Mesh::Assignment::CLOUD_IN_CELL, Mesh::Assignment::TRIANGULAR_SHAPED_CLOUD}) {
+    double previous{1};
+    for (const size_t cells : {16, 32, 64}) {
+      const auto start{std::chrono::steady_clock::now()};
+      Mesh mesh{this->CENTER, this->HALF_SIZE, cells, this->SOFTENING, assignment};
+      const auto setup{std::chrono::steady_clock::now()};
+      const auto actual{this->meshed(mesh, assembly)};
+      const auto end{std::chrono::steady_clock::now()};
+
+      const double error{relative_error(actual, expected)};
+      LOG(INFO) << (assignment == Mesh::Assignment::CLOUD_IN_CELL ? "CIC" : "TSC") << ", "
+                << cells << " cells: error " << error << ", setup "
+                << std::chrono::duration<double>(setup - start).count() * 1e3 << " ms, step "
+                << std::chrono::duration<double>(end - setup).count() * 1e3 << " ms";
+      EXPECT_LT(error, previous) << "cells: " << cells;
+      previous = error;
+    }
+    EXPECT_LT(previous, 0.01);
+  }
+}
+
+/**
+ * Benchmark: wall time of a step against the pairwise sum as the number of particles grows on a
+ * fixed mesh.
+ */
+TYPED_TEST(ParticleMeshTest, ScalingWithParticles) {
+  using Mesh = typename TestFixture::Mesh;
+  Mesh mesh{this->CENTER, this->HALF_SIZE, 32, this->SOFTENING};
+
+  for (const size_t count : {500, 1000, 2000}) {
+    const auto assembly{this->particles(count)};
+
+    auto start{std::chrono::steady_clock::now()};
+    const auto expected{this->exact(assembly)};
+    const double exact_seconds{
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    start = std::chrono::steady_clock::now();
+    const auto actual{this->meshed(mesh, assembly)};
+    const double step_seconds{
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    const double error{relative_error(actual, expected)};
+    LOG(INFO) << count << " particles: pairwise " << exact_seconds * 1e3 << " ms, particle mesh "
+              << step_seconds * 1e3 << " ms, error " << error;
+    EXPECT_LT(error, 0.05);
+  }
+}
+
+}  // namespace ndyn::test
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace ndyn::assembly {
+
+/**
+ * Scene-graph transform cache for a tree of particles.
+ *
+ * Each node holds its local pose, the motor mapping its frame into its parent's, and its world
+ * pose, the motor mapping its frame into the global frame: world = parent_world * local. Without
+ * the cache, every interaction re-multiplies the chain of local poses from its particle up to the
+ * root, repeating the same prefix products for every leaf that shares an ancestor.
+ *
+ * Nodes are added parents first, so storage order is a topological order of the tree and the world
+ * poses are refreshed by update() in a single top-down scan. set_local_pose() marks a node dirty;
+ * update() recomputes exactly the dirty nodes and their descendants, and world_pose() then reads
+ * the result in O(1). Call update() once per step, after the local poses have been written and
+ * before any connection reads a world pose.
+ *
+ * Not thread-safe while updating; concurrent reads of an updated hierarchy are safe.
+ */
+template <typename Geometry>
+class PoseHierarchy final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using NodeId = size_t;
+
+  static constexpr NodeId NO_PARENT{std::numeric_limits<NodeId>::max()};
+
+ private:
+  std::vector<NodeId> parents_{};
+  std::vector<Multivector> local_poses_{};
+  std::vector<Multivector> world_poses_{};
+  std::vector<uint8_t> dirty_{};
+  // The update() pass in which each world pose was last recomputed. A node whose parent was
+  // recomputed in the current pass must be recomputed too.
+  std::vector<uint64_t> updated_in_{};
+  uint64_t pass_{0};
+
+  void check_node(NodeId node) const {
+    LOG_IF(FATAL, node >= parents_.size()) << "Unknown pose hierarchy node " << node << ".";
+  }
+
+ public:
+  void reserve(size_t count) {
+    parents_.reserve(count);
+    local_poses_.reserve(count);
+    world_poses_.reserve(count);
+    dirty_.reserve(count);
+    updated_in_.reserve(count);
+  }
+
+  /**
+   * Adds a node below parent, or a root if parent is NO_PARENT, and returns its id. The parent must
+   * already exist. The new node is dirty until the next update().
+   */
+  NodeId add(NodeId parent = NO_PARENT,
+             const Multivector& local_pose = Multivector{static_cast<ScalarType>(1)}) {
+    if (parent != NO_PARENT) {
+      check_node(parent);
+    }
+    const NodeId node{parents_.size()};
+    parents_.push_back(parent);
+    local_poses_.push_back(local_pose);
+    world_poses_.push_back(local_pose);
+    dirty_.push_back(1);
+    updated_in_.push_back(0);
+    return node;
+  }
+
+  void set_local_pose(NodeId node, const Multivector& local_pose) {
+    check_node(node);
+    local_poses_[node] = local_pose;
+    dirty_[node] = 1;
+  }
+
+  /**
+   * Recomputes the world poses of dirty nodes and of every node below them, and clears the dirty
+   * flags. Returns the number of world poses recomputed.
+   */
+  size_t update() {
+    ++pass_;
+    size_t recomputed{0};
+    for (NodeId node = 0; node < parents_.size(); ++node) {
+      const NodeId parent{parents_[node]};
+      const bool parent_moved{parent != NO_PARENT && updated_in_[parent] == pass_};
+      if (!dirty_[node] && !parent_moved) {
+        continue;
+      }
+      world_poses_[node] = parent == NO_PARENT ? local_poses_[node]
+                                               : world_poses_[parent] * local_poses_[node];
+      dirty_[node] = 0;
+      updated_in_[node] = pass_;
+      ++recomputed;
+    }
+    return recomputed;
+  }
+
+  const Multivector& world_pose(NodeId node) const noexcept { return world_poses_[node]; }
+  const Multivector& local_pose(NodeId node) const noexcept { return local_poses_[node]; }
+  NodeId parent(NodeId node) const noexcept { return parents_[node]; }
+  bool is_dirty(NodeId node) const noexcept { return dirty_[node] != 0; }
+
+  std::span<const Multivector> world_poses() const noexcept { return world_poses_; }
+  std::span<const Multivector> local_poses() const noexcept { return local_poses_; }
+  std::span<const NodeId> parents() const noexcept { return parents_; }
+
+  size_t size() const noexcept { return parents_.size(); }
+};
+
+}  // namespace ndyn::assembly
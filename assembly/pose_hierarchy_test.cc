@@ -0,0 +1,81 @@
+#include "assembly/pose_hierarchy.h"
+
+#include "assembly/geometry_test_utils.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class PoseHierarchyTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+
+  // Rotations and translations, so that the order of composition matters.
+  static MV rotation(Scalar angle) { return Geometry::motor_exp(Geometry::bivector_xy(angle)); }
+  static MV translation(Scalar x) { return Geometry::translator(x, 2 * x, 0); }
+
+  static void expect_near(const MV& actual, const MV& expected) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      EXPECT_NEAR(actual.coefficient(i), expected.coefficient(i), 1e-12) << "blade: " << i;
+    }
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(PoseHierarchyTest, GeometryTypes);
+
+TYPED_TEST(PoseHierarchyTest, WorldPosesComposeDownTheTree) {
+  using Geometry = TypeParam;
+  PoseHierarchy<Geometry> poses;
+  const auto root{poses.add(PoseHierarchy<Geometry>::NO_PARENT, this->translation(1))};
+  const auto arm{poses.add(root, this->rotation(0.3))};
+  const auto hand{poses.add(arm, this->translation(-0.5))};
+  const auto other{poses.add(root, this->rotation(-0.7))};
+
+  EXPECT_EQ(poses.update(), 4u);
+
+  this->expect_near(poses.world_pose(root), this->translation(1));
+  this->expect_near(poses.world_pose(arm), this->translation(1) * this->rotation(0.3));
+  this->expect_near(poses.world_pose(hand), this->translation(1) * this->rotation(0.3) *
+                                                this->translation(-0.5));
+  this->expect_near(poses.world_pose(other), this->translation(1) * this->rotation(-0.7));
+}
+
+/**
+ * Changing a local pose must recompute that node and everything below it, and nothing else.
+ */
+TYPED_TEST(PoseHierarchyTest, OnlyDirtySubtreesRecompute) {
+  using Geometry = TypeParam;
+  PoseHierarchy<Geometry> poses;
+  const auto root{poses.add()};
+  const auto arm{poses.add(root, this->rotation(0.3))};
+  const auto hand{poses.add(arm, this->translation(-0.5))};
+  const auto finger{poses.add(hand, this->rotation(0.1))};
+  const auto other{poses.add(root, this->rotation(-0.7))};
+  poses.update();
+
+  EXPECT_EQ(poses.update(), 0u);
+
+  poses.set_local_pose(arm, this->rotation(0.4));
+  EXPECT_TRUE(poses.is_dirty(arm));
+  EXPECT_FALSE(poses.is_dirty(hand));
+  EXPECT_EQ(poses.update(), 3u);
+  EXPECT_FALSE(poses.is_dirty(arm));
+
+  this->expect_near(poses.world_pose(finger),
+                    this->rotation(0.4) * this->translation(-0.5) * this->rotation(0.1));
+  this->expect_near(poses.world_pose(other), this->rotation(-0.7));
+
+  // Two dirty nodes on the same branch still recompute each node once.
+  poses.set_local_pose(hand, this->translation(0.25));
+  poses.set_local_pose(finger, this->rotation(0.2));
+  EXPECT_EQ(poses.update(), 2u);
+  this->expect_near(poses.world_pose(finger),
+                    this->rotation(0.4) * this->translation(0.25) * this->rotation(0.2));
+}
+
+}  // namespace ndyn::test
@@ -1,34 +1,221 @@
 #pragma once
 
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "assembly/light_speed.h"
 #include "assembly/manifold.h"
+#include "assembly/retardation.h"
+#include "assembly/retardation_cache.h"
+#include "assembly/root_finders.h"
+#include "assembly/spatial.h"
 #include "assembly/worldline.h"
+#include "glog/logging.h"
 
 namespace ndyn::assembly {
 
-template <typename Geometry>
-class Propagator {
+/**
+ * The shared retarded-event service: for a target event, the event on a source's worldline whose
+ * signal reaches it, found by the Manifold's retardation solver.
+ *
+ * Results are memoised per source for the current step, in a RetardationCache keyed by the
+ * quantized target event, so that connections sharing a source, and the stages of one step, solve
+ * the same causal geometry once. begin_step() starts a new step and forgets the previous one's
+ * results. Sources that record a state in the middle of a step must be invalidated.
+ *
+ * retarded_events() resolves many targets against one source at once: the hits come from the
+ * memo, and the misses are solved together by Manifold::solve_retardation_batch(), which makes a
+ * single pass over the part of the source's history they need.
+ *
+ * Not thread-safe; give each worker thread its own Propagator.
+ */
+template <typename Geometry, typename RootFinder = BrentRootFinder,
+          typename LightSpeed = CallableLightSpeed<typename Geometry::ScalarType>>
+class Propagator final {
  public:
   using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using ManifoldType = Manifold<Geometry, RootFinder, LightSpeed>;
+  using Entry = typename RetardationCache<Geometry>::Entry;
+  using Key = typename RetardationCache<Geometry>::Key;
 
-  // Finds the event in the source's worldline that intersects
-  // the past light-cone of the target_event.
-  Multivector find_retarded_event(const Worldline<Geometry>& source_wl,
-                                  const Multivector& target_event,
-                                  const Manifold<Geometry>& manifold) const {
-    double t_now = Geometry::extract_time(target_event);
-    double c = manifold.coordinate_c(t_now);
-
-    // Solve: dist(target_event, source_state(t_ret)) = c * (t_now - t_ret)
-    // For now, we assume a simple root-finding or iterative approximation
-    double t_ret = t_now;  // Simplified: would be the result of the solver
-
-    auto state_at_ret = source_wl.get_state_at(t_ret);
-    // Map the local origin to the world frame via the pose motor (element 0)
-    return state_at_ret.template element<0>() * Geometry::origin() *
-           ~state_at_ret.template element<0>();
+  struct Counters final {
+    uint64_t lookups{0};
+    uint64_t hits{0};
+    // Targets solved, singly or in batches, and the number of batches.
+    uint64_t solves{0};
+    uint64_t batches{0};
+    // Wall time spent in the retardation solver and interpolating the retarded source states.
+    std::chrono::nanoseconds solve_time{0};
+
+    double hit_rate() const noexcept {
+      return lookups == 0 ? 0 : static_cast<double>(hits) / lookups;
+    }
+  };
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  const ManifoldType* manifold_;
+  RetardationCache<Geometry> memo_;
+  uint64_t step_{0};
+  Counters counters_{};
+  RetardationCounters solver_counters_{};
+
+  // Scratch for the misses of a batch: the first target of each missed cell, its pose and key, and
+  // the targets that share a cell with an earlier miss, each with the index of that miss.
+  std::vector<size_t> misses_{};
+  std::vector<Multivector> miss_poses_{};
+  std::vector<Key> miss_keys_{};
+  std::unordered_map<Key, size_t, typename RetardationCache<Geometry>::KeyHash> miss_of_key_{};
+  std::vector<std::pair<size_t, size_t>> duplicates_{};
+  std::vector<ScalarType> t_rets_{};
+
+ public:
+  /**
+   * time_quantum and space_quantum bound how far apart two target events may be and still share a
+   * result; see RetardationCache.
+   */
+  Propagator(const ManifoldType& manifold, ScalarType time_quantum, ScalarType space_quantum)
+      : manifold_{&manifold}, memo_{time_quantum, space_quantum} {}
+
+  /**
+   * Starts the given step. Results memoised during any other step are dropped.
+   */
+  void begin_step(uint64_t step) {
+    if (step != step_) {
+      memo_.clear();
+      step_ = step;
+    }
+  }
+
+  /**
+   * Drops the results for one source within the current step, after it records a state.
+   */
+  template <typename SourceWorldline>
+  void invalidate(const SourceWorldline& source_worldline) {
+    memo_.invalidate(source_worldline);
+  }
+
+  /**
+   * The retarded time and source state for the target. The reference is valid until the next
+   * call to a non-const member.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  const Entry& resolve(const SourceWorldline& source_worldline, const Multivector& target_pose) {
+    ++counters_.lookups;
+    if (const Entry* entry{memo_.find(*manifold_, source_worldline, target_pose)};
+        entry != nullptr) {
+      ++counters_.hits;
+      return *entry;
+    }
+
+    ++counters_.solves;
+    const auto start{Clock::now()};
+    const ScalarType t_ret{
+        manifold_->solve_retardation(source_worldline, target_pose, solver_counters_)};
+    const auto source_state{source_worldline.get_state_at(t_ret)};
+    counters_.solve_time += Clock::now() - start;
+    return memo_.store(*manifold_, source_worldline, target_pose, t_ret, source_state);
   }
+
+  /**
+   * The retarded source event for the target: the position of the source at the retarded time.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  Multivector retarded_event(const SourceWorldline& source_worldline,
+                             const Multivector& target_pose) {
+    return origin_image<Geometry>(
+        resolve(source_worldline, target_pose).source_state.template element<0>());
+  }
+
+  /**
+   * The retarded source events of many targets at the common time t_now: events[i] receives
+   * retarded_event(source_worldline, target_poses[i]). Every target must be at t_now, to within
+   * the memo's time quantum, since the batch solves them all there.
+   *
+   * Targets that miss the memo are solved once per cell, as successive resolve() calls would:
+   * a target sharing a cell with an earlier miss takes that miss's result and counts as a hit.
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  void retarded_events(const SourceWorldline& source_worldline,
+                       std::span<const Multivector> target_poses, ScalarType t_now,
+                       std::span<Multivector> events) {
+    using std::abs;
+    LOG_IF(FATAL, events.size() != target_poses.size())
+        << "Batched propagation requires one event per target.";
+
+    misses_.clear();
+    miss_poses_.clear();
+    miss_keys_.clear();
+    miss_of_key_.clear();
+    duplicates_.clear();
+    counters_.lookups += target_poses.size();
+    for (size_t i = 0; i < target_poses.size(); ++i) {
+      LOG_IF(FATAL, abs(Geometry::extract_time(target_poses[i]) - t_now) > memo_.time_quantum())
+          << "Batched propagation requires every target at t_now. Target: " << i
+          << ", time: " << Geometry::extract_time(target_poses[i]) << ", t_now: " << t_now;
+      const Key key{memo_.key(*manifold_, source_worldline, target_poses[i])};
+      if (const Entry* entry{memo_.find(key)}; entry != nullptr) {
+        ++counters_.hits;
+        events[i] = origin_image<Geometry>(entry->source_state.template element<0>());
+        continue;
+      }
+      const auto [miss, inserted] = miss_of_key_.try_emplace(key, misses_.size());
+      if (inserted) {
+        misses_.push_back(i);
+        miss_poses_.push_back(target_poses[i]);
+        miss_keys_.push_back(key);
+      } else {
+        ++counters_.hits;
+        duplicates_.emplace_back(i, miss->second);
+      }
+    }
+    if (misses_.empty()) return;
+
+    ++counters_.batches;
+    counters_.solves += misses_.size();
+    const auto start{Clock::now()};
+    t_rets_.resize(misses_.size());
+    manifold_->solve_retardation_batch(source_worldline, miss_poses_, t_now,
+                                       std::span<ScalarType>{t_rets_}, solver_counters_);
+    for (size_t j = 0; j < misses_.size(); ++j) {
+      const Entry& entry{
+          memo_.store(miss_keys_[j], t_rets_[j], source_worldline.get_state_at(t_rets_[j]))};
+      events[misses_[j]] = origin_image<Geometry>(entry.source_state.template element<0>());
+    }
+    for (const auto& [target, miss] : duplicates_) {
+      events[target] = events[misses_[miss]];
+    }
+    counters_.solve_time += Clock::now() - start;
+  }
+
+  /**
+   * The transition motor from the source's retarded frame to the target's, as
+   * Manifold::transport().
+   */
+  template <WorldlineLike<Geometry> SourceWorldline>
+  Multivector transport(const SourceWorldline& source_worldline, const Multivector& target_pose) {
+    return target_pose *
+           (~resolve(source_worldline, target_pose).source_state.template element<0>());
+  }
+
+  uint64_t step() const noexcept { return step_; }
+
+  const Counters& counters() const noexcept { return counters_; }
+
+  /**
+   * Work done by the solves the memo did not avoid.
+   */
+  const RetardationCounters& solver_counters() const noexcept { return solver_counters_; }
+
+  const ManifoldType& manifold() const noexcept { return *manifold_; }
 };
 
 }  // namespace ndyn::assembly
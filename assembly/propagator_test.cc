@@ -0,0 +1,214 @@
+#include "assembly/propagator.h"
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "assembly/geometry_test_utils.h"
+#include "assembly/manifold.h"
+#include "assembly/spatial.h"
+#include "assembly/worldline.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class PropagatorTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using StateType = math::State<Geometry, 2>;
+
+  static constexpr Scalar TIME_QUANTUM{1e-4};
+  static constexpr Scalar SPACE_QUANTUM{1e-4};
+
+  auto constant_c(Scalar value) {
+    return [value](Scalar /*time*/) { return value; };
+  }
+
+  static StateType make_state(Scalar t) {
+    StateType s;
+    s.template set_element<0>(Geometry::translator(0.3 * t, std::sin(t), 0) *
+                              Geometry::identity_at_time(t));
+    return s;
+  }
+
+  static MV target_at(Scalar t, Scalar x = 5, Scalar y = 0) {
+    return Geometry::translator(x, y, 0) * Geometry::identity_at_time(t);
+  }
+
+  // The retarded source event without the Propagator.
+  static MV expected_event(const Manifold<Geometry>& manifold, const Worldline<Geometry>& wl,
+                           const MV& target) {
+    return origin_image<Geometry>(
+        wl.get_state_at(manifold.solve_retardation(wl, target)).template element<0>());
+  }
+
+  static void expect_near(const MV& actual, const MV& expected, double tolerance) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      EXPECT_NEAR(actual.coefficient(i), expected.coefficient(i), tolerance) << "blade: " << i;
+    }
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(PropagatorTest, GeometryTypes);
+
+/**
+ * Within a step, repeated targets are answered from the memo with what a direct solve would give;
+ * a new step solves them again.
+ */
+TYPED_TEST(PropagatorTest, MemoisesPerSourceAndStep) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(1.0));
+  Worldline<Geometry> first(manifold, 1024);
+  Worldline<Geometry> second(manifold, 1024);
+  for (int i = 0; i <= 100; ++i) {
+    first.record_state(this->make_state(0.1 * i));
+    second.record_state(this->make_state(0.1 * i + 0.05));
+  }
+
+  Propagator<Geometry> propagator(manifold, this->TIME_QUANTUM, this->SPACE_QUANTUM);
+  const auto target{this->target_at(8.0)};
+  for (int connection = 0; connection < 3; ++connection) {
+    this->expect_near(propagator.retarded_event(first, target),
+                      this->expected_event(manifold, first, target), 0);
+    this->expect_near(propagator.retarded_event(second, target),
+                      this->expected_event(manifold, second, target), 0);
+  }
+  EXPECT_EQ(propagator.counters().lookups, 6u);
+  EXPECT_EQ(propagator.counters().solves, 2u);
+  EXPECT_EQ(propagator.counters().hits, 4u);
+
+  propagator.begin_step(0);
+  propagator.retarded_event(first, target);
+  EXPECT_EQ(propagator.counters().solves, 2u);
+
+  propagator.begin_step(1);
+  propagator.retarded_event(first, target);
+  EXPECT_EQ(propagator.counters().solves, 3u);
+  EXPECT_EQ(propagator.step(), 1u);
+}
+
+/**
+ * A batch gives the events of single solves, solves only the targets it has not seen this step,
+ * and shares its results with later single lookups.
+ */
+TYPED_TEST(PropagatorTest, BatchMatchesSingleSolves) {
+  using Geometry = TypeParam;
+  using MV = typename Geometry::Multivector;
+  Manifold<Geometry> manifold(this->constant_c(1.0));
+  Worldline<Geometry> wl(manifold, 1024);
+  for (int i = 0; i <= 100; ++i) {
+    wl.record_state(this->make_state(0.1 * i));
+  }
+
+  const double t_now{9.0};
+  std::vector<MV> targets{};
+  for (int i = 0; i < 40; ++i) {
+    targets.push_back(this->target_at(t_now, 2 + 0.1 * i, std::cos(0.3 * i)));
+  }
+
+  Propagator<Geometry> propagator(manifold, this->TIME_QUANTUM, this->SPACE_QUANTUM);
+  propagator.retarded_event(wl, targets[3]);
+  std::vector<MV> events(targets.size());
+  propagator.retarded_events(wl, targets, t_now, std::span<MV>{events});
+  for (size_t i = 0; i < targets.size(); ++i) {
+    this->expect_near(events[i], this->expected_event(manifold, wl, targets[i]), 1e-9);
+  }
+  EXPECT_EQ(propagator.counters().batches, 1u);
+  EXPECT_EQ(propagator.counters().solves, targets.size());
+
+  propagator.retarded_events(wl, targets, t_now, std::span<MV>{events});
+  propagator.retarded_event(wl, targets[7]);
+  EXPECT_EQ(propagator.counters().batches, 1u);
+  EXPECT_EQ(propagator.counters().solves, targets.size());
+  EXPECT_EQ(propagator.counters().hits, targets.size() + 2);
+}
+
+/**
+ * Targets of one batch that share a memo cell are solved once, as successive single lookups would
+ * be, and all receive that solve's event.
+ */
+TYPED_TEST(PropagatorTest, BatchSolvesEachCellOnce) {
+  using Geometry = TypeParam;
+  using MV = typename Geometry::Multivector;
+  Manifold<Geometry> manifold(this->constant_c(1.0));
+  Worldline<Geometry> wl(manifold, 1024);
+  for (int i = 0; i <= 100; ++i) {
+    wl.record_state(this->make_state(0.1 * i));
+  }
+
+  const double t_now{9.0};
+  std::vector<MV> targets{};
+  for (int i = 0; i < 10; ++i) {
+    // Each target three times: twice exactly, and once a small fraction of a quantum away.
+    const double x{2 + 0.25 * i};
+    targets.push_back(this->target_at(t_now, x));
+    targets.push_back(this->target_at(t_now, x));
+    targets.push_back(this->target_at(t_now, x + 1e-3 * this->SPACE_QUANTUM));
+  }
+
+  Propagator<Geometry> propagator(manifold, this->TIME_QUANTUM, this->SPACE_QUANTUM);
+  std::vector<MV> events(targets.size());
+  propagator.retarded_events(wl, targets, t_now, std::span<MV>{events});
+  for (size_t i = 0; i < targets.size(); ++i) {
+    // The nearby target may take its neighbour's event, which is up to a quantum off.
+    const double tolerance{i % 3 == 2 ? this->SPACE_QUANTUM : 1e-9};
+    if (i % 3 == 1) this->expect_near(events[i], events[i - 1], 0);
+    this->expect_near(events[i], this->expected_event(manifold, wl, targets[i]), tolerance);
+  }
+
+  Propagator<Geometry> single(manifold, this->TIME_QUANTUM, this->SPACE_QUANTUM);
+  for (const MV& target : targets) {
+    single.retarded_event(wl, target);
+  }
+  EXPECT_EQ(propagator.counters().lookups, targets.size());
+  EXPECT_EQ(propagator.counters().solves, single.counters().solves);
+  EXPECT_EQ(propagator.counters().hits, single.counters().hits);
+  EXPECT_LE(propagator.counters().solves, 2 * targets.size() / 3);
+  EXPECT_EQ(propagator.solver_counters().solves, propagator.counters().solves);
+}
+
+/**
+ * Benchmark: solver time for many targets resolved one by one against one batch.
+ */
+TYPED_TEST(PropagatorTest, BatchSolveTime) {
+  using Geometry = TypeParam;
+  using MV = typename Geometry::Multivector;
+  Manifold<Geometry> manifold(this->constant_c(1.0));
+  Worldline<Geometry> wl(manifold, 4096);
+  for (int i = 0; i <= 2000; ++i) {
+    wl.record_state(this->make_state(0.005 * i));
+  }
+
+  const double t_now{10.0};
+  std::vector<MV> targets{};
+  for (int i = 0; i < 1000; ++i) {
+    targets.push_back(this->target_at(t_now, 1 + 0.005 * i, std::sin(0.1 * i)));
+  }
+  std::vector<MV> events(targets.size());
+
+  Propagator<Geometry> single(manifold, this->TIME_QUANTUM, this->SPACE_QUANTUM);
+  for (size_t i = 0; i < targets.size(); ++i) {
+    events[i] = single.retarded_event(wl, targets[i]);
+  }
+  Propagator<Geometry> batched(manifold, this->TIME_QUANTUM, this->SPACE_QUANTUM);
+  batched.retarded_events(wl, targets, t_now, std::span<MV>{events});
+
+  const auto milliseconds{[](const auto& propagator) {
+    return std::chrono::duration<double, std::milli>(propagator.counters().solve_time).count();
+  }};
+  LOG(INFO) << targets.size() << " targets: single " << milliseconds(single) << " ms, "
+            << single.solver_counters().evaluations << " evaluations; batch "
+            << milliseconds(batched) << " ms, " << batched.solver_counters().evaluations
+            << " evaluations";
+  EXPECT_EQ(batched.counters().solves, targets.size());
+  EXPECT_LT(batched.solver_counters().evaluations, single.solver_counters().evaluations);
+}
+
+}  // namespace ndyn::test
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ndyn::assembly {
+
+/**
+ * Work done by the retardation solver. Every evaluation of the light-cone equation samples the
+ * source worldline once, so `evaluations` is the number of get_state_at() calls made. `samples`
+ * counts the much cheaper evaluations at recorded samples, which need no interpolation.
+ */
+struct RetardationCounters final {
+  uint64_t solves{0};
+  uint64_t evaluations{0};
+  uint64_t samples{0};
+  uint64_t iterations{0};
+
+  // Warm-started solves only: how often the initial bracket around the prediction had to be grown,
+  // and how often the solver gave up on it and searched the full history instead.
+  uint64_t widenings{0};
+  uint64_t fallbacks{0};
+
+  RetardationCounters& operator+=(const RetardationCounters& rhs) noexcept {
+    solves += rhs.solves;
+    evaluations += rhs.evaluations;
+    samples += rhs.samples;
+    iterations += rhs.iterations;
+    widenings += rhs.widenings;
+    fallbacks += rhs.fallbacks;
+    return *this;
+  }
+};
+
+/**
+ * The solver state carried from one retardation solve to the next for a single source/target pair.
+ *
+ * Between consecutive steps, or consecutive stages of one step, the retarded time moves very
+ * little, so the previous solution extrapolated by its rate of change is an excellent first guess.
+ * The Manifold updates this after each solve; callers may also seed `rate` themselves, for example
+ * from the source's known velocity.
+ */
+template <typename ScalarType>
+struct RetardationWarmStart final {
+  bool primed{false};
+
+  // The target time and retarded time of the previous solve.
+  ScalarType t_now{};
+  ScalarType t_ret{};
+
+  // d(t_ret) / d(t_now). A source at rest relative to the target advances one for one.
+  ScalarType rate{1};
+
+  RetardationCounters counters{};
+
+  ScalarType predict(ScalarType t) const noexcept { return t_ret + rate * (t - t_now); }
+};
+
+}  // namespace ndyn::assembly
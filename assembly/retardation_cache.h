@@ -0,0 +1,232 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "assembly/manifold.h"
+#include "assembly/retardation.h"
+#include "assembly/spatial.h"
+#include "assembly/worldline.h"
+#include "glog/logging.h"
+#include "math/state.h"
+
+namespace ndyn::assembly {
+
+/**
+ * Memoizes retardation solves for the duration of one integration step.
+ *
+ * Within a step, the stages of a Runge-Kutta integrator evaluate every connection at nearby
+ * events, and leaves that share a parent solve against the same parent worldline. Each of those
+ * solves, and the interpolation of the source state at the resulting retarded time, is repeated
+ * work. The cache keys each solve by the manifold, the source worldline and the target event,
+ * quantized to time_quantum in time and space_quantum in each spatial coordinate, and returns the
+ * retarded time and the interpolated source state recorded for the first event in that cell.
+ * Manifolds with different speeds of light may share a source worldline, so they never share
+ * entries.
+ *
+ * The quanta therefore bound the error the cache may introduce: a hit can return the retarded time
+ * of an event up to one quantum away. Choose them well below the step size.
+ *
+ * Appending to a worldline changes its retarded solutions, so whoever appends must call
+ * invalidate() for that worldline; this costs O(1) and stale entries are recomputed on their next
+ * lookup. clear() drops everything, typically at the start of each step.
+ *
+ * Not thread-safe; give each worker thread its own cache.
+ */
+template <typename Geometry>
+class RetardationCache final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+
+  struct Entry final {
+    ScalarType t_ret;
+    StateType source_state;
+    uint64_t generation;
+  };
+
+  /**
+   * The cell of a target event for a manifold and source worldline: targets with equal keys share
+   * an entry. The cell is compared coordinate by coordinate, so distinct cells never collide.
+   */
+  struct Key final {
+    const void* manifold;
+    const void* source;
+    int64_t time;
+    std::array<int64_t, 3> position;
+
+    bool operator==(const Key&) const = default;
+  };
+
+  struct KeyHash final {
+    size_t operator()(const Key& key) const noexcept {
+      uint64_t hash{reinterpret_cast<uintptr_t>(key.manifold)};
+      hash = mix(hash, reinterpret_cast<uintptr_t>(key.source));
+      hash = mix(hash, static_cast<uint64_t>(key.time));
+      for (const int64_t coordinate : key.position) {
+        hash = mix(hash, static_cast<uint64_t>(coordinate));
+      }
+      return static_cast<size_t>(hash);
+    }
+  };
+
+  struct Counters final {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    // Misses caused by an entry that had been invalidated.
+    uint64_t stale{0};
+    uint64_t invalidations{0};
+
+    double hit_rate() const noexcept {
+      const uint64_t lookups{hits + misses};
+      return lookups == 0 ? 0 : static_cast<double>(hits) / lookups;
+    }
+  };
+
+ private:
+  static constexpr uint64_t mix(uint64_t hash, uint64_t value) noexcept {
+    // The 64-bit finalizer from MurmurHash3, applied to the running hash combined with value.
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  ScalarType time_quantum_;
+  ScalarType space_quantum_;
+
+  std::unordered_map<Key, Entry, KeyHash> entries_{};
+  std::unordered_map<const void*, uint64_t> generations_{};
+  Counters counters_{};
+  RetardationCounters solver_counters_{};
+
+  static int64_t quantize(ScalarType value, ScalarType quantum) noexcept {
+    using std::floor;
+    return static_cast<int64_t>(floor(value / quantum));
+  }
+
+  uint64_t generation_of(const void* source) const noexcept {
+    const auto it{generations_.find(source)};
+    return it == generations_.end() ? 0 : it->second;
+  }
+
+ public:
+  RetardationCache(ScalarType time_quantum, ScalarType space_quantum)
+      : time_quantum_{time_quantum}, space_quantum_{space_quantum} {
+    LOG_IF(FATAL, !(time_quantum > 0) || !(space_quantum > 0))
+        << "Retardation cache requires positive quanta.";
+  }
+
+  /**
+   * Returns the retarded time and source state for target_pose, solving and interpolating only if
+   * no valid entry exists for its cell. The reference is valid until the next call to resolve() or
+   * clear().
+   */
+  template <typename RootFinder, typename LightSpeed, WorldlineLike<Geometry> SourceWorldline>
+  const Entry& resolve(const Manifold<Geometry, RootFinder, LightSpeed>& manifold,
+                       const SourceWorldline& source_worldline, const Multivector& target_pose) {
+    const void* source{&source_worldline};
+    const uint64_t generation{generation_of(source)};
+    const auto [it, inserted] = entries_.try_emplace(key(manifold, source_worldline, target_pose));
+    Entry& entry{it->second};
+
+    if (!inserted && entry.generation == generation) {
+      ++counters_.hits;
+      return entry;
+    }
+
+    ++counters_.misses;
+    if (!inserted) {
+      ++counters_.stale;
+    }
+    entry.t_ret = manifold.solve_retardation(source_worldline, target_pose, solver_counters_);
+    entry.source_state = source_worldline.get_state_at(entry.t_ret);
+    entry.generation = generation;
+    return entry;
+  }
+
+  /**
+   * The cell of target_pose for source_worldline on manifold.
+   */
+  template <typename ManifoldType, typename SourceWorldline>
+  Key key(const ManifoldType& manifold, const SourceWorldline& source_worldline,
+          const Multivector& target_pose) const noexcept {
+    const auto position{spatial_coordinates<Geometry>(origin_image<Geometry>(target_pose))};
+    return Key{&manifold,
+               &source_worldline,
+               quantize(Geometry::extract_time(target_pose), time_quantum_),
+               {quantize(position[0], space_quantum_), quantize(position[1], space_quantum_),
+                quantize(position[2], space_quantum_)}};
+  }
+
+  /**
+   * The valid entry for a cell, or nullptr if there is none. With store(), lets callers that solve
+   * their misses together, such as Propagator's batches, share the cache.
+   */
+  const Entry* find(const Key& key) {
+    const auto it{entries_.find(key)};
+    if (it == entries_.end() || it->second.generation != generation_of(key.source)) {
+      return nullptr;
+    }
+    ++counters_.hits;
+    return &it->second;
+  }
+
+  template <typename ManifoldType, typename SourceWorldline>
+  const Entry* find(const ManifoldType& manifold, const SourceWorldline& source_worldline,
+                    const Multivector& target_pose) {
+    return find(key(manifold, source_worldline, target_pose));
+  }
+
+  /**
+   * Records a solve for a cell, replacing any entry there, and counts it as a miss. The reference
+   * is valid as for resolve().
+   */
+  const Entry& store(const Key& key, ScalarType t_ret, const StateType& source_state) {
+    const auto [it, inserted] = entries_.try_emplace(key);
+    ++counters_.misses;
+    if (!inserted) {
+      ++counters_.stale;
+    }
+    it->second = Entry{t_ret, source_state, generation_of(key.source)};
+    return it->second;
+  }
+
+  template <typename ManifoldType, typename SourceWorldline>
+  const Entry& store(const ManifoldType& manifold, const SourceWorldline& source_worldline,
+                     const Multivector& target_pose, ScalarType t_ret,
+                     const StateType& source_state) {
+    return store(key(manifold, source_worldline, target_pose), t_ret, source_state);
+  }
+
+  /**
+   * Marks every entry for source_worldline as stale. Call whenever that worldline records a state.
+   */
+  template <typename SourceWorldline>
+  void invalidate(const SourceWorldline& source_worldline) {
+    ++generations_[&source_worldline];
+    ++counters_.invalidations;
+  }
+
+  void clear() noexcept {
+    entries_.clear();
+    generations_.clear();
+  }
+
+  size_t size() const noexcept { return entries_.size(); }
+  ScalarType time_quantum() const noexcept { return time_quantum_; }
+
+  const Counters& counters() const noexcept { return counters_; }
+
+  /**
+   * Work done by the solves the cache did not avoid.
+   */
+  const RetardationCounters& solver_counters() const noexcept { return solver_counters_; }
+};
+
+}  // namespace ndyn::assembly
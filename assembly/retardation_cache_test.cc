@@ -0,0 +1,160 @@
+#include "assembly/retardation_cache.h"
+
+#include <cmath>
+
+#include "assembly/geometry_test_utils.h"
+#include "assembly/manifold.h"
+#include "assembly/worldline.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class RetardationCacheTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using StateType = math::State<Geometry, 2>;
+
+  static constexpr Scalar TIME_QUANTUM{1e-4};
+  static constexpr Scalar SPACE_QUANTUM{1e-4};
+
+  auto constant_c(Scalar value) {
+    return [value](Scalar /*time*/) { return value; };
+  }
+
+  static StateType make_state(Scalar t) {
+    StateType s;
+    s.template set_element<0>(Geometry::translator(0.3 * t, std::sin(t), 0) *
+                              Geometry::identity_at_time(t));
+    return s;
+  }
+
+  static MV target_at(Scalar t, Scalar x = 5) {
+    return Geometry::translator(x, 0, 0) * Geometry::identity_at_time(t);
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(RetardationCacheTest, GeometryTypes);
+
+/**
+ * The two middle stages of a Runge-Kutta 4 step share their time, and connections with the same
+ * parent share their source. Repeating a target event must hit, and must return what an uncached
+ * solve would.
+ */
+TYPED_TEST(RetardationCacheTest, RepeatedEventsHit) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(1.0));
+  Worldline<Geometry> wl(manifold, 1024);
+  for (int i = 0; i <= 100; ++i) {
+    wl.record_state(this->make_state(0.1 * i));
+  }
+
+  RetardationCache<Geometry> cache(this->TIME_QUANTUM, this->SPACE_QUANTUM);
+  const double h{0.01};
+  const double t{8.0};
+  // Stages at t, t + h/2, t + h/2 and t + h, evaluated for four leaves sharing the parent.
+  for (int leaf = 0; leaf < 4; ++leaf) {
+    for (const double stage_time : {t, t + h / 2, t + h / 2, t + h}) {
+      const auto target{this->target_at(stage_time)};
+      const auto& entry{cache.resolve(manifold, wl, target)};
+      EXPECT_EQ(entry.t_ret, manifold.solve_retardation(wl, target));
+    }
+  }
+
+  EXPECT_EQ(cache.size(), 3u);
+  EXPECT_EQ(cache.counters().misses, 3u);
+  EXPECT_EQ(cache.counters().hits, 13u);
+  EXPECT_NEAR(cache.counters().hit_rate(), 13.0 / 16.0, 1e-12);
+  EXPECT_EQ(cache.solver_counters().solves, 3u);
+}
+
+/**
+ * Events in different cells, or against different sources, must not share entries.
+ */
+TYPED_TEST(RetardationCacheTest, DistinctEventsAndSourcesMiss) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(1.0));
+  Worldline<Geometry> first(manifold, 1024);
+  Worldline<Geometry> second(manifold, 1024);
+  for (int i = 0; i <= 100; ++i) {
+    first.record_state(this->make_state(0.1 * i));
+    second.record_state(this->make_state(0.1 * i + 0.05));
+  }
+
+  RetardationCache<Geometry> cache(this->TIME_QUANTUM, this->SPACE_QUANTUM);
+  cache.resolve(manifold, first, this->target_at(8.0));
+  cache.resolve(manifold, second, this->target_at(8.0));
+  cache.resolve(manifold, first, this->target_at(8.0, 5.5));
+  cache.resolve(manifold, first, this->target_at(8.5));
+
+  EXPECT_EQ(cache.counters().hits, 0u);
+  EXPECT_EQ(cache.counters().misses, 4u);
+}
+
+/**
+ * Manifolds with different speeds of light retard the same source differently, so a cache shared
+ * between them must keep their entries apart.
+ */
+TYPED_TEST(RetardationCacheTest, DistinctManifoldsMiss) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> fast(this->constant_c(1.0));
+  Manifold<Geometry> slow(this->constant_c(0.5));
+  Worldline<Geometry> wl(fast, 1024);
+  for (int i = 0; i <= 100; ++i) {
+    wl.record_state(this->make_state(0.1 * i));
+  }
+
+  RetardationCache<Geometry> cache(this->TIME_QUANTUM, this->SPACE_QUANTUM);
+  const auto target{this->target_at(8.0)};
+  const double t_fast{cache.resolve(fast, wl, target).t_ret};
+  const double t_slow{cache.resolve(slow, wl, target).t_ret};
+
+  EXPECT_EQ(cache.counters().hits, 0u);
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_EQ(t_fast, fast.solve_retardation(wl, target));
+  EXPECT_EQ(t_slow, slow.solve_retardation(wl, target));
+  EXPECT_LT(t_slow, t_fast);
+}
+
+/**
+ * Once a source records a new state its cached entries must be recomputed against the new
+ * history; entries for other sources are unaffected.
+ */
+TYPED_TEST(RetardationCacheTest, InvalidationForcesRecompute) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(1.0));
+  Worldline<Geometry> wl(manifold, 1024);
+  Worldline<Geometry> other(manifold, 1024);
+  for (int i = 0; i <= 50; ++i) {
+    wl.record_state(this->make_state(0.1 * i));
+    other.record_state(this->make_state(0.1 * i));
+  }
+
+  RetardationCache<Geometry> cache(this->TIME_QUANTUM, this->SPACE_QUANTUM);
+  // The signal from the latest sample reaches the target after t = 5.0, so this target's
+  // retarded time depends on states that have not been recorded yet.
+  const auto target{this->target_at(9.0, 2.0)};
+  const double before{cache.resolve(manifold, wl, target).t_ret};
+  cache.resolve(manifold, other, target);
+
+  for (int i = 51; i <= 100; ++i) {
+    wl.record_state(this->make_state(0.1 * i));
+  }
+  cache.invalidate(wl);
+
+  const double after{cache.resolve(manifold, wl, target).t_ret};
+  cache.resolve(manifold, other, target);
+
+  EXPECT_NE(before, after);
+  EXPECT_EQ(after, manifold.solve_retardation(wl, target));
+  EXPECT_EQ(cache.counters().stale, 1u);
+  EXPECT_EQ(cache.counters().hits, 1u);
+  EXPECT_EQ(cache.counters().invalidations, 1u);
+}
+
+}  // namespace ndyn::test
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <concepts>
+#include <utility>
+
+#include "assembly/retardation.h"
+#include "math/abs.h"
+
+namespace ndyn::assembly {
+
+/**
+ * The light-cone error and its first two derivatives with respect to the emission time, sampled at
+ * a single time.
+ */
+template <typename ScalarType>
+struct LightConeSample final {
+  ScalarType value;
+  ScalarType first;
+  ScalarType second;
+};
+
+/**
+ * Root-finding policies for the retardation solver, selected per Manifold:
+ *
+ *   Manifold<Geometry, NewtonRootFinder> manifold{c_func};
+ *
+ * Each policy provides
+ *
+ *   template <typename Problem, typename ScalarType>
+ *   static ScalarType find_root(const Problem& f, ScalarType lower, ScalarType upper,
+ *                               ScalarType f_lower, ScalarType f_upper, ScalarType tolerance,
+ *                               RetardationCounters& counters);
+ *
+ * which finds a root of f in [lower, upper], given that f_lower and f_upper, the values of f at
+ * either end, differ in sign. f(t) returns the error at t; f.with_derivatives(t) returns a
+ * LightConeSample. Both sample the source worldline once.
+ */
+template <typename Problem, typename ScalarType>
+concept RootFindingProblem = requires(const Problem& f, ScalarType t) {
+  { f(t) } -> std::convertible_to<ScalarType>;
+  { f.with_derivatives(t) } -> std::convertible_to<LightConeSample<ScalarType>>;
+};
+
+/**
+ * Brent's method. Needs no derivatives, and is the most robust choice when the source's recorded
+ * velocity is missing or inconsistent with its motion.
+ */
+struct BrentRootFinder final {
+  template <typename Problem, typename ScalarType>
+  static ScalarType find_root(const Problem& f, ScalarType lower_bound, ScalarType upper_bound,
+                              ScalarType f_lower, ScalarType f_upper, ScalarType tolerance,
+                              RetardationCounters& counters) {
+    using math::abs;
+
+    // Brent's Method variables
+    ScalarType best_estimate{upper_bound};
+    ScalarType prev_best{lower_bound};
+    ScalarType contrivance_point{lower_bound};  // 'c' in standard Brent notation
+
+    ScalarType f_best{f_upper};
+    ScalarType f_prev{f_lower};
+    ScalarType f_contrivance{f_lower};
+
+    ScalarType interpolation_step{0};
+    bool use_bisection{true};
+
+    for (int iteration{0}; iteration < 64; ++iteration) {
+      ++counters.iterations;
+
+      // Check convergence
+      if (abs(f_best) < tolerance || abs(best_estimate - prev_best) < tolerance) {
+        return best_estimate;
+      }
+
+      // Inverse Quadratic Interpolation or Secant Method
+      if (f_best != f_prev && f_best != f_contrivance && f_prev != f_contrivance) {
+        // Inverse Quadratic
+        interpolation_step =
+            (prev_best * f_best * f_contrivance) / ((f_prev - f_best) * (f_prev - f_contrivance)) +
+            (best_estimate * f_prev * f_contrivance) /
+                ((f_best - f_prev) * (f_best - f_contrivance)) +
+            (contrivance_point * f_prev * f_best) /
+                ((f_contrivance - f_prev) * (f_contrivance - f_best));
+      } else {
+        // Secant
+        interpolation_step =
+            best_estimate - f_best * (best_estimate - prev_best) / (f_best - f_prev);
+      }
+
+      // Evaluate if the proposed step is acceptable
+      const ScalarType delta_est_prev{abs(best_estimate - prev_best)};
+      const ScalarType delta_prev_contrivance{abs(prev_best - contrivance_point)};
+
+      const bool out_of_bounds = (interpolation_step < (3 * prev_best + best_estimate) / 4 ||
+                                  interpolation_step > best_estimate);
+      const bool too_slow_iq =
+          (use_bisection && abs(interpolation_step - best_estimate) >= delta_est_prev / 2);
+      const bool too_slow_secant =
+          (!use_bisection && abs(interpolation_step - best_estimate) >= delta_prev_contrivance / 2);
+
+      if (out_of_bounds || too_slow_iq || too_slow_secant) {
+        interpolation_step = (prev_best + best_estimate) / 2;
+        use_bisection = true;
+      } else {
+        use_bisection = false;
+      }
+
+      const ScalarType f_new{f(interpolation_step)};
+
+      // Update the bracket
+      contrivance_point = prev_best;
+      f_contrivance = f_prev;
+
+      if (f_prev * f_new < 0) {
+        best_estimate = interpolation_step;
+        f_best = f_new;
+      } else {
+        prev_best = interpolation_step;
+        f_prev = f_new;
+      }
+
+      if (abs(f_prev) < abs(f_best)) {
+        std::swap(prev_best, best_estimate);
+        std::swap(f_prev, f_best);
+      }
+    }
+
+    return best_estimate;
+  }
+};
+
+/**
+ * Newton's and Halley's methods, safeguarded by the bracket. Each iteration proposes a step from
+ * the derivatives at the current estimate; a step that leaves the bracket, or that would shrink
+ * the bracket more slowly than bisection, is replaced by a bisection step. The bracket is kept
+ * around the root throughout, so convergence is never worse than bisection's.
+ *
+ * ORDER selects Newton's method (1) or Halley's (2).
+ */
+template <int ORDER>
+struct SafeguardedRootFinder final {
+  static_assert(ORDER == 1 || ORDER == 2, "Only Newton's and Halley's methods are supported.");
+
+  template <typename Problem, typename ScalarType>
+    requires RootFindingProblem<Problem, ScalarType>
+  static ScalarType find_root(const Problem& f, ScalarType lower_bound, ScalarType upper_bound,
+                              ScalarType f_lower, ScalarType f_upper, ScalarType tolerance,
+                              RetardationCounters& counters) {
+    using math::abs;
+
+    if (f_lower == 0) return lower_bound;
+    if (f_upper == 0) return upper_bound;
+
+    ScalarType lower{lower_bound};
+    ScalarType upper{upper_bound};
+
+    // Start from the secant through the bracket, which is already close for a slowly moving source.
+    ScalarType estimate{lower - f_lower * (upper - lower) / (f_upper - f_lower)};
+    ScalarType previous_step{upper - lower};
+
+    for (int iteration{0}; iteration < 64; ++iteration) {
+      ++counters.iterations;
+
+      const LightConeSample<ScalarType> sample{f.with_derivatives(estimate)};
+      if (abs(sample.value) < tolerance) {
+        return estimate;
+      }
+
+      if (sample.value * f_lower > 0) {
+        lower = estimate;
+        f_lower = sample.value;
+      } else {
+        upper = estimate;
+      }
+      if (upper - lower < tolerance) {
+        return estimate;
+      }
+
+      ScalarType step{0};
+      bool accept{sample.first != 0};
+      if (accept) {
+        if constexpr (ORDER == 1) {
+          step = sample.value / sample.first;
+        } else {
+          const ScalarType denominator{2 * sample.first * sample.first -
+                                       sample.value * sample.second};
+          accept = denominator != 0;
+          if (accept) step = 2 * sample.value * sample.first / denominator;
+        }
+      }
+
+      const ScalarType proposal{estimate - step};
+      if (!accept || !(proposal > lower && proposal < upper) ||
+          2 * abs(step) > abs(previous_step)) {
+        previous_step = (upper - lower) / 2;
+        estimate = lower + previous_step;
+      } else {
+        previous_step = step;
+        estimate = proposal;
+      }
+    }
+
+    return estimate;
+  }
+};
+
+using NewtonRootFinder = SafeguardedRootFinder<1>;
+using HalleyRootFinder = SafeguardedRootFinder<2>;
+
+}  // namespace ndyn::assembly
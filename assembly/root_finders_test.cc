@@ -0,0 +1,235 @@
+#include "assembly/root_finders.h"
+
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "assembly/concurrent_worldline.h"
+#include "assembly/geometry_test_utils.h"
+#include "assembly/manifold.h"
+#include "assembly/retardation.h"
+#include "assembly/worldline.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+/**
+ * A scalar function with analytic derivatives, for exercising the policies directly.
+ */
+struct AnalyticProblem final {
+  std::function<double(double)> value;
+  std::function<double(double)> first;
+  std::function<double(double)> second;
+  RetardationCounters* counters;
+
+  double operator()(double t) const {
+    ++counters->evaluations;
+    return value(t);
+  }
+
+  LightConeSample<double> with_derivatives(double t) const {
+    ++counters->evaluations;
+    return {value(t), first(t), second(t)};
+  }
+};
+
+template <typename RootFinder>
+class RootFinderTest : public ::testing::Test {};
+
+using RootFinderTypes = ::testing::Types<BrentRootFinder, NewtonRootFinder, HalleyRootFinder>;
+TYPED_TEST_SUITE(RootFinderTest, RootFinderTypes);
+
+TYPED_TEST(RootFinderTest, FindsSimpleRoot) {
+  RetardationCounters counters{};
+  const AnalyticProblem f{[](double t) { return t * t * t - 2; },
+                          [](double t) { return 3 * t * t; }, [](double t) { return 6 * t; },
+                          &counters};
+
+  const double root{TypeParam::find_root(f, 0.0, 4.0, f(0.0), f(4.0), 1e-10, counters)};
+  EXPECT_NEAR(root, std::cbrt(2.0), 1e-9);
+}
+
+/**
+ * Newton's step from the far side of an arctangent overshoots the bracket by a wide margin; the
+ * safeguard must bisect instead and still converge.
+ */
+TYPED_TEST(RootFinderTest, StaysInsideBracket) {
+  RetardationCounters counters{};
+  const auto slope = [](double t) { return 1 / (1 + (t - 0.3) * (t - 0.3)); };
+  const AnalyticProblem f{[](double t) { return std::atan(t - 0.3); }, slope,
+                          [slope](double t) { return -2 * (t - 0.3) * slope(t) * slope(t); },
+                          &counters};
+
+  const double root{TypeParam::find_root(f, -1.0, 20.0, f(-1.0), f(20.0), 1e-10, counters)};
+  EXPECT_NEAR(root, 0.3, 1e-9);
+  EXPECT_LT(counters.iterations, 64u);
+}
+
+/**
+ * Derivatives that are wrong, here of a different function, may slow the safeguarded methods down
+ * but must not stop them converging.
+ */
+TYPED_TEST(RootFinderTest, ConvergesWithInconsistentDerivatives) {
+  RetardationCounters counters{};
+  const AnalyticProblem f{[](double t) { return std::exp(t) - 5; }, [](double) { return -1.0; },
+                          [](double) { return 0.0; }, &counters};
+
+  const double root{TypeParam::find_root(f, 0.0, 3.0, f(0.0), f(3.0), 1e-10, counters)};
+  EXPECT_NEAR(root, std::log(5.0), 1e-9);
+}
+
+/**
+ * The retardation scenarios of manifold_test, solved against a source whose recorded velocity
+ * matches its motion, as the derivative-based policies expect.
+ */
+template <typename Geometry>
+class RetardationRootFinderTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using StateType = math::State<Geometry, 2>;
+  using LightSpeedFunc = std::function<Scalar(Scalar)>;
+  using Trajectory = std::function<void(Scalar, Scalar (&)[3], Scalar (&)[3])>;
+
+  struct Scenario final {
+    std::string name;
+    LightSpeedFunc c_func;
+    Trajectory trajectory;
+    Scalar target_x;
+  };
+
+  static constexpr Scalar STEP{0.1};
+  static constexpr int NUM_SAMPLES{201};
+
+  static std::vector<Scenario> scenarios() {
+    return {
+        // EuclideanDistanceTimeConsistency: a source at rest, with c = 2.
+        {"static", [](Scalar) { return 2.0; },
+         [](Scalar, Scalar(&x)[3], Scalar(&v)[3]) {
+           x[0] = x[1] = x[2] = v[0] = v[1] = v[2] = 0;
+         },
+         10},
+        // SegmentSolveIsExactForUniformMotion: uniform motion away from the target.
+        {"uniform", [](Scalar) { return 1.0; },
+         [](Scalar t, Scalar(&x)[3], Scalar(&v)[3]) {
+           x[0] = -0.5 * t;
+           v[0] = -0.5;
+           x[1] = x[2] = v[1] = v[2] = 0;
+         },
+         5},
+        // An oscillating source, as in the warm-start tests.
+        {"oscillating", [](Scalar) { return 1.0; },
+         [](Scalar t, Scalar(&x)[3], Scalar(&v)[3]) {
+           x[0] = 0.3 * t;
+           x[1] = std::sin(t);
+           v[0] = 0.3;
+           v[1] = std::cos(t);
+           x[2] = v[2] = 0;
+         },
+         5},
+        // ComplexLightSpeedConvergence: a varying speed of light and an off-axis source.
+        {"complex_c", [](Scalar t) { return 5.0 + std::sin(t); },
+         [](Scalar t, Scalar(&x)[3], Scalar(&v)[3]) {
+           x[0] = x[1] = x[2] = 1 + 0.2 * std::cos(t);
+           v[0] = v[1] = v[2] = -0.2 * std::sin(t);
+         },
+         40},
+    };
+  }
+
+  static StateType make_state(const Trajectory& trajectory, Scalar t) {
+    Scalar x[3];
+    Scalar v[3];
+    trajectory(t, x, v);
+    StateType s;
+    s.template set_element<0>(Geometry::translator(x[0], x[1], x[2]) *
+                              Geometry::identity_at_time(t));
+    s.template set_element<1>(Geometry::motor_log(Geometry::translator(v[0], v[1], v[2])));
+    return s;
+  }
+
+  static MV target_at(Scalar t, Scalar x) {
+    return Geometry::translator(x, 0, 0) * Geometry::identity_at_time(t);
+  }
+
+  /**
+   * Solves the scenario for a sweep of target times, returning the retarded times and accumulating
+   * the solver's work in counters.
+   */
+  template <typename RootFinder, template <typename> class SourceWorldline>
+  static std::vector<Scalar> sweep(const Scenario& scenario, RetardationCounters& counters) {
+    Manifold<Geometry, RootFinder> manifold(scenario.c_func);
+    SourceWorldline<Geometry> wl(manifold, 1024);
+    for (int i = 0; i < NUM_SAMPLES; ++i) {
+      wl.record_state(make_state(scenario.trajectory, STEP * i));
+    }
+
+    std::vector<Scalar> t_rets;
+    for (Scalar t = 12.05; t < 20; t += 0.173) {
+      t_rets.push_back(manifold.solve_retardation(wl, target_at(t, scenario.target_x), counters));
+    }
+    return t_rets;
+  }
+};
+
+template <typename Geometry>
+using DenseWorldline = Worldline<Geometry>;
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(RetardationRootFinderTest, GeometryTypes);
+
+/**
+ * Every policy must find the same retarded times, whether the solver brackets the full history or
+ * locates the segment from the samples first.
+ */
+TYPED_TEST(RetardationRootFinderTest, PoliciesAgree) {
+  for (const auto& scenario : this->scenarios()) {
+    RetardationCounters counters{};
+    const auto brent{
+        this->template sweep<BrentRootFinder, ConcurrentWorldline>(scenario, counters)};
+    const auto newton{
+        this->template sweep<NewtonRootFinder, ConcurrentWorldline>(scenario, counters)};
+    const auto halley{
+        this->template sweep<HalleyRootFinder, ConcurrentWorldline>(scenario, counters)};
+    const auto segments{this->template sweep<NewtonRootFinder, DenseWorldline>(scenario, counters)};
+
+    ASSERT_EQ(brent.size(), newton.size());
+    for (size_t i = 0; i < brent.size(); ++i) {
+      EXPECT_NEAR(newton[i], brent[i], 1e-5) << scenario.name << " i: " << i;
+      EXPECT_NEAR(halley[i], brent[i], 1e-5) << scenario.name << " i: " << i;
+      EXPECT_NEAR(segments[i], brent[i], 1e-5) << scenario.name << " i: " << i;
+    }
+  }
+}
+
+/**
+ * Benchmark: evaluations of the light-cone equation needed to reach the solver tolerance, per
+ * policy and scenario. Solving against a ConcurrentWorldline brackets the full history, so the
+ * policy does all of the work.
+ */
+TYPED_TEST(RetardationRootFinderTest, EvaluationsToTolerance) {
+  for (const auto& scenario : this->scenarios()) {
+    RetardationCounters brent{};
+    RetardationCounters newton{};
+    RetardationCounters halley{};
+    this->template sweep<BrentRootFinder, ConcurrentWorldline>(scenario, brent);
+    this->template sweep<NewtonRootFinder, ConcurrentWorldline>(scenario, newton);
+    this->template sweep<HalleyRootFinder, ConcurrentWorldline>(scenario, halley);
+
+    LOG(INFO) << scenario.name << ": evaluations per solve: brent "
+              << static_cast<double>(brent.evaluations) / brent.solves << ", newton "
+              << static_cast<double>(newton.evaluations) / newton.solves << ", halley "
+              << static_cast<double>(halley.evaluations) / halley.solves;
+
+    // With consistent velocities the derivative-based methods converge quadratically or better.
+    EXPECT_LE(newton.evaluations, brent.evaluations) << scenario.name;
+    EXPECT_LE(halley.evaluations, newton.evaluations + newton.solves) << scenario.name;
+  }
+}
+
+}  // namespace ndyn::test
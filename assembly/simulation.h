@@ -0,0 +1,241 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "assembly/assembly.h"
+#include "glog/logging.h"
+
+namespace ndyn::assembly {
+
+/**
+ * A simulation step engine: an Assembly advanced one step at a time, with completed frames handed
+ * to an output stage on its own thread.
+ *
+ * Each step clears the accelerations, lets the caller accumulate new ones from the current world
+ * poses, integrates with Assembly::integrate() and propagates the new world poses. The world poses
+ * do not change while accelerations are accumulated, so every particle's acceleration is computed
+ * from one consistent state however the caller parallelizes it.
+ *
+ * Anything that must see every step, such as recording worldlines for retardation, belongs in the
+ * step's recorder, which runs on the integration thread once the step is complete.
+ *
+ * Output -- writing trajectories, rendering with VulkanRenderer::render_frame() -- runs on the
+ * output thread, which receives copies of completed frames through a bounded queue of recycled
+ * frame buffers. What happens when every buffer is still queued or being output depends on the
+ * overflow policy:
+ *
+ *   Overflow::WAIT  Integration waits for a buffer, and every frame is output. Use this for
+ *                   anything that must see every frame, such as trajectory writers.
+ *   Overflow::DROP  The frame is dropped and counted instead, so integration never waits. Use this
+ *                   only for stages that want the latest frame rather than all of them, such as
+ *                   rendering.
+ *
+ * flush() waits for the queue to drain.
+ */
+template <typename Geometry>
+class Simulation final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+
+  /**
+   * The state of every particle after a step: world poses and velocities, indexed by ParticleId.
+   */
+  struct Frame final {
+    uint64_t step{0};
+    ScalarType time{0};
+    std::vector<Multivector> poses{};
+    std::vector<Multivector> velocities{};
+  };
+
+  using Output = std::function<void(const Frame&)>;
+
+  enum class Overflow {
+    WAIT,
+    DROP,
+  };
+
+  struct Counters final {
+    uint64_t steps{0};
+    // Frames queued for output, frames dropped because the queue was full, and frames output.
+    uint64_t frames_queued{0};
+    uint64_t frames_dropped{0};
+    uint64_t frames_output{0};
+    // Wall time the output thread spent in the output stage, and the integration thread spent
+    // waiting for a free buffer.
+    std::chrono::nanoseconds output_time{0};
+    std::chrono::nanoseconds wait_time{0};
+  };
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  Assembly<Geometry> assembly_;
+  uint64_t step_{0};
+  ScalarType time_;
+
+  Output output_;
+  Overflow overflow_;
+  // Frame buffers for the output stage: free_ holds the indices of idle ones, queued_ those
+  // waiting for output, in step order. All guarded by mutex_, along with counters_.
+  std::vector<Frame> buffers_;
+  std::deque<size_t> free_{};
+  std::deque<size_t> queued_{};
+  bool outputting_{false};
+  bool stopping_{false};
+  std::mutex mutex_{};
+  std::condition_variable queued_cv_{};
+  std::condition_variable drained_cv_{};
+  Counters counters_{};
+  std::thread output_thread_{};
+
+  void output_loop() {
+    std::unique_lock lock{mutex_};
+    while (true) {
+      queued_cv_.wait(lock, [this] { return stopping_ || !queued_.empty(); });
+      if (queued_.empty()) return;
+      const size_t buffer{queued_.front()};
+      queued_.pop_front();
+      outputting_ = true;
+      lock.unlock();
+
+      const auto start{Clock::now()};
+      output_(buffers_[buffer]);
+      const auto elapsed{Clock::now() - start};
+
+      lock.lock();
+      outputting_ = false;
+      free_.push_back(buffer);
+      ++counters_.frames_output;
+      counters_.output_time += elapsed;
+      drained_cv_.notify_all();
+    }
+  }
+
+  // Copies the current state into a free buffer and queues it. When there is none, waits for one
+  // or drops the frame, as the overflow policy says.
+  void publish() {
+    size_t buffer{};
+    {
+      std::unique_lock lock{mutex_};
+      if (free_.empty()) {
+        if (overflow_ == Overflow::DROP) {
+          ++counters_.frames_dropped;
+          return;
+        }
+        const auto start{Clock::now()};
+        drained_cv_.wait(lock, [this] { return !free_.empty(); });
+        counters_.wait_time += Clock::now() - start;
+      }
+      buffer = free_.front();
+      free_.pop_front();
+    }
+    // The buffer belongs to this thread until it is queued; assignment reuses its storage.
+    Frame& frame{buffers_[buffer]};
+    frame.step = step_;
+    frame.time = time_;
+    const auto poses{assembly_.poses().world_poses()};
+    const auto velocities{assembly_.velocities()};
+    frame.poses.assign(poses.begin(), poses.end());
+    frame.velocities.assign(velocities.begin(), velocities.end());
+    {
+      std::lock_guard lock{mutex_};
+      queued_.push_back(buffer);
+      ++counters_.frames_queued;
+    }
+    queued_cv_.notify_one();
+  }
+
+ public:
+  /**
+   * Starts from the given particles at time t0, as step zero. output receives completed frames,
+   * the first being step zero, on the output thread; queue_capacity frames may be waiting for or
+   * in output at once.
+   */
+  Simulation(Assembly<Geometry> assembly, ScalarType t0, Output output,
+             Overflow overflow = Overflow::WAIT, size_t queue_capacity = 4)
+      : assembly_{std::move(assembly)},
+        time_{t0},
+        output_{std::move(output)},
+        overflow_{overflow},
+        buffers_(queue_capacity) {
+    LOG_IF(FATAL, queue_capacity == 0) << "A simulation requires at least one output buffer.";
+    assembly_.update_world_poses();
+    for (size_t buffer = 0; buffer < queue_capacity; ++buffer) {
+      free_.push_back(buffer);
+    }
+    output_thread_ = std::thread{[this] { output_loop(); }};
+    publish();
+  }
+
+  /**
+   * Outputs every queued frame before returning.
+   */
+  ~Simulation() {
+    {
+      std::lock_guard lock{mutex_};
+      stopping_ = true;
+    }
+    queued_cv_.notify_all();
+    output_thread_.join();
+  }
+
+  Simulation(const Simulation&) = delete;
+  Simulation& operator=(const Simulation&) = delete;
+
+  /**
+   * Advances by dt. accelerate(assembly) adds the acceleration of every particle, through
+   * Assembly::accumulate() or add_acceleration(), from the current world poses; it must not change
+   * the poses or velocities. record(assembly, step, time) then sees the completed step on this
+   * thread, before the frame is published.
+   */
+  template <typename Accelerate, typename Record>
+  void step(ScalarType dt, const Accelerate& accelerate, const Record& record) {
+    assembly_.clear_accelerations();
+    accelerate(assembly_);
+    assembly_.integrate(dt);
+    assembly_.update_world_poses();
+    ++step_;
+    time_ += dt;
+    {
+      std::lock_guard lock{mutex_};
+      ++counters_.steps;
+    }
+    record(std::as_const(assembly_), step_, time_);
+    publish();
+  }
+
+  template <typename Accelerate>
+  void step(ScalarType dt, const Accelerate& accelerate) {
+    step(dt, accelerate, [](const Assembly<Geometry>&, uint64_t, ScalarType) {});
+  }
+
+  /**
+   * Waits until every queued frame has been output.
+   */
+  void flush() {
+    std::unique_lock lock{mutex_};
+    drained_cv_.wait(lock, [this] { return queued_.empty() && !outputting_; });
+  }
+
+  const Assembly<Geometry>& assembly() const noexcept { return assembly_; }
+  uint64_t current_step() const noexcept { return step_; }
+  ScalarType time() const noexcept { return time_; }
+  size_t size() const noexcept { return assembly_.size(); }
+
+  Counters counters() {
+    std::lock_guard lock{mutex_};
+    return counters_;
+  }
+};
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,211 @@
+#include "assembly/simulation.h"
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "assembly/assembly.h"
+#include "assembly/geometry_test_utils.h"
+#include "assembly/light_speed.h"
+#include "assembly/manifold.h"
+#include "assembly/root_finders.h"
+#include "assembly/worldline.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class SimulationTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+
+  static constexpr Scalar DT{0.01};
+
+  /**
+   * count particles in pairs, a root and a child, moving apart.
+   */
+  static Assembly<Geometry> particles(size_t count) {
+    Assembly<Geometry> assembly{};
+    for (size_t i = 0; i < count; ++i) {
+      const auto parent{i % 2 == 0 ? Assembly<Geometry>::NO_PARENT : i - 1};
+      const auto particle{assembly.add(parent, Geometry::translator(i, 0.5 * i, 0), MV{1}, i)};
+      assembly.set_velocity(particle,
+                            Geometry::motor_log(Geometry::translator(0.1, -0.2 * i, 0.3)));
+    }
+    return assembly;
+  }
+
+  // A drag on each particle proportional to its velocity.
+  static void drag(Assembly<Geometry>& assembly) {
+    for (size_t i = 0; i < assembly.size(); ++i) {
+      assembly.add_acceleration(i, assembly.velocity(i) * static_cast<Scalar>(-0.5));
+    }
+  }
+
+  static void expect_near(const MV& actual, const MV& expected) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      EXPECT_NEAR(actual.coefficient(i), expected.coefficient(i), 1e-12) << "blade: " << i;
+    }
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(SimulationTest, GeometryTypes);
+
+/**
+ * With room in the queue, every frame reaches the output stage, in order, and matches the same
+ * Assembly stepped in place. The recorder sees every step and records the particles' worldlines.
+ */
+TYPED_TEST(SimulationTest, OutputsEveryFrameInOrder) {
+  using Geometry = TypeParam;
+  using Scalar = typename TestFixture::Scalar;
+  using Frame = typename Simulation<Geometry>::Frame;
+  using StateType = math::State<Geometry, 2>;
+  const size_t count{8};
+  const size_t num_steps{20};
+
+  const Manifold<Geometry, BrentRootFinder, ConstantLightSpeed<Scalar>> manifold{
+      ConstantLightSpeed<Scalar>{1}};
+  std::vector<Worldline<Geometry>> worldlines{};
+  for (size_t i = 0; i < count; ++i) {
+    worldlines.emplace_back(manifold, num_steps + 1);
+  }
+
+  std::vector<Frame> output{};
+  Simulation<Geometry> simulation{this->particles(count), 0,
+                                  [&output](const Frame& frame) { output.push_back(frame); },
+                                  Simulation<Geometry>::Overflow::DROP, num_steps + 1};
+  Assembly<Geometry> expected{this->particles(count)};
+  uint64_t expected_step{0};
+  for (size_t step = 0; step < num_steps; ++step) {
+    simulation.step(
+        this->DT,
+        [&](Assembly<Geometry>& assembly) {
+          EXPECT_EQ(simulation.current_step(), expected_step++);
+          this->drag(assembly);
+        },
+        [&](const Assembly<Geometry>& assembly, uint64_t current_step, Scalar time) {
+          EXPECT_EQ(current_step, expected_step);
+          for (size_t i = 0; i < assembly.size(); ++i) {
+            StateType state{};
+            state.template set_element<0>(assembly.world_pose(i) *
+                                          Geometry::identity_at_time(time));
+            state.template set_element<1>(assembly.velocity(i));
+            worldlines[assembly.worldline(i)].record_state(state);
+          }
+        });
+
+    expected.update_world_poses();
+    expected.clear_accelerations();
+    this->drag(expected);
+    expected.integrate(this->DT);
+  }
+  expected.update_world_poses();
+  simulation.flush();
+
+  ASSERT_EQ(output.size(), num_steps + 1);
+  for (size_t step = 0; step <= num_steps; ++step) {
+    EXPECT_EQ(output[step].step, step);
+  }
+  EXPECT_NEAR(output.back().time, num_steps * this->DT, 1e-12);
+  for (size_t i = 0; i < count; ++i) {
+    this->expect_near(output.back().poses[i], expected.world_pose(i));
+    this->expect_near(output.back().velocities[i], expected.velocity(i));
+    this->expect_near(simulation.assembly().world_pose(i), expected.world_pose(i));
+
+    ASSERT_EQ(worldlines[i].history().size(), num_steps);
+    EXPECT_NEAR(worldlines[i].latest_time(), num_steps * this->DT, 1e-12);
+    this->expect_near(worldlines[i].get_state_at(num_steps * this->DT).template element<1>(),
+                      expected.velocity(i));
+  }
+  const auto counters{simulation.counters()};
+  EXPECT_EQ(counters.steps, num_steps);
+  EXPECT_EQ(counters.frames_output, num_steps + 1);
+  EXPECT_EQ(counters.frames_dropped, 0u);
+}
+
+/**
+ * By default, a full queue holds integration back rather than lose frames: an output stage far
+ * slower than a step still sees every frame, in order.
+ */
+TYPED_TEST(SimulationTest, WaitingOutputIsLossless) {
+  using Geometry = TypeParam;
+  using Frame = typename Simulation<Geometry>::Frame;
+  const size_t count{16};
+  const size_t num_steps{50};
+  const auto output_delay{std::chrono::milliseconds(1)};
+
+  std::vector<uint64_t> output_steps{};
+  {
+    Simulation<Geometry> simulation{this->particles(count), 0,
+                                    [&](const Frame& frame) {
+                                      std::this_thread::sleep_for(output_delay);
+                                      output_steps.push_back(frame.step);
+                                    },
+                                    Simulation<Geometry>::Overflow::WAIT, 2};
+    for (size_t step = 0; step < num_steps; ++step) {
+      simulation.step(this->DT, &TestFixture::drag);
+    }
+    simulation.flush();
+
+    const auto counters{simulation.counters()};
+    EXPECT_EQ(counters.frames_dropped, 0u);
+    EXPECT_EQ(counters.frames_queued, num_steps + 1);
+    EXPECT_EQ(counters.frames_output, num_steps + 1);
+    EXPECT_GT(counters.wait_time.count(), 0);
+  }
+  ASSERT_EQ(output_steps.size(), num_steps + 1);
+  for (size_t i = 0; i < output_steps.size(); ++i) {
+    EXPECT_EQ(output_steps[i], i);
+  }
+}
+
+/**
+ * Benchmark: integration against an output stage far slower than a step, dropping frames. The
+ * steps run at their own pace, and the output stage gets a subset of the frames, still in order.
+ */
+TYPED_TEST(SimulationTest, DroppingOutputDoesNotWait) {
+  using Geometry = TypeParam;
+  using Frame = typename Simulation<Geometry>::Frame;
+  const size_t count{64};
+  const size_t num_steps{100};
+  const auto output_delay{std::chrono::milliseconds(10)};
+
+  std::vector<uint64_t> output_steps{};
+  Simulation<Geometry> simulation{this->particles(count), 0,
+                                  [&](const Frame& frame) {
+                                    std::this_thread::sleep_for(output_delay);
+                                    output_steps.push_back(frame.step);
+                                  },
+                                  Simulation<Geometry>::Overflow::DROP, 2};
+  const auto start{std::chrono::steady_clock::now()};
+  for (size_t step = 0; step < num_steps; ++step) {
+    simulation.step(this->DT, &TestFixture::drag);
+  }
+  const auto elapsed{std::chrono::steady_clock::now() - start};
+  simulation.flush();
+
+  const auto counters{simulation.counters()};
+  LOG(INFO) << num_steps << " steps in "
+            << std::chrono::duration<double, std::milli>(elapsed).count() << " ms; output "
+            << counters.frames_output << " frames in "
+            << std::chrono::duration<double, std::milli>(counters.output_time).count()
+            << " ms, dropped " << counters.frames_dropped;
+  EXPECT_LT(elapsed, output_delay * num_steps / 2);
+  EXPECT_GT(counters.frames_dropped, 0u);
+  EXPECT_EQ(counters.wait_time.count(), 0);
+  EXPECT_EQ(counters.frames_queued + counters.frames_dropped, num_steps + 1);
+  EXPECT_EQ(counters.frames_output, counters.frames_queued);
+  ASSERT_EQ(output_steps.size(), counters.frames_output);
+  for (size_t i = 1; i < output_steps.size(); ++i) {
+    EXPECT_LT(output_steps[i - 1], output_steps[i]);
+  }
+}
+
+}  // namespace ndyn::test
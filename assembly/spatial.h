@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include "assembly/field.h"
+#include "glog/logging.h"
+#include "math/geometry_model.h"
+
+namespace ndyn::assembly {
+
+/**
+ * Euclidean coordinates of a position in space, for the spatial data structures that partition
+ * particles by where they are.
+ */
+template <typename ScalarType>
+using SpatialPoint = std::array<ScalarType, 3>;
+
+/**
+ * The position of a pose: the image of the origin under it. Geometries that provide the image in
+ * closed form skip the two full geometric products of the sandwich.
+ */
+template <typename Geometry>
+typename Geometry::Multivector origin_image(const typename Geometry::Multivector& pose) {
+  if constexpr (math::HasOriginImage<Geometry>) {
+    return Geometry::extract_origin_image(pose);
+  } else {
+    return pose * Geometry::origin() * ~pose;
+  }
+}
+
+/**
+ * The spatial coordinates of a position. Geometry::extract_point() yields one coordinate per
+ * physical dimension, time first when time is one of them; the last three are the spatial ones.
+ */
+template <typename Geometry>
+SpatialPoint<typename Geometry::ScalarType> spatial_coordinates(
+    const typename Geometry::Multivector& position) {
+  using ScalarType = typename Geometry::ScalarType;
+  static constexpr size_t N{Geometry::NUM_PHYSICAL_DIMENSIONS};
+  static_assert(N >= 3, "Spatial coordinates require at least three spatial dimensions.");
+
+  std::array<ScalarType, N> coordinates{};
+  std::apply([&position](auto&... out) { Geometry::extract_point(position, out...); },
+             coordinates);
+  return {coordinates[N - 3], coordinates[N - 2], coordinates[N - 1]};
+}
+
+/**
+ * The spatial coordinates of each pose's position.
+ */
+template <typename Geometry>
+void spatial_positions(std::span<const typename Geometry::Multivector> poses,
+                       std::span<SpatialPoint<typename Geometry::ScalarType>> points) {
+  LOG_IF(FATAL, poses.size() != points.size()) << "Spatial positions require one point per pose.";
+  std::transform(poses.begin(), poses.end(), points.begin(), [](const auto& pose) {
+    return spatial_coordinates<Geometry>(origin_image<Geometry>(pose));
+  });
+}
+
+template <typename ScalarType>
+ScalarType squared_distance(const SpatialPoint<ScalarType>& a,
+                            const SpatialPoint<ScalarType>& b) noexcept {
+  ScalarType result{0};
+  for (size_t i = 0; i < 3; ++i) {
+    result += (a[i] - b[i]) * (a[i] - b[i]);
+  }
+  return result;
+}
+
+/**
+ * Point sources of a field.
+ *
+ * A Field describes the field of a source at the origin: evaluate_at(event, coupling) is the
+ * acceleration of a target at the event. For many sources, each source s at position p_s with
+ * coupling Q_s acts on a target with world pose X and coupling Q through
+ *
+ *   field.evaluate_at(translator(-p_s) * X, Q_s * Q)
+ *
+ * that is, at the target's pose as seen from an unrotated frame at the source, with the product of
+ * the two couplings. The result is linear in Q_s, which is what lets the hierarchical methods treat
+ * a distant cluster of sources as one source with their summed coupling.
+ *
+ * source_frame_event() is that event, and source_interaction() the single evaluation.
+ */
+template <typename Geometry>
+typename Geometry::Multivector source_frame_event(
+    const SpatialPoint<typename Geometry::ScalarType>& source,
+    const typename Geometry::Multivector& target_pose) noexcept {
+  return Geometry::translator(-source[0], -source[1], -source[2]) * target_pose;
+}
+
+template <typename Geometry, BatchField<Geometry> FieldType>
+typename Geometry::Multivector source_interaction(
+    const FieldType& field, const SpatialPoint<typename Geometry::ScalarType>& source,
+    const typename Geometry::Multivector& source_coupling,
+    const typename Geometry::Multivector& target_pose,
+    const typename Geometry::Multivector& target_coupling) noexcept {
+  return field.evaluate_at(source_frame_event<Geometry>(source, target_pose),
+                           source_coupling * target_coupling);
+}
+
+/**
+ * Source interactions gathered for one call to Field::evaluate_batch(): add() the interactions on a
+ * target, then sum() evaluates them together and returns their total. Keep one per thread and reuse
+ * it, so that its buffers are allocated once.
+ */
+template <typename Geometry>
+class InteractionBatch final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+
+ private:
+  std::vector<Multivector> events_{};
+  std::vector<Multivector> couplings_{};
+  std::vector<Multivector> accelerations_{};
+
+ public:
+  void add(const SpatialPoint<typename Geometry::ScalarType>& source,
+           const Multivector& source_coupling, const Multivector& target_pose,
+           const Multivector& target_coupling) {
+    events_.push_back(source_frame_event<Geometry>(source, target_pose));
+    couplings_.push_back(source_coupling * target_coupling);
+  }
+
+  /**
+   * The total acceleration of the gathered interactions. Empties the batch.
+   */
+  template <BatchField<Geometry> FieldType>
+  Multivector sum(const FieldType& field) {
+    accelerations_.resize(events_.size());
+    field.evaluate_batch(events_, couplings_, std::span<Multivector>{accelerations_});
+    Multivector result{};
+    for (const Multivector& acceleration : accelerations_) {
+      result += acceleration;
+    }
+    clear();
+    return result;
+  }
+
+  void clear() noexcept {
+    events_.clear();
+    couplings_.clear();
+  }
+
+  size_t size() const noexcept { return events_.size(); }
+};
+
+/**
+ * The exact pairwise sum: adds to each particle's acceleration the interaction with every other
+ * particle as a source. Quadratic in the number of particles; the reference the approximate methods
+ * are measured against.
+ */
+template <typename Geometry, BatchField<Geometry> FieldType>
+void accumulate_pairwise(const FieldType& field,
+                         std::span<const SpatialPoint<typename Geometry::ScalarType>> positions,
+                         std::span<const typename Geometry::Multivector> poses,
+                         std::span<const typename Geometry::Multivector> couplings,
+                         std::span<typename Geometry::Multivector> accelerations) {
+  LOG_IF(FATAL, positions.size() != poses.size() || couplings.size() != poses.size() ||
+                    accelerations.size() != poses.size())
+      << "Pairwise accumulation requires one position, coupling and acceleration per pose.";
+  InteractionBatch<Geometry> batch{};
+  for (size_t target = 0; target < poses.size(); ++target) {
+    for (size_t source = 0; source < poses.size(); ++source) {
+      if (source == target) continue;
+      batch.add(positions[source], couplings[source], poses[target], couplings[target]);
+    }
+    accelerations[target] += batch.sum(field);
+  }
+}
+
+}  // namespace ndyn::assembly
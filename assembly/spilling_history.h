@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include "glog/logging.h"
+#include "io/mapped_file.h"
+#include "math/state.h"
+
+namespace ndyn::assembly {
+
+/**
+ * A two-tier history that never discards samples.
+ *
+ * The most recent samples live in an in-memory hot tier of fixed capacity. When the hot tier fills,
+ * Worldline calls spill(), which moves its older half to an append-only, memory-mapped file. Cold
+ * samples are read in place from the mapping, so paging them back in costs no read() calls or
+ * intermediate buffers; the OS keeps recently used pages resident.
+ *
+ * Each cold record is the sample time followed by every coefficient of both state elements, padded
+ * to a multiple of 8 bytes; see io::AppendOnlyMappedFile for the file header. A sparse index holds
+ * the time of every INDEX_STRIDE-th cold record, so a lookup binary searches the index in memory
+ * and then touches at most one stride of the mapping.
+ *
+ * Indices span both tiers: cold samples first, then hot ones. capacity() reports the cold size plus
+ * the hot capacity, so size() == capacity() exactly when the hot tier is full. The file is left in
+ * place when the history is destroyed so that it can be analysed after the run.
+ *
+ * Selected as, for example:
+ *
+ *   Worldline<Geometry, SpillingHistory<Geometry>> wl{manifold, 4096, "/scratch/particle7.wl"};
+ */
+template <typename Geometry, size_t INDEX_STRIDE = 64>
+class SpillingHistory final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+
+  static_assert(INDEX_STRIDE > 0, "Index stride must be positive.");
+
+ private:
+  static constexpr size_t NUM_BLADES{Geometry::Algebra::NUM_BASIS_BLADES};
+
+  // Time, then element 0, then element 1, rounded up to a whole number of 8-byte words.
+  static constexpr size_t RECORD_WORDS{((1 + 2 * NUM_BLADES) * sizeof(ScalarType) + 7) / 8 * 8 /
+                                       sizeof(ScalarType)};
+  using Record = std::array<ScalarType, RECORD_WORDS>;
+
+  std::vector<StateType> hot_{};
+  size_t hot_capacity_;
+
+  io::AppendOnlyMappedFile cold_;
+  std::vector<ScalarType> cold_index_{};
+
+  static ScalarType time_of(const StateType& state) noexcept {
+    return Geometry::extract_time(state.template element<0>());
+  }
+
+  const ScalarType* cold_record(size_t index) const noexcept {
+    return reinterpret_cast<const ScalarType*>(cold_.record(index));
+  }
+
+  StateType decode(const ScalarType* record) const noexcept {
+    Multivector pose{};
+    Multivector velocity{};
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      pose.set_coefficient(i, record[1 + i]);
+      velocity.set_coefficient(i, record[1 + NUM_BLADES + i]);
+    }
+    StateType result{};
+    result.template set_element<0>(pose);
+    result.template set_element<1>(velocity);
+    return result;
+  }
+
+  static Record encode(const StateType& state) noexcept {
+    Record record{};
+    record[0] = time_of(state);
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      record[1 + i] = state.template element<0>().coefficient(i);
+      record[1 + NUM_BLADES + i] = state.template element<1>().coefficient(i);
+    }
+    return record;
+  }
+
+  size_t cold_lower_bound(ScalarType t) const noexcept {
+    // The first index entry with time >= t bounds the answer from above; the entry before it bounds
+    // it from below. Only the records between the two are read from the mapping.
+    const size_t entry{static_cast<size_t>(
+        std::lower_bound(cold_index_.begin(), cold_index_.end(), t) - cold_index_.begin())};
+    size_t lower{entry == 0 ? 0 : (entry - 1) * INDEX_STRIDE};
+    size_t upper{std::min(entry * INDEX_STRIDE, cold_.size())};
+    while (lower < upper) {
+      const size_t middle{lower + (upper - lower) / 2};
+      if (cold_record(middle)[0] < t) {
+        lower = middle + 1;
+      } else {
+        upper = middle;
+      }
+    }
+    return lower;
+  }
+
+ public:
+  /**
+   * hot_capacity is the number of samples kept in memory. Cold samples are spilled to path, which
+   * is created or truncated.
+   */
+  SpillingHistory(size_t hot_capacity, const std::filesystem::path& path)
+      : hot_capacity_{hot_capacity}, cold_{path, sizeof(Record)} {
+    LOG_IF(FATAL, hot_capacity < 2) << "Spilling history requires a hot tier of at least two.";
+    hot_.reserve(hot_capacity);
+  }
+
+  size_t size() const noexcept { return cold_.size() + hot_.size(); }
+  size_t capacity() const noexcept { return cold_.size() + hot_capacity_; }
+  bool empty() const noexcept { return size() == 0; }
+
+  size_t cold_size() const noexcept { return cold_.size(); }
+  size_t hot_size() const noexcept { return hot_.size(); }
+  const std::filesystem::path& path() const noexcept { return cold_.path(); }
+
+  ScalarType time(size_t index) const noexcept {
+    if (index < cold_.size()) return cold_record(index)[0];
+    return time_of(hot_[index - cold_.size()]);
+  }
+
+  StateType state(size_t index) const noexcept {
+    if (index < cold_.size()) return decode(cold_record(index));
+    return hot_[index - cold_.size()];
+  }
+
+  size_t lower_bound(ScalarType t) const noexcept {
+    if (cold_.empty() || (!hot_.empty() && time_of(hot_.front()) < t)) {
+      const auto it = std::lower_bound(
+          hot_.begin(), hot_.end(), t,
+          [](const StateType& s, ScalarType value) { return time_of(s) < value; });
+      return cold_.size() + static_cast<size_t>(it - hot_.begin());
+    }
+    return cold_lower_bound(t);
+  }
+
+  void push_back(const StateType& state) noexcept { hot_.push_back(state); }
+
+  /**
+   * Moves the older half of the hot tier to the cold file. Throws if the file cannot be extended,
+   * leaving both tiers unchanged.
+   */
+  void spill() {
+    const size_t count{std::max<size_t>(1, hot_.size() / 2)};
+
+    std::vector<Record> records{};
+    records.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      records.push_back(encode(hot_[i]));
+    }
+
+    const size_t first{cold_.size()};
+    cold_.append(records.data(), records.size());
+    for (size_t i = first; i < cold_.size(); ++i) {
+      if (i % INDEX_STRIDE == 0) {
+        cold_index_.push_back(records[i - first][0]);
+      }
+    }
+
+    hot_.erase(hot_.begin(), hot_.begin() + static_cast<std::ptrdiff_t>(count));
+  }
+};
+
+}  // namespace ndyn::assembly
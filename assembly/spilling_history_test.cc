@@ -0,0 +1,205 @@
+#include "assembly/spilling_history.h"
+
+#include <sys/resource.h>
+
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#include "assembly/geometry_test_utils.h"
+#include "assembly/manifold.h"
+#include "assembly/worldline.h"
+#include "gtest/gtest.h"
+#include "io/mapped_file.h"
+#include "io/utils.h"
+#include "testing/test_temp_directory.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class SpillingHistoryTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using StateType = math::State<Geometry, 2>;
+
+  std::filesystem::path directory_{
+      ndyn::testing::TestTempDirectory::getInstance()->createTestSubdirectory()};
+
+  auto constant_c(Scalar value) {
+    return [value](Scalar /*time*/) { return value; };
+  }
+
+  StateType make_state(Scalar t) {
+    StateType s;
+    s.template set_element<0>(Geometry::translator(2 * t, std::sin(t), 0) *
+                              Geometry::identity_at_time(t));
+    s.template set_element<1>(Geometry::bivector_xy(std::cos(t)));
+    return s;
+  }
+
+  static bool equal(const StateType& lhs, const StateType& rhs) {
+    for (size_t i = 0; i < Geometry::Algebra::NUM_BASIS_BLADES; ++i) {
+      if (lhs.template element<0>().coefficient(i) != rhs.template element<0>().coefficient(i) ||
+          lhs.template element<1>().coefficient(i) != rhs.template element<1>().coefficient(i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(SpillingHistoryTest, GeometryTypes);
+
+/**
+ * With fast light a bounded Worldline would prune almost everything; the spilling one must keep
+ * every sample, bit for bit, and interpolate exactly like an unbounded in-memory Worldline.
+ */
+TYPED_TEST(SpillingHistoryTest, RetainsFullHistory) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(4000));
+  Worldline<Geometry> reference(manifold, 1024);
+  Worldline<Geometry, SpillingHistory<Geometry>> spilling(manifold, 16,
+                                                          this->directory_ / "retains.wl");
+
+  for (int i = 0; i < 500; ++i) {
+    reference.record_state(this->make_state(0.1 * i));
+    spilling.record_state(this->make_state(0.1 * i));
+  }
+
+  const auto& history{spilling.history()};
+  ASSERT_EQ(history.size(), 500u);
+  EXPECT_GT(history.cold_size(), 0u);
+  EXPECT_LE(history.hot_size(), 16u);
+  EXPECT_EQ(reference.oldest_time(), spilling.oldest_time());
+  EXPECT_EQ(reference.latest_time(), spilling.latest_time());
+
+  for (int i = 0; i < 500; ++i) {
+    EXPECT_TRUE(this->equal(history.state(i), this->make_state(0.1 * i))) << "i: " << i;
+  }
+  for (double t = 0.05; t < 50; t += 0.37) {
+    EXPECT_TRUE(this->equal(reference.get_state_at(t), spilling.get_state_at(t))) << "t: " << t;
+  }
+}
+
+/**
+ * A spill that cannot extend its file throws out of record_state(), and loses nothing already
+ * recorded. The file size limit makes extending the file fail.
+ */
+TYPED_TEST(SpillingHistoryTest, SpillFailuresPropagate) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(4000));
+  const auto path{this->directory_ / "limited.wl"};
+  Worldline<Geometry, SpillingHistory<Geometry>> spilling(manifold, 16, path);
+  static_assert(!noexcept(spilling.record_state(this->make_state(0))));
+  const auto& history{spilling.history()};
+
+  rlimit original{};
+  ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &original), 0);
+  const auto previous_handler{std::signal(SIGXFSZ, SIG_IGN)};
+  rlimit limited{original};
+  limited.rlim_cur = std::filesystem::file_size(path);
+  ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &limited), 0);
+
+  // Record until a spill needs more file than the limit allows.
+  size_t recorded{0};
+  bool threw{false};
+  while (!threw && recorded < 10000) {
+    try {
+      spilling.record_state(this->make_state(0.1 * recorded));
+      ++recorded;
+    } catch (const std::runtime_error&) {
+      threw = true;
+    }
+  }
+
+  ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &original), 0);
+  std::signal(SIGXFSZ, previous_handler);
+
+  EXPECT_TRUE(threw);
+  ASSERT_EQ(history.size(), recorded);
+  for (size_t j = 0; j < recorded; ++j) {
+    EXPECT_TRUE(this->equal(history.state(j), this->make_state(0.1 * j))) << "j: " << j;
+  }
+
+  // Once the file can grow again, so does the history.
+  for (size_t j = recorded; j < recorded + 100; ++j) {
+    spilling.record_state(this->make_state(0.1 * j));
+  }
+  EXPECT_EQ(history.size(), recorded + 100);
+  EXPECT_TRUE(this->equal(history.state(recorded), this->make_state(0.1 * recorded)));
+}
+
+/**
+ * The sparse index must lead to the same sample as a full search, on both sides of every index
+ * entry and across the boundary between the tiers.
+ */
+TYPED_TEST(SpillingHistoryTest, LowerBoundAgreesWithDense) {
+  using Geometry = TypeParam;
+  DenseHistory<Geometry> dense(512);
+  SpillingHistory<Geometry, 8> spilling(64, this->directory_ / "lower_bound.wl");
+
+  for (int i = 0; i < 300; ++i) {
+    if (spilling.size() == spilling.capacity()) {
+      spilling.spill();
+    }
+    dense.push_back(this->make_state(0.1 * i));
+    spilling.push_back(this->make_state(0.1 * i));
+  }
+
+  ASSERT_GT(spilling.cold_size(), 8u);
+  for (double t = -1; t < 31; t += 0.025) {
+    EXPECT_EQ(dense.lower_bound(t), spilling.lower_bound(t)) << "t: " << t;
+  }
+}
+
+/**
+ * The spilled file must be self-describing: a header with the record count, then fixed-stride
+ * records beginning with the sample time.
+ */
+TYPED_TEST(SpillingHistoryTest, FileHasFixedStrideLayout) {
+  using Geometry = TypeParam;
+  using Scalar = typename Geometry::ScalarType;
+  const auto path{this->directory_ / "layout.wl"};
+
+  size_t cold_size{};
+  {
+    SpillingHistory<Geometry> spilling(32, path);
+    for (int i = 0; i < 100; ++i) {
+      if (spilling.size() == spilling.capacity()) {
+        spilling.spill();
+      }
+      spilling.push_back(this->make_state(0.5 * i));
+    }
+    cold_size = spilling.cold_size();
+  }
+
+  const std::string contents{io::read_file(path)};
+  ASSERT_GE(contents.size(), io::AppendOnlyMappedFile::HEADER_SIZE);
+
+  uint32_t record_size{};
+  uint64_t record_count{};
+  std::memcpy(&record_size, contents.data() + 12, sizeof(record_size));
+  std::memcpy(&record_count, contents.data() + 16, sizeof(record_count));
+
+  EXPECT_EQ(0, contents.compare(0, 7, "NDYNREC"));
+  EXPECT_EQ(record_count, cold_size);
+  EXPECT_EQ(contents.size(), io::AppendOnlyMappedFile::HEADER_SIZE + record_count * record_size);
+
+  for (size_t i = 0; i < record_count; ++i) {
+    Scalar time{};
+    std::memcpy(&time, contents.data() + io::AppendOnlyMappedFile::HEADER_SIZE + i * record_size,
+                sizeof(time));
+    EXPECT_EQ(time, Geometry::extract_time(this->make_state(0.5 * i).template element<0>()));
+  }
+}
+
+}  // namespace ndyn::test
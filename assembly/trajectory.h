@@ -0,0 +1,284 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "base/bits.h"
+#include "glog/logging.h"
+#include "io/trajectory.h"
+#include "math/state.h"
+
+namespace ndyn::assembly {
+
+/**
+ * The record of a particle's state in a trajectory file: only the blades that can be non-zero,
+ * the even grades of the pose, a motor, and grade two of the velocity, a bivector, as
+ * QuantizedHistory keeps. The layout's encoding words identify the algebra by its signature, and
+ * the record, so that a trajectory only decodes with the geometry it was written from, not merely
+ * one with as many blades.
+ */
+template <typename Geometry>
+class TrajectoryCodec final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+
+ private:
+  using Algebra = typename Geometry::Algebra;
+
+  static constexpr size_t NUM_BLADES{Algebra::NUM_BASIS_BLADES};
+
+  static constexpr bool is_pose_blade(size_t blade) { return bit_count(blade) % 2 == 0; }
+  static constexpr bool is_velocity_blade(size_t blade) { return bit_count(blade) == 2; }
+
+  static constexpr size_t count_blades(bool (*keep)(size_t)) {
+    size_t count{0};
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      if (keep(i)) ++count;
+    }
+    return count;
+  }
+
+ public:
+  static constexpr size_t NUM_POSE_BLADES{count_blades(&is_pose_blade)};
+  static constexpr size_t NUM_VELOCITY_BLADES{count_blades(&is_velocity_blade)};
+  static constexpr size_t RECORD_SIZE{(NUM_POSE_BLADES + NUM_VELOCITY_BLADES) * sizeof(ScalarType)};
+
+  // Chunks are sized to about this many bytes of records, so that the writer's buffers stay
+  // bounded however many particles there are.
+  static constexpr size_t TARGET_CHUNK_SIZE{size_t{16} << 20};
+  static constexpr uint32_t MAX_FRAMES_PER_CHUNK{64};
+
+ private:
+  static constexpr std::array<size_t, NUM_POSE_BLADES + NUM_VELOCITY_BLADES> KEPT_BLADES = []() {
+    std::array<size_t, NUM_POSE_BLADES + NUM_VELOCITY_BLADES> result{};
+    size_t next{0};
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      if (is_pose_blade(i)) result[next++] = i;
+    }
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      if (is_velocity_blade(i)) result[next++] = i;
+    }
+    return result;
+  }();
+
+  // The numbers of positive, negative and zero bases, 16 bits each.
+  static constexpr uint64_t SIGNATURE{uint64_t{Algebra::NUM_POSITIVE_BASES} |
+                                      uint64_t{Algebra::NUM_NEGATIVE_BASES} << 16 |
+                                      uint64_t{Algebra::NUM_ZERO_BASES} << 32};
+
+  static constexpr std::array<uint64_t, 4> ENCODING{SIGNATURE, sizeof(ScalarType),
+                                                    NUM_POSE_BLADES, NUM_VELOCITY_BLADES};
+
+  // Whether the blades a record drops are all zero, as they are for a motor and a bivector.
+  static bool is_encodable(const Multivector& pose, const Multivector& velocity) noexcept {
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      if ((!is_pose_blade(i) && pose.coefficient(i) != 0) ||
+          (!is_velocity_blade(i) && velocity.coefficient(i) != 0)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ public:
+  static io::TrajectoryLayout layout(size_t num_particles, size_t particles_per_block = 4096) {
+    io::TrajectoryLayout result{};
+    result.num_particles = num_particles;
+    result.record_size = RECORD_SIZE;
+    result.particles_per_block = particles_per_block;
+    result.frames_per_chunk = static_cast<uint32_t>(std::clamp<size_t>(
+        TARGET_CHUNK_SIZE / std::max<size_t>(1, num_particles * RECORD_SIZE), 1,
+        MAX_FRAMES_PER_CHUNK));
+    result.encoding = ENCODING;
+    return result;
+  }
+
+  /**
+   * Whether the records of a trajectory with this layout are this codec's.
+   */
+  static bool matches(const io::TrajectoryLayout& layout) noexcept {
+    return layout.record_size == RECORD_SIZE && layout.encoding == ENCODING;
+  }
+
+  /**
+   * Encodes the poses and velocities of consecutive particles into their records. The records
+   * keep only the even grades of a pose and grade two of a velocity; any other coefficient is
+   * fatal rather than silently lost.
+   */
+  static void encode(std::span<const Multivector> poses, std::span<const Multivector> velocities,
+                     std::span<std::byte> records) noexcept {
+    std::byte* next{records.data()};
+    for (size_t particle = 0; particle < poses.size(); ++particle) {
+      LOG_IF(FATAL, !is_encodable(poses[particle], velocities[particle]))
+          << "Trajectory records hold only motor poses and bivector velocities. Particle: "
+          << particle;
+      for (size_t i = 0; i < KEPT_BLADES.size(); ++i) {
+        const Multivector& element{i < NUM_POSE_BLADES ? poses[particle] : velocities[particle]};
+        const ScalarType value{element.coefficient(KEPT_BLADES[i])};
+        std::memcpy(next, &value, sizeof(value));
+        next += sizeof(value);
+      }
+    }
+  }
+
+  /**
+   * Decodes consecutive records into states, pose first and velocity second.
+   */
+  static void decode(std::span<const std::byte> records, std::span<StateType> states) noexcept {
+    const std::byte* next{records.data()};
+    for (StateType& state : states) {
+      Multivector pose{};
+      Multivector velocity{};
+      for (size_t i = 0; i < KEPT_BLADES.size(); ++i) {
+        ScalarType value;
+        std::memcpy(&value, next, sizeof(value));
+        next += sizeof(value);
+        (i < NUM_POSE_BLADES ? pose : velocity).set_coefficient(KEPT_BLADES[i], value);
+      }
+      state.template set_element<0>(pose);
+      state.template set_element<1>(velocity);
+    }
+  }
+};
+
+/**
+ * Records every step of a simulation to a compressed trajectory file. record() encodes the frame
+ * and hands it to an io::TrajectoryWriter, which deflates and writes on its own thread.
+ */
+template <typename Geometry>
+class TrajectoryRecorder final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using Codec = TrajectoryCodec<Geometry>;
+
+ private:
+  io::TrajectoryWriter writer_;
+  std::vector<std::byte> frame_{};
+
+ public:
+  TrajectoryRecorder(std::filesystem::path path, size_t num_particles, int compression_level = 1)
+      : writer_{std::move(path), Codec::layout(num_particles), compression_level},
+        frame_(writer_.layout().frame_size()) {}
+
+  void record(ScalarType time, std::span<const Multivector> poses,
+              std::span<const Multivector> velocities) {
+    LOG_IF(FATAL, poses.size() != writer_.layout().num_particles ||
+                      velocities.size() != poses.size())
+        << "Trajectory frames require a pose and a velocity for every particle.";
+    Codec::encode(poses, velocities, frame_);
+    writer_.append(static_cast<double>(time), frame_);
+  }
+
+  void close() { writer_.close(); }
+
+  io::TrajectoryWriter& writer() noexcept { return writer_; }
+};
+
+/**
+ * Reads the states of particles in frames of a trajectory written by TrajectoryRecorder: a whole
+ * frame, or any range of particles over any range of frames, inflating only what is asked for.
+ */
+template <typename Geometry>
+class TrajectoryPlayback final {
+ public:
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+  using Codec = TrajectoryCodec<Geometry>;
+
+ private:
+  io::TrajectoryReader reader_;
+
+ public:
+  explicit TrajectoryPlayback(std::filesystem::path path) : reader_{std::move(path)} {
+    if (!Codec::matches(reader_.layout())) {
+      LOG(WARNING) << "Trajectory is from another geometry. File: '" << reader_.path() << "'";
+      throw std::runtime_error("Trajectory is from another geometry.");
+    }
+  }
+
+  size_t size() const noexcept { return reader_.size(); }
+  size_t num_particles() const noexcept { return reader_.layout().num_particles; }
+  ScalarType time(size_t frame) const noexcept { return reader_.time(frame); }
+  size_t frame_at(ScalarType t) const noexcept { return reader_.frame_at(t); }
+
+  /**
+   * The frames with times in [from, to], as the first frame and the number of frames.
+   */
+  std::pair<size_t, size_t> frames_between(ScalarType from, ScalarType to) const noexcept {
+    return reader_.frames_between(from, to);
+  }
+
+  void read(size_t frame, std::span<StateType> states) const {
+    LOG_IF(FATAL, states.size() != num_particles())
+        << "Trajectory frames hold " << num_particles() << " states, not " << states.size() << ".";
+    read(frame, 1, 0, states);
+  }
+
+  /**
+   * Reads the states of states.size() / num_frames particles from first_particle, for num_frames
+   * frames from first_frame, frame after frame.
+   */
+  void read(size_t first_frame, size_t num_frames, size_t first_particle,
+            std::span<StateType> states) const {
+    LOG_IF(FATAL, num_frames == 0 || states.size() % num_frames != 0)
+        << "Trajectory reads of " << num_frames << " frames cannot fill " << states.size()
+        << " states.";
+    std::vector<std::byte> records(states.size() * Codec::RECORD_SIZE);
+    reader_.read(first_frame, num_frames, first_particle, states.size() / num_frames, records);
+    Codec::decode(records, states);
+  }
+
+  const io::TrajectoryReader& reader() const noexcept { return reader_; }
+};
+
+/**
+ * Plays a range of particles back frame by frame, from a TrajectoryPlayback that must outlive it,
+ * with the next chunk inflated on a background thread, for a renderer to upload states() each
+ * frame.
+ */
+template <typename Geometry>
+class TrajectoryStream final {
+ public:
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+  using Codec = TrajectoryCodec<Geometry>;
+
+ private:
+  io::TrajectoryPrefetcher frames_;
+  std::vector<StateType> states_;
+
+  void decode() {
+    if (!frames_.done()) Codec::decode(frames_.records(), states_);
+  }
+
+ public:
+  TrajectoryStream(const TrajectoryPlayback<Geometry>& playback, size_t first_particle,
+                   size_t num_particles, size_t first_frame = 0)
+      : frames_{playback.reader(), first_particle, num_particles, first_frame},
+        states_(num_particles) {
+    decode();
+  }
+
+  bool done() const noexcept { return frames_.done(); }
+  size_t frame() const noexcept { return frames_.frame(); }
+  ScalarType time() const noexcept { return frames_.time(); }
+  std::span<const StateType> states() const noexcept { return states_; }
+
+  void advance() {
+    frames_.advance();
+    decode();
+  }
+};
+
+}  // namespace ndyn::assembly
@@ -0,0 +1,260 @@
+#include "assembly/trajectory.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "assembly/geometry_test_utils.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "testing/test_temp_directory.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class TrajectoryTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using StateType = math::State<Geometry, 2>;
+
+  std::filesystem::path directory_{
+      ndyn::testing::TestTempDirectory::getInstance()->createTestSubdirectory()};
+
+  static MV pose(size_t particle, Scalar t) {
+    return Geometry::translator(std::sin(t + particle), 0.5 * particle, t) *
+           Geometry::identity_at_time(t);
+  }
+
+  static MV velocity(size_t particle, Scalar t) {
+    return Geometry::bivector_xy(std::cos(t * particle));
+  }
+
+  // Records num_frames frames of count particles, at times 0.1 apart.
+  void record(const std::filesystem::path& path, size_t count, size_t num_frames) {
+    TrajectoryRecorder<Geometry> recorder{path, count};
+    std::vector<MV> poses(count);
+    std::vector<MV> velocities(count);
+    for (size_t frame = 0; frame < num_frames; ++frame) {
+      const Scalar t{static_cast<Scalar>(0.1 * frame)};
+      for (size_t i = 0; i < count; ++i) {
+        poses[i] = pose(i, t);
+        velocities[i] = velocity(i, t);
+      }
+      recorder.record(t, poses, velocities);
+    }
+  }
+
+  static void expect_equal(const MV& actual, const MV& expected) {
+    for (size_t i = 0; i < MV::NUM_BASIS_BLADES; ++i) {
+      EXPECT_EQ(actual.coefficient(i), expected.coefficient(i)) << "blade: " << i;
+    }
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(TrajectoryTest, GeometryTypes);
+
+/**
+ * Every frame reads back exactly, in any order, from the blades the codec keeps.
+ */
+TYPED_TEST(TrajectoryTest, RoundTripsFrames) {
+  using Geometry = TypeParam;
+  using StateType = typename TestFixture::StateType;
+  const size_t count{500};
+  const size_t num_frames{40};
+  const auto path{this->directory_ / "frames"};
+  this->record(path, count, num_frames);
+
+  TrajectoryPlayback<Geometry> playback{path};
+  ASSERT_EQ(playback.size(), num_frames);
+  ASSERT_EQ(playback.num_particles(), count);
+  std::vector<StateType> states(count);
+  for (const size_t frame : {0, 39, 17, 18, 3}) {
+    playback.read(frame, states);
+    const auto t{playback.time(frame)};
+    EXPECT_EQ(t, static_cast<typename TestFixture::Scalar>(0.1 * frame));
+    for (size_t i = 0; i < count; ++i) {
+      this->expect_equal(states[i].template element<0>(), this->pose(i, t));
+      this->expect_equal(states[i].template element<1>(), this->velocity(i, t));
+    }
+  }
+}
+
+/**
+ * frame_at() finds the last frame at or before a time, clamping to the ends.
+ */
+TYPED_TEST(TrajectoryTest, SeeksByTime) {
+  using Geometry = TypeParam;
+  const auto path{this->directory_ / "seek"};
+  this->record(path, 10, 100);
+
+  TrajectoryPlayback<Geometry> playback{path};
+  EXPECT_EQ(playback.frame_at(-1), 0u);
+  EXPECT_EQ(playback.frame_at(0), 0u);
+  EXPECT_EQ(playback.frame_at(0.05), 0u);
+  EXPECT_EQ(playback.frame_at(4.25), 42u);
+  EXPECT_EQ(playback.frame_at(playback.time(63)), 63u);
+  EXPECT_EQ(playback.frame_at(1e6), 99u);
+}
+
+/**
+ * Ranges of particles over ranges of frames, crossing chunks and blocks, read the same states as
+ * whole frames.
+ */
+TYPED_TEST(TrajectoryTest, ReadsParticleAndFrameRanges) {
+  using Geometry = TypeParam;
+  using StateType = typename TestFixture::StateType;
+  const size_t count{10000};
+  const size_t num_frames{30};
+  const auto path{this->directory_ / "ranges"};
+  this->record(path, count, num_frames);
+
+  const TrajectoryPlayback<Geometry> playback{path};
+  ASSERT_GT(playback.reader().frames_in_chunk_from(0), 0u);
+  const auto [first_frame, frames]{playback.frames_between(0.65, 2.05)};
+  EXPECT_EQ(first_frame, 7u);
+  EXPECT_EQ(frames, 14u);
+
+  const size_t first_particle{4000};
+  const size_t particles{300};
+  std::vector<StateType> range(frames * particles);
+  playback.read(first_frame, frames, first_particle, range);
+  std::vector<StateType> whole(count);
+  for (size_t frame = 0; frame < frames; ++frame) {
+    playback.read(first_frame + frame, whole);
+    for (size_t i = 0; i < particles; ++i) {
+      this->expect_equal(range[frame * particles + i].template element<0>(),
+                         whole[first_particle + i].template element<0>());
+      this->expect_equal(range[frame * particles + i].template element<1>(),
+                         whole[first_particle + i].template element<1>());
+    }
+  }
+}
+
+/**
+ * A stream visits every frame from its first, in order, with the states of its particles.
+ */
+TYPED_TEST(TrajectoryTest, StreamsFramesInOrder) {
+  using Geometry = TypeParam;
+  const size_t count{50};
+  const size_t num_frames{150};
+  const auto path{this->directory_ / "stream"};
+  this->record(path, count, num_frames);
+
+  const TrajectoryPlayback<Geometry> playback{path};
+  size_t expected{5};
+  for (TrajectoryStream<Geometry> stream{playback, 10, 20, expected}; !stream.done();
+       stream.advance()) {
+    ASSERT_EQ(stream.frame(), expected);
+    EXPECT_EQ(stream.time(), playback.time(expected));
+    ASSERT_EQ(stream.states().size(), 20u);
+    for (size_t i = 0; i < 20; ++i) {
+      this->expect_equal(stream.states()[i].template element<0>(),
+                         this->pose(10 + i, stream.time()));
+    }
+    ++expected;
+  }
+  EXPECT_EQ(expected, num_frames);
+}
+
+/**
+ * Benchmark: time to read one particle over every frame against reading every frame whole.
+ */
+TYPED_TEST(TrajectoryTest, PartialReadCost) {
+  using Geometry = TypeParam;
+  using StateType = typename TestFixture::StateType;
+  const size_t count{20000};
+  const size_t num_frames{24};
+  const auto path{this->directory_ / "partial"};
+  this->record(path, count, num_frames);
+
+  const TrajectoryPlayback<Geometry> playback{path};
+  const auto start{std::chrono::steady_clock::now()};
+  std::vector<StateType> particle(num_frames);
+  playback.read(0, num_frames, 0, particle);
+  const auto partial{std::chrono::steady_clock::now()};
+  std::vector<StateType> frame(count);
+  for (size_t f = 0; f < num_frames; ++f) {
+    playback.read(f, frame);
+  }
+  const auto end{std::chrono::steady_clock::now()};
+
+  const auto milliseconds{[](auto duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }};
+  LOG(INFO) << count << " particles, " << num_frames << " frames: one particle "
+            << milliseconds(partial - start) << " ms, every particle "
+            << milliseconds(end - partial) << " ms";
+  this->expect_equal(particle.back().template element<0>(), frame[0].template element<0>());
+}
+
+/**
+ * Benchmark: time spent in record() against the time the background thread spends deflating, for
+ * a large frame.
+ */
+TYPED_TEST(TrajectoryTest, RecordingCost) {
+  using Geometry = TypeParam;
+  using MV = typename TestFixture::MV;
+  const size_t count{20000};
+  const size_t num_frames{24};
+  std::vector<MV> poses(count);
+  std::vector<MV> velocities(count);
+  for (size_t i = 0; i < count; ++i) {
+    poses[i] = this->pose(i, 0);
+    velocities[i] = this->velocity(i, 0);
+  }
+
+  TrajectoryRecorder<Geometry> recorder{this->directory_ / "cost", count};
+  std::chrono::nanoseconds record_time{0};
+  for (size_t frame = 0; frame < num_frames; ++frame) {
+    for (size_t i = 0; i < count; i += 97) {
+      poses[i] = this->pose(i, 0.1 * frame);
+    }
+    const auto start{std::chrono::steady_clock::now()};
+    recorder.record(0.1 * frame, poses, velocities);
+    record_time += std::chrono::steady_clock::now() - start;
+  }
+  recorder.close();
+
+  const auto counters{recorder.writer().counters()};
+  const auto milliseconds{[](auto duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }};
+  LOG(INFO) << count << " particles, " << num_frames << " frames: record "
+            << milliseconds(record_time) << " ms (stalled " << milliseconds(counters.stall_time)
+            << " ms), deflate " << milliseconds(counters.compress_time) << " ms, "
+            << counters.raw_bytes << " -> " << counters.compressed_bytes << " bytes";
+  EXPECT_EQ(counters.frames, num_frames);
+  EXPECT_LT(counters.compressed_bytes, counters.raw_bytes);
+}
+
+/**
+ * A trajectory refuses a geometry with as many blades and as large a record as its own but another
+ * signature.
+ */
+TEST(TrajectorySignatureTest, RejectsAlgebrasWithTheSameBladeCount) {
+  using Geometry = PgaSpacetimeGeometry;
+  static_assert(TrajectoryCodec<Vga4dGeometry>::RECORD_SIZE ==
+                TrajectoryCodec<Geometry>::RECORD_SIZE);
+  const auto path{ndyn::testing::TestTempDirectory::getInstance()->createTestSubdirectory() /
+                  "pga"};
+  {
+    TrajectoryRecorder<Geometry> recorder{path, 1};
+    const std::vector<Geometry::Multivector> poses{Geometry::translator(1, 2, 3)};
+    const std::vector<Geometry::Multivector> velocities{Geometry::bivector_xy(1)};
+    recorder.record(0, poses, velocities);
+  }
+
+  EXPECT_EQ(TrajectoryPlayback<Geometry>{path}.size(), 1u);
+  EXPECT_THROW(TrajectoryPlayback<Vga4dGeometry>{path}, std::runtime_error);
+}
+
+}  // namespace ndyn::test
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace ndyn::assembly {
+
+/**
+ * A fixed pool of threads that runs batches of independent tasks with work stealing.
+ *
+ * run(num_tasks, body) calls body(task, worker) once for every task in [0, num_tasks) and returns
+ * when all have finished. The calling thread takes part as worker 0, so a pool of one thread runs
+ * everything inline. Tasks are dealt out in contiguous blocks, one block per worker; a worker takes
+ * tasks from the back of its own queue and, once that is empty, steals from the front of the
+ * others', so uneven tasks balance out without a central queue.
+ *
+ * The worker index is stable for the duration of the call, which lets the body keep per-worker
+ * state such as a RetardationCache. Which worker runs which task is not deterministic; callers that
+ * need deterministic results must make each task's output depend only on the task.
+ *
+ * The body must not throw. run() must not be called concurrently or from inside a body.
+ */
+class WorkStealingPool final {
+ public:
+  using Task = std::function<void(size_t task, size_t worker)>;
+
+  struct Counters final {
+    uint64_t batches{0};
+    uint64_t tasks{0};
+    uint64_t steals{0};
+  };
+
+ private:
+  struct Queue final {
+    std::mutex mutex{};
+    std::deque<size_t> tasks{};
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues_{};
+  std::vector<std::thread> threads_{};
+
+  std::mutex mutex_{};
+  std::condition_variable start_{};
+  std::condition_variable done_{};
+  const Task* body_{nullptr};
+  uint64_t batch_{0};
+  size_t busy_workers_{0};
+  bool stopping_{false};
+
+  Counters counters_{};
+  std::atomic<uint64_t> steals_{0};
+
+  std::optional<size_t> pop(size_t worker) {
+    Queue& queue{*queues_[worker]};
+    std::lock_guard lock{queue.mutex};
+    if (queue.tasks.empty()) return std::nullopt;
+    const size_t task{queue.tasks.back()};
+    queue.tasks.pop_back();
+    return task;
+  }
+
+  std::optional<size_t> steal(size_t thief) {
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+      Queue& queue{*queues_[(thief + offset) % queues_.size()]};
+      std::lock_guard lock{queue.mutex};
+      if (!queue.tasks.empty()) {
+        const size_t task{queue.tasks.front()};
+        queue.tasks.pop_front();
+        steals_.fetch_add(1, std::memory_order_relaxed);
+        return task;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // No task is ever added during a batch, so once every queue is empty the worker is done.
+  void work(size_t worker, const Task& body) {
+    while (true) {
+      std::optional<size_t> task{pop(worker)};
+      if (!task) task = steal(worker);
+      if (!task) return;
+      body(*task, worker);
+    }
+  }
+
+  void worker_loop(size_t worker) {
+    uint64_t seen{0};
+    while (true) {
+      const Task* body{};
+      {
+        std::unique_lock lock{mutex_};
+        start_.wait(lock, [&] { return stopping_ || batch_ != seen; });
+        if (stopping_) return;
+        seen = batch_;
+        body = body_;
+      }
+      work(worker, *body);
+      {
+        std::lock_guard lock{mutex_};
+        if (--busy_workers_ == 0) done_.notify_one();
+      }
+    }
+  }
+
+ public:
+  /**
+   * A pool of num_threads workers, including the calling thread. Zero selects the hardware
+   * concurrency.
+   */
+  explicit WorkStealingPool(size_t num_threads = 0) {
+    if (num_threads == 0) {
+      num_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    queues_.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+      queues_.push_back(std::make_unique<Queue>());
+    }
+    threads_.reserve(num_threads - 1);
+    for (size_t worker = 1; worker < num_threads; ++worker) {
+      threads_.emplace_back([this, worker] { worker_loop(worker); });
+    }
+  }
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard lock{mutex_};
+      stopping_ = true;
+    }
+    start_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  void run(size_t num_tasks, const Task& body) {
+    const size_t num_workers{size()};
+    // Deal contiguous blocks, so that neighbouring tasks, which tend to share data, start on the
+    // same worker.
+    for (size_t worker = 0; worker < num_workers; ++worker) {
+      Queue& queue{*queues_[worker]};
+      std::lock_guard lock{queue.mutex};
+      for (size_t task = worker * num_tasks / num_workers;
+           task < (worker + 1) * num_tasks / num_workers; ++task) {
+        queue.tasks.push_back(task);
+      }
+    }
+
+    {
+      std::lock_guard lock{mutex_};
+      body_ = &body;
+      busy_workers_ = threads_.size();
+      ++batch_;
+    }
+    start_.notify_all();
+
+    work(0, body);
+
+    std::unique_lock lock{mutex_};
+    done_.wait(lock, [this] { return busy_workers_ == 0; });
+    body_ = nullptr;
+    ++counters_.batches;
+    counters_.tasks += num_tasks;
+    counters_.steals = steals_.load(std::memory_order_relaxed);
+  }
+
+  size_t size() const noexcept { return queues_.size(); }
+
+  const Counters& counters() const noexcept { return counters_; }
+};
+
+}  // namespace ndyn::assembly
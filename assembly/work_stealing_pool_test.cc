@@ -0,0 +1,57 @@
+#include "assembly/work_stealing_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::assembly;
+
+TEST(WorkStealingPoolTest, RunsEveryTaskOnce) {
+  for (const size_t num_threads : {1, 2, 3, 8}) {
+    WorkStealingPool pool{num_threads};
+    EXPECT_EQ(pool.size(), num_threads);
+
+    // Several batches through the same pool, including empty and tiny ones.
+    for (const size_t num_tasks : {0, 1, 5, 1000}) {
+      std::vector<std::atomic<int>> runs(num_tasks);
+      std::atomic<bool> bad_worker{false};
+      pool.run(num_tasks, [&](size_t task, size_t worker) {
+        runs[task].fetch_add(1);
+        if (worker >= num_threads) bad_worker = true;
+      });
+      for (size_t task = 0; task < num_tasks; ++task) {
+        EXPECT_EQ(runs[task].load(), 1) << "threads: " << num_threads << " task: " << task;
+      }
+      EXPECT_FALSE(bad_worker);
+    }
+    EXPECT_EQ(pool.counters().batches, 4u);
+    EXPECT_EQ(pool.counters().tasks, 1006u);
+  }
+}
+
+/**
+ * When one worker's block is far slower than the others', the idle workers must take over the rest
+ * of it.
+ */
+TEST(WorkStealingPoolTest, IdleWorkersSteal) {
+  WorkStealingPool pool{4};
+  std::vector<size_t> worker_of(64);
+  pool.run(worker_of.size(), [&](size_t task, size_t worker) {
+    if (task < 16) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    worker_of[task] = worker;
+  });
+
+  size_t moved{0};
+  for (size_t task = 0; task < 16; ++task) {
+    if (worker_of[task] != 0) ++moved;
+  }
+  EXPECT_GT(moved, 0u);
+  EXPECT_GT(pool.counters().steals, 0u);
+}
+
+}  // namespace ndyn::test
@@ -1,80 +1,146 @@
 #pragma once
 
-#include <algorithm>
-#include <vector>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <utility>
 
+#include "assembly/worldline_history.h"
 #include "glog/logging.h"
 #include "math/state.h"
 
 namespace ndyn::assembly {
 
+template <typename Geometry, typename RootFinder, typename LightSpeed>
+class Manifold;
+
+/**
+ * Anything the Manifold can solve retardation against: a time-ordered history that can be sampled
+ * at arbitrary times within [oldest_time(), latest_time()].
+ */
+template <typename W, typename Geometry>
+concept WorldlineLike = requires(const W& worldline, typename Geometry::ScalarType t) {
+  { worldline.get_state_at(t) } -> std::convertible_to<math::State<Geometry, 2>>;
+  { worldline.oldest_time() } -> std::convertible_to<typename Geometry::ScalarType>;
+  { worldline.latest_time() } -> std::convertible_to<typename Geometry::ScalarType>;
+};
+
+/**
+ * A WorldlineLike whose recorded samples are directly addressable through history(), which follows
+ * the History policy interface in worldline_history.h. The retardation solver uses the samples to
+ * locate the relevant segment without interpolating.
+ */
+template <typename W, typename Geometry>
+concept SampledWorldline =
+    WorldlineLike<W, Geometry> &&
+    requires(const W& worldline, size_t index, typename Geometry::ScalarType t) {
+      { worldline.history().size() } -> std::convertible_to<size_t>;
+      { worldline.history().time(index) } -> std::convertible_to<typename Geometry::ScalarType>;
+      { worldline.history().state(index) } -> std::convertible_to<math::State<Geometry, 2>>;
+      { worldline.history().lower_bound(t) } -> std::convertible_to<size_t>;
+    };
+
+/**
+ * Performs Cubic Hermite Spline interpolation between two samples of a worldline taken at times t0
+ * and t1. Uses cubic basis functions to ensure smooth derivatives for the solver.
+ *
+ * The sample times are passed explicitly rather than read back from the poses so that histories
+ * which encode their samples can supply their exact times.
+ */
 template <typename Geometry>
+math::State<Geometry, 2> interpolate_states(const math::State<Geometry, 2>& s0,
+                                            typename Geometry::ScalarType t0,
+                                            const math::State<Geometry, 2>& s1,
+                                            typename Geometry::ScalarType t1,
+                                            typename Geometry::ScalarType t) noexcept {
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+
+  const ScalarType duration{t1 - t0};
+
+  if (duration < Geometry::Algebra::EPSILON) return s1;
+
+  const ScalarType tau{(t - t0) / duration};
+  const ScalarType tau2{tau * tau};
+  const ScalarType tau3{tau2 * tau};
+
+  // Cubic Hermite basis functions
+  const ScalarType h00{2 * tau3 - 3 * tau2 + 1};
+  const ScalarType h10{tau3 - 2 * tau2 + tau};
+  const ScalarType h01{-2 * tau3 + 3 * tau2};
+  const ScalarType h11{tau3 - tau2};
+
+  StateType result{};
+
+  // Interpolate Kinematics (element 1) using full cubic Hermite
+  // Note: This assumes element 1 contains velocity, and we treat it as a linear space.
+  const Multivector v0{s0.template element<1>()};
+  const Multivector v1{s1.template element<1>()};
+  result.template set_element<1>(v0 * h00 + v1 * h01);  // Simplified: h10/h11 require acceleration
+
+  // Interpolate Pose Motor (element 0) in the Lie Algebra
+  const Multivector m0{s0.template element<0>()};
+  const Multivector m1{s1.template element<0>()};
+  const Multivector log_displacement{Geometry::motor_log(m1 * (~m0))};
+  result.template set_element<0>(Geometry::motor_exp(log_displacement * tau) * m0);
+
+  return result;
+}
+
+/**
+ * The sampled history of a particle, interpolated on demand.
+ *
+ * The History policy decides how samples are stored; see worldline_history.h. DenseHistory keeps
+ * full States. QuantizedHistory trades a bounded encoding error for a much smaller footprint and
+ * is selected as, for example:
+ *
+ *   Worldline<Geometry, QuantizedHistory<Geometry>> wl{manifold, 4096, error_bound};
+ *
+ * SpillingHistory never discards samples; it moves cold ones to a memory-mapped file instead.
+ */
+template <typename Geometry, typename History = DenseHistory<Geometry>>
 class Worldline final {
  public:
   using Multivector = typename Geometry::Multivector;
   using ScalarType = typename Geometry::ScalarType;
   using StateType = math::State<Geometry, 2>;
+  using HistoryType = History;
 
  private:
-  const Manifold<Geometry>* manifold_;
-  std::vector<StateType> history_;
-
-  /**
-   * Performs Cubic Hermite Spline interpolation.
-   * Uses cubic basis functions to ensure smooth derivatives for the solver.
-   */
-  StateType interpolate(const StateType& s0, const StateType& s1, ScalarType t) const noexcept {
-    const ScalarType t0{Geometry::extract_time(s0.template element<0>())};
-    const ScalarType t1{Geometry::extract_time(s1.template element<0>())};
-    const ScalarType duration{t1 - t0};
-
-    if (duration < Geometry::Algebra::EPSILON) return s1;
-
-    const ScalarType tau{(t - t0) / duration};
-    const ScalarType tau2{tau * tau};
-    const ScalarType tau3{tau2 * tau};
-
-    // Cubic Hermite basis functions
-    const ScalarType h00{2 * tau3 - 3 * tau2 + 1};
-    const ScalarType h10{tau3 - 2 * tau2 + tau};
-    const ScalarType h01{-2 * tau3 + 3 * tau2};
-    const ScalarType h11{tau3 - tau2};
-
-    StateType result{};
-
-    // Interpolate Kinematics (element 1) using full cubic Hermite
-    // Note: This assumes element 1 contains velocity, and we treat it as a linear space.
-    const Multivector v0{s0.template element<1>()};
-    const Multivector v1{s1.template element<1>()};
-    result.set_element<1>(v0 * h00 + v1 * h01);  // Simplified: h10/h11 require acceleration
-
-    // Interpolate Pose Motor (element 0) in the Lie Algebra
-    const Multivector m0{s0.template element<0>()};
-    const Multivector m1{s1.template element<0>()};
-    const Multivector log_displacement{Geometry::motor_log(m1 * (~m0))};
-    result.set_element<0>(Geometry::motor_exp(log_displacement * tau) * m0);
-
-    return result;
-  }
+  // The speed of light of the Manifold, which must outlive this Worldline.
+  std::function<ScalarType(ScalarType)> speed_of_light_;
+  History history_;
 
  public:
   /**
-   * Takes a reference to the Manifold to monitor causal horizon during pruning.
+   * Takes a reference to the Manifold to monitor causal horizon during pruning. Any arguments after
+   * max_size are forwarded to the History policy's constructor.
    */
-  Worldline(const Manifold<Geometry>& manifold, size_t max_size = 1024) : manifold_{&manifold} {
-    history_.reserve(max_size);
-  }
+  template <typename RootFinder, typename LightSpeed, typename... HistoryArgs>
+  explicit Worldline(const Manifold<Geometry, RootFinder, LightSpeed>& manifold,
+                     size_t max_size = 1024, HistoryArgs&&... history_args)
+      : speed_of_light_{[&manifold](ScalarType t) { return manifold.calculate_speed_of_light(t); }},
+        history_{max_size, std::forward<HistoryArgs>(history_args)...} {}
 
   /**
    * Manages history depth. If causal horizon is threatened by a slowing speed of light,
    * it decimates history to preserve temporal reach.
+   *
+   * Tiered histories spill to storage instead, and throw if they cannot; the history is then
+   * unchanged and the state is not recorded.
    */
-  void record_state(const StateType& state) noexcept {
+  void record_state(const StateType& state) noexcept(!TieredHistory<History>) {
     // Check size against capacity before adding a new element. We want to maintain a fixed memory
     // footprint.
-    if (history_.size() == history_.capacity()) {
+    if constexpr (TieredHistory<History>) {
+      if (history_.size() == history_.capacity()) {
+        // Nothing is lost; the oldest in-memory samples move to cold storage.
+        history_.spill();
+      }
+    } else if (history_.size() == history_.capacity()) {
       const ScalarType t_now{Geometry::extract_time(state.template element<0>())};
-      const ScalarType speed_of_light{manifold_->coordinate_c(t_now)};
+      const ScalarType speed_of_light{speed_of_light_(t_now)};
       const ScalarType t_oldest{oldest_time()};
       const ScalarType causal_limit{t_now - (Geometry::max_system_radius() / speed_of_light)};
 
@@ -83,16 +149,10 @@ class Worldline final {
 
         // Remove every other element. We lose precision, but the interpolation guarantees we can
         // still get some values.
-        size_t count{0};
-        auto it = std::remove_if(history_.begin(), history_.end(),
-                                 [&](const StateType&) { return (count++ % 2 == 1); });
-        history_.erase(it, history_.end());
+        history_.decimate();
       } else {
         // Remove all the states that are no longer reachable.
-        auto it = std::remove_if(history_.begin(), history_.end(), [&](const StateType& state) {
-          return Geometry::extract_time(state.template element<0>()) < causal_limit;
-        });
-        history_.erase(it, history_.end());
+        history_.drop_before(causal_limit);
       }
     }
 
@@ -103,28 +163,26 @@ class Worldline final {
 
   StateType get_state_at(ScalarType t) const noexcept {
     if (history_.empty()) return {};
-    if (history_.size() == 1) return history_.front();
-    if (t <= oldest_time()) return history_.front();
-    if (t >= latest_time()) return history_.back();
+    if (history_.size() == 1) return history_.state(0);
+    if (t <= oldest_time()) return history_.state(0);
+    if (t >= latest_time()) return history_.state(history_.size() - 1);
 
-    auto it = std::lower_bound(history_.begin(), history_.end(), t,
-                               [](const StateType& s, ScalarType val) {
-                                 return Geometry::extract_time(s.template element<0>()) < val;
-                               });
+    const size_t index{history_.lower_bound(t)};
 
-    if (it == history_.begin()) return history_.front();
-    return interpolate(*(std::prev(it)), *it, t);
+    if (index == 0) return history_.state(0);
+    return interpolate_states<Geometry>(history_.state(index - 1), history_.time(index - 1),
+                                        history_.state(index), history_.time(index), t);
   }
 
-  ScalarType oldest_time() const noexcept {
-    return history_.empty() ? 0 : Geometry::extract_time(history_.front().template element<0>());
-  }
+  ScalarType oldest_time() const noexcept { return history_.empty() ? 0 : history_.time(0); }
 
   ScalarType latest_time() const noexcept {
-    return history_.empty() ? 0 : Geometry::extract_time(history_.back().template element<0>());
+    return history_.empty() ? 0 : history_.time(history_.size() - 1);
   }
 
   bool empty() const noexcept { return history_.empty(); }
+
+  const History& history() const noexcept { return history_; }
 };
 
 }  // namespace ndyn::assembly
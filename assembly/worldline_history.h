@@ -0,0 +1,383 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "base/bits.h"
+#include "glog/logging.h"
+#include "math/state.h"
+
+namespace ndyn::assembly {
+
+/**
+ * Storage policies for the sampled history of a Worldline.
+ *
+ * A history is an ordered sequence of states, oldest first, with strictly non-decreasing times. The
+ * Worldline owns the causal bookkeeping (when to prune, when to decimate); the history only stores
+ * samples and answers queries about them. Every policy provides the same interface:
+ *
+ *   size(), capacity(), empty()
+ *   time(i)          -- the time of sample i, exact.
+ *   state(i)         -- sample i, decoded if the policy encodes its samples.
+ *   lower_bound(t)   -- index of the first sample with time >= t.
+ *   push_back(s)     -- append a sample. The caller guarantees size() < capacity().
+ *   drop_before(t)   -- remove all samples with time < t.
+ *   decimate()       -- remove every other sample, keeping the oldest.
+ *
+ * Tiered policies (see spilling_history.h) never discard samples. They provide spill() instead of
+ * drop_before() and decimate(), and Worldline calls it whenever the in-memory tier is full.
+ */
+
+template <typename History>
+concept TieredHistory = requires(History& history) { history.spill(); };
+
+/**
+ * Stores every sample as a full State. This is the reference policy: no encoding error, but every
+ * blade of every element is resident, including the many blades that are structurally zero for
+ * motors and bivector velocities.
+ */
+template <typename Geometry>
+class DenseHistory final {
+ public:
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+
+ private:
+  std::vector<StateType> states_{};
+
+  static ScalarType time_of(const StateType& state) noexcept {
+    return Geometry::extract_time(state.template element<0>());
+  }
+
+ public:
+  explicit DenseHistory(size_t capacity) { states_.reserve(capacity); }
+
+  size_t size() const noexcept { return states_.size(); }
+  size_t capacity() const noexcept { return states_.capacity(); }
+  bool empty() const noexcept { return states_.empty(); }
+
+  ScalarType time(size_t index) const noexcept { return time_of(states_[index]); }
+  const StateType& state(size_t index) const noexcept { return states_[index]; }
+
+  size_t lower_bound(ScalarType t) const noexcept {
+    auto it = std::lower_bound(
+        states_.begin(), states_.end(), t,
+        [](const StateType& s, ScalarType value) { return time_of(s) < value; });
+    return static_cast<size_t>(it - states_.begin());
+  }
+
+  void push_back(const StateType& state) noexcept { states_.push_back(state); }
+
+  void drop_before(ScalarType t) noexcept {
+    states_.erase(states_.begin(), states_.begin() + lower_bound(t));
+  }
+
+  void decimate() noexcept {
+    size_t count{0};
+    auto it = std::remove_if(states_.begin(), states_.end(),
+                             [&](const StateType&) { return (count++ % 2 == 1); });
+    states_.erase(it, states_.end());
+  }
+};
+
+/**
+ * Stores samples as fixed-point deltas against periodic keyframes, keeping only the blades that a
+ * pose motor and a kinematic bivector can populate.
+ *
+ * Element 0 (the pose motor) lives in the even subalgebra and element 1 (the velocity) is a
+ * bivector, so every odd-grade blade of the pose and every non-grade-2 blade of the velocity is
+ * dropped. For Tcga this keeps 47 of 128 coefficients; for Pga, 14 of 32.
+ *
+ * Each kept coefficient is stored as a count of quanta relative to the sample's keyframe, where a
+ * quantum is twice the requested error bound. Decoding therefore reproduces every kept coefficient
+ * to within error_bound. A keyframe (the full-precision kept coefficients) is emitted every
+ * KEYFRAME_INTERVAL samples, or earlier when a delta would overflow the int16_t range. Times are
+ * stored exactly, since the Worldline's binary search and causal pruning depend on them.
+ *
+ * The samples a keyframe covers, its run, share one delta width. A run starts with int8_t deltas
+ * and is widened to int16_t, re-encoding the samples it already holds, when a delta first needs
+ * it; only the newest run is ever widened. Samples do not store their keyframe: each keyframe
+ * records the first sample it covers, and a lookup binary searches those.
+ *
+ * A sample therefore costs its time plus 1 byte per kept blade while its run stays within 127
+ * quanta of the keyframe, and 2 bytes otherwise. Against sizeof(State) for DenseHistory, counting
+ * keyframes amortised over full runs, the narrow runs are about 6.2x smaller for Pga and 9x for Cga
+ * in float, and 9.8x and 15x in double; wide runs, 3.7x, 4.9x, 6.4x and 9x. Pga in float
+ * therefore only reaches 4x on runs whose motion stays within 127 quanta of their keyframe: the
+ * int16_t deltas of its 14 kept blades and the time already take 32 of the State's 128 bytes.
+ */
+template <typename Geometry, size_t KEYFRAME_INTERVAL = 32>
+class QuantizedHistory final {
+ public:
+  using Multivector = typename Geometry::Multivector;
+  using ScalarType = typename Geometry::ScalarType;
+  using StateType = math::State<Geometry, 2>;
+
+  static_assert(KEYFRAME_INTERVAL > 0, "Keyframe interval must be positive.");
+
+ private:
+  static constexpr size_t NUM_BLADES{Geometry::Algebra::NUM_BASIS_BLADES};
+
+  static constexpr size_t count_blades(bool (*keep)(size_t)) {
+    size_t count{0};
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      if (keep(i)) ++count;
+    }
+    return count;
+  }
+
+  static constexpr bool is_pose_blade(size_t blade) { return bit_count(blade) % 2 == 0; }
+  static constexpr bool is_velocity_blade(size_t blade) { return bit_count(blade) == 2; }
+
+  static constexpr size_t NUM_POSE_BLADES{count_blades(&is_pose_blade)};
+  static constexpr size_t NUM_VELOCITY_BLADES{count_blades(&is_velocity_blade)};
+
+ public:
+  // Number of coefficients retained per sample.
+  static constexpr size_t NUM_KEPT{NUM_POSE_BLADES + NUM_VELOCITY_BLADES};
+
+ private:
+  using Coefficients = std::array<ScalarType, NUM_KEPT>;
+  using Deltas = std::array<int16_t, NUM_KEPT>;
+
+  struct Keyframe final {
+    Coefficients coefficients;
+    // Index of the first sample the keyframe covers. Strictly increasing, and 0 for the first.
+    size_t first_sample;
+    // Position of that sample's deltas in deltas_, and the width in bytes of each of its run's.
+    size_t offset;
+    size_t width;
+  };
+
+  // Blade index of each retained coefficient. The first NUM_POSE_BLADES entries belong to element
+  // 0, the rest to element 1.
+  static constexpr std::array<size_t, NUM_KEPT> KEPT_BLADES = []() {
+    std::array<size_t, NUM_KEPT> result{};
+    size_t next{0};
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      if (is_pose_blade(i)) result[next++] = i;
+    }
+    for (size_t i = 0; i < NUM_BLADES; ++i) {
+      if (is_velocity_blade(i)) result[next++] = i;
+    }
+    return result;
+  }();
+
+  static constexpr int32_t MAX_DELTA{std::numeric_limits<int16_t>::max()};
+  static constexpr int32_t MAX_NARROW_DELTA{std::numeric_limits<int8_t>::max()};
+
+  ScalarType error_bound_;
+  ScalarType quantum_;
+  size_t capacity_;
+
+  std::vector<ScalarType> times_{};
+  // The deltas of every sample, NUM_KEPT of its run's width each, in sample order.
+  std::vector<int8_t> deltas_{};
+  std::vector<Keyframe> keyframes_{};
+
+  // Number of samples appended since the most recent keyframe was emitted.
+  size_t since_keyframe_{0};
+
+  static Coefficients gather(const StateType& state) noexcept {
+    Coefficients result{};
+    for (size_t i = 0; i < NUM_KEPT; ++i) {
+      const Multivector& element{i < NUM_POSE_BLADES ? state.template element<0>()
+                                                     : state.template element<1>()};
+      result[i] = element.coefficient(KEPT_BLADES[i]);
+    }
+    return result;
+  }
+
+  bool try_quantize(const Coefficients& values, const Coefficients& keyframe,
+                    Deltas& out) const noexcept {
+    using std::lround;
+    for (size_t i = 0; i < NUM_KEPT; ++i) {
+      const long steps{lround((values[i] - keyframe[i]) / quantum_)};
+      if (steps > MAX_DELTA || steps < -MAX_DELTA) {
+        return false;
+      }
+      out[i] = static_cast<int16_t>(steps);
+    }
+    return true;
+  }
+
+  static bool is_narrow(const Deltas& deltas) noexcept {
+    return std::all_of(deltas.begin(), deltas.end(), [](int16_t delta) {
+      return delta <= MAX_NARROW_DELTA && delta >= -MAX_NARROW_DELTA;
+    });
+  }
+
+  size_t keyframe_of(size_t index) const noexcept {
+    return static_cast<size_t>(
+        std::upper_bound(keyframes_.begin(), keyframes_.end(), index,
+                         [](size_t value, const Keyframe& k) { return value < k.first_sample; }) -
+        keyframes_.begin() - 1);
+  }
+
+  int16_t delta(const Keyframe& keyframe, size_t index, size_t blade) const noexcept {
+    const size_t position{keyframe.offset +
+                          ((index - keyframe.first_sample) * NUM_KEPT + blade) * keyframe.width};
+    if (keyframe.width == sizeof(int8_t)) {
+      return deltas_[position];
+    }
+    int16_t result;
+    std::memcpy(&result, &deltas_[position], sizeof(result));
+    return result;
+  }
+
+  void store_delta(size_t position, int16_t value, size_t width) noexcept {
+    if (width == sizeof(int8_t)) {
+      deltas_[position] = static_cast<int8_t>(value);
+    } else {
+      std::memcpy(&deltas_[position], &value, sizeof(value));
+    }
+  }
+
+  /**
+   * Re-encodes the newest run's deltas as int16_t, in place, from the last backwards.
+   */
+  void widen_last_run() noexcept {
+    Keyframe& keyframe{keyframes_.back()};
+    const size_t count{deltas_.size() - keyframe.offset};
+    deltas_.resize(keyframe.offset + count * sizeof(int16_t));
+    for (size_t i = count; i-- > 0;) {
+      store_delta(keyframe.offset + i * sizeof(int16_t), deltas_[keyframe.offset + i],
+                  sizeof(int16_t));
+    }
+    keyframe.width = sizeof(int16_t);
+  }
+
+  /**
+   * Keeps the samples for which keep(index) holds, in order, along with their deltas and the
+   * keyframes that still cover at least one of them.
+   */
+  template <typename Keep>
+  void retain(Keep keep) noexcept {
+    size_t next_sample{0};
+    size_t next_offset{0};
+    size_t next_keyframe{0};
+    for (size_t k = 0; k < keyframes_.size(); ++k) {
+      const Keyframe keyframe{keyframes_[k]};
+      const size_t end{k + 1 < keyframes_.size() ? keyframes_[k + 1].first_sample : times_.size()};
+      const size_t stride{NUM_KEPT * keyframe.width};
+      const size_t first_sample{next_sample};
+      const size_t offset{next_offset};
+      for (size_t i = keyframe.first_sample; i < end; ++i) {
+        if (!keep(i)) {
+          continue;
+        }
+        times_[next_sample++] = times_[i];
+        std::memmove(&deltas_[next_offset],
+                     &deltas_[keyframe.offset + (i - keyframe.first_sample) * stride], stride);
+        next_offset += stride;
+      }
+      if (next_sample > first_sample) {
+        keyframes_[next_keyframe++] =
+            Keyframe{keyframe.coefficients, first_sample, offset, keyframe.width};
+      }
+    }
+    times_.resize(next_sample);
+    deltas_.resize(next_offset);
+    keyframes_.resize(next_keyframe);
+    if (times_.empty()) {
+      since_keyframe_ = 0;
+    }
+  }
+
+ public:
+  /**
+   * error_bound is the largest absolute error tolerated on any retained coefficient after decoding.
+   */
+  QuantizedHistory(size_t capacity, ScalarType error_bound)
+      : error_bound_{error_bound}, quantum_{2 * error_bound}, capacity_{capacity} {
+    LOG_IF(FATAL, !(error_bound > 0)) << "Quantized history requires a positive error bound.";
+    times_.reserve(capacity);
+    deltas_.reserve(capacity * NUM_KEPT);
+    keyframes_.reserve(capacity / KEYFRAME_INTERVAL + 1);
+  }
+
+  size_t size() const noexcept { return times_.size(); }
+  size_t capacity() const noexcept { return capacity_; }
+  bool empty() const noexcept { return times_.empty(); }
+
+  ScalarType error_bound() const noexcept { return error_bound_; }
+  size_t keyframe_count() const noexcept { return keyframes_.size(); }
+
+  /**
+   * Bytes held by the stored samples and keyframes, not counting unused capacity.
+   */
+  size_t footprint() const noexcept {
+    return times_.size() * sizeof(ScalarType) + deltas_.size() * sizeof(int8_t) +
+           keyframes_.size() * sizeof(Keyframe);
+  }
+
+  ScalarType time(size_t index) const noexcept { return times_[index]; }
+
+  StateType state(size_t index) const noexcept {
+    const Keyframe& keyframe{keyframes_[keyframe_of(index)]};
+
+    Multivector pose{};
+    Multivector velocity{};
+    for (size_t i = 0; i < NUM_KEPT; ++i) {
+      const ScalarType value{keyframe.coefficients[i] +
+                             quantum_ * static_cast<ScalarType>(delta(keyframe, index, i))};
+      if (i < NUM_POSE_BLADES) {
+        pose.set_coefficient(KEPT_BLADES[i], value);
+      } else {
+        velocity.set_coefficient(KEPT_BLADES[i], value);
+      }
+    }
+
+    StateType result{};
+    result.template set_element<0>(pose);
+    result.template set_element<1>(velocity);
+    return result;
+  }
+
+  size_t lower_bound(ScalarType t) const noexcept {
+    return static_cast<size_t>(std::lower_bound(times_.begin(), times_.end(), t) - times_.begin());
+  }
+
+  void push_back(const StateType& state) noexcept {
+    const Coefficients values{gather(state)};
+
+    Deltas deltas{};
+    const bool needs_keyframe{keyframes_.empty() || since_keyframe_ >= KEYFRAME_INTERVAL ||
+                              !try_quantize(values, keyframes_.back().coefficients, deltas)};
+    if (needs_keyframe) {
+      keyframes_.push_back(Keyframe{values, times_.size(), deltas_.size(), sizeof(int8_t)});
+      deltas.fill(0);
+      since_keyframe_ = 0;
+    }
+    ++since_keyframe_;
+
+    if (keyframes_.back().width == sizeof(int8_t) && !is_narrow(deltas)) {
+      widen_last_run();
+    }
+    const size_t width{keyframes_.back().width};
+    const size_t position{deltas_.size()};
+    deltas_.resize(position + NUM_KEPT * width);
+    for (size_t i = 0; i < NUM_KEPT; ++i) {
+      store_delta(position + i * width, deltas[i], width);
+    }
+
+    times_.push_back(Geometry::extract_time(state.template element<0>()));
+  }
+
+  void drop_before(ScalarType t) noexcept {
+    const size_t count{lower_bound(t)};
+    retain([count](size_t index) { return index >= count; });
+  }
+
+  void decimate() noexcept {
+    retain([](size_t index) { return index % 2 == 0; });
+  }
+};
+
+}  // namespace ndyn::assembly
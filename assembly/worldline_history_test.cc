@@ -0,0 +1,230 @@
+#include "assembly/worldline_history.h"
+
+#include <cmath>
+
+#include "assembly/geometry_test_utils.h"
+#include "assembly/manifold.h"
+#include "assembly/worldline.h"
+#include "gtest/gtest.h"
+
+namespace ndyn::test {
+
+using namespace ndyn::math;
+using namespace ndyn::assembly;
+
+template <typename Geometry>
+class WorldlineHistoryTest : public ::testing::Test {
+ protected:
+  using Scalar = typename Geometry::ScalarType;
+  using MV = typename Geometry::Multivector;
+  using StateType = math::State<Geometry, 2>;
+
+  static constexpr Scalar ERROR_BOUND{1e-4};
+
+  auto constant_c(Scalar value) {
+    return [value](Scalar /*time*/) { return value; };
+  }
+
+  // A particle drifting along x with a small wobble in y, so consecutive samples differ in more
+  // than one blade.
+  StateType make_state(Scalar t) {
+    StateType s;
+    s.template set_element<0>(Geometry::translator(2 * t, std::sin(t), 0) *
+                              Geometry::identity_at_time(t));
+    s.template set_element<1>(Geometry::bivector_xy(std::cos(t)));
+    return s;
+  }
+
+  static Scalar max_error(const MV& lhs, const MV& rhs) {
+    Scalar result{0};
+    for (size_t i = 0; i < Geometry::Algebra::NUM_BASIS_BLADES; ++i) {
+      result = std::max(result, std::abs(lhs.coefficient(i) - rhs.coefficient(i)));
+    }
+    return result;
+  }
+};
+
+using GeometryTypes = ::testing::Types<PgaSpacetimeGeometry, CgaSpacetimeGeometry>;
+TYPED_TEST_SUITE(WorldlineHistoryTest, GeometryTypes);
+
+/**
+ * Every decoded coefficient must lie within the configured error bound of the original, and the
+ * sample times must survive exactly.
+ */
+TYPED_TEST(WorldlineHistoryTest, QuantizedRoundTripWithinErrorBound) {
+  using Geometry = TypeParam;
+  QuantizedHistory<Geometry> history(256, this->ERROR_BOUND);
+
+  for (int i = 0; i < 200; ++i) {
+    history.push_back(this->make_state(0.05 * i));
+  }
+
+  ASSERT_EQ(history.size(), 200u);
+  for (int i = 0; i < 200; ++i) {
+    const auto original{this->make_state(0.05 * i)};
+    const auto decoded{history.state(i)};
+    EXPECT_EQ(history.time(i), Geometry::extract_time(original.template element<0>()));
+    EXPECT_LE(this->max_error(original.template element<0>(), decoded.template element<0>()),
+              this->ERROR_BOUND);
+    EXPECT_LE(this->max_error(original.template element<1>(), decoded.template element<1>()),
+              this->ERROR_BOUND);
+  }
+}
+
+/**
+ * Pruning and decimation must agree with the dense reference on which samples survive.
+ */
+TYPED_TEST(WorldlineHistoryTest, QuantizedMatchesDenseUnderPruning) {
+  using Geometry = TypeParam;
+  DenseHistory<Geometry> dense(256);
+  QuantizedHistory<Geometry> quantized(256, this->ERROR_BOUND);
+
+  for (int i = 0; i < 150; ++i) {
+    dense.push_back(this->make_state(0.1 * i));
+    quantized.push_back(this->make_state(0.1 * i));
+  }
+
+  dense.drop_before(3.05);
+  quantized.drop_before(3.05);
+  dense.decimate();
+  quantized.decimate();
+
+  ASSERT_EQ(dense.size(), quantized.size());
+  for (size_t i = 0; i < dense.size(); ++i) {
+    EXPECT_EQ(dense.time(i), quantized.time(i));
+    EXPECT_LE(this->max_error(dense.state(i).template element<0>(),
+                              quantized.state(i).template element<0>()),
+              this->ERROR_BOUND);
+  }
+
+  // Samples appended after the compaction must still decode correctly.
+  for (int i = 150; i < 180; ++i) {
+    dense.push_back(this->make_state(0.1 * i));
+    quantized.push_back(this->make_state(0.1 * i));
+  }
+  ASSERT_EQ(dense.size(), quantized.size());
+  for (size_t i = 0; i < dense.size(); ++i) {
+    EXPECT_LE(this->max_error(dense.state(i).template element<0>(),
+                              quantized.state(i).template element<0>()),
+              this->ERROR_BOUND);
+  }
+}
+
+/**
+ * Samples find their keyframe by index, so pruning and decimation must renumber the keyframes and
+ * drop those left covering no sample, whether every sample is a keyframe or only some are.
+ */
+TYPED_TEST(WorldlineHistoryTest, KeyframesFollowRepeatedPruning) {
+  using Geometry = TypeParam;
+  DenseHistory<Geometry> dense(256);
+  QuantizedHistory<Geometry, 1> every(256, this->ERROR_BOUND);
+  QuantizedHistory<Geometry, 3> some(256, this->ERROR_BOUND);
+
+  int next{0};
+  for (const double cutoff : {2.05, 4.0, 7.15}) {
+    for (; next < 20 * cutoff; ++next) {
+      dense.push_back(this->make_state(0.1 * next));
+      every.push_back(this->make_state(0.1 * next));
+      some.push_back(this->make_state(0.1 * next));
+    }
+    dense.drop_before(cutoff);
+    every.drop_before(cutoff);
+    some.drop_before(cutoff);
+    dense.decimate();
+    every.decimate();
+    some.decimate();
+
+    ASSERT_EQ(every.size(), dense.size());
+    ASSERT_EQ(some.size(), dense.size());
+    EXPECT_EQ(every.keyframe_count(), dense.size());
+    EXPECT_LT(some.keyframe_count(), dense.size()) << "cutoff: " << cutoff;
+    for (size_t i = 0; i < dense.size(); ++i) {
+      EXPECT_EQ(every.time(i), dense.time(i));
+      EXPECT_EQ(some.time(i), dense.time(i));
+      EXPECT_LE(this->max_error(dense.state(i).template element<0>(),
+                                every.state(i).template element<0>()),
+                this->ERROR_BOUND);
+      EXPECT_LE(this->max_error(dense.state(i).template element<0>(),
+                                some.state(i).template element<0>()),
+                this->ERROR_BOUND);
+    }
+  }
+}
+
+/**
+ * A run keeps one byte per delta while its samples stay within 127 quanta of its keyframe, and is
+ * widened in place once one does not. Both kinds of run must decode within the error bound, before
+ * and after pruning and decimation.
+ */
+TYPED_TEST(WorldlineHistoryTest, RunsWidenOnlyWhenTheyMust) {
+  using Geometry = TypeParam;
+  DenseHistory<Geometry> dense(64);
+  QuantizedHistory<Geometry> slow(64, this->ERROR_BOUND);
+  QuantizedHistory<Geometry> fast(64, this->ERROR_BOUND);
+
+  // The slow samples stay within a few quanta of their keyframes. The fast ones start within 127
+  // and pass it a few samples into each run.
+  for (int i = 0; i < 64; ++i) {
+    slow.push_back(this->make_state(1e-5 * i));
+    fast.push_back(this->make_state(4.37e-3 * i));
+    dense.push_back(this->make_state(4.37e-3 * i));
+  }
+  ASSERT_EQ(slow.keyframe_count(), fast.keyframe_count());
+  EXPECT_EQ(fast.footprint() - slow.footprint(), 64 * QuantizedHistory<Geometry>::NUM_KEPT);
+
+  for (size_t i = 0; i < dense.size(); ++i) {
+    EXPECT_LE(this->max_error(this->make_state(1e-5 * i).template element<0>(),
+                              slow.state(i).template element<0>()),
+              this->ERROR_BOUND);
+    EXPECT_LE(this->max_error(dense.state(i).template element<0>(),
+                              fast.state(i).template element<0>()),
+              this->ERROR_BOUND);
+    EXPECT_LE(this->max_error(dense.state(i).template element<1>(),
+                              fast.state(i).template element<1>()),
+              this->ERROR_BOUND);
+  }
+
+  dense.drop_before(0.1);
+  fast.drop_before(0.1);
+  dense.decimate();
+  fast.decimate();
+  for (int i = 64; i < 80; ++i) {
+    dense.push_back(this->make_state(4.37e-3 * i));
+    fast.push_back(this->make_state(4.37e-3 * i));
+  }
+  ASSERT_EQ(fast.size(), dense.size());
+  for (size_t i = 0; i < dense.size(); ++i) {
+    EXPECT_EQ(fast.time(i), dense.time(i));
+    EXPECT_LE(this->max_error(dense.state(i).template element<0>(),
+                              fast.state(i).template element<0>()),
+              this->ERROR_BOUND);
+  }
+}
+
+/**
+ * A Worldline backed by the quantized history must interpolate the same trajectory as one backed
+ * by full states.
+ */
+TYPED_TEST(WorldlineHistoryTest, QuantizedWorldlineInterpolatesLikeDense) {
+  using Geometry = TypeParam;
+  Manifold<Geometry> manifold(this->constant_c(1.0));
+  Worldline<Geometry> dense(manifold, 64);
+  Worldline<Geometry, QuantizedHistory<Geometry>> quantized(manifold, 64, this->ERROR_BOUND);
+
+  for (int i = 0; i < 40; ++i) {
+    dense.record_state(this->make_state(0.25 * i));
+    quantized.record_state(this->make_state(0.25 * i));
+  }
+
+  EXPECT_EQ(dense.oldest_time(), quantized.oldest_time());
+  EXPECT_EQ(dense.latest_time(), quantized.latest_time());
+
+  for (double t = 0.1; t < 9.5; t += 0.7) {
+    EXPECT_LE(this->max_error(dense.get_state_at(t).template element<0>(),
+                              quantized.get_state_at(t).template element<0>()),
+              10 * this->ERROR_BOUND)
+        << "t: " << t;
+  }
+}
+
+}  // namespace ndyn::test
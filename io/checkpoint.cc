@@ -0,0 +1,229 @@
+#include "io/checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace ndyn::io {
+
+namespace {
+
+constexpr char MAGIC[8]{'N', 'D', 'Y', 'N', 'C', 'K', 'P', 'T'};
+
+struct Header final {
+  char magic[8];
+  uint32_t version;
+  uint32_t section_count;
+  uint64_t file_size;
+};
+
+struct TableEntry final {
+  uint32_t tag;
+  uint32_t reserved;
+  uint64_t offset;
+  uint64_t size;
+};
+
+static_assert(sizeof(Header) == 24);
+static_assert(sizeof(TableEntry) == 24);
+
+constexpr size_t align_up(size_t offset) noexcept {
+  return (offset + CHECKPOINT_SECTION_ALIGNMENT - 1) / CHECKPOINT_SECTION_ALIGNMENT *
+         CHECKPOINT_SECTION_ALIGNMENT;
+}
+
+void write_fully(int fd, const void* data, size_t bytes, const std::filesystem::path& path) {
+  const char* next{static_cast<const char*>(data)};
+  while (bytes > 0) {
+    const ssize_t written{::write(fd, next, bytes)};
+    if (written < 0) {
+      LOG(WARNING) << "Could not write checkpoint. File: '" << path << "'";
+      throw std::runtime_error("Could not write checkpoint.");
+    }
+    next += written;
+    bytes -= static_cast<size_t>(written);
+  }
+}
+
+// Makes a rename within the directory durable.
+void sync_directory(const std::filesystem::path& directory) noexcept {
+  const int fd{::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY)};
+  if (fd < 0) return;
+  ::fsync(fd);
+  ::close(fd);
+}
+
+}  // namespace
+
+void CheckpointWriter::add_section(uint32_t tag, std::span<const std::byte> bytes) {
+  for (const Section& section : sections_) {
+    if (section.tag == tag) {
+      LOG(WARNING) << "Duplicate checkpoint section. Tag: " << tag;
+      throw std::invalid_argument("Checkpoint section tags must be unique.");
+    }
+  }
+  sections_.push_back(Section{tag, bytes});
+}
+
+void CheckpointWriter::commit(const std::filesystem::path& path) const {
+  std::vector<TableEntry> table{};
+  table.reserve(sections_.size());
+  size_t offset{align_up(sizeof(Header) + sections_.size() * sizeof(TableEntry))};
+  for (const Section& section : sections_) {
+    table.push_back(TableEntry{section.tag, 0, offset, section.bytes.size()});
+    offset = align_up(offset + section.bytes.size());
+  }
+
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = CHECKPOINT_FORMAT_VERSION;
+  header.section_count = static_cast<uint32_t>(sections_.size());
+  header.file_size = offset;
+
+  std::filesystem::path temporary{path};
+  temporary += ".tmp";
+  const int fd{::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+  if (fd < 0) {
+    LOG(WARNING) << "Could not open checkpoint for writing. File: '" << temporary << "'";
+    throw std::runtime_error("Could not open checkpoint for writing.");
+  }
+
+  try {
+    static constexpr std::byte PADDING[CHECKPOINT_SECTION_ALIGNMENT]{};
+    size_t position{0};
+    const auto pad_to{[&](size_t target) {
+      write_fully(fd, PADDING, target - position, temporary);
+      position = target;
+    }};
+
+    write_fully(fd, &header, sizeof(header), temporary);
+    write_fully(fd, table.data(), table.size() * sizeof(TableEntry), temporary);
+    position = sizeof(header) + table.size() * sizeof(TableEntry);
+    for (size_t i = 0; i < sections_.size(); ++i) {
+      pad_to(table[i].offset);
+      write_fully(fd, sections_[i].bytes.data(), sections_[i].bytes.size(), temporary);
+      position += sections_[i].bytes.size();
+    }
+    pad_to(offset);
+
+    if (::fsync(fd) != 0) {
+      LOG(WARNING) << "Could not sync checkpoint. File: '" << temporary << "'";
+      throw std::runtime_error("Could not sync checkpoint.");
+    }
+  } catch (...) {
+    ::close(fd);
+    ::unlink(temporary.c_str());
+    throw;
+  }
+  ::close(fd);
+
+  if (::rename(temporary.c_str(), path.c_str()) != 0) {
+    ::unlink(temporary.c_str());
+    LOG(WARNING) << "Could not replace checkpoint. File: '" << path << "'";
+    throw std::runtime_error("Could not replace checkpoint.");
+  }
+  sync_directory(path.parent_path());
+}
+
+MappedCheckpoint::MappedCheckpoint(std::filesystem::path path) : path_{std::move(path)} {
+  const int fd{::open(path_.c_str(), O_RDONLY)};
+  if (fd < 0) {
+    LOG(WARNING) << "Could not open checkpoint. File: '" << path_ << "'";
+    throw std::runtime_error("Could not open checkpoint.");
+  }
+  struct stat status {};
+  if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(Header)) {
+    ::close(fd);
+    LOG(WARNING) << "Checkpoint is truncated. File: '" << path_ << "'";
+    throw std::runtime_error("Checkpoint is truncated.");
+  }
+  const size_t bytes{static_cast<size_t>(status.st_size)};
+  void* mapping{::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0)};
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    LOG(WARNING) << "Could not map checkpoint. File: '" << path_ << "'";
+    throw std::runtime_error("Could not map checkpoint.");
+  }
+  mapping_ = static_cast<const std::byte*>(mapping);
+  mapped_bytes_ = bytes;
+
+  Header header{};
+  std::memcpy(&header, mapping_, sizeof(header));
+  const char* problem{nullptr};
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+    problem = "File is not a checkpoint.";
+  } else if (header.version != CHECKPOINT_FORMAT_VERSION) {
+    problem = "Unsupported checkpoint format version.";
+  } else if (header.file_size != bytes ||
+             sizeof(Header) + header.section_count * sizeof(TableEntry) > bytes) {
+    problem = "Checkpoint is truncated.";
+  }
+  for (uint32_t i = 0; problem == nullptr && i < header.section_count; ++i) {
+    TableEntry entry{};
+    std::memcpy(&entry, mapping_ + sizeof(Header) + i * sizeof(TableEntry), sizeof(entry));
+    if (entry.offset % CHECKPOINT_SECTION_ALIGNMENT != 0 || entry.offset > bytes ||
+        entry.size > bytes - entry.offset) {
+      problem = "Checkpoint section table is corrupt.";
+    } else {
+      sections_.push_back(Section{entry.tag, {mapping_ + entry.offset, entry.size}});
+    }
+  }
+  if (problem != nullptr) {
+    close();
+    LOG(WARNING) << problem << " File: '" << path_ << "'";
+    throw std::runtime_error(problem);
+  }
+}
+
+MappedCheckpoint::~MappedCheckpoint() { close(); }
+
+MappedCheckpoint::MappedCheckpoint(MappedCheckpoint&& rhs) noexcept
+    : path_{std::move(rhs.path_)},
+      mapping_{std::exchange(rhs.mapping_, nullptr)},
+      mapped_bytes_{std::exchange(rhs.mapped_bytes_, 0)},
+      sections_{std::move(rhs.sections_)} {}
+
+MappedCheckpoint& MappedCheckpoint::operator=(MappedCheckpoint&& rhs) noexcept {
+  if (this != &rhs) {
+    close();
+    path_ = std::move(rhs.path_);
+    mapping_ = std::exchange(rhs.mapping_, nullptr);
+    mapped_bytes_ = std::exchange(rhs.mapped_bytes_, 0);
+    sections_ = std::move(rhs.sections_);
+  }
+  return *this;
+}
+
+bool MappedCheckpoint::has_section(uint32_t tag) const noexcept {
+  for (const Section& section : sections_) {
+    if (section.tag == tag) return true;
+  }
+  return false;
+}
+
+std::span<const std::byte> MappedCheckpoint::section(uint32_t tag) const {
+  for (const Section& section : sections_) {
+    if (section.tag == tag) return section.bytes;
+  }
+  LOG(WARNING) << "Missing checkpoint section. File: '" << path_ << "', tag: " << tag;
+  throw std::runtime_error("Missing checkpoint section.");
+}
+
+void MappedCheckpoint::close() noexcept {
+  if (mapping_ != nullptr) {
+    ::munmap(const_cast<std::byte*>(mapping_), mapped_bytes_);
+    mapping_ = nullptr;
+    mapped_bytes_ = 0;
+  }
+  sections_.clear();
+}
+
+}  // namespace ndyn::io
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace ndyn::io {
+
+static_assert(std::endian::native == std::endian::little,
+              "Checkpoints are little-endian and are read and written in place.");
+
+/**
+ * A versioned checkpoint file made of tagged sections, each an opaque run of bytes.
+ *
+ * The file starts with a fixed header (magic, format version, section count, file size), followed
+ * by a table of sections (tag, offset, size) and then the sections themselves, each starting on a
+ * SECTION_ALIGNMENT boundary so that arrays of any fundamental type can be used in place. Integers
+ * in the header and table are little-endian; the layout of each section is up to its writer.
+ *
+ * CheckpointWriter assembles the file in a temporary sibling of the destination and renames it over
+ * the destination once it is complete and synced, so a checkpoint on disk is always either the
+ * previous one or the new one in full. MappedCheckpoint maps a checkpoint read-only and validates
+ * only its header and table; section contents are paged in as they are read.
+ */
+inline constexpr uint32_t CHECKPOINT_FORMAT_VERSION{1};
+inline constexpr size_t CHECKPOINT_SECTION_ALIGNMENT{64};
+
+/**
+ * A section tag from four characters, such as checkpoint_tag("POSE").
+ */
+constexpr uint32_t checkpoint_tag(const char (&name)[5]) noexcept {
+  return static_cast<uint32_t>(static_cast<unsigned char>(name[0])) |
+         static_cast<uint32_t>(static_cast<unsigned char>(name[1])) << 8 |
+         static_cast<uint32_t>(static_cast<unsigned char>(name[2])) << 16 |
+         static_cast<uint32_t>(static_cast<unsigned char>(name[3])) << 24;
+}
+
+class CheckpointWriter final {
+ private:
+  struct Section final {
+    uint32_t tag;
+    std::span<const std::byte> bytes;
+  };
+
+  std::vector<Section> sections_{};
+
+ public:
+  /**
+   * Adds a section. The bytes are not copied and must stay valid until commit() returns. Tags must
+   * be unique.
+   */
+  void add_section(uint32_t tag, std::span<const std::byte> bytes);
+
+  template <typename T>
+  void add_section(uint32_t tag, std::span<const T> values) {
+    add_section(tag, std::as_bytes(values));
+  }
+
+  /**
+   * Writes the checkpoint to path, atomically replacing any file there.
+   */
+  void commit(const std::filesystem::path& path) const;
+};
+
+class MappedCheckpoint final {
+ private:
+  struct Section final {
+    uint32_t tag;
+    std::span<const std::byte> bytes;
+  };
+
+  std::filesystem::path path_;
+  const std::byte* mapping_{nullptr};
+  size_t mapped_bytes_{0};
+  std::vector<Section> sections_{};
+
+  void close() noexcept;
+
+ public:
+  /**
+   * Maps the checkpoint at path. Throws if it cannot be read or is not a checkpoint of this format
+   * version.
+   */
+  explicit MappedCheckpoint(std::filesystem::path path);
+  ~MappedCheckpoint();
+
+  MappedCheckpoint(const MappedCheckpoint&) = delete;
+  MappedCheckpoint& operator=(const MappedCheckpoint&) = delete;
+
+  MappedCheckpoint(MappedCheckpoint&& rhs) noexcept;
+  MappedCheckpoint& operator=(MappedCheckpoint&& rhs) noexcept;
+
+  bool has_section(uint32_t tag) const noexcept;
+
+  /**
+   * The bytes of a section, valid while this MappedCheckpoint lives. Throws if there is no such
+   * section.
+   */
+  std::span<const std::byte> section(uint32_t tag) const;
+
+  size_t size() const noexcept { return mapped_bytes_; }
+  const std::filesystem::path& path() const noexcept { return path_; }
+};
+
+}  // namespace ndyn::io
@@ -0,0 +1,166 @@
+#include "io/checkpoint.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "testing/test_temp_directory.h"
+
+namespace ndyn::io {
+
+namespace fs = std::filesystem;
+
+class CheckpointTest : public ::testing::Test {
+ protected:
+  fs::path directory_{ndyn::testing::TestTempDirectory::getInstance()->createTestSubdirectory()};
+
+  static std::vector<std::byte> read_file(const fs::path& path) {
+    std::ifstream in{path, std::ios::binary};
+    std::vector<std::byte> bytes(fs::file_size(path));
+    in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return bytes;
+  }
+
+  static void write_file(const fs::path& path, std::span<const std::byte> bytes) {
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    out.write(reinterpret_cast<const char*>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+  }
+};
+
+TEST_F(CheckpointTest, TagsAreLittleEndianCharacters) {
+  EXPECT_EQ(checkpoint_tag("ABCD"), 0x44434241u);
+  EXPECT_NE(checkpoint_tag("POSE"), checkpoint_tag("ESOP"));
+}
+
+TEST_F(CheckpointTest, RoundTripsSections) {
+  const std::vector<uint64_t> integers{1, 2, 3, 0xffffffffffffffff};
+  const std::vector<double> doubles{0.5, -1.25, 1e300};
+  const std::vector<char> odd{'a', 'b', 'c', 'd', 'e'};
+  const std::vector<std::byte> empty{};
+
+  CheckpointWriter writer{};
+  writer.add_section(checkpoint_tag("INTS"), std::span<const uint64_t>{integers});
+  writer.add_section(checkpoint_tag("ODDS"), std::span<const char>{odd});
+  writer.add_section(checkpoint_tag("DBLS"), std::span<const double>{doubles});
+  writer.add_section(checkpoint_tag("NONE"), std::span<const std::byte>{empty});
+  const fs::path path{directory_ / "sections"};
+  writer.commit(path);
+  EXPECT_FALSE(fs::exists(path.string() + ".tmp"));
+
+  const MappedCheckpoint checkpoint{path};
+  EXPECT_EQ(checkpoint.path(), path);
+  EXPECT_EQ(checkpoint.size(), fs::file_size(path));
+  EXPECT_EQ(checkpoint.size() % CHECKPOINT_SECTION_ALIGNMENT, 0u);
+
+  const auto ints{checkpoint.section(checkpoint_tag("INTS"))};
+  ASSERT_EQ(ints.size(), integers.size() * sizeof(uint64_t));
+  EXPECT_EQ(0, std::memcmp(ints.data(), integers.data(), ints.size()));
+
+  const auto odds{checkpoint.section(checkpoint_tag("ODDS"))};
+  ASSERT_EQ(odds.size(), odd.size());
+  EXPECT_EQ(0, std::memcmp(odds.data(), odd.data(), odds.size()));
+
+  // Every section starts aligned, whatever the size of the one before it.
+  const auto dbls{checkpoint.section(checkpoint_tag("DBLS"))};
+  ASSERT_EQ(dbls.size(), doubles.size() * sizeof(double));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(dbls.data()) % CHECKPOINT_SECTION_ALIGNMENT, 0u);
+  EXPECT_EQ(reinterpret_cast<const double*>(dbls.data())[2], 1e300);
+
+  EXPECT_TRUE(checkpoint.has_section(checkpoint_tag("NONE")));
+  EXPECT_TRUE(checkpoint.section(checkpoint_tag("NONE")).empty());
+  EXPECT_FALSE(checkpoint.has_section(checkpoint_tag("MISS")));
+  EXPECT_THROW(checkpoint.section(checkpoint_tag("MISS")), std::runtime_error);
+}
+
+TEST_F(CheckpointTest, RejectsDuplicateTags) {
+  const std::vector<uint32_t> values{1};
+  CheckpointWriter writer{};
+  writer.add_section(checkpoint_tag("SAME"), std::span<const uint32_t>{values});
+  EXPECT_THROW(writer.add_section(checkpoint_tag("SAME"), std::span<const uint32_t>{values}),
+               std::invalid_argument);
+}
+
+TEST_F(CheckpointTest, MappingSurvivesReplacement) {
+  const std::vector<uint32_t> first{1, 2, 3};
+  const std::vector<uint32_t> second{4, 5};
+  const fs::path path{directory_ / "replaced"};
+
+  CheckpointWriter writer{};
+  writer.add_section(checkpoint_tag("DATA"), std::span<const uint32_t>{first});
+  writer.commit(path);
+  const MappedCheckpoint old{path};
+
+  CheckpointWriter replacement{};
+  replacement.add_section(checkpoint_tag("DATA"), std::span<const uint32_t>{second});
+  replacement.commit(path);
+
+  EXPECT_EQ(old.section(checkpoint_tag("DATA")).size(), first.size() * sizeof(uint32_t));
+  EXPECT_EQ(reinterpret_cast<const uint32_t*>(old.section(checkpoint_tag("DATA")).data())[2], 3u);
+  EXPECT_EQ(MappedCheckpoint{path}.section(checkpoint_tag("DATA")).size(),
+            second.size() * sizeof(uint32_t));
+}
+
+TEST_F(CheckpointTest, MovesTheMapping) {
+  const std::vector<uint32_t> values{7};
+  const fs::path path{directory_ / "moved"};
+  CheckpointWriter writer{};
+  writer.add_section(checkpoint_tag("DATA"), std::span<const uint32_t>{values});
+  writer.commit(path);
+
+  MappedCheckpoint original{path};
+  const size_t size{original.size()};
+  MappedCheckpoint moved{std::move(original)};
+  EXPECT_EQ(moved.size(), size);
+  EXPECT_TRUE(moved.has_section(checkpoint_tag("DATA")));
+  EXPECT_EQ(original.size(), 0u);
+  EXPECT_FALSE(original.has_section(checkpoint_tag("DATA")));
+}
+
+/**
+ * The raw layout: a 24-byte header of magic, version, section count and file size, then a table of
+ * 24-byte entries of tag, reserved, offset and size.
+ */
+TEST_F(CheckpointTest, RejectsDamagedHeadersAndTables) {
+  const std::vector<uint64_t> values{1, 2, 3, 4};
+  const fs::path path{directory_ / "original"};
+  CheckpointWriter writer{};
+  writer.add_section(checkpoint_tag("DATA"), std::span<const uint64_t>{values});
+  writer.commit(path);
+  const std::vector<std::byte> original{read_file(path)};
+  ASSERT_NO_THROW(MappedCheckpoint{path});
+
+  const fs::path damaged{directory_ / "damaged"};
+  const auto expect_rejected{[&](size_t offset, auto value) {
+    std::vector<std::byte> bytes{original};
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    write_file(damaged, bytes);
+    EXPECT_THROW(MappedCheckpoint{damaged}, std::runtime_error) << "offset: " << offset;
+  }};
+
+  // The magic, version, section count and file size.
+  expect_rejected(0, 'X');
+  expect_rejected(8, uint32_t{CHECKPOINT_FORMAT_VERSION + 1});
+  expect_rejected(12, uint32_t{1000});
+  expect_rejected(16, uint64_t{original.size() + 64});
+  // A misaligned section, a section starting past the end and one running past it.
+  expect_rejected(24 + 8, uint64_t{CHECKPOINT_SECTION_ALIGNMENT + 1});
+  expect_rejected(24 + 8, uint64_t{original.size() + CHECKPOINT_SECTION_ALIGNMENT});
+  expect_rejected(24 + 16, uint64_t{original.size()});
+
+  // Truncated files, including ones too short to hold a header.
+  write_file(damaged, std::span<const std::byte>{original}.first(original.size() - 8));
+  EXPECT_THROW(MappedCheckpoint{damaged}, std::runtime_error);
+  write_file(damaged, std::span<const std::byte>{original}.first(10));
+  EXPECT_THROW(MappedCheckpoint{damaged}, std::runtime_error);
+  EXPECT_THROW(MappedCheckpoint{directory_ / "missing"}, std::runtime_error);
+}
+
+}  // namespace ndyn::io
@@ -0,0 +1,135 @@
+#include "io/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace ndyn::io {
+
+namespace {
+
+constexpr char MAGIC[8]{'N', 'D', 'Y', 'N', 'R', 'E', 'C', '\0'};
+
+// Initial storage, in bytes, reserved beyond the header the first time records are appended.
+constexpr size_t INITIAL_RESERVATION{1 << 20};
+
+struct Header final {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t record_count;
+};
+
+static_assert(sizeof(Header) <= AppendOnlyMappedFile::HEADER_SIZE);
+
+}  // namespace
+
+AppendOnlyMappedFile::AppendOnlyMappedFile(std::filesystem::path path, size_t record_size)
+    : path_{std::move(path)}, record_size_{record_size} {
+  if (record_size_ == 0 || record_size_ % 8 != 0) {
+    LOG(WARNING) << "Invalid record size. Record size: " << record_size_;
+    throw std::invalid_argument("Record size must be a positive multiple of 8 bytes.");
+  }
+
+  fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    LOG(WARNING) << "Could not open file for writing. File: '" << path_ << "'";
+    throw std::runtime_error("Could not open file for writing.");
+  }
+
+  grow_to(HEADER_SIZE + INITIAL_RESERVATION);
+  write_header();
+}
+
+AppendOnlyMappedFile::~AppendOnlyMappedFile() { close(); }
+
+AppendOnlyMappedFile::AppendOnlyMappedFile(AppendOnlyMappedFile&& rhs) noexcept
+    : path_{std::move(rhs.path_)},
+      record_size_{rhs.record_size_},
+      fd_{std::exchange(rhs.fd_, -1)},
+      mapping_{std::exchange(rhs.mapping_, nullptr)},
+      mapped_bytes_{std::exchange(rhs.mapped_bytes_, 0)},
+      record_count_{std::exchange(rhs.record_count_, 0)} {}
+
+AppendOnlyMappedFile& AppendOnlyMappedFile::operator=(AppendOnlyMappedFile&& rhs) noexcept {
+  if (this != &rhs) {
+    close();
+    path_ = std::move(rhs.path_);
+    record_size_ = rhs.record_size_;
+    fd_ = std::exchange(rhs.fd_, -1);
+    mapping_ = std::exchange(rhs.mapping_, nullptr);
+    mapped_bytes_ = std::exchange(rhs.mapped_bytes_, 0);
+    record_count_ = std::exchange(rhs.record_count_, 0);
+  }
+  return *this;
+}
+
+void AppendOnlyMappedFile::grow_to(size_t bytes) {
+  // Reserve the blocks rather than extending the file sparsely: a store through the mapping into a
+  // hole the filesystem cannot fill raises SIGBUS, where this fails with an error.
+  const int error{::posix_fallocate(fd_, static_cast<off_t>(mapped_bytes_),
+                                    static_cast<off_t>(bytes - mapped_bytes_))};
+  if (error != 0) {
+    LOG(WARNING) << "Could not extend file. File: '" << path_ << "', bytes: " << bytes
+                 << ", error: " << std::strerror(error);
+    throw std::runtime_error("Could not extend file.");
+  }
+
+  // Map the grown file before unmapping the old one, so that a failure leaves the records readable.
+  void* mapping{::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0)};
+  if (mapping == MAP_FAILED) {
+    LOG(WARNING) << "Could not map file. File: '" << path_ << "', bytes: " << bytes;
+    throw std::runtime_error("Could not map file.");
+  }
+  if (mapping_ != nullptr) {
+    ::munmap(mapping_, mapped_bytes_);
+  }
+  mapping_ = static_cast<std::byte*>(mapping);
+  mapped_bytes_ = bytes;
+}
+
+void AppendOnlyMappedFile::write_header() noexcept {
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = FORMAT_VERSION;
+  header.record_size = static_cast<uint32_t>(record_size_);
+  header.record_count = record_count_;
+  std::memcpy(mapping_, &header, sizeof(header));
+}
+
+void AppendOnlyMappedFile::append(const void* records, size_t count) {
+  const size_t required{HEADER_SIZE + (record_count_ + count) * record_size_};
+  if (required > mapped_bytes_) {
+    grow_to(std::max(required, 2 * mapped_bytes_));
+  }
+
+  std::memcpy(mapping_ + HEADER_SIZE + record_count_ * record_size_, records, count * record_size_);
+  record_count_ += count;
+  write_header();
+}
+
+void AppendOnlyMappedFile::close() noexcept {
+  if (mapping_ != nullptr) {
+    ::munmap(mapping_, mapped_bytes_);
+    mapping_ = nullptr;
+    mapped_bytes_ = 0;
+  }
+  if (fd_ >= 0) {
+    // Drop the unused reservation so that the file is exactly header plus records.
+    if (::ftruncate(fd_, static_cast<off_t>(HEADER_SIZE + record_count_ * record_size_)) != 0) {
+      LOG(WARNING) << "Could not truncate file. File: '" << path_ << "'";
+    }
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+}  // namespace ndyn::io
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace ndyn::io {
+
+/**
+ * An append-only file of fixed-size records that is read in place through a shared memory mapping.
+ *
+ * The file starts with a small header (magic, format version, record size and record count)
+ * followed by the records back to back, so record i lives at HEADER_SIZE + i * record_size() and
+ * the file can be inspected after the run without any knowledge of how it was written. The record
+ * count in the header is kept current on every append.
+ *
+ * Storage is grown geometrically and remapped as needed; the file is truncated to its exact length
+ * when closed. Pointers returned by record() are invalidated by the next append().
+ *
+ * Growing reserves the file's blocks with posix_fallocate(), so a full disk makes the append() that
+ * needs the space throw, rather than a later store through the mapping raise SIGBUS. Filesystems
+ * that allocate on every write, such as copy-on-write ones, can still fail that store.
+ */
+class AppendOnlyMappedFile final {
+ public:
+  static constexpr size_t HEADER_SIZE{64};
+  static constexpr uint32_t FORMAT_VERSION{1};
+
+ private:
+  std::filesystem::path path_;
+  size_t record_size_;
+  int fd_{-1};
+
+  std::byte* mapping_{nullptr};
+  size_t mapped_bytes_{0};
+  size_t record_count_{0};
+
+  void grow_to(size_t bytes);
+  void write_header() noexcept;
+  void close() noexcept;
+
+ public:
+  /**
+   * Creates, or truncates, the file at path. Records must be a multiple of 8 bytes so that every
+   * record in the mapping is suitably aligned for floating point payloads.
+   */
+  AppendOnlyMappedFile(std::filesystem::path path, size_t record_size);
+  ~AppendOnlyMappedFile();
+
+  AppendOnlyMappedFile(const AppendOnlyMappedFile&) = delete;
+  AppendOnlyMappedFile& operator=(const AppendOnlyMappedFile&) = delete;
+
+  AppendOnlyMappedFile(AppendOnlyMappedFile&& rhs) noexcept;
+  AppendOnlyMappedFile& operator=(AppendOnlyMappedFile&& rhs) noexcept;
+
+  /**
+   * Appends count records, each record_size() bytes, copied from records.
+   */
+  void append(const void* records, size_t count);
+
+  const std::byte* record(size_t index) const noexcept {
+    return mapping_ + HEADER_SIZE + index * record_size_;
+  }
+
+  size_t size() const noexcept { return record_count_; }
+  bool empty() const noexcept { return record_count_ == 0; }
+  size_t record_size() const noexcept { return record_size_; }
+  const std::filesystem::path& path() const noexcept { return path_; }
+};
+
+}  // namespace ndyn::io
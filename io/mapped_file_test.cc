@@ -0,0 +1,55 @@
+#include "io/mapped_file.h"
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "testing/test_temp_directory.h"
+
+namespace ndyn::io {
+
+namespace fs = std::filesystem;
+
+class AppendOnlyMappedFileTest : public ::testing::Test {
+ protected:
+  fs::path directory_{ndyn::testing::TestTempDirectory::getInstance()->createTestSubdirectory()};
+
+  // Bytes of storage the filesystem has allocated to the file, holes excluded.
+  static uint64_t allocated_bytes(const fs::path& path) {
+    struct stat status {};
+    EXPECT_EQ(::stat(path.c_str(), &status), 0);
+    return static_cast<uint64_t>(status.st_blocks) * 512;
+  }
+};
+
+/**
+ * Every byte the file is grown to is allocated, not a hole, so that stores through the mapping
+ * cannot find the disk full. The records survive each growth and remapping.
+ */
+TEST_F(AppendOnlyMappedFileTest, ReservesEveryBlockItMaps) {
+  const auto path{directory_ / "records"};
+  AppendOnlyMappedFile file{path, 64};
+  EXPECT_GE(allocated_bytes(path), fs::file_size(path));
+
+  const size_t initial_size{fs::file_size(path)};
+  std::vector<uint64_t> record(8);
+  size_t count{0};
+  while (fs::file_size(path) == initial_size) {
+    record[0] = count++;
+    file.append(record.data(), 1);
+  }
+  EXPECT_GE(allocated_bytes(path), fs::file_size(path));
+
+  ASSERT_EQ(file.size(), count);
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t value;
+    std::memcpy(&value, file.record(i), sizeof(value));
+    ASSERT_EQ(value, i);
+  }
+}
+
+}  // namespace ndyn::io
@@ -0,0 +1,600 @@
+#include "io/trajectory.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "glog/logging.h"
+#include "zlib.h"
+
+namespace ndyn::io {
+
+namespace {
+
+constexpr char MAGIC[8]{'N', 'D', 'Y', 'N', 'T', 'R', 'A', 'J'};
+constexpr char FOOTER_MAGIC[8]{'N', 'D', 'Y', 'N', 'T', 'I', 'D', 'X'};
+constexpr uint32_t FORMAT_VERSION{1};
+constexpr uint32_t CHUNK_MAGIC{0x4b4e4843};  // "CHNK"
+
+struct Header final {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  TrajectoryLayout layout;
+};
+
+struct ChunkHeader final {
+  uint32_t magic;
+  uint32_t num_frames;
+  uint64_t first_frame;
+  uint64_t num_blocks;
+};
+
+struct BlockEntry final {
+  uint64_t compressed_size;
+  uint64_t raw_size;
+};
+
+struct Footer final {
+  uint64_t index_offset;
+  uint64_t num_chunks;
+  uint64_t num_frames;
+  uint32_t version;
+  uint32_t reserved;
+  char magic[8];
+};
+
+static_assert(sizeof(TrajectoryLayout) == 64);
+static_assert(sizeof(Header) == 80);
+static_assert(sizeof(ChunkHeader) == 24);
+static_assert(sizeof(Footer) == 40);
+
+// zlib counts the bytes of a stream in a uInt, so every block, raw or deflated, must fit in one.
+constexpr uint64_t MAX_BLOCK_SIZE{std::numeric_limits<uInt>::max()};
+
+// Why a layout can be neither written nor read, or nullptr if it is valid.
+const char* check_layout(const TrajectoryLayout& layout) noexcept {
+  if (layout.num_particles == 0 || layout.record_size == 0 || layout.particles_per_block == 0 ||
+      layout.frames_per_chunk == 0) {
+    return "Trajectory layouts must have particles, records and chunks.";
+  }
+  const uint64_t largest_block{layout.block_particles(0)};
+  if (layout.record_size > MAX_BLOCK_SIZE / layout.frames_per_chunk / largest_block ||
+      compressBound(layout.frames_per_chunk * largest_block * layout.record_size) >
+          MAX_BLOCK_SIZE) {
+    return "Trajectory blocks must fit in zlib's 32-bit stream sizes.";
+  }
+  if (layout.num_particles >
+      std::numeric_limits<uint64_t>::max() / layout.frames_per_chunk / layout.record_size) {
+    return "Trajectory chunks are too large.";
+  }
+  return nullptr;
+}
+
+// Offset of a block's records within a chunk's records, which reserve frames_per_chunk frames.
+uint64_t block_offset(const TrajectoryLayout& layout, uint64_t block) noexcept {
+  return layout.frames_per_chunk * block * layout.particles_per_block * layout.record_size;
+}
+
+}  // namespace
+
+TrajectoryWriter::TrajectoryWriter(std::filesystem::path path, const TrajectoryLayout& layout,
+                                   int compression_level)
+    : path_{std::move(path)}, layout_{layout}, compression_level_{compression_level} {
+  if (const char* problem{check_layout(layout_)}; problem != nullptr) {
+    LOG(WARNING) << "Invalid trajectory layout. Particles: " << layout_.num_particles
+                 << ", record size: " << layout_.record_size
+                 << ", particles per block: " << layout_.particles_per_block
+                 << ", frames per chunk: " << layout_.frames_per_chunk;
+    throw std::invalid_argument(problem);
+  }
+
+  fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    LOG(WARNING) << "Could not open trajectory for writing. File: '" << path_ << "'";
+    throw std::runtime_error("Could not open trajectory for writing.");
+  }
+
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = FORMAT_VERSION;
+  header.layout = layout_;
+  write(&header, sizeof(header));
+
+  const size_t chunk_bytes{layout_.frames_per_chunk * layout_.frame_size()};
+  filling_.times.reserve(layout_.frames_per_chunk);
+  filling_.records.resize(chunk_bytes);
+  pending_.times.reserve(layout_.frames_per_chunk);
+  pending_.records.resize(chunk_bytes);
+  thread_ = std::thread{[this] { background_loop(); }};
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+  try {
+    close();
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Could not finish trajectory. File: '" << path_ << "', error: " << e.what();
+  }
+}
+
+void TrajectoryWriter::write(const void* data, size_t bytes) {
+  const char* next{static_cast<const char*>(data)};
+  while (bytes > 0) {
+    const ssize_t written{::write(fd_, next, bytes)};
+    if (written < 0) {
+      LOG(WARNING) << "Could not write trajectory. File: '" << path_ << "'";
+      throw std::runtime_error("Could not write trajectory.");
+    }
+    next += written;
+    bytes -= static_cast<size_t>(written);
+    file_offset_ += static_cast<uint64_t>(written);
+  }
+}
+
+void TrajectoryWriter::write_chunk(const Chunk& chunk) {
+  const uint64_t num_frames{chunk.times.size()};
+  const uint64_t num_blocks{layout_.num_blocks()};
+  std::vector<BlockEntry> blocks(num_blocks);
+
+  const auto start{std::chrono::steady_clock::now()};
+  compressed_.resize(num_blocks * compressBound(layout_.frames_per_chunk *
+                                                layout_.block_particles(0) * layout_.record_size));
+  uint64_t compressed_size{0};
+  for (uint64_t block = 0; block < num_blocks; ++block) {
+    const uint64_t raw_size{num_frames * layout_.block_particles(block) * layout_.record_size};
+    uLongf size{static_cast<uLongf>(compressed_.size() - compressed_size)};
+    const int result{compress2(reinterpret_cast<Bytef*>(compressed_.data() + compressed_size),
+                               &size,
+                               reinterpret_cast<const Bytef*>(chunk.records.data() +
+                                                              block_offset(layout_, block)),
+                               raw_size, compression_level_)};
+    if (result != Z_OK) {
+      LOG(WARNING) << "Could not compress trajectory chunk. File: '" << path_
+                   << "', zlib error: " << result;
+      throw std::runtime_error("Could not compress trajectory chunk.");
+    }
+    blocks[block] = BlockEntry{size, raw_size};
+    compressed_size += size;
+  }
+  const auto elapsed{std::chrono::steady_clock::now() - start};
+
+  index_.push_back(IndexEntry{file_offset_, chunk.first_frame, num_frames});
+  times_.insert(times_.end(), chunk.times.begin(), chunk.times.end());
+  const ChunkHeader header{CHUNK_MAGIC, static_cast<uint32_t>(num_frames), chunk.first_frame,
+                           num_blocks};
+  write(&header, sizeof(header));
+  write(blocks.data(), blocks.size() * sizeof(BlockEntry));
+  write(compressed_.data(), compressed_size);
+
+  std::lock_guard lock{mutex_};
+  ++counters_.chunks;
+  counters_.raw_bytes += num_frames * layout_.frame_size();
+  counters_.compressed_bytes += compressed_size;
+  counters_.compress_time += elapsed;
+}
+
+void TrajectoryWriter::background_loop() {
+  std::unique_lock lock{mutex_};
+  while (true) {
+    handoff_.wait(lock, [this] { return has_pending_ || stopping_; });
+    if (!has_pending_) return;
+    lock.unlock();
+    try {
+      write_chunk(pending_);
+    } catch (...) {
+      lock.lock();
+      error_ = std::current_exception();
+      has_pending_ = false;
+      handoff_.notify_all();
+      return;
+    }
+    lock.lock();
+    has_pending_ = false;
+    handoff_.notify_all();
+  }
+}
+
+void TrajectoryWriter::rethrow_error() {
+  if (error_) std::rethrow_exception(error_);
+}
+
+void TrajectoryWriter::submit() {
+  std::unique_lock lock{mutex_};
+  if (has_pending_) {
+    const auto start{std::chrono::steady_clock::now()};
+    handoff_.wait(lock, [this] { return !has_pending_; });
+    counters_.stall_time += std::chrono::steady_clock::now() - start;
+  }
+  rethrow_error();
+  std::swap(filling_, pending_);
+  has_pending_ = true;
+  handoff_.notify_all();
+  lock.unlock();
+
+  filling_.times.clear();
+  filling_.first_frame = num_frames_;
+}
+
+void TrajectoryWriter::append(double time, std::span<const std::byte> frame) {
+  if (fd_ < 0) {
+    throw std::logic_error("Trajectory is closed.");
+  }
+  if (frame.size() != layout_.frame_size()) {
+    LOG(WARNING) << "Trajectory frame has the wrong size. Bytes: " << frame.size()
+                 << ", expected: " << layout_.frame_size();
+    throw std::invalid_argument("Trajectory frames must hold one record per particle.");
+  }
+  if (num_frames_ > 0 && time < last_time_) {
+    LOG(WARNING) << "Trajectory frame time decreases. Time: " << time << ", previous: "
+                 << last_time_;
+    throw std::invalid_argument("Trajectory frame times must not decrease.");
+  }
+
+  const uint64_t frame_in_chunk{filling_.times.size()};
+  for (uint64_t block = 0; block < layout_.num_blocks(); ++block) {
+    const uint64_t block_bytes{layout_.block_particles(block) * layout_.record_size};
+    std::byte* records{filling_.records.data() + block_offset(layout_, block)};
+    std::memcpy(records + frame_in_chunk * block_bytes,
+                frame.data() + block * layout_.particles_per_block * layout_.record_size,
+                block_bytes);
+  }
+  filling_.times.push_back(time);
+  last_time_ = time;
+  ++num_frames_;
+  {
+    std::lock_guard lock{mutex_};
+    ++counters_.frames;
+  }
+  if (filling_.times.size() == layout_.frames_per_chunk) submit();
+}
+
+void TrajectoryWriter::close() {
+  if (fd_ < 0) return;
+  // The background thread must be joined however the last chunk fares.
+  std::exception_ptr error{};
+  try {
+    if (!filling_.times.empty()) submit();
+  } catch (...) {
+    error = std::current_exception();
+  }
+  {
+    std::lock_guard lock{mutex_};
+    stopping_ = true;
+  }
+  handoff_.notify_all();
+  thread_.join();
+
+  try {
+    if (error) std::rethrow_exception(error);
+    rethrow_error();
+    Footer footer{};
+    footer.index_offset = file_offset_;
+    footer.num_chunks = index_.size();
+    footer.num_frames = times_.size();
+    footer.version = FORMAT_VERSION;
+    std::memcpy(footer.magic, FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+    write(index_.data(), index_.size() * sizeof(IndexEntry));
+    write(times_.data(), times_.size() * sizeof(double));
+    write(&footer, sizeof(footer));
+  } catch (...) {
+    ::close(fd_);
+    fd_ = -1;
+    throw;
+  }
+  ::close(fd_);
+  fd_ = -1;
+}
+
+TrajectoryWriter::Counters TrajectoryWriter::counters() {
+  std::lock_guard lock{mutex_};
+  return counters_;
+}
+
+TrajectoryReader::TrajectoryReader(std::filesystem::path path) : path_{std::move(path)} {
+  const int fd{::open(path_.c_str(), O_RDONLY)};
+  if (fd < 0) {
+    LOG(WARNING) << "Could not open trajectory. File: '" << path_ << "'";
+    throw std::runtime_error("Could not open trajectory.");
+  }
+  struct stat status {};
+  if (::fstat(fd, &status) != 0 ||
+      static_cast<size_t>(status.st_size) < sizeof(Header) + sizeof(Footer)) {
+    ::close(fd);
+    LOG(WARNING) << "Trajectory is truncated. File: '" << path_ << "'";
+    throw std::runtime_error("Trajectory is truncated.");
+  }
+  const size_t bytes{static_cast<size_t>(status.st_size)};
+  void* mapping{::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0)};
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    LOG(WARNING) << "Could not map trajectory. File: '" << path_ << "'";
+    throw std::runtime_error("Could not map trajectory.");
+  }
+  mapping_ = static_cast<const std::byte*>(mapping);
+  mapped_bytes_ = bytes;
+
+  Header header{};
+  std::memcpy(&header, mapping_, sizeof(header));
+  Footer footer{};
+  std::memcpy(&footer, mapping_ + bytes - sizeof(footer), sizeof(footer));
+  const char* problem{nullptr};
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      std::memcmp(footer.magic, FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) != 0) {
+    problem = "File is not a complete trajectory.";
+  } else if (header.version != FORMAT_VERSION || footer.version != FORMAT_VERSION) {
+    problem = "Unsupported trajectory format version.";
+  } else if (check_layout(header.layout) != nullptr) {
+    problem = "Trajectory layout is corrupt.";
+  } else if (footer.index_offset + footer.num_chunks * sizeof(IndexEntry) +
+                 footer.num_frames * sizeof(double) + sizeof(Footer) !=
+             bytes) {
+    problem = "Trajectory index is corrupt.";
+  }
+  if (problem == nullptr) {
+    layout_ = header.layout;
+    index_.resize(footer.num_chunks);
+    times_.resize(footer.num_frames);
+    const std::byte* next{mapping_ + footer.index_offset};
+    std::memcpy(index_.data(), next, index_.size() * sizeof(IndexEntry));
+    std::memcpy(times_.data(), next + index_.size() * sizeof(IndexEntry),
+                times_.size() * sizeof(double));
+    for (const IndexEntry& entry : index_) {
+      if (entry.offset < sizeof(Header) || entry.offset > footer.index_offset ||
+          entry.first_frame + entry.num_frames > times_.size()) {
+        problem = "Trajectory index is corrupt.";
+        break;
+      }
+    }
+  }
+  if (problem != nullptr) {
+    close();
+    LOG(WARNING) << problem << " File: '" << path_ << "'";
+    throw std::runtime_error(problem);
+  }
+}
+
+TrajectoryReader::~TrajectoryReader() { close(); }
+
+void TrajectoryReader::close() noexcept {
+  if (mapping_ != nullptr) {
+    ::munmap(const_cast<std::byte*>(mapping_), mapped_bytes_);
+    mapping_ = nullptr;
+    mapped_bytes_ = 0;
+  }
+  index_.clear();
+  times_.clear();
+}
+
+size_t TrajectoryReader::chunk_of(uint64_t frame) const noexcept {
+  return static_cast<size_t>(std::upper_bound(index_.begin(), index_.end(), frame,
+                                              [](uint64_t frame, const IndexEntry& entry) {
+                                                return frame < entry.first_frame;
+                                              }) -
+                             index_.begin() - 1);
+}
+
+uint64_t TrajectoryReader::frame_at(double t) const noexcept {
+  const auto after{std::upper_bound(times_.begin(), times_.end(), t)};
+  return after == times_.begin() ? 0 : static_cast<uint64_t>(after - times_.begin()) - 1;
+}
+
+std::pair<uint64_t, uint64_t> TrajectoryReader::frames_between(double from,
+                                                               double to) const noexcept {
+  const auto first{std::lower_bound(times_.begin(), times_.end(), from)};
+  const auto last{std::upper_bound(first, times_.end(), to)};
+  return {static_cast<uint64_t>(first - times_.begin()), static_cast<uint64_t>(last - first)};
+}
+
+uint64_t TrajectoryReader::frames_in_chunk_from(uint64_t frame) const noexcept {
+  if (frame >= size()) return 0;
+  const IndexEntry& entry{index_[chunk_of(frame)]};
+  return entry.first_frame + entry.num_frames - frame;
+}
+
+void TrajectoryReader::will_need(uint64_t frame) const noexcept {
+  if (frame >= size()) return;
+  const size_t chunk{chunk_of(frame)};
+  const uint64_t end{chunk + 1 < index_.size() ? index_[chunk + 1].offset
+                                               : mapped_bytes_ - sizeof(Footer)};
+  // madvise() wants a page-aligned start.
+  const uint64_t page{static_cast<uint64_t>(::sysconf(_SC_PAGESIZE))};
+  const uint64_t start{index_[chunk].offset / page * page};
+  ::madvise(const_cast<std::byte*>(mapping_) + start, end - start, MADV_WILLNEED);
+}
+
+void TrajectoryReader::read(uint64_t first_frame, uint64_t num_frames, uint64_t first_particle,
+                            uint64_t num_particles, std::span<std::byte> out) const {
+  if (first_frame > size() || num_frames > size() - first_frame ||
+      first_particle > layout_.num_particles ||
+      num_particles > layout_.num_particles - first_particle ||
+      out.size() != num_frames * num_particles * layout_.record_size) {
+    LOG(WARNING) << "Invalid trajectory read. File: '" << path_ << "', frames: " << first_frame
+                 << " + " << num_frames << ", particles: " << first_particle << " + "
+                 << num_particles;
+    throw std::out_of_range("Trajectory frames or particles out of range, or output of the wrong "
+                            "size.");
+  }
+  if (num_frames == 0 || num_particles == 0) return;
+
+  const uint64_t frame_bytes{num_particles * layout_.record_size};
+  uint64_t frame{first_frame};
+  while (frame < first_frame + num_frames) {
+    const size_t chunk{chunk_of(frame)};
+    const IndexEntry& entry{index_[chunk]};
+    const uint64_t count{
+        std::min(entry.first_frame + entry.num_frames, first_frame + num_frames) - frame};
+    read_chunk(chunk, frame - entry.first_frame, count, first_particle, num_particles,
+               out.data() + (frame - first_frame) * frame_bytes);
+    frame += count;
+  }
+}
+
+void TrajectoryReader::read_chunk(size_t chunk, uint64_t first_frame, uint64_t num_frames,
+                                  uint64_t first_particle, uint64_t num_particles,
+                                  std::byte* out) const {
+  const IndexEntry& entry{index_[chunk]};
+  const uint64_t end{chunk + 1 < index_.size() ? index_[chunk + 1].offset
+                                               : mapped_bytes_ - sizeof(Footer)};
+  ChunkHeader header{};
+  bool corrupt{entry.offset + sizeof(header) > end};
+  if (!corrupt) {
+    std::memcpy(&header, mapping_ + entry.offset, sizeof(header));
+    corrupt = header.magic != CHUNK_MAGIC || header.num_blocks != layout_.num_blocks() ||
+              header.num_frames != entry.num_frames ||
+              header.num_blocks * sizeof(BlockEntry) > end - entry.offset - sizeof(header);
+  }
+  if (corrupt) {
+    LOG(WARNING) << "Trajectory chunk is corrupt. File: '" << path_ << "', chunk: " << chunk;
+    throw std::runtime_error("Trajectory chunk is corrupt.");
+  }
+
+  const uint64_t record_size{layout_.record_size};
+  const uint64_t frame_bytes{num_particles * record_size};
+  const uint64_t first_block{first_particle / layout_.particles_per_block};
+  const uint64_t last_block{(first_particle + num_particles - 1) / layout_.particles_per_block};
+  const std::byte* blocks{mapping_ + entry.offset + sizeof(header)};
+  uint64_t offset{entry.offset + sizeof(header) + header.num_blocks * sizeof(BlockEntry)};
+  std::vector<std::byte> records{};
+  for (uint64_t block = 0; block <= last_block; ++block) {
+    BlockEntry sizes{};
+    std::memcpy(&sizes, blocks + block * sizeof(BlockEntry), sizeof(sizes));
+    const uint64_t block_particles{layout_.block_particles(block)};
+    const uint64_t block_bytes{block_particles * record_size};
+    if (sizes.compressed_size > end - offset || sizes.compressed_size > MAX_BLOCK_SIZE ||
+        sizes.raw_size != entry.num_frames * block_bytes) {
+      LOG(WARNING) << "Trajectory chunk is corrupt. File: '" << path_ << "', chunk: " << chunk;
+      throw std::runtime_error("Trajectory chunk is corrupt.");
+    }
+    const uint64_t compressed_offset{offset};
+    offset += sizes.compressed_size;
+    if (block < first_block) continue;
+
+    // A block holds its particles' records frame after frame, so only the frames up to the last
+    // one requested need inflating.
+    records.resize((first_frame + num_frames) * block_bytes);
+    z_stream stream{};
+    int result{inflateInit(&stream)};
+    if (result == Z_OK) {
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(mapping_) +
+                                                compressed_offset);
+      stream.avail_in = static_cast<uInt>(sizes.compressed_size);
+      stream.next_out = reinterpret_cast<Bytef*>(records.data());
+      stream.avail_out = static_cast<uInt>(records.size());
+      do {
+        result = inflate(&stream, Z_SYNC_FLUSH);
+      } while (result == Z_OK && stream.avail_out > 0);
+      inflateEnd(&stream);
+    }
+    if (stream.avail_out != 0 || (result != Z_OK && result != Z_STREAM_END)) {
+      LOG(WARNING) << "Could not inflate trajectory chunk. File: '" << path_
+                   << "', chunk: " << chunk << ", zlib error: " << result;
+      throw std::runtime_error("Could not inflate trajectory chunk.");
+    }
+
+    const uint64_t block_first{block * layout_.particles_per_block};
+    const uint64_t from{std::max(first_particle, block_first)};
+    const uint64_t to{std::min(first_particle + num_particles, block_first + block_particles)};
+    for (uint64_t frame = 0; frame < num_frames; ++frame) {
+      std::memcpy(out + frame * frame_bytes + (from - first_particle) * record_size,
+                  records.data() + (first_frame + frame) * block_bytes +
+                      (from - block_first) * record_size,
+                  (to - from) * record_size);
+    }
+  }
+}
+
+TrajectoryPrefetcher::TrajectoryPrefetcher(const TrajectoryReader& reader, uint64_t first_particle,
+                                           uint64_t num_particles, uint64_t first_frame)
+    : reader_{&reader},
+      first_particle_{first_particle},
+      num_particles_{num_particles},
+      frame_size_{num_particles * reader.layout().record_size},
+      frame_{first_frame} {
+  if (first_particle > reader.layout().num_particles ||
+      num_particles > reader.layout().num_particles - first_particle) {
+    LOG(WARNING) << "Invalid trajectory particles. File: '" << reader.path()
+                 << "', particles: " << first_particle << " + " << num_particles;
+    throw std::out_of_range("Trajectory particles out of range.");
+  }
+  if (done()) return;
+  load(current_, frame_);
+  thread_ = std::thread{&TrajectoryPrefetcher::prefetch_loop, this};
+  request_next();
+}
+
+TrajectoryPrefetcher::~TrajectoryPrefetcher() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard lock{mutex_};
+      stopping_ = true;
+    }
+    ready_.notify_all();
+    thread_.join();
+  }
+}
+
+void TrajectoryPrefetcher::load(Batch& batch, uint64_t first_frame) const {
+  batch.first_frame = first_frame;
+  batch.num_frames = reader_->frames_in_chunk_from(first_frame);
+  batch.records.resize(batch.num_frames * frame_size_);
+  reader_->read(first_frame, batch.num_frames, first_particle_, num_particles_, batch.records);
+}
+
+void TrajectoryPrefetcher::prefetch_loop() {
+  std::unique_lock lock{mutex_};
+  while (true) {
+    ready_.wait(lock, [this]() { return next_requested_ || stopping_; });
+    if (stopping_) return;
+    next_requested_ = false;
+    Batch batch{std::move(next_)};
+    lock.unlock();
+
+    std::exception_ptr error{};
+    try {
+      reader_->will_need(batch.first_frame);
+      load(batch, batch.first_frame);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    lock.lock();
+    next_ = std::move(batch);
+    error_ = error;
+    next_ready_ = true;
+    ready_.notify_all();
+  }
+}
+
+void TrajectoryPrefetcher::request_next() {
+  const uint64_t next_frame{current_.first_frame + current_.num_frames};
+  if (next_frame >= reader_->size()) return;
+  {
+    std::lock_guard lock{mutex_};
+    next_.first_frame = next_frame;
+    next_requested_ = true;
+    next_ready_ = false;
+  }
+  ready_.notify_all();
+}
+
+void TrajectoryPrefetcher::advance() {
+  ++frame_;
+  if (done() || frame_ < current_.first_frame + current_.num_frames) return;
+  {
+    std::unique_lock lock{mutex_};
+    ready_.wait(lock, [this]() { return next_ready_; });
+    next_ready_ = false;
+    if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+    std::swap(current_, next_);
+  }
+  request_next();
+}
+
+}  // namespace ndyn::io
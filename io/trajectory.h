@@ -0,0 +1,284 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ndyn::io {
+
+/**
+ * Compressed trajectory files: a sequence of frames, each holding one fixed-size record per
+ * particle, with the time of every frame.
+ *
+ * Frames are grouped into chunks of frames_per_chunk, and within a chunk the particles into blocks
+ * of particles_per_block, each block deflated separately and holding its particles' records for
+ * every frame of the chunk. A reader therefore inflates one chunk at a time, and only the blocks
+ * with the particles it needs. zlib counts bytes in 32 bits, so a block of frames_per_chunk frames
+ * must fit in 4 GiB, deflated too; writers and readers reject layouts whose blocks do not.
+ *
+ * The file is a header with the layout, the chunks, each a small header and a table of block sizes
+ * followed by the deflated blocks, and at the end an index of the chunks' offsets and the time of
+ * every frame, located by a fixed-size footer. All integers are little-endian. The layout's
+ * encoding words are not interpreted here; they describe the records to whoever decodes them.
+ */
+struct TrajectoryLayout final {
+  uint64_t num_particles{0};
+  // Bytes per particle per frame.
+  uint64_t record_size{0};
+  uint64_t particles_per_block{4096};
+  uint32_t frames_per_chunk{16};
+  uint32_t reserved{0};
+  std::array<uint64_t, 4> encoding{};
+
+  uint64_t frame_size() const noexcept { return num_particles * record_size; }
+  uint64_t num_blocks() const noexcept {
+    return (num_particles + particles_per_block - 1) / particles_per_block;
+  }
+  uint64_t block_particles(uint64_t block) const noexcept {
+    const uint64_t first{block * particles_per_block};
+    return num_particles - first < particles_per_block ? num_particles - first
+                                                       : particles_per_block;
+  }
+};
+
+/**
+ * Writes a trajectory file, deflating and writing each full chunk on a background thread while
+ * the next is filled. append() only copies the frame into the chunk being filled; it waits only if
+ * a chunk fills before the background thread has finished the previous one.
+ */
+class TrajectoryWriter final {
+ public:
+  struct Counters final {
+    uint64_t frames{0};
+    uint64_t chunks{0};
+    uint64_t raw_bytes{0};
+    uint64_t compressed_bytes{0};
+    // Wall time append() spent waiting for the background thread, and the time the background
+    // thread spent deflating.
+    std::chrono::nanoseconds stall_time{0};
+    std::chrono::nanoseconds compress_time{0};
+  };
+
+ private:
+  struct Chunk final {
+    uint64_t first_frame{0};
+    std::vector<double> times{};
+    // The records of each block for every frame of the chunk, block after block.
+    std::vector<std::byte> records{};
+  };
+
+  struct IndexEntry final {
+    uint64_t offset;
+    uint64_t first_frame;
+    uint64_t num_frames;
+  };
+
+  std::filesystem::path path_;
+  TrajectoryLayout layout_;
+  int compression_level_;
+  int fd_{-1};
+
+  Chunk filling_{};
+  uint64_t num_frames_{0};
+  double last_time_{0};
+
+  // Handoff to the background thread, guarded by mutex_. The thread alone touches the rest of the
+  // file state below.
+  std::mutex mutex_{};
+  std::condition_variable handoff_{};
+  Chunk pending_{};
+  bool has_pending_{false};
+  bool stopping_{false};
+  std::exception_ptr error_{};
+  Counters counters_{};
+  std::thread thread_{};
+
+  uint64_t file_offset_{0};
+  std::vector<IndexEntry> index_{};
+  std::vector<double> times_{};
+  std::vector<std::byte> compressed_{};
+
+  void write(const void* data, size_t bytes);
+  void write_chunk(const Chunk& chunk);
+  void background_loop();
+  void submit();
+  void rethrow_error();
+
+ public:
+  /**
+   * Creates, or truncates, the trajectory at path. compression_level is zlib's, from 1, the
+   * fastest, to 9. Throws std::invalid_argument if the layout is empty or its blocks too large.
+   */
+  TrajectoryWriter(std::filesystem::path path, const TrajectoryLayout& layout,
+                   int compression_level = 1);
+  ~TrajectoryWriter();
+
+  TrajectoryWriter(const TrajectoryWriter&) = delete;
+  TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+  /**
+   * Appends a frame of layout().frame_size() bytes at the given time, which must not precede the
+   * previous frame's.
+   */
+  void append(double time, std::span<const std::byte> frame);
+
+  /**
+   * Writes the remaining frames and the index. Further appends are not allowed. Called by the
+   * destructor if need be, which then logs rather than throws any error.
+   */
+  void close();
+
+  const TrajectoryLayout& layout() const noexcept { return layout_; }
+  uint64_t size() const noexcept { return num_frames_; }
+  Counters counters();
+};
+
+/**
+ * Reads any frames of a trajectory file, for any range of particles, through a read-only mapping
+ * of the file.
+ *
+ * Opening copies out only the header, the index and the frame times; chunks are paged in as they
+ * are read. read() inflates only the blocks holding the requested
+ * particles, and within each block stops once past the requested frames, so the cost of a read
+ * follows what it returns rather than the size of the file. read() is const and may be called from
+ * several threads at once.
+ */
+class TrajectoryReader final {
+ private:
+  struct IndexEntry final {
+    uint64_t offset;
+    uint64_t first_frame;
+    uint64_t num_frames;
+  };
+
+  std::filesystem::path path_;
+  const std::byte* mapping_{nullptr};
+  size_t mapped_bytes_{0};
+  TrajectoryLayout layout_{};
+  std::vector<IndexEntry> index_{};
+  std::vector<double> times_{};
+
+  size_t chunk_of(uint64_t frame) const noexcept;
+  void read_chunk(size_t chunk, uint64_t first_frame, uint64_t num_frames,
+                  uint64_t first_particle, uint64_t num_particles, std::byte* out) const;
+  void close() noexcept;
+
+ public:
+  explicit TrajectoryReader(std::filesystem::path path);
+  ~TrajectoryReader();
+
+  TrajectoryReader(const TrajectoryReader&) = delete;
+  TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+  uint64_t size() const noexcept { return times_.size(); }
+  double time(uint64_t frame) const noexcept { return times_[frame]; }
+
+  /**
+   * The last frame at or before time t, or the first frame if t precedes it.
+   */
+  uint64_t frame_at(double t) const noexcept;
+
+  /**
+   * The frames with times in [from, to], as the first frame and the number of frames.
+   */
+  std::pair<uint64_t, uint64_t> frames_between(double from, double to) const noexcept;
+
+  /**
+   * Copies the records of num_particles particles from first_particle, for num_frames frames from
+   * first_frame, into out: frame after frame, each with its particles' records back to back.
+   */
+  void read(uint64_t first_frame, uint64_t num_frames, uint64_t first_particle,
+            uint64_t num_particles, std::span<std::byte> out) const;
+
+  /**
+   * Copies a frame, layout().frame_size() bytes, into out.
+   */
+  void read_frame(uint64_t frame, std::span<std::byte> out) const {
+    read(frame, 1, 0, layout_.num_particles, out);
+  }
+
+  /**
+   * The number of frames in the chunk holding frame, from frame on: how many consecutive frames
+   * one inflation of its blocks yields.
+   */
+  uint64_t frames_in_chunk_from(uint64_t frame) const noexcept;
+
+  /**
+   * Advises the kernel that the chunk holding frame will be read soon.
+   */
+  void will_need(uint64_t frame) const noexcept;
+
+  const TrajectoryLayout& layout() const noexcept { return layout_; }
+  const std::filesystem::path& path() const noexcept { return path_; }
+};
+
+/**
+ * Sequential playback of a range of particles, one frame at a time, with the next chunk inflated
+ * on a background thread while the current one is consumed, as a renderer would read a trajectory.
+ *
+ *   for (TrajectoryPrefetcher frames{reader, 0, count}; !frames.done(); frames.advance()) {
+ *     upload(frames.time(), frames.records());
+ *   }
+ */
+class TrajectoryPrefetcher final {
+ private:
+  struct Batch final {
+    uint64_t first_frame{0};
+    uint64_t num_frames{0};
+    std::vector<std::byte> records{};
+  };
+
+  const TrajectoryReader* reader_;
+  uint64_t first_particle_;
+  uint64_t num_particles_;
+  uint64_t frame_size_;
+
+  Batch current_{};
+  uint64_t frame_;
+
+  // The batch being prefetched, guarded by mutex_.
+  std::mutex mutex_{};
+  std::condition_variable ready_{};
+  Batch next_{};
+  bool next_requested_{false};
+  bool next_ready_{false};
+  bool stopping_{false};
+  std::exception_ptr error_{};
+  std::thread thread_{};
+
+  void load(Batch& batch, uint64_t first_frame) const;
+  void prefetch_loop();
+  void request_next();
+
+ public:
+  TrajectoryPrefetcher(const TrajectoryReader& reader, uint64_t first_particle,
+                       uint64_t num_particles, uint64_t first_frame = 0);
+  ~TrajectoryPrefetcher();
+
+  TrajectoryPrefetcher(const TrajectoryPrefetcher&) = delete;
+  TrajectoryPrefetcher& operator=(const TrajectoryPrefetcher&) = delete;
+
+  bool done() const noexcept { return frame_ >= reader_->size(); }
+  uint64_t frame() const noexcept { return frame_; }
+  double time() const noexcept { return reader_->time(frame_); }
+
+  /**
+   * The current frame's records for the particles, valid until the next advance().
+   */
+  std::span<const std::byte> records() const noexcept {
+    return {current_.records.data() + (frame_ - current_.first_frame) * frame_size_, frame_size_};
+  }
+
+  void advance();
+};
+
+}  // namespace ndyn::io
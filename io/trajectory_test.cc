@@ -0,0 +1,229 @@
+#include "io/trajectory.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "testing/test_temp_directory.h"
+
+namespace ndyn::io {
+
+namespace fs = std::filesystem;
+
+/**
+ * The raw layout: an 80-byte header of magic, version and reserved words, then the
+ * TrajectoryLayout, whose num_particles, record_size, particles_per_block and frames_per_chunk are
+ * at offsets 16, 24, 32 and 40. Each chunk is a 24-byte header followed by 16-byte block entries of
+ * compressed and raw size.
+ */
+class TrajectoryFileTest : public ::testing::Test {
+ protected:
+  fs::path directory_{ndyn::testing::TestTempDirectory::getInstance()->createTestSubdirectory()};
+
+  static TrajectoryLayout small_layout() {
+    TrajectoryLayout layout{};
+    layout.num_particles = 20;
+    layout.record_size = 8;
+    layout.particles_per_block = 7;
+    layout.frames_per_chunk = 3;
+    return layout;
+  }
+
+  static std::byte byte_of(size_t frame, size_t offset) {
+    return static_cast<std::byte>((frame * 31 + offset * 7) % 251);
+  }
+
+  static void write_frames(const fs::path& path, const TrajectoryLayout& layout,
+                           size_t num_frames) {
+    TrajectoryWriter writer{path, layout};
+    std::vector<std::byte> frame(layout.frame_size());
+    for (size_t f = 0; f < num_frames; ++f) {
+      for (size_t offset = 0; offset < frame.size(); ++offset) {
+        frame[offset] = byte_of(f, offset);
+      }
+      writer.append(0.5 * f, frame);
+    }
+    writer.close();
+  }
+
+  static std::vector<std::byte> read_file(const fs::path& path) {
+    std::ifstream in{path, std::ios::binary};
+    std::vector<std::byte> bytes(fs::file_size(path));
+    in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return bytes;
+  }
+
+  static void write_file(const fs::path& path, std::span<const std::byte> bytes) {
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    out.write(reinterpret_cast<const char*>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+  }
+};
+
+/**
+ * Frames split into several chunks and blocks, including a partial last chunk and block, read
+ * back byte for byte, whole, in ranges and in sequence.
+ */
+TEST_F(TrajectoryFileTest, RoundTripsAcrossChunksAndBlocks) {
+  const auto path{directory_ / "bytes"};
+  const TrajectoryLayout layout{small_layout()};
+  const size_t num_frames{10};
+  {
+    TrajectoryWriter writer{path, layout};
+    std::vector<std::byte> frame(layout.frame_size());
+    for (size_t f = 0; f < num_frames; ++f) {
+      for (size_t offset = 0; offset < frame.size(); ++offset) {
+        frame[offset] = byte_of(f, offset);
+      }
+      writer.append(0.5 * f, frame);
+    }
+    EXPECT_THROW(writer.append(0, frame), std::invalid_argument);
+    EXPECT_THROW(writer.append(10, std::span{frame}.first(8)), std::invalid_argument);
+    writer.close();
+    EXPECT_EQ(writer.counters().chunks, 4u);
+    EXPECT_THROW(writer.append(10, frame), std::logic_error);
+  }
+
+  TrajectoryReader reader{path};
+  ASSERT_EQ(reader.size(), num_frames);
+  EXPECT_EQ(reader.layout().particles_per_block, 7u);
+  std::vector<std::byte> frame(layout.frame_size());
+  for (const size_t f : {9, 0, 4, 5, 3}) {
+    reader.read_frame(f, frame);
+    EXPECT_EQ(reader.time(f), 0.5 * f);
+    for (size_t offset = 0; offset < frame.size(); ++offset) {
+      ASSERT_EQ(frame[offset], byte_of(f, offset)) << "frame: " << f << ", offset: " << offset;
+    }
+  }
+
+  // Particles 5 to 16 span three blocks; frames 2 to 7 span three chunks.
+  std::vector<std::byte> range(6 * 12 * layout.record_size);
+  reader.read(2, 6, 5, 12, range);
+  for (size_t f = 0; f < 6; ++f) {
+    for (size_t offset = 0; offset < 12 * layout.record_size; ++offset) {
+      ASSERT_EQ(range[f * 12 * layout.record_size + offset],
+                byte_of(2 + f, 5 * layout.record_size + offset))
+          << "frame: " << 2 + f << ", offset: " << offset;
+    }
+  }
+  EXPECT_THROW(reader.read(8, 3, 0, 1, std::span{range}.first(3 * layout.record_size)),
+               std::out_of_range);
+  EXPECT_THROW(reader.read(0, 1, 15, 6, std::span{range}.first(6 * layout.record_size)),
+               std::out_of_range);
+
+  size_t expected{4};
+  for (TrajectoryPrefetcher frames{reader, 19, 1, expected}; !frames.done(); frames.advance()) {
+    ASSERT_EQ(frames.frame(), expected);
+    ASSERT_EQ(frames.records().size(), layout.record_size);
+    EXPECT_EQ(frames.records()[0], byte_of(expected, 19 * layout.record_size));
+    ++expected;
+  }
+  EXPECT_EQ(expected, num_frames);
+}
+
+TEST_F(TrajectoryFileTest, SeeksByTime) {
+  const auto path{directory_ / "seek"};
+  write_frames(path, small_layout(), 10);
+
+  const TrajectoryReader reader{path};
+  EXPECT_EQ(reader.frame_at(-1), 0u);
+  EXPECT_EQ(reader.frame_at(1.25), 2u);
+  EXPECT_EQ(reader.frame_at(100), 9u);
+  EXPECT_EQ(reader.frames_between(0.75, 2.5), (std::pair<uint64_t, uint64_t>{2, 4}));
+  EXPECT_EQ(reader.frames_in_chunk_from(4), 2u);
+  EXPECT_EQ(reader.frames_in_chunk_from(9), 1u);
+}
+
+/**
+ * Writers refuse layouts without particles, records or chunks, and layouts whose blocks would not
+ * fit in zlib's 32-bit stream sizes, or whose chunks would not fit in memory at all.
+ */
+TEST_F(TrajectoryFileTest, RejectsInvalidLayouts) {
+  const auto path{directory_ / "invalid"};
+  const auto expect_rejected{[&](TrajectoryLayout layout) {
+    EXPECT_THROW((TrajectoryWriter{path, layout}), std::invalid_argument)
+        << "particles: " << layout.num_particles << ", record size: " << layout.record_size
+        << ", particles per block: " << layout.particles_per_block
+        << ", frames per chunk: " << layout.frames_per_chunk;
+  }};
+
+  TrajectoryLayout layout{small_layout()};
+  layout.num_particles = 0;
+  expect_rejected(layout);
+  layout = small_layout();
+  layout.record_size = 0;
+  expect_rejected(layout);
+  layout = small_layout();
+  layout.particles_per_block = 0;
+  expect_rejected(layout);
+  layout = small_layout();
+  layout.frames_per_chunk = 0;
+  expect_rejected(layout);
+
+  // 4096 particles of 64 KiB records over 16 frames make a 4 GiB block.
+  layout = small_layout();
+  layout.num_particles = 100000;
+  layout.particles_per_block = 4096;
+  layout.record_size = uint64_t{1} << 16;
+  layout.frames_per_chunk = 16;
+  expect_rejected(layout);
+  // The same records in blocks of one particle fit, but not a chunk of every particle.
+  layout.particles_per_block = 1;
+  layout.num_particles = uint64_t{1} << 50;
+  expect_rejected(layout);
+}
+
+/**
+ * Readers check the header's layout before trusting it: a zero particles_per_block or
+ * frames_per_chunk, or blocks too large for zlib, are corruption rather than a division by zero or
+ * a truncated inflation.
+ */
+TEST_F(TrajectoryFileTest, RejectsDamagedFiles) {
+  const auto path{directory_ / "original"};
+  write_frames(path, small_layout(), 10);
+  const std::vector<std::byte> original{read_file(path)};
+  ASSERT_NO_THROW(TrajectoryReader{path});
+
+  const fs::path damaged{directory_ / "damaged"};
+  const auto damage{[&](size_t offset, auto value) {
+    std::vector<std::byte> bytes{original};
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    write_file(damaged, bytes);
+  }};
+  const auto expect_rejected{[&](size_t offset, auto value) {
+    damage(offset, value);
+    EXPECT_THROW(TrajectoryReader{damaged}, std::runtime_error) << "offset: " << offset;
+  }};
+
+  // The magic and version.
+  expect_rejected(0, 'X');
+  expect_rejected(8, uint32_t{2});
+  // The layout: no particles, no records, no particles per block, no frames per chunk, and
+  // records too large for a block to fit in zlib's sizes.
+  expect_rejected(16, uint64_t{0});
+  expect_rejected(24, uint64_t{0});
+  expect_rejected(32, uint64_t{0});
+  expect_rejected(40, uint32_t{0});
+  expect_rejected(24, uint64_t{1} << 32);
+
+  // A block entry claiming more than zlib can take is refused when read.
+  damage(80 + 24, uint64_t{1} << 33);
+  const TrajectoryReader reader{damaged};
+  std::vector<std::byte> frame(small_layout().frame_size());
+  EXPECT_THROW(reader.read_frame(0, frame), std::runtime_error);
+
+  // Truncated files, including ones too short to hold a header and footer.
+  write_file(damaged, std::span<const std::byte>{original}.first(original.size() - 1));
+  EXPECT_THROW(TrajectoryReader{damaged}, std::runtime_error);
+  write_file(damaged, std::span<const std::byte>{original}.first(40));
+  EXPECT_THROW(TrajectoryReader{damaged}, std::runtime_error);
+  EXPECT_THROW(TrajectoryReader{directory_ / "missing"}, std::runtime_error);
+}
+
+}  // namespace ndyn::io
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <array>
 #include <cmath>
 #include <limits>
+#include <span>
+#include <stdexcept>
+#include <tuple>
 
+#include "base/bits.h"
 #include "glog/logging.h"
 #include "math/abs.h"
 #include "math/algebra.h"
@@ -65,6 +70,46 @@ class CgaGeometryType final {
     return mv.template mask_bases<NUM_PHYSICAL_DIMENSIONS, NUM_PHYSICAL_DIMENSIONS + 1>();
   }
 
+  // Bit masks of e_plus and e_minus, and the number of blades built from the Euclidean bases alone.
+  static constexpr size_t E_PLUS_BIT{1UL << NUM_PHYSICAL_DIMENSIONS};
+  static constexpr size_t E_MINUS_BIT{1UL << (NUM_PHYSICAL_DIMENSIONS + 1)};
+  static constexpr size_t NUM_EUCLIDEAN_BLADES{1UL << NUM_PHYSICAL_DIMENSIONS};
+
+  // Sign of the product of the Euclidean blades lhs and rhs, from the swaps needed to bring the
+  // product into canonical order.
+  static constexpr Scalar reordering_sign(size_t lhs, size_t rhs) noexcept {
+    size_t swaps{0};
+    for (lhs >>= 1; lhs != 0; lhs >>= 1) {
+      swaps += bit_count(lhs & rhs);
+    }
+    return swaps % 2 == 0 ? Scalar{1} : Scalar{-1};
+  }
+
+  // One term of the Euclidean part of the origin image: the product of the even Euclidean blade
+  // and the reverse of the odd one, which differ only in the given axis.
+  struct OriginImageTerm final {
+    size_t even_blade;
+    size_t odd_blade;
+    size_t axis_blade;
+    Scalar sign;
+  };
+
+  static constexpr auto ORIGIN_IMAGE_TERMS{[]() {
+    std::array<OriginImageTerm, NUM_PHYSICAL_DIMENSIONS * NUM_EUCLIDEAN_BLADES / 2> terms{};
+    size_t index{0};
+    for (size_t even_blade = 0; even_blade < NUM_EUCLIDEAN_BLADES; ++even_blade) {
+      if (bit_count(even_blade) % 2 != 0) continue;
+      for (size_t axis = 0; axis < NUM_PHYSICAL_DIMENSIONS; ++axis) {
+        const size_t odd_blade{even_blade ^ (1UL << axis)};
+        const size_t grade{bit_count(odd_blade)};
+        const Scalar reverse_sign{(grade * (grade - 1) / 2) % 2 == 0 ? Scalar{1} : Scalar{-1}};
+        terms.at(index++) = {even_blade, odd_blade, 1UL << axis,
+                             reordering_sign(even_blade, odd_blade) * reverse_sign};
+      }
+    }
+    return terms;
+  }()};
+
  public:
   /**
    * Standard weight calculation.
@@ -105,6 +150,60 @@ class CgaGeometryType final {
 
   [[nodiscard]] static constexpr auto origin() noexcept { return e_orig(); }
 
+  /**
+   * The image of the origin under a motor, motor * origin() * ~motor, computed directly from the
+   * motor coefficients rather than by two full geometric products.
+   *
+   * Each Euclidean blade E of the motor pairs with e_plus and e_minus: the even blades E and
+   * E ^ e_plus ^ e_minus act on the origin together, as do the odd blades E ^ e_plus and
+   * E ^ e_minus. Writing r and s for those sums, the image is
+   *
+   *   |r|^2 e_orig + (1/2) |s|^2 e_inf - <r ~s>_1,
+   *
+   * where the last term pairs blades that differ in one axis. This is exact for versors, including
+   * every rigid motor built from translators and rotors.
+   */
+  [[nodiscard]] static constexpr Multivector extract_origin_image(const Multivector& motor) {
+    std::array<Scalar, NUM_EUCLIDEAN_BLADES> paired{};
+    Scalar even_norm_sq{0};
+    Scalar odd_norm_sq{0};
+    for (size_t blade = 0; blade < NUM_EUCLIDEAN_BLADES; ++blade) {
+      if (bit_count(blade) % 2 == 0) {
+        const size_t conformal_blade{blade | E_PLUS_BIT | E_MINUS_BIT};
+        paired[blade] = motor.coefficient(blade) + motor.coefficient(conformal_blade);
+        even_norm_sq += paired[blade] * paired[blade];
+      } else {
+        paired[blade] =
+            motor.coefficient(blade | E_PLUS_BIT) + motor.coefficient(blade | E_MINUS_BIT);
+        odd_norm_sq += paired[blade] * paired[blade];
+      }
+    }
+
+    Multivector result{};
+    for (const OriginImageTerm& term : ORIGIN_IMAGE_TERMS) {
+      result.set_coefficient(term.axis_blade,
+                             result.coefficient(term.axis_blade) -
+                                 term.sign * paired[term.even_blade] * paired[term.odd_blade]);
+    }
+    result.set_coefficient(E_PLUS_BIT, (odd_norm_sq - even_norm_sq) / 2);
+    result.set_coefficient(E_MINUS_BIT, (odd_norm_sq + even_norm_sq) / 2);
+    return result;
+  }
+
+  /**
+   * Batched form of extract_origin_image(): images[i] receives the image of the origin under
+   * motors[i].
+   */
+  static void extract_origin_images(std::span<const Multivector> motors,
+                                    std::span<Multivector> images) {
+    if (motors.size() != images.size()) {
+      except<std::invalid_argument>("Origin image batches require one image per motor.");
+    }
+    for (size_t i = 0; i < motors.size(); ++i) {
+      images[i] = extract_origin_image(motors[i]);
+    }
+  }
+
   // Factory methods for basis vectors under the generic names.
   [[nodiscard]] static constexpr auto e1() noexcept
     requires(NUM_PHYSICAL_DIMENSIONS >= 1)
@@ -1499,5 +1598,8 @@ using Cga4dGeometry = CgaGeometryType<4, Scalar>;
 static_assert(ConformalGeometryModel<Cga2dGeometry<>>);
 static_assert(ConformalGeometryModel<Cga3dGeometry<>>);
 static_assert(ConformalGeometryModel<Cga4dGeometry<>>);
+static_assert(HasOriginImage<Cga2dGeometry<>>);
+static_assert(HasOriginImage<Cga3dGeometry<>>);
+static_assert(HasOriginImage<Cga4dGeometry<>>);
 
 }  // namespace ndyn::math
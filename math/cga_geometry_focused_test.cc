@@ -1,3 +1,6 @@
+#include <array>
+#include <span>
+
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 #include "math/canonical_basis_representation.h"
@@ -97,4 +100,68 @@ TEST(Cga2dGeometryTest, LinePhysicalPointExtraction) {
   EXPECT_TRUE(G::join(proj2, line1).near_zero()) << "line1: " << line1 << ", proj2: " << proj2;
 }
 
+/**
+ * Rigid motors composed of translators and rotors in every coordinate plane, for checking the
+ * closed-form origin image against the sandwich product.
+ */
+template <typename G>
+std::array<typename G::Multivector, 4> rigid_motors() {
+  using Scalar = typename G::Scalar;
+  using Multivector = typename G::Multivector;
+
+  std::array<Multivector, 4> motors{};
+  for (size_t m = 0; m < motors.size(); ++m) {
+    Multivector motor{Scalar{1}};
+    for (size_t i = 0; i < G::NUM_PHYSICAL_DIMENSIONS; ++i) {
+      Multivector direction{};
+      direction.set_coefficient(1UL << i, Scalar{1});
+      const Scalar displacement{static_cast<Scalar>(m + 1) - static_cast<Scalar>(i) / 2};
+      motor = motor * G::make_translator(direction, displacement);
+
+      Multivector plane{};
+      plane.set_coefficient((1UL << i) | (1UL << ((i + 1) % G::NUM_PHYSICAL_DIMENSIONS)),
+                            Scalar{1});
+      motor = motor * G::make_rotor(plane, static_cast<Scalar>(0.3 * (m + i + 1)));
+    }
+    motors.at(m) = motor;
+  }
+  return motors;
+}
+
+template <typename G>
+void expect_origin_image_matches_sandwich() {
+  using Multivector = typename G::Multivector;
+  static constexpr typename G::Scalar TOLERANCE{1e-4};
+
+  const auto motors{rigid_motors<G>()};
+  std::array<Multivector, motors.size()> images{};
+  G::extract_origin_images(std::span<const Multivector>{motors}, std::span<Multivector>{images});
+
+  for (size_t m = 0; m < motors.size(); ++m) {
+    const Multivector expected{motors.at(m) * G::origin() * ~motors.at(m)};
+    EXPECT_TRUE(G::extract_origin_image(motors.at(m)).near_equal(expected, TOLERANCE))
+        << "motor: " << motors.at(m) << ", expected: " << expected;
+    EXPECT_TRUE(images.at(m).near_equal(expected, TOLERANCE))
+        << "motor: " << motors.at(m) << ", expected: " << expected;
+  }
+
+  // A translator moves the origin to the normalized point at its displacement.
+  Multivector direction{};
+  direction.set_coefficient(0b1, 1);
+  EXPECT_TRUE(G::extract_origin_image(G::make_translator(direction, 2))
+                  .near_equal(G::make_point(2), TOLERANCE));
+}
+
+TEST(Cga2dGeometryTest, OriginImageMatchesSandwich) {
+  expect_origin_image_matches_sandwich<Cga2dGeometry<>>();
+}
+
+TEST(Cga3dGeometryTest, OriginImageMatchesSandwich) {
+  expect_origin_image_matches_sandwich<Cga3dGeometry<>>();
+}
+
+TEST(Cga4dGeometryTest, OriginImageMatchesSandwich) {
+  expect_origin_image_matches_sandwich<Cga4dGeometry<>>();
+}
+
 }  // namespace ndyn::math
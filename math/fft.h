@@ -0,0 +1,97 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <numbers>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace ndyn::math {
+
+/**
+ * Discrete Fourier transforms of a fixed power-of-two size, by the iterative radix-2 Cooley-Tukey
+ * algorithm.
+ *
+ * forward() computes X[k] = sum_j x[j] exp(-2 pi i j k / n) in place, and inverse() undoes it,
+ * including the factor of 1/n. The bit-reversal permutation and the twiddle factors are computed
+ * once, on construction, so that each transform is only the butterflies.
+ *
+ * Multidimensional transforms are the one-dimensional transform along each axis in turn.
+ */
+template <typename Scalar>
+class Fft final {
+ public:
+  using Complex = std::complex<Scalar>;
+
+ private:
+  size_t size_;
+  std::vector<size_t> reversed_{};
+  // exp(-2 pi i k / size_) for k < size_ / 2.
+  std::vector<Complex> twiddles_{};
+
+  // Spelled out so that the product skips the checks for infinities of std::complex.
+  static Complex multiply(const Complex& a, const Complex& b) noexcept {
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+  }
+
+  template <bool INVERSE>
+  void transform(std::span<Complex> data) const noexcept {
+    for (size_t i = 0; i < size_; ++i) {
+      if (i < reversed_[i]) std::swap(data[i], data[reversed_[i]]);
+    }
+    for (size_t length = 2, stride = size_ / 2; length <= size_; length *= 2, stride /= 2) {
+      const size_t half{length / 2};
+      for (size_t start = 0; start < size_; start += length) {
+        for (size_t j = 0; j < half; ++j) {
+          const Complex& twiddle{twiddles_[j * stride]};
+          const Complex v{multiply(data[start + j + half],
+                                   INVERSE ? std::conj(twiddle) : twiddle)};
+          const Complex u{data[start + j]};
+          data[start + j] = u + v;
+          data[start + j + half] = u - v;
+        }
+      }
+    }
+  }
+
+ public:
+  explicit Fft(size_t size) : size_{size} {
+    LOG_IF(FATAL, size == 0 || !std::has_single_bit(size))
+        << "Fft requires a power-of-two size, not " << size << ".";
+    const size_t bits{static_cast<size_t>(std::countr_zero(size))};
+    reversed_.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+      size_t reversed{0};
+      for (size_t bit = 0; bit < bits; ++bit) {
+        reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+      }
+      reversed_[i] = reversed;
+    }
+    twiddles_.resize(size / 2);
+    for (size_t k = 0; k < size / 2; ++k) {
+      const Scalar angle{-2 * std::numbers::pi_v<Scalar> * static_cast<Scalar>(k) /
+                         static_cast<Scalar>(size)};
+      twiddles_[k] = Complex{std::cos(angle), std::sin(angle)};
+    }
+  }
+
+  size_t size() const noexcept { return size_; }
+
+  // Both transforms require data.size() == size().
+  void forward(std::span<Complex> data) const noexcept { transform<false>(data); }
+
+  void inverse(std::span<Complex> data) const noexcept {
+    transform<true>(data);
+    const Scalar scale{1 / static_cast<Scalar>(size_)};
+    for (Complex& value : data) {
+      value *= scale;
+    }
+  }
+};
+
+}  // namespace ndyn::math
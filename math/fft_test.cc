@@ -0,0 +1,70 @@
+#include "math/fft.h"
+
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace ndyn::math {
+
+using Complex = std::complex<double>;
+
+std::vector<Complex> signal(size_t size) {
+  std::vector<Complex> result(size);
+  for (size_t i = 0; i < size; ++i) {
+    result[i] = Complex{std::sin(0.7 * i + 0.1) + 0.25 * i, std::cos(1.3 * i) - 0.5};
+  }
+  return result;
+}
+
+std::vector<Complex> naive_transform(const std::vector<Complex>& data) {
+  const size_t size{data.size()};
+  std::vector<Complex> result(size);
+  for (size_t k = 0; k < size; ++k) {
+    for (size_t j = 0; j < size; ++j) {
+      const double angle{-2 * std::numbers::pi * static_cast<double>((j * k) % size) / size};
+      result[k] += data[j] * Complex{std::cos(angle), std::sin(angle)};
+    }
+  }
+  return result;
+}
+
+TEST(FftTest, MatchesDirectTransform) {
+  for (size_t size = 1; size <= 256; size *= 2) {
+    const Fft<double> fft{size};
+    auto actual{signal(size)};
+    const auto expected{naive_transform(actual)};
+    fft.forward(actual);
+    for (size_t k = 0; k < size; ++k) {
+      EXPECT_NEAR(actual[k].real(), expected[k].real(), 1e-9 * size) << "size: " << size;
+      EXPECT_NEAR(actual[k].imag(), expected[k].imag(), 1e-9 * size) << "size: " << size;
+    }
+  }
+}
+
+TEST(FftTest, InverseUndoesForward) {
+  const Fft<double> fft{1024};
+  const auto expected{signal(1024)};
+  auto actual{expected};
+  fft.forward(actual);
+  fft.inverse(actual);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(actual[i].real(), expected[i].real(), 1e-12);
+    EXPECT_NEAR(actual[i].imag(), expected[i].imag(), 1e-12);
+  }
+}
+
+TEST(FftTest, TransformsAnImpulseToAConstant) {
+  const Fft<float> fft{16};
+  std::vector<std::complex<float>> data(16);
+  data[0] = 2;
+  fft.forward(data);
+  for (const auto& value : data) {
+    EXPECT_FLOAT_EQ(value.real(), 2);
+    EXPECT_FLOAT_EQ(value.imag(), 0);
+  }
+}
+
+}  // namespace ndyn::math
@@ -2,6 +2,7 @@
 
 #include <concepts>
 #include <cstddef>
+#include <span>
 
 namespace ndyn::math {
 
@@ -102,6 +103,18 @@ concept GeometryModel =  //
     } &&  //
     true;
 
+/**
+ * Geometries that compute the image of their origin under a motor, motor * origin() * ~motor,
+ * directly from the motor's coefficients, one motor at a time or in batches.
+ */
+template <typename G>
+concept HasOriginImage = requires(const G::Multivector& motor,
+                                  std::span<const typename G::Multivector> motors,
+                                  std::span<typename G::Multivector> images) {
+  { G::extract_origin_image(motor) } -> IsMultivectorLike<G>;
+  G::extract_origin_images(motors, images);
+};
+
 template <typename G>
 concept HasPoint =
     GeometryModel<G> &&  //
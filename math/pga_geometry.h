@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+
 #include "math/abs.h"
 #include "math/algebra.h"
 #include "math/geometry_model.h"
@@ -51,6 +55,10 @@ class PgaGrade1PointGeometry final {
   static constexpr size_t e123_coefficient{e1_coefficient | e2_coefficient | e3_coefficient};
   static constexpr size_t e0123_coefficient{e0_coefficient | e1_coefficient | e2_coefficient |
                                             e3_coefficient};
+
+ public:
+  static constexpr size_t NUM_PHYSICAL_DIMENSIONS{3};
+
   static constexpr Multivector e0() { return Multivector::template e<0>(); };
   static constexpr Multivector e1() { return Multivector::template e<1>(); };
   static constexpr Multivector e2() { return Multivector::template e<2>(); };
@@ -60,7 +68,6 @@ class PgaGrade1PointGeometry final {
   static_assert((e2() * e2()).scalar() == 1);
   static_assert((e3() * e3()).scalar() == 1);
 
- public:
   static constexpr Scalar scalar(const Multivector& mv) {
     return mv.coefficient(scalar_coefficient);
   }
@@ -69,6 +76,9 @@ class PgaGrade1PointGeometry final {
   static constexpr Scalar e1(const Multivector& mv) { return mv.coefficient(e1_coefficient); }
   static constexpr Scalar e2(const Multivector& mv) { return mv.coefficient(e2_coefficient); }
   static constexpr Scalar e3(const Multivector& mv) { return mv.coefficient(e3_coefficient); }
+  static constexpr Scalar get_e1(const Multivector& mv) { return e1(mv); }
+  static constexpr Scalar get_e2(const Multivector& mv) { return e2(mv); }
+  static constexpr Scalar get_e3(const Multivector& mv) { return e3(mv); }
 
   static constexpr Scalar e01(const Multivector& mv) { return mv.coefficient(e01_coefficient); }
   static constexpr Scalar e02(const Multivector& mv) { return mv.coefficient(e02_coefficient); }
@@ -167,6 +177,17 @@ class PgaGrade1PointGeometry final {
     return a.outer(b);
   }
 
+  /**
+   * The join of no elements is the identity of its product, the scalar, and the join of one
+   * element is that element. Longer joins fold left.
+   */
+  static constexpr Multivector join() { return Multivector{Scalar{1}}; }
+  static constexpr Multivector join(const Multivector& a) { return a; }
+  static constexpr Multivector join(const Multivector& a, const Multivector& b,
+                                   const Multivector& c) {
+    return join(join(a, b), c);
+  }
+
   /**
    * Compute the meet via the regressive product. In the grade-1 point convention, the
    * regressive product of two planes yields the line of intersection (grade-2), and the
@@ -178,6 +199,17 @@ class PgaGrade1PointGeometry final {
     return a.regress(b);
   }
 
+  /**
+   * The meet of no elements is the identity of its product, the pseudoscalar, and the meet of one
+   * element is that element. Longer meets fold left.
+   */
+  static constexpr Multivector meet() { return Multivector::pseudoscalar(); }
+  static constexpr Multivector meet(const Multivector& a) { return a; }
+  static constexpr Multivector meet(const Multivector& a, const Multivector& b,
+                                   const Multivector& c) {
+    return meet(meet(a, b), c);
+  }
+
   /**
    * Construct a rotor for rotation about the given axis line by angle radians. The axis is a
    * grade-2 bivector representing a line through the origin in the grade-1 point convention.
@@ -331,6 +363,34 @@ class PgaGrade1PointGeometry final {
     return result;
   }
 
+  /**
+   * The image of the origin under a motor, motor * e0 * ~motor, computed directly from the motor
+   * coefficients. Every term of the motor that contains e0 annihilates the origin, and the
+   * Euclidean rotor commutes with it, so the image is the origin scaled by the rotor's squared
+   * norm. Translators therefore fix the origin in this convention; see PgaGrade3PointGeometry for
+   * the convention in which they move points.
+   */
+  static constexpr Multivector extract_origin_image(const Multivector& motor) {
+    Multivector result{};
+    result.set_coefficient(e0_coefficient, scalar(motor) * scalar(motor) + e12(motor) * e12(motor) +
+                                               e13(motor) * e13(motor) + e23(motor) * e23(motor));
+    return result;
+  }
+
+  /**
+   * Batched form of extract_origin_image(): images[i] receives the image of the origin under
+   * motors[i].
+   */
+  static void extract_origin_images(std::span<const Multivector> motors,
+                                    std::span<Multivector> images) {
+    if (motors.size() != images.size()) {
+      except<std::invalid_argument>("Origin image batches require one image per motor.");
+    }
+    for (size_t i = 0; i < motors.size(); ++i) {
+      images[i] = extract_origin_image(motors[i]);
+    }
+  }
+
   /**
    * Extract Euclidean coordinates from a grade-1 point. The e0 coefficient is the homogeneous
    * weight w. Finite points have w != 0, and the Euclidean coordinates are recovered by dividing
@@ -385,6 +445,7 @@ class PgaGrade1PointGeometry final {
 };
 
 static_assert(GeometryModel<PgaGrade1PointGeometry<>>);
+static_assert(HasOriginImage<PgaGrade1PointGeometry<>>);
 
 /**
  * GeometryModel implementation for PGA (Projective Geometric Algebra, R(3,0,1)) using the
@@ -432,6 +493,10 @@ class PgaGrade3PointGeometry final {
   static constexpr size_t e123_coefficient{e1_coefficient | e2_coefficient | e3_coefficient};
   static constexpr size_t e0123_coefficient{e0_coefficient | e1_coefficient | e2_coefficient |
                                             e3_coefficient};
+
+ public:
+  static constexpr size_t NUM_PHYSICAL_DIMENSIONS{3};
+
   static constexpr Multivector e0() { return Multivector::template e<0>(); };
   static constexpr Multivector e1() { return Multivector::template e<1>(); };
   static constexpr Multivector e2() { return Multivector::template e<2>(); };
@@ -441,7 +506,6 @@ class PgaGrade3PointGeometry final {
   static_assert((e2() * e2()).scalar() == 1);
   static_assert((e3() * e3()).scalar() == 1);
 
- public:
   static constexpr Scalar scalar(const Multivector& mv) {
     return mv.coefficient(scalar_coefficient);
   }
@@ -450,6 +514,9 @@ class PgaGrade3PointGeometry final {
   static constexpr Scalar e1(const Multivector& mv) { return mv.coefficient(e1_coefficient); }
   static constexpr Scalar e2(const Multivector& mv) { return mv.coefficient(e2_coefficient); }
   static constexpr Scalar e3(const Multivector& mv) { return mv.coefficient(e3_coefficient); }
+  static constexpr Scalar get_e1(const Multivector& mv) { return e1(mv); }
+  static constexpr Scalar get_e2(const Multivector& mv) { return e2(mv); }
+  static constexpr Scalar get_e3(const Multivector& mv) { return e3(mv); }
 
   static constexpr Scalar e01(const Multivector& mv) { return mv.coefficient(e01_coefficient); }
   static constexpr Scalar e02(const Multivector& mv) { return mv.coefficient(e02_coefficient); }
@@ -557,6 +624,17 @@ class PgaGrade3PointGeometry final {
     return a.regress(b);
   }
 
+  /**
+   * The join of no elements is the identity of its product, the pseudoscalar, and the join of one
+   * element is that element. Longer joins fold left.
+   */
+  static constexpr Multivector join() { return Multivector::pseudoscalar(); }
+  static constexpr Multivector join(const Multivector& a) { return a; }
+  static constexpr Multivector join(const Multivector& a, const Multivector& b,
+                                   const Multivector& c) {
+    return join(join(a, b), c);
+  }
+
   /**
    * Compute the meet via the outer product. In the plane-based PGA convention, the outer
    * product of two grade-1 planes produces the grade-2 line of intersection, and the outer
@@ -568,6 +646,17 @@ class PgaGrade3PointGeometry final {
     return a.outer(b);
   }
 
+  /**
+   * The meet of no elements is the identity of its product, the scalar, and the meet of one
+   * element is that element. Longer meets fold left.
+   */
+  static constexpr Multivector meet() { return Multivector{Scalar{1}}; }
+  static constexpr Multivector meet(const Multivector& a) { return a; }
+  static constexpr Multivector meet(const Multivector& a, const Multivector& b,
+                                   const Multivector& c) {
+    return meet(meet(a, b), c);
+  }
+
   /**
    * Construct a rotor for rotation about the given axis line by angle radians. The axis is a
    * grade-2 bivector. The Euclidean part of the bivector (e12, e13, e23 components) defines
@@ -692,6 +781,44 @@ class PgaGrade3PointGeometry final {
     return result;
   }
 
+  /**
+   * The image of the origin under a motor, motor * e123 * ~motor, computed directly from the
+   * motor coefficients rather than by two geometric products. The weight is the squared norm of
+   * the rotor part; each coordinate pairs the rotor part with the ideal (translation) part and the
+   * pseudoscalar. The result is identical to the sandwich product for any even multivector.
+   */
+  static constexpr Multivector extract_origin_image(const Multivector& motor) {
+    const Scalar s{scalar(motor)};
+    const Scalar t1{e01(motor)};
+    const Scalar t2{e02(motor)};
+    const Scalar t3{e03(motor)};
+    const Scalar b12{e12(motor)};
+    const Scalar b13{e13(motor)};
+    const Scalar b23{e23(motor)};
+    const Scalar p{e0123(motor)};
+
+    Multivector result{};
+    result.set_coefficient(e123_coefficient, s * s + b12 * b12 + b13 * b13 + b23 * b23);
+    result.set_coefficient(e023_coefficient, 2 * (s * t1 + t2 * b12 + t3 * b13 + b23 * p));
+    result.set_coefficient(e013_coefficient, 2 * (t1 * b12 - s * t2 - t3 * b23 + b13 * p));
+    result.set_coefficient(e012_coefficient, 2 * (s * t3 - t1 * b13 - t2 * b23 + b12 * p));
+    return result;
+  }
+
+  /**
+   * Batched form of extract_origin_image(): images[i] receives the image of the origin under
+   * motors[i].
+   */
+  static void extract_origin_images(std::span<const Multivector> motors,
+                                    std::span<Multivector> images) {
+    if (motors.size() != images.size()) {
+      except<std::invalid_argument>("Origin image batches require one image per motor.");
+    }
+    for (size_t i = 0; i < motors.size(); ++i) {
+      images[i] = extract_origin_image(motors[i]);
+    }
+  }
+
   /**
    * Extract Euclidean coordinates from a grade-3 point trivector. The e123 coefficient is
    * the homogeneous weight w. The spatial coordinates are in e032, e013, e021, normalized
@@ -749,5 +876,6 @@ class PgaGrade3PointGeometry final {
 };
 
 static_assert(GeometryModel<PgaGrade3PointGeometry<>>);
+static_assert(HasOriginImage<PgaGrade3PointGeometry<>>);
 
 }  // namespace ndyn::math
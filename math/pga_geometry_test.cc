@@ -0,0 +1,63 @@
+#include "math/pga_geometry.h"
+
+#include <array>
+#include <bit>
+#include <random>
+#include <span>
+
+#include "gtest/gtest.h"
+#include "math/canonical_basis_representation.h"
+
+namespace ndyn::math {
+
+/**
+ * Random even multivectors. Motors are the unit ones, but the closed forms hold for any even
+ * element, so these also check the weight of the image.
+ */
+template <typename G>
+std::array<typename G::Multivector, 64> random_even_elements() {
+  using Scalar = typename G::Scalar;
+  using Multivector = typename G::Multivector;
+
+  std::mt19937 random{42};
+  std::uniform_real_distribution<Scalar> coefficient{-2, 2};
+  std::array<Multivector, 64> elements{};
+  for (Multivector& element : elements) {
+    for (size_t basis = 0; basis < Multivector::NUM_BASIS_BLADES; ++basis) {
+      if (std::popcount(basis) % 2 == 0) {
+        element.set_coefficient(basis, coefficient(random));
+      }
+    }
+  }
+  return elements;
+}
+
+template <typename G>
+void expect_origin_image_matches_sandwich(const typename G::Multivector& origin) {
+  using Multivector = typename G::Multivector;
+  static constexpr typename G::Scalar TOLERANCE{1e-4};
+
+  const auto motors{random_even_elements<G>()};
+  std::array<Multivector, motors.size()> images{};
+  G::extract_origin_images(std::span<const Multivector>{motors}, std::span<Multivector>{images});
+
+  for (size_t m = 0; m < motors.size(); ++m) {
+    const Multivector expected{motors.at(m) * origin * ~motors.at(m)};
+    EXPECT_TRUE(G::extract_origin_image(motors.at(m)).near_equal(expected, TOLERANCE))
+        << "motor: " << motors.at(m) << ", expected: " << expected;
+    EXPECT_TRUE(images.at(m).near_equal(expected, TOLERANCE))
+        << "motor: " << motors.at(m) << ", expected: " << expected;
+  }
+}
+
+TEST(PgaGrade1PointGeometryTest, OriginImageMatchesSandwich) {
+  using G = PgaGrade1PointGeometry<>;
+  expect_origin_image_matches_sandwich<G>(G::e0());
+}
+
+TEST(PgaGrade3PointGeometryTest, OriginImageMatchesSandwich) {
+  using G = PgaGrade3PointGeometry<>;
+  expect_origin_image_matches_sandwich<G>(G::make_point(0, 0, 0));
+}
+
+}  // namespace ndyn::math
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+
 #include "math/algebra.h"
 #include "math/geometry_model.h"
 #include "math/multivector.h"
@@ -44,6 +48,12 @@ class VgaGeometry final {
   using Multivector = Algebra::VectorType;
   using Scalar = Algebra::ScalarType;
 
+  static constexpr size_t NUM_PHYSICAL_DIMENSIONS{3};
+
+  static constexpr Multivector e1() noexcept { return Multivector::template e<0>(); }
+  static constexpr Multivector e2() noexcept { return Multivector::template e<1>(); }
+  static constexpr Multivector e3() noexcept { return Multivector::template e<2>(); }
+
   static constexpr Scalar scalar(const Multivector& mv) noexcept {
     return mv.coefficient(scalar_coefficient);
   }
@@ -57,6 +67,9 @@ class VgaGeometry final {
   static constexpr Scalar e3(const Multivector& mv) noexcept {
     return mv.coefficient(e3_coefficient);
   }
+  static constexpr Scalar get_e1(const Multivector& mv) noexcept { return e1(mv); }
+  static constexpr Scalar get_e2(const Multivector& mv) noexcept { return e2(mv); }
+  static constexpr Scalar get_e3(const Multivector& mv) noexcept { return e3(mv); }
 
   static constexpr Scalar e12(const Multivector& mv) noexcept {
     return mv.coefficient(e12_coefficient);
@@ -104,6 +117,17 @@ class VgaGeometry final {
     return a.outer(b);
   }
 
+  /**
+   * The join of no elements is the identity of its product, the scalar, and the join of one
+   * element is that element. Longer joins fold left.
+   */
+  static constexpr Multivector join() noexcept { return Multivector{Scalar{1}}; }
+  static constexpr Multivector join(const Multivector& a) noexcept { return a; }
+  static constexpr Multivector join(const Multivector& a, const Multivector& b,
+                                   const Multivector& c) noexcept {
+    return join(join(a, b), c);
+  }
+
   /**
    * Compute the meet of two elements via the regressive product. In VGA the meet recovers the
    * largest subspace contained in both operands. As with join, the absence of ideal elements
@@ -114,6 +138,17 @@ class VgaGeometry final {
     return a.regress(b);
   }
 
+  /**
+   * The meet of no elements is the identity of its product, the pseudoscalar, and the meet of one
+   * element is that element. Longer meets fold left.
+   */
+  static constexpr Multivector meet() noexcept { return Multivector::pseudoscalar(); }
+  static constexpr Multivector meet(const Multivector& a) noexcept { return a; }
+  static constexpr Multivector meet(const Multivector& a, const Multivector& b,
+                                   const Multivector& c) noexcept {
+    return meet(meet(a, b), c);
+  }
+
   /**
    * Construct a rotor representing a rotation about the given axis bivector by angle radians.
    * The axis must be a grade-2 bivector (a plane through the origin). The rotor is the
@@ -189,6 +224,28 @@ class VgaGeometry final {
     return result;
   }
 
+  /**
+   * The image of the origin under a rotor. The origin is the zero vector in VGA, and rotors about
+   * the origin fix it, so the image is always zero.
+   */
+  static constexpr Multivector extract_origin_image(const Multivector& /*rotor*/) noexcept {
+    return Multivector{};
+  }
+
+  /**
+   * Batched form of extract_origin_image(): images[i] receives the image of the origin under
+   * motors[i].
+   */
+  static void extract_origin_images(std::span<const Multivector> motors,
+                                    std::span<Multivector> images) {
+    if (motors.size() != images.size()) {
+      except<std::invalid_argument>("Origin image batches require one image per motor.");
+    }
+    for (size_t i = 0; i < motors.size(); ++i) {
+      images[i] = extract_origin_image(motors[i]);
+    }
+  }
+
   /**
    * Extract Euclidean coordinates from a multivector. In VGA there is no homogeneous
    * weight to normalize — the coefficients of e1, e2, e3 are the coordinates directly.
@@ -214,5 +271,6 @@ class VgaGeometry final {
 };
 
 static_assert(GeometryModel<VgaGeometry<>>);
+static_assert(HasOriginImage<VgaGeometry<>>);
 
 }  // namespace ndyn::math
@@ -0,0 +1,40 @@
+#include "math/vga_geometry.h"
+
+#include <array>
+#include <random>
+#include <span>
+
+#include "gtest/gtest.h"
+#include "math/canonical_basis_representation.h"
+
+namespace ndyn::math {
+
+TEST(VgaGeometryTest, OriginImageMatchesSandwich) {
+  using G = VgaGeometry<>;
+  using Scalar = G::Scalar;
+  using Multivector = G::Multivector;
+
+  std::mt19937 random{42};
+  std::uniform_real_distribution<Scalar> coefficient{-2, 2};
+  std::array<Multivector, 64> rotors{};
+  for (Multivector& rotor : rotors) {
+    const Multivector axis{coefficient(random) * G::e1() * G::e2() +
+                           coefficient(random) * G::e1() * G::e3() +
+                           coefficient(random) * G::e2() * G::e3()};
+    rotor = G::make_rotor(axis, coefficient(random));
+  }
+  std::array<Multivector, rotors.size()> images{};
+  G::extract_origin_images(std::span<const Multivector>{rotors}, std::span<Multivector>{images});
+
+  // The origin is the zero vector.
+  const Multivector origin{G::make_point(0, 0, 0)};
+  for (size_t r = 0; r < rotors.size(); ++r) {
+    const Multivector expected{rotors.at(r) * origin * ~rotors.at(r)};
+    EXPECT_TRUE(G::extract_origin_image(rotors.at(r)).near_equal(expected))
+        << "rotor: " << rotors.at(r) << ", expected: " << expected;
+    EXPECT_TRUE(images.at(r).near_equal(expected))
+        << "rotor: " << rotors.at(r) << ", expected: " << expected;
+  }
+}
+
+}  // namespace ndyn::math